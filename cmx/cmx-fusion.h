@@ -0,0 +1,518 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * CMX fusion - Integer hinge angle and mode detection
+ *
+ * The in-kernel fusion of cmx.c, kept in one header so cmxd's fixed-point
+ * path (cmxd-fixed.c) runs exactly the same arithmetic and replay-fusion
+ * can hold it against cmxd's doubles. It follows cmxd-calculations.c and
+ * cmxd-modes.c step for step, with vectors in mm/s^2 and angles in tenths
+ * of a degree (hundredths until the end).
+ *
+ * Everything is integer: the cosine comes from one square root and one
+ * division, its angle from a table of whole degrees, and thresholds on
+ * magnitudes and horizontal components are compared squared. A pair
+ * takes one square root, two near 0 or 180 degrees, and two more when
+ * gravity compensation applies.
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#ifndef CMX_FUSION_H
+#define CMX_FUSION_H
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#include <linux/math64.h>
+#include <linux/int_sqrt.h>
+#else
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef int32_t s32;
+typedef uint32_t u32;
+typedef int64_t s64;
+typedef uint64_t u64;
+
+static inline s64 div64_s64(s64 dividend, s64 divisor)
+{
+	return dividend / divisor;
+}
+
+static inline u64 div_u64(u64 dividend, u32 divisor)
+{
+	return dividend / divisor;
+}
+
+/* int_sqrt_seed[i - 64] is 16 sqrt(i + 1) rounded up, for i from 64 to 255 */
+static const uint16_t int_sqrt_seed[192] = {
+	129, 130, 131, 132, 133, 134, 135, 136, 137, 138, 139, 140,
+	141, 142, 143, 144, 144, 145, 146, 147, 148, 149, 150, 151,
+	151, 152, 153, 154, 155, 156, 156, 157, 158, 159, 160, 160,
+	161, 162, 163, 164, 164, 165, 166, 167, 168, 168, 169, 170,
+	171, 171, 172, 173, 174, 174, 175, 176, 176, 177, 178, 179,
+	179, 180, 181, 182, 182, 183, 184, 184, 185, 186, 186, 187,
+	188, 188, 189, 190, 190, 191, 192, 192, 193, 194, 194, 195,
+	196, 196, 197, 198, 198, 199, 200, 200, 201, 202, 202, 203,
+	204, 204, 205, 205, 206, 207, 207, 208, 208, 209, 210, 210,
+	211, 212, 212, 213, 213, 214, 215, 215, 216, 216, 217, 218,
+	218, 219, 219, 220, 220, 221, 222, 222, 223, 223, 224, 224,
+	225, 226, 226, 227, 227, 228, 228, 229, 230, 230, 231, 231,
+	232, 232, 233, 233, 234, 235, 235, 236, 236, 237, 237, 238,
+	238, 239, 239, 240, 240, 241, 242, 242, 243, 243, 244, 244,
+	245, 245, 246, 246, 247, 247, 248, 248, 249, 249, 250, 250,
+	251, 251, 252, 252, 253, 253, 254, 254, 255, 255, 256, 256,
+};
+
+/*
+ * The square root rounded down, as int_sqrt64() in lib/math/int_sqrt.c,
+ * for x under 2^62. That one takes a step per result bit; here the top
+ * eight bits give a root less than 1% high, and two Newton steps from
+ * above bring it to within a few units.
+ */
+static inline u32 int_sqrt64(u64 x)
+{
+	u64 y;
+	int k;
+
+	if (x < 2)
+		return x;
+	if (x < 64) {
+		for (y = 1; (y + 1) * (y + 1) <= x; y++)
+			;
+		return y;
+	}
+
+	k = (63 - __builtin_clzll(x)) / 2;
+	y = (((u64)int_sqrt_seed[(x >> (2 * k - 6)) - 64] << k) >> 7) + 1;
+	y = (y + x / y) / 2;
+	y = (y + x / y) / 2;
+	while (y * y > x)
+		y--;
+	return y;
+}
+#endif
+
+/* Modes in cmxd's order; valid_modes[] in cmx.c follows it */
+enum cmx_mode {
+	CMX_MODE_CLOSING,
+	CMX_MODE_LAPTOP,
+	CMX_MODE_FLAT,
+	CMX_MODE_TENT,
+	CMX_MODE_TABLET,
+	CMX_MODE_INDETERMINATE,
+};
+
+/* Mode boundaries (0.1 deg) and hysteresis, as in cmxd-modes.c */
+#define CMX_CLOSING_MAX		450
+#define CMX_LAPTOP_MAX		1600
+#define CMX_FLAT_MAX		2400
+#define CMX_TENT_MAX		3450
+#define CMX_HYSTERESIS		60
+#define CMX_CLOSING_HYSTERESIS	30
+#define CMX_STABILITY_SAMPLES	3
+
+/* Gravity confidence (mm/s^2) */
+#define CMX_GRAVITY_MIN		7500
+#define CMX_GRAVITY_MIN_TENT	5500
+#define CMX_GRAVITY_MAX		13000
+#define CMX_GRAVITY_TILT	20000
+
+/* Readings weaker than this (mm/s^2) give no angle */
+#define CMX_READING_MIN		1000
+
+/* Fold-back hysteresis on the cross product's Y component (mm^2/s^4) */
+#define CMX_FOLD_THRESHOLD	5000000LL
+
+/* Cosines are Q31 */
+#define CMX_COS_ONE		(1LL << 31)
+
+/* 18000 / pi, Q20: radians (Q31) to hundredths of a degree */
+#define CMX_RAD_CENTIDEG	6007897930ULL
+
+/* cos() of every whole degree from 0 to 90, Q31 */
+static const u32 cmx_cos_table[91] = {
+	2147483648, 2147156576, 2146175459, 2144540596, 2142252486, 2139311824,
+	2135719508, 2131476631, 2126584485, 2121044561, 2114858546, 2108028325,
+	2100555978, 2092443781, 2083694206, 2074309917, 2064293773, 2053648826,
+	2042378317, 2030485680, 2017974537, 2004848700, 1991112166, 1976769121,
+	1961823932, 1946281153, 1930145517, 1913421941, 1896115518, 1878231519,
+	1859775393, 1840752762, 1821169419, 1801031331, 1780344631, 1759115620,
+	1737350766, 1715056699, 1692240208, 1668908244, 1645067915, 1620726483,
+	1595891361, 1570570115, 1544770459, 1518500250, 1491767492, 1464580326,
+	1436947036, 1408876037, 1380375881, 1351455249, 1322122951, 1292387921,
+	1262259218, 1231746018, 1200857616, 1169603422, 1137992955, 1106035844,
+	1073741824, 1041120732, 1008182504, 974937175, 941394869, 907565806,
+	873460290, 839088709, 804461534, 769589312, 734482665, 699152288,
+	663608942, 627863455, 591926714, 555809667, 519523315, 483078711,
+	446486956, 409759197, 372906622, 335940456, 298871959, 261712422,
+	224473166, 187165532, 149800887, 112390610, 74946098, 37478757,
+	0,
+};
+
+/**
+ * struct cmx_pair - One base/lid sample pair and what fusion derives from it
+ * @base: Base vector, mm/s^2
+ * @lid: Lid vector, mm/s^2
+ * @base_mag2: Squared magnitude of @base
+ * @lid_mag2: Squared magnitude of @lid
+ * @cos: Cosine of the angle between the vectors, Q31 (0 without an angle)
+ * @sensor_angle: Angle between the vectors in hundredths of a degree
+ *                (0-18000), -1 if either reading is under CMX_READING_MIN
+ * @base_h2: Squared horizontal part of @base, its X/Y
+ * @lid_h2: Squared horizontal part of @lid: Y/Z while it stands upright
+ *          (sensor angle 70-110 degrees), X/Y otherwise
+ * @cross_y: Y component of base x lid, along the hinge
+ *
+ * Fill in @base and @lid, then cmx_pair_fuse() derives the rest.
+ */
+struct cmx_pair {
+	s32 base[3];
+	s32 lid[3];
+	u64 base_mag2;
+	u64 lid_mag2;
+	s64 cos;
+	int sensor_angle;
+	u64 base_h2;
+	u64 lid_h2;
+	s64 cross_y;
+};
+
+/**
+ * struct cmx_mode_filter - Mode carried from one pair to the next
+ * @mode: Stable mode, may be CMX_MODE_INDETERMINATE
+ * @candidate: Mode waiting for CMX_STABILITY_SAMPLES agreeing pairs, -1 if none
+ * @stability: Pairs agreeing with @candidate so far
+ */
+struct cmx_mode_filter {
+	int mode;
+	int candidate;
+	int stability;
+};
+
+/* cos() of a whole degree from 0 to 180, Q31 */
+static inline s64 cmx_cos_deg(int deg)
+{
+	return deg <= 90 ? (s64)cmx_cos_table[deg] : -(s64)cmx_cos_table[180 - deg];
+}
+
+/*
+ * cmx_acos - Angle from its cosine
+ * @c: Cosine, Q31
+ *
+ * Bisects the table and interpolates between whole degrees, which is good
+ * to 0.02 degrees from 10 to 170. Nearer 0 or 180 the cosine is too flat
+ * for that, so the half angle is taken from its sine, the square root of
+ * (1 - |c|) / 2.
+ *
+ * Returns: Angle in hundredths of a degree, 0 to 18000
+ */
+static inline int cmx_acos(s64 c)
+{
+	bool obtuse = c < 0;
+	int angle, lo = 10, hi = 90;
+
+	if (obtuse)
+		c = -c;
+
+	if (c >= CMX_COS_ONE) {
+		angle = 0;
+	} else if (c > cmx_cos_table[10]) {
+		/* 2 asin(s) = 2s + s^3/3 + ... radians, Q31 */
+		u64 s = int_sqrt64((u64)(CMX_COS_ONE - c) << 30);
+		u64 s3 = (((s * s) >> 31) * s) >> 31;
+		u64 rad = 2 * s + div_u64(s3, 3);
+
+		angle = (int)((rad * CMX_RAD_CENTIDEG + (1ULL << 50)) >> 51);
+	} else {
+		s64 step;
+
+		/* The table falls over 10-90; find cos(lo) >= c > cos(lo + 1) */
+		while (hi - lo > 1) {
+			int mid = (lo + hi) / 2;
+
+			if (cmx_cos_table[mid] >= c)
+				lo = mid;
+			else
+				hi = mid;
+		}
+		step = (s64)cmx_cos_table[lo] - cmx_cos_table[lo + 1];
+		angle = lo * 100 + (int)div64_s64((cmx_cos_table[lo] - c) * 100 + step / 2, step);
+	}
+
+	return obtuse ? 18000 - angle : angle;
+}
+
+/* Whether the sensor angle is within [lo, hi] whole degrees; cosines don't round */
+static inline bool cmx_pair_within(const struct cmx_pair *p, int lo, int hi)
+{
+	return p->sensor_angle >= 0 && p->cos <= cmx_cos_deg(lo) && p->cos >= cmx_cos_deg(hi);
+}
+
+/**
+ * cmx_pair_fuse - cmxd_frame_need() for everything fusion uses
+ * @p: Pair with @base and @lid filled in
+ */
+static inline void cmx_pair_fuse(struct cmx_pair *p)
+{
+	const s32 *b = p->base, *l = p->lid;
+	const u64 reading_min2 = (u64)CMX_READING_MIN * CMX_READING_MIN;
+
+	p->base_mag2 = (s64)b[0] * b[0] + (s64)b[1] * b[1] + (s64)b[2] * b[2];
+	p->lid_mag2 = (s64)l[0] * l[0] + (s64)l[1] * l[1] + (s64)l[2] * l[2];
+	p->cross_y = (s64)b[2] * l[0] - (s64)b[0] * l[2];
+	p->base_h2 = (s64)b[0] * b[0] + (s64)b[1] * b[1];
+
+	p->cos = 0;
+	p->sensor_angle = -1;
+	if (p->base_mag2 >= reading_min2 && p->lid_mag2 >= reading_min2) {
+		u64 base_mag2 = p->base_mag2, lid_mag2 = p->lid_mag2;
+		s64 dot = (s64)b[0] * l[0] + (s64)b[1] * l[1] + (s64)b[2] * l[2];
+		s64 c;
+
+		/*
+		 * One root of the product keeps near-parallel vectors accurate.
+		 * Past 2^31 (about 4.7 g) scale each square down so the product
+		 * stays under 2^62 and the dot product can take 31 more bits.
+		 */
+		while (base_mag2 >> 31) {
+			base_mag2 >>= 2;
+			dot /= 2;
+		}
+		while (lid_mag2 >> 31) {
+			lid_mag2 >>= 2;
+			dot /= 2;
+		}
+		c = div64_s64(dot * CMX_COS_ONE, int_sqrt64(base_mag2 * lid_mag2));
+		p->cos = c > CMX_COS_ONE ? CMX_COS_ONE : (c < -CMX_COS_ONE ? -CMX_COS_ONE : c);
+		p->sensor_angle = cmx_acos(p->cos);
+	}
+
+	/* Lid upright (laptop): its X carries gravity, Y/Z are the horizontal part */
+	if (cmx_pair_within(p, 70, 110))
+		p->lid_h2 = (s64)l[1] * l[1] + (s64)l[2] * l[2];
+	else
+		p->lid_h2 = (s64)l[0] * l[0] + (s64)l[1] * l[1];
+}
+
+/* Square root rounded to the nearest */
+static inline u32 cmx_root(u64 x)
+{
+	u32 r = int_sqrt64(x);
+
+	return x - (u64)r * r > r ? r + 1 : r;
+}
+
+/*
+ * cmx_pair_compensated - cmxd_frame_gravity_compensated_hinge_angle()
+ *
+ * Boosts angles in the sticky 90-110 degree zone when large horizontal
+ * components suggest the whole device is tilted rather than the hinge.
+ * Returns hundredths of a degree, -1 without an angle.
+ */
+static inline int cmx_pair_compensated(const struct cmx_pair *p)
+{
+	int angle = p->sensor_angle, excess, boost = 0;
+	u64 lid_h2 = (s64)p->lid[0] * p->lid[0] + (s64)p->lid[1] * p->lid[1];
+
+	if (!cmx_pair_within(p, 90, 110))
+		return angle;
+	if (p->base_h2 <= 6000ULL * 6000 && lid_h2 <= 8000ULL * 8000)
+		return angle;
+
+	/* 5% per m/s^2 of horizontal acceleration beyond 10, at most 30% */
+	excess = (int)(cmx_root(p->base_h2) + cmx_root(lid_h2)) - 10000;
+	if (excess > 0)
+		boost = (angle * (excess < 6000 ? excess : 6000) + 10000) / 20000;
+	if (cmx_pair_within(p, 95, 110))
+		boost += (angle - 9500) / 2;
+
+	boost = boost < 0 ? 0 : (boost > 5000 ? 5000 : boost);
+	return boost > 200 ? angle + boost : angle;
+}
+
+/**
+ * cmx_pair_angle_360 - cmxd_frame_hinge_angle_360()
+ * @p: Fused pair
+ * @folded_back: Fold-back hysteresis, stepped by this pair
+ *
+ * The cross product's Y component tells a lid folded back past flat.
+ *
+ * Returns: Hinge angle in tenths of a degree (0-3600), -1 without one
+ */
+static inline int cmx_pair_angle_360(const struct cmx_pair *p, bool *folded_back)
+{
+	int angle = cmx_pair_compensated(p);
+
+	if (angle < 0)
+		return angle;
+
+	if (*folded_back)
+		*folded_back = p->cross_y < CMX_FOLD_THRESHOLD;
+	else
+		*folded_back = p->cross_y < -CMX_FOLD_THRESHOLD;
+	if (*folded_back)
+		angle = 36000 - angle;
+
+	return (angle + 5) / 10;
+}
+
+static inline int cmx_angle_mode(int angle)
+{
+	if (angle < CMX_CLOSING_MAX)
+		return CMX_MODE_CLOSING;
+	if (angle < CMX_LAPTOP_MAX)
+		return CMX_MODE_LAPTOP;
+	if (angle < CMX_FLAT_MAX)
+		return CMX_MODE_FLAT;
+	if (angle < CMX_TENT_MAX)
+		return CMX_MODE_TENT;
+	return CMX_MODE_TABLET;
+}
+
+/* Adjacent modes only, except laptop <-> tent; anything out of indeterminate */
+static inline bool cmx_mode_transition_allowed(int from, int to)
+{
+	if (from == CMX_MODE_INDETERMINATE || (to >= from - 1 && to <= from + 1))
+		return true;
+
+	return (from == CMX_MODE_LAPTOP && to == CMX_MODE_TENT) ||
+	       (from == CMX_MODE_TENT && to == CMX_MODE_LAPTOP);
+}
+
+/* Whether the roots of @a2 and @b2 add up to less than @limit */
+static inline bool cmx_roots_below(u64 a2, u64 b2, u32 limit)
+{
+	u64 limit2 = (u64)limit * limit, rest;
+
+	if (a2 + b2 >= limit2)
+		return false;
+
+	/* (a + b)^2 < limit^2 once 2ab < limit^2 - a^2 - b^2; all under 2^60 */
+	rest = limit2 - a2 - b2;
+	return 4 * a2 * b2 < rest * rest;
+}
+
+static inline bool cmx_gravity_confident(const struct cmx_pair *p, int mode)
+{
+	const u64 max2 = (u64)CMX_GRAVITY_MAX * CMX_GRAVITY_MAX;
+	u64 min2 = (u64)CMX_GRAVITY_MIN * CMX_GRAVITY_MIN;
+	u32 tolerance;
+
+	switch (mode) {
+	case CMX_MODE_CLOSING:
+	case CMX_MODE_LAPTOP:
+		tolerance = 12000;
+		break;
+	case CMX_MODE_FLAT:
+		tolerance = 18000;
+		break;
+	case CMX_MODE_TENT:
+		/* Inverted tent reads low on the base */
+		min2 = (u64)CMX_GRAVITY_MIN_TENT * CMX_GRAVITY_MIN_TENT;
+		tolerance = 20000;
+		break;
+	case CMX_MODE_TABLET:
+		tolerance = 15000;
+		break;
+	default:
+		tolerance = CMX_GRAVITY_TILT;
+		break;
+	}
+
+	return p->base_mag2 >= min2 && p->base_mag2 <= max2 &&
+	       p->lid_mag2 >= min2 && p->lid_mag2 <= max2 &&
+	       cmx_roots_below(p->base_h2, p->lid_h2, tolerance);
+}
+
+/* cmxd_get_device_mode(): boundaries with hysteresis against the current mode */
+static inline int cmx_device_mode(int angle, int cur_mode)
+{
+	int mode = cmx_angle_mode(angle);
+	int hysteresis = CMX_HYSTERESIS;
+	static const int boundary[] = {
+		CMX_CLOSING_MAX, CMX_LAPTOP_MAX, CMX_FLAT_MAX, CMX_TENT_MAX
+	};
+
+	if (mode == cur_mode)
+		return mode;
+	if (!cmx_mode_transition_allowed(cur_mode, mode))
+		return cur_mode;
+	if (cur_mode == CMX_MODE_INDETERMINATE)
+		return mode;
+
+	if ((cur_mode == CMX_MODE_CLOSING && mode == CMX_MODE_LAPTOP) ||
+	    (cur_mode == CMX_MODE_LAPTOP && mode == CMX_MODE_CLOSING))
+		hysteresis = CMX_CLOSING_HYSTERESIS;
+
+	/* Only single steps get hysteresis, like cmxd */
+	if (mode == cur_mode + 1 && angle < boundary[cur_mode] + hysteresis)
+		return cur_mode;
+	if (mode == cur_mode - 1 && angle > boundary[mode] - hysteresis)
+		return cur_mode;
+
+	return mode;
+}
+
+static inline void cmx_mode_filter_set(struct cmx_mode_filter *f, int mode)
+{
+	f->mode = mode;
+	f->candidate = -1;
+	f->stability = 0;
+}
+
+/**
+ * cmx_mode_filter_step - cmxd_get_stable_device_mode_with_gravity()
+ * @f: Mode filter
+ * @p: Fused pair
+ * @angle: Its 0-3600 hinge angle
+ *
+ * Returns: The stable mode, which may be CMX_MODE_INDETERMINATE
+ */
+static inline int cmx_mode_filter_step(struct cmx_mode_filter *f, const struct cmx_pair *p, int angle)
+{
+	int mode;
+
+	if (cmx_gravity_confident(p, f->mode)) {
+		mode = cmx_device_mode(angle, f->mode);
+	} else if (cmx_gravity_confident(p, cmx_angle_mode(angle))) {
+		mode = cmx_device_mode(angle, f->mode);
+	} else if (!cmx_gravity_confident(p, CMX_MODE_TENT)) {
+		mode = CMX_MODE_INDETERMINATE;
+	} else {
+		mode = f->mode;
+	}
+
+	if (mode == f->mode) {
+		f->candidate = -1;
+		f->stability = 0;
+		return f->mode;
+	}
+	if (mode != f->candidate) {
+		f->candidate = mode;
+		f->stability = 1;
+		return f->mode;
+	}
+	if (++f->stability >= CMX_STABILITY_SAMPLES)
+		cmx_mode_filter_set(f, mode);
+	return f->mode;
+}
+
+/*
+ * cmx_mode_filter_resync - Mode from the first confident pair after resume
+ *
+ * The posture may have changed any amount during sleep, so the reading is
+ * taken as is, without hysteresis or the stability count. Returns -1 if
+ * the pair is not confident enough; cmx_mode_filter_step() then applies.
+ */
+static inline int cmx_mode_filter_resync(struct cmx_mode_filter *f, const struct cmx_pair *p, int angle)
+{
+	int mode = cmx_angle_mode(angle);
+
+	if (!cmx_gravity_confident(p, mode))
+		return -1;
+
+	cmx_mode_filter_set(f, mode);
+	return mode;
+}
+
+#endif /* CMX_FUSION_H */
@@ -9,7 +9,7 @@
  * interface for userspace tablet mode daemon communication.
  *
  * This driver discovers IIO accelerometer devices created by the
- * serial-multi-instantiate driver and exposes their paths via sysfs
+ * serial-multi-instantiate driver and exposes their names via sysfs
  * for use by the userspace daemon (cmxd) which performs the actual
  * accelerometer data processing and tablet mode detection.
  *
@@ -25,6 +25,37 @@
 #include <linux/dmi.h>
 #include <linux/input.h>
 #include <linux/kobject.h>
+#include <linux/version.h>
+#include <linux/build_bug.h>
+#include <linux/miscdevice.h>
+#include <linux/fs.h>
+#include <linux/poll.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/wait.h>
+#include <linux/bitmap.h>
+#include <linux/bitops.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <linux/i2c.h>
+#include <linux/notifier.h>
+#include <linux/seqlock.h>
+#include <linux/atomic.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/hrtimer.h>
+#include <linux/pm.h>
+#include <linux/iio/iio.h>
+#include <linux/iio/buffer.h>
+#include <linux/iio/buffer_impl.h>
+#include <linux/iio/triggered_buffer.h>
+#include <linux/iio/consumer.h>
+#include <linux/iio/trigger.h>
+#include <linux/iio/types.h>
+
+#include "cmx-fusion.h"
 
 #define CMX_DRIVER_NAME "cmx"
 
@@ -37,21 +68,41 @@ static const char * const valid_orientations[] = {
 	"portrait", "landscape", "portrait-flipped", "landscape-flipped", NULL
 };
 
-/* IIO device names for accelerometers */
-#define LID_IIO_DEVICE_NAME  "iio:device0"
-#define BASE_IIO_DEVICE_NAME "iio:device1"
+/* valid_orientations[] indices */
+enum cmx_orientation {
+	CMX_ORIENTATION_PORTRAIT,
+	CMX_ORIENTATION_LANDSCAPE,
+	CMX_ORIENTATION_PORTRAIT_FLIPPED,
+	CMX_ORIENTATION_LANDSCAPE_FLIPPED,
+};
+
+/*
+ * serial-multi-instantiate names the accelerometer clients of the MDA6655
+ * ACPI node "i2c-MDA6655:NN-mxc4005.<instance>"; instance 0 is the lid
+ * sensor and instance 1 the base sensor.
+ */
+#define CMX_SMI_CLIENT_PREFIX	"i2c-MDA6655:"
+#define CMX_SMI_CLIENT_TYPE	"mxc4005"
+#define CMX_SMI_LID		0
+#define CMX_SMI_BASE		1
 
 /**
  * struct cmx - Driver context structure
  * @pdev: Platform device
  * @base_iio_device: Base IIO device name for userspace daemon
  * @lid_iio_device: Lid IIO device name for userspace daemon
- * @lock: Synchronization mutex
+ * @base_i2c: Base sensor I2C identity, "i2c-<bus>:0x<addr>"
+ * @lid_i2c: Lid sensor I2C identity
+ * @iio_nb: IIO bus notifier that keeps the names current
+ * @lock: Protects the device names
  */
 struct cmx {
 	struct platform_device *pdev;
 	char base_iio_device[64];
 	char lid_iio_device[64];
+	char base_i2c[32];
+	char lid_i2c[32];
+	struct notifier_block iio_nb;
 	struct mutex lock;
 };
 
@@ -71,6 +122,43 @@ MODULE_ALIAS("platform:" CMX_DRIVER_NAME);
 /* Ensure serial_multi_instantiate loads before this driver */
 MODULE_SOFTDEP("pre: serial_multi_instantiate");
 
+/* Binary state record accepted by the "state" attribute */
+#define CMX_STATE_VERSION	2
+#define CMX_STATE_KEEP		0xff
+#define CMX_ANGLE_UNKNOWN	(-1)
+
+/**
+ * struct cmx_state - Combined per-sample update from the userspace daemon
+ * @version: CMX_STATE_VERSION
+ * @seq: Daemon sequence number, echoed back on read
+ * @timestamp: Timestamp of the sample the update was fused from (ns)
+ * @base: Base gravity vector in micro-g (x, y, z)
+ * @lid: Lid gravity vector in micro-g (x, y, z)
+ * @mode: Index into valid_modes, or CMX_STATE_KEEP
+ * @orientation: Index into valid_orientations, or CMX_STATE_KEEP
+ * @angle: Hinge angle in 0.1 degrees (0-3600), or CMX_ANGLE_UNKNOWN.
+ *         Version 2 only; version 1 records leave the angle unchanged
+ * @reserved: Must be zero
+ *
+ * Replaces four text writes (base_vec, lid_vec, mode, orientation) with a
+ * single binary write that is applied under one lock. Native byte order;
+ * the daemon keeps an identical definition. Accepted by the "state"
+ * attribute and by /dev/cmx, which also returns it from read(). Version 1
+ * records, where @angle was still reserved, are accepted too.
+ */
+struct cmx_state {
+	__u32 version;
+	__u32 seq;
+	__u64 timestamp;
+	__s32 base[3];
+	__s32 lid[3];
+	__u8 mode;
+	__u8 orientation;
+	__s16 angle;
+	__u8 reserved[4];
+};
+static_assert(sizeof(struct cmx_state) == 48);
+
 /**
  * struct vec3 - 3D accelerometer vector in micro-g units
  * @x: X-axis acceleration in micro-g
@@ -88,27 +176,131 @@ struct vec3 {
  * These maintain current state for communication with userspace via sysfs.
  */
 
-/* Input device for SW_TABLET_MODE events */
+/* Input device for SW_TABLET_MODE events and the hinge axes */
 static struct input_dev *tm_input;
 
-/* Protects global state variables */  
-static DEFINE_MUTEX(tm_lock);
+/* Axes next to SW_TABLET_MODE; evdev has no codes of its own for these */
+#define CMX_ABS_ANGLE		ABS_MISC	/* Hinge angle, 0.1 degrees */
+#define CMX_ABS_MODE		(ABS_MISC + 1)	/* Index into valid_modes */
+#define CMX_ABS_ANGLE_FUZZ	5		/* Sensor noise, half a degree */
 
-/* Current gravity vector from base accelerometer (micro-g) */
-static struct vec3 g_base = { 0, 0, 1000000 };
+/**
+ * struct cmx_shared - State exchanged with userspace and the fusion work
+ * @base: Gravity vector from the base accelerometer (micro-g)
+ * @lid: Gravity vector from the lid accelerometer (micro-g)
+ * @mode: Index into valid_modes
+ * @orientation: Index into valid_orientations
+ * @angle: Hinge angle in 0.1 degrees, CMX_ANGLE_UNKNOWN if not reported
+ * @seq: Sequence number of the last update. Text attribute writes advance
+ *       it too, so /dev/cmx readers see them
+ * @timestamp: Sample timestamp of the last state record (ns)
+ * @base_ns: ktime_get_ns() of the last write to @base
+ * @lid_ns: Same for @lid
+ * @mode_ns: Same for @mode
+ * @orientation_ns: Same for @orientation
+ * @stale: CMX_STALE_* vectors not refreshed since the last resume; while
+ *         any is set, SW_TABLET_MODE is held at its pre-suspend value
+ * @resume_seq: Resumes from system sleep since load
+ */
+struct cmx_shared {
+	struct vec3 base;
+	struct vec3 lid;
+	u8 mode;
+	u8 orientation;
+	s16 angle;
+	u32 seq;
+	u64 timestamp;
+	u64 base_ns;
+	u64 lid_ns;
+	u64 mode_ns;
+	u64 orientation_ns;
+	u8 stale;
+	u32 resume_seq;
+};
 
-/* Current gravity vector from lid accelerometer (micro-g) */
-static struct vec3 g_lid = { 0, 0, -1000000 };
+#define CMX_STALE_BASE		BIT(0)
+#define CMX_STALE_LID		BIT(1)
+#define CMX_STALE_ALL		(CMX_STALE_BASE | CMX_STALE_LID)
 
-/* Current device mode string */
-static char current_mode[16] = "laptop";
+/*
+ * Writers serialize on state_lock; readers copy the struct with
+ * cmx_shared_read() and retry if a write raced them, so a reader never
+ * holds up the daemon's writes.
+ */
+static DEFINE_SEQLOCK(state_lock);
+static struct cmx_shared shared = {
+	.base = { 0, 0, 1000000 },
+	.lid = { 0, 0, -1000000 },
+	.mode = CMX_MODE_LAPTOP,
+	.orientation = CMX_ORIENTATION_LANDSCAPE,
+	.angle = CMX_ANGLE_UNKNOWN,
+};
+
+/* /dev/cmx readers waiting for shared.seq to move */
+static DECLARE_WAIT_QUEUE_HEAD(state_wait);
+
+/* Where a state update came from, for the debugfs counters */
+enum cmx_source {
+	CMX_SRC_BASE_VEC,
+	CMX_SRC_LID_VEC,
+	CMX_SRC_MODE,
+	CMX_SRC_ORIENTATION,
+	CMX_SRC_STATE,
+	CMX_SRC_FUSION,
+	CMX_SRC_COUNT,
+};
 
-/* Current device orientation string */
-static char current_orientation[32] = "landscape";
+static const char * const cmx_source_names[CMX_SRC_COUNT] = {
+	"base_vec", "lid_vec", "mode", "orientation", "state", "fusion"
+};
+
+/* Interval histogram: bucket i < 2^i ms, the last one everything longer */
+#define CMX_INTERVAL_BUCKETS	12
+
+/**
+ * struct cmx_stats - Counters behind the debugfs files
+ * @updates: Accepted updates per source (under state_lock)
+ * @intervals: Time between consecutive updates (under state_lock)
+ * @last_ns: ktime_get_ns() of the last update, 0 if none (under state_lock)
+ * @since_ns: Start of the counting period (load or last reset)
+ * @parse_errors: Writes rejected as malformed
+ * @ignored: Writes dropped because in-kernel fusion owns the field
+ * @toggles: SW_TABLET_MODE events reported
+ */
+static struct cmx_stats {
+	u64 updates[CMX_SRC_COUNT];
+	u64 intervals[CMX_INTERVAL_BUCKETS];
+	u64 last_ns;
+	u64 since_ns;
+	atomic64_t parse_errors;
+	atomic64_t ignored;
+	atomic64_t toggles;
+} stats;
+
+/* debugfs directory, NULL (or an error pointer) without debugfs */
+static struct dentry *cmx_debugfs;
 
 /* Enable/disable SW_TABLET_MODE input events */
 static bool enable_events = true;
 
+/* Compute the hinge angle and mode in the driver instead of cmxd */
+static bool kernel_fusion;
+module_param(kernel_fusion, bool, 0444);
+MODULE_PARM_DESC(kernel_fusion,
+		 "Detect mode from the accelerometer buffers in the driver; userspace vector and mode writes are then ignored (default: off)");
+
+/* Pace the accelerometers with a trigger of our own */
+static bool sampling_trigger = true;
+module_param(sampling_trigger, bool, 0444);
+MODULE_PARM_DESC(sampling_trigger,
+		 "Register an hrtimer IIO trigger and make it the accelerometers' current trigger (default: on)");
+
+/* Stop that trigger while the lid switch reports closed */
+static bool lid_pause = true;
+module_param(lid_pause, bool, 0444);
+MODULE_PARM_DESC(lid_pause,
+		 "Pause sampling while the lid is closed, unless folded back into tent/tablet (default: on)");
+
 /* Global driver context */
 static struct cmx *g_chip;
 
@@ -153,61 +345,1385 @@ static void notify_tablet_mode_change(bool is_tablet)
 	
 	input_report_switch(tm_input, SW_TABLET_MODE, is_tablet ? 1 : 0);
 	input_sync(tm_input);
+	atomic64_inc(&stats.toggles);
 	
 	pr_info(CMX_DRIVER_NAME ": Tablet mode %s\n", is_tablet ? "ENABLED" : "DISABLED");
 }
 
+/* cmx_shared_read - Take a consistent copy of the shared state */
+static void cmx_shared_read(struct cmx_shared *snap)
+{
+	unsigned int seq;
+
+	do {
+		seq = read_seqbegin(&state_lock);
+		*snap = shared;
+	} while (read_seqretry(&state_lock, seq));
+}
+
+/*
+ * cmx_stats_account - Count an update and the interval since the last one
+ * @src: Where the update came from
+ * @now: ktime_get_ns() of the update
+ *
+ * Called inside write_seqlock(&state_lock).
+ */
+static void cmx_stats_account(enum cmx_source src, u64 now)
+{
+	u64 ms;
+
+	lockdep_assert_held(&state_lock.lock);
+
+	stats.updates[src]++;
+	if (stats.last_ns) {
+		ms = div_u64(now - stats.last_ns, NSEC_PER_MSEC);
+		stats.intervals[ms ? min(fls64(ms), CMX_INTERVAL_BUCKETS - 1) : 0]++;
+	}
+	stats.last_ns = now;
+}
+
+/*
+ * cmx_state_advance - Account for a state update and move the sequence
+ * @src: Where the update came from
+ * @now: ktime_get_ns() of the update
+ *
+ * Called inside write_seqlock(&state_lock); readers are woken once it is
+ * dropped.
+ */
+static void cmx_state_advance(enum cmx_source src, u64 now)
+{
+	cmx_stats_account(src, now);
+	shared.seq++;
+}
+
+/*
+ * Fired after every state update so the hinge IIO device can capture it.
+ * hinge_lock keeps the poll from racing teardown and serializes the nested
+ * trigger handler between writers.
+ */
+static struct iio_trigger *hinge_trig;
+static DEFINE_MUTEX(hinge_lock);
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 4, 0)
+#define iio_trigger_poll_nested iio_trigger_poll_chained
+#endif
+
+/*
+ * cmx_report_axes - Report the hinge angle and mode axes of tm_input
+ *
+ * The input core drops values that did not change, and angle jitter
+ * within the fuzz, so calling this on every update only wakes evdev
+ * readers when something moved. Held back with SW_TABLET_MODE while the
+ * vectors are stale after resume.
+ */
+static void cmx_report_axes(void)
+{
+	struct cmx_shared snap;
+
+	if (!tm_input)
+		return;
+
+	cmx_shared_read(&snap);
+	if (snap.stale)
+		return;
+
+	input_report_abs(tm_input, CMX_ABS_ANGLE, snap.angle);
+	input_report_abs(tm_input, CMX_ABS_MODE, snap.mode);
+	input_sync(tm_input);
+}
+
 /*
- * is_tablet_mode - Check if mode string represents tablet mode
- * @mode: Mode string to check  
+ * cmx_state_published - Pass an update on to /dev/cmx readers, the input
+ * axes and the hinge trigger; after write_sequnlock()
+ */
+static void cmx_state_published(void)
+{
+	wake_up_interruptible(&state_wait);
+	cmx_report_axes();
+
+	mutex_lock(&hinge_lock);
+	if (hinge_trig)
+		iio_trigger_poll_nested(hinge_trig);
+	mutex_unlock(&hinge_lock);
+}
+
+/*
+ * notify_state_change - Tell sysfs pollers and udev about a new mode/orientation
+ * @mode_changed: The mode differs from its previous value
+ * @orientation_changed: The orientation differs from its previous value
+ *
+ * Wakes poll(POLLPRI) waiters on the changed attributes and sends a
+ * KOBJ_CHANGE uevent carrying CMX_MODE= and CMX_ORIENTATION=. Must be
+ * called outside write_seqlock(&state_lock).
+ */
+static void notify_state_change(bool mode_changed, bool orientation_changed)
+{
+	char mode_env[32], orientation_env[48];
+	char *envp[] = { mode_env, orientation_env, NULL };
+	struct cmx_shared snap;
+	struct kobject *kobj;
+
+	if (!mode_changed && !orientation_changed)
+		return;
+	if (!g_chip || !g_chip->pdev)
+		return;
+	kobj = &g_chip->pdev->dev.kobj;
+
+	cmx_shared_read(&snap);
+	snprintf(mode_env, sizeof(mode_env), "CMX_MODE=%s", valid_modes[snap.mode]);
+	snprintf(orientation_env, sizeof(orientation_env), "CMX_ORIENTATION=%s",
+		 valid_orientations[snap.orientation]);
+
+	if (mode_changed)
+		sysfs_notify(kobj, NULL, "mode");
+	if (orientation_changed)
+		sysfs_notify(kobj, NULL, "orientation");
+
+	kobject_uevent_env(kobj, KOBJ_CHANGE, envp);
+}
+
+/*
+ * is_tablet_mode - Check if a mode index represents tablet mode
+ * @mode: Index into valid_modes
  *
  * Returns: true if mode is "tablet" or "tent", false otherwise
  */
-static bool is_tablet_mode(const char *mode)
+static bool is_tablet_mode(int mode)
+{
+	return mode == CMX_MODE_TABLET || mode == CMX_MODE_TENT;
+}
+
+/*
+ * cmx_sync_tablet_mode - Bring SW_TABLET_MODE in line with the published mode
+ * @mode: Mode the caller published
+ * @stale: The vectors have not been refreshed since resume
+ *
+ * Held back while @stale, so a mode worked out from samples taken before
+ * suspend is never reported; the update that refreshes the vectors then
+ * reports whatever mode is current.
+ */
+static void cmx_sync_tablet_mode(int mode, bool stale)
+{
+	bool is_tablet = is_tablet_mode(mode);
+
+	if (stale || !tm_input)
+		return;
+	if (is_tablet != !!test_bit(SW_TABLET_MODE, tm_input->sw))
+		notify_tablet_mode_change(is_tablet);
+}
+
+/*
+ * In-kernel fusion (kernel_fusion=1)
+ *
+ * Attaches a buffer of our own to each accelerometer next to cmxd's, so
+ * every scan the trigger produces is also handed to the driver, and runs
+ * the daemon's hinge angle and mode detection on it in integer arithmetic.
+ * Mode changes drive SW_TABLET_MODE directly; cmxd, if running, keeps
+ * publishing orientation and D-Bus/socket events. Vectors are in mm/s^2,
+ * angles in tenths of a degree; constants mirror cmxd-calculations.c and
+ * cmxd-modes.c.
+ *
+ * The buffers only produce data once a trigger is attached to the
+ * accelerometers (normally the driver's own, see "Sampling trigger"
+ * below), so attaching is retried once a second until both are running.
+ */
+
+/* Standard gravity in mm/s^2, for micro-g conversion */
+#define CMX_STANDARD_GRAVITY	9807
+
+#define CMX_ACCEL_BASE	0
+#define CMX_ACCEL_LID	1
+
+/**
+ * struct cmx_accel - Driver-side buffer on one accelerometer
+ * @buffer: Buffer attached to the IIO device alongside any others
+ * @dev: Reference to the IIO device, from bus_find_device_by_name()
+ * @indio_dev: The IIO device
+ * @axis: X, Y and Z channels
+ * @offset: Byte offset of each axis in a scan demuxed to our mask
+ * @scale_nano: Scale in nano-m/s^2 per LSB
+ * @sample: Newest sample, mm/s^2 (under fusion.lock)
+ * @fresh: @sample has not been fused yet (under fusion.lock)
+ * @attached: @buffer is active
+ * @stale: The device behind this sensor went away or changed
+ */
+struct cmx_accel {
+	struct iio_buffer buffer;
+	struct device *dev;
+	struct iio_dev *indio_dev;
+	const struct iio_chan_spec *axis[3];
+	unsigned int offset[3];
+	s64 scale_nano;
+	struct vec3 sample;
+	bool fresh;
+	bool attached;
+	bool stale;
+};
+
+/**
+ * struct cmx_fusion - In-kernel fusion state
+ * @accel: Base and lid buffers
+ * @lock: Protects the accel samples, taken from the buffer push path
+ * @work: Fuses a base/lid sample pair
+ * @attach_work: Retries attaching the buffers
+ * @folded_back: Fold-back hysteresis state for the 0-360 degree angle
+ * @filter: Stable mode and the candidate waiting to replace it
+ * @angle: Last hinge angle (0.1 deg), -1 if unreliable
+ * @resync: No confident pair since resume; the next one sets the mode
+ *          outright (under @lock)
+ * @started: Work items are set up; device changes may queue @attach_work
+ */
+struct cmx_fusion {
+	struct cmx_accel accel[2];
+	spinlock_t lock;
+	struct work_struct work;
+	struct delayed_work attach_work;
+	bool folded_back;
+	struct cmx_mode_filter filter;
+	int angle;
+	bool resync;
+	bool started;
+};
+
+static struct cmx_fusion fusion;
+
+static s32 cmx_micro_g(s32 mm_s2)
+{
+	return (s32)div_s64((s64)mm_s2 * 1000000, CMX_STANDARD_GRAVITY);
+}
+
+/*
+ * cmx_fusion_work - Fuse the newest base/lid pair and publish the result
+ *
+ * Mirrors process_sensor_pair() in cmxd through cmx-fusion.h: hinge
+ * angle, gravity confidence from magnitudes and horizontal components,
+ * then the stable mode. An indeterminate mode leaves the published mode
+ * alone.
+ */
+static void cmx_fusion_work(struct work_struct *work)
+{
+	struct vec3 base, lid;
+	struct cmx_pair pair;
+	int angle, mode, published;
+	bool resync, mode_changed = false;
+	unsigned long flags;
+	u64 now;
+
+	spin_lock_irqsave(&fusion.lock, flags);
+	base = fusion.accel[CMX_ACCEL_BASE].sample;
+	lid = fusion.accel[CMX_ACCEL_LID].sample;
+	fusion.accel[CMX_ACCEL_BASE].fresh = false;
+	fusion.accel[CMX_ACCEL_LID].fresh = false;
+	resync = fusion.resync;
+	spin_unlock_irqrestore(&fusion.lock, flags);
+
+	pair = (struct cmx_pair){
+		.base = { base.x, base.y, base.z },
+		.lid = { lid.x, lid.y, lid.z },
+	};
+	cmx_pair_fuse(&pair);
+	angle = cmx_pair_angle_360(&pair, &fusion.folded_back);
+	fusion.angle = angle;
+
+	mode = resync && angle >= 0 ? cmx_mode_filter_resync(&fusion.filter, &pair, angle) : -1;
+	if (mode >= 0) {
+		spin_lock_irqsave(&fusion.lock, flags);
+		fusion.resync = false;
+		spin_unlock_irqrestore(&fusion.lock, flags);
+	} else {
+		mode = angle >= 0 ? cmx_mode_filter_step(&fusion.filter, &pair, angle) : CMX_MODE_LAPTOP;
+	}
+
+	now = ktime_get_ns();
+	write_seqlock(&state_lock);
+	shared.base = (struct vec3){ cmx_micro_g(base.x), cmx_micro_g(base.y), cmx_micro_g(base.z) };
+	shared.lid = (struct vec3){ cmx_micro_g(lid.x), cmx_micro_g(lid.y), cmx_micro_g(lid.z) };
+	shared.timestamp = now;
+	shared.base_ns = now;
+	shared.lid_ns = now;
+	shared.angle = angle;
+	shared.stale = 0;
+
+	if (mode != CMX_MODE_INDETERMINATE && shared.mode != mode) {
+		shared.mode = mode;
+		shared.mode_ns = now;
+		mode_changed = true;
+	}
+	published = shared.mode;
+	cmx_state_advance(CMX_SRC_FUSION, now);
+	write_sequnlock(&state_lock);
+	cmx_state_published();
+
+	cmx_sync_tablet_mode(published, false);
+
+	if (mode_changed) {
+		pr_debug(CMX_DRIVER_NAME ": fusion: angle %d.%d, mode %s\n",
+			 angle / 10, angle % 10, valid_modes[mode]);
+		notify_state_change(true, false);
+	}
+}
+
+/* Decode one channel of a scan according to its scan_type */
+static s32 cmx_scan_value(const struct iio_chan_spec *chan, const u8 *p)
+{
+	const struct iio_scan_type *st = &chan->scan_type;
+	u32 v;
+
+	switch (st->storagebits) {
+	case 8:
+		v = *p;
+		break;
+	case 16: {
+		u16 raw;
+
+		memcpy(&raw, p, sizeof(raw));
+		if (st->endianness == IIO_BE)
+			v = be16_to_cpu((__force __be16)raw);
+		else if (st->endianness == IIO_LE)
+			v = le16_to_cpu((__force __le16)raw);
+		else
+			v = raw;
+		break;
+	}
+	default: {
+		u32 raw;
+
+		memcpy(&raw, p, sizeof(raw));
+		if (st->endianness == IIO_BE)
+			v = be32_to_cpu((__force __be32)raw);
+		else if (st->endianness == IIO_LE)
+			v = le32_to_cpu((__force __le32)raw);
+		else
+			v = raw;
+		break;
+	}
+	}
+
+	v >>= st->shift;
+	if (st->sign == 's')
+		return sign_extend32(v, st->realbits - 1);
+	return st->realbits < 32 ? v & GENMASK(st->realbits - 1, 0) : v;
+}
+
+/* Buffer push path; may run in interrupt context */
+static int cmx_accel_store_to(struct iio_buffer *buffer, const void *data)
+{
+	struct cmx_accel *a = container_of(buffer, struct cmx_accel, buffer);
+	s32 mm[3];
+	bool ready;
+	unsigned long flags;
+
+	for (int i = 0; i < 3; i++)
+		mm[i] = (s32)div_s64(cmx_scan_value(a->axis[i], (const u8 *)data + a->offset[i]) *
+				     a->scale_nano, 1000000);
+
+	spin_lock_irqsave(&fusion.lock, flags);
+	a->sample = (struct vec3){ mm[0], mm[1], mm[2] };
+	a->fresh = true;
+	ready = fusion.accel[CMX_ACCEL_BASE].fresh && fusion.accel[CMX_ACCEL_LID].fresh;
+	spin_unlock_irqrestore(&fusion.lock, flags);
+
+	if (ready)
+		schedule_work(&fusion.work);
+
+	return 0;
+}
+
+/* The buffer itself is static; only the scan mask is ours to free */
+static void cmx_accel_release(struct iio_buffer *buffer)
+{
+	bitmap_free(buffer->scan_mask);
+	buffer->scan_mask = NULL;
+}
+
+static const struct iio_buffer_access_funcs cmx_accel_access = {
+	.store_to = cmx_accel_store_to,
+	.release = cmx_accel_release,
+	.modes = INDIO_BUFFER_SOFTWARE | INDIO_BUFFER_TRIGGERED,
+};
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 11, 0)
+#define cmx_masklength(indio_dev) iio_get_masklength(indio_dev)
+#else
+#define cmx_masklength(indio_dev) ((indio_dev)->masklength)
+#endif
+
+/*
+ * cmx_accel_bind - Find an accelerometer and describe its X/Y/Z scan
+ * @a: Buffer to fill in
+ * @name: IIO device name, e.g. "iio:device0"
+ *
+ * Returns: 0 on success, negative error code on failure
+ */
+static int cmx_accel_bind(struct cmx_accel *a, const char *name)
+{
+	struct iio_channel chan = { };
+	unsigned int offset = 0;
+	int order[3] = { 0, 1, 2 };
+	int val, val2, type;
+
+	a->dev = bus_find_device_by_name(&iio_bus_type, NULL, name);
+	if (!a->dev)
+		return -ENODEV;
+	a->indio_dev = dev_to_iio_dev(a->dev);
+
+	if (!(a->indio_dev->modes & INDIO_BUFFER_TRIGGERED))
+		goto err_put;
+
+	for (int i = 0; i < a->indio_dev->num_channels; i++) {
+		const struct iio_chan_spec *ch = &a->indio_dev->channels[i];
+
+		if (ch->type != IIO_ACCEL || !ch->modified || ch->scan_index < 0)
+			continue;
+		if (ch->channel2 >= IIO_MOD_X && ch->channel2 <= IIO_MOD_Z)
+			a->axis[ch->channel2 - IIO_MOD_X] = ch;
+	}
+	if (!a->axis[0] || !a->axis[1] || !a->axis[2])
+		goto err_put;
+
+	/* Our scan holds only X, Y and Z, packed in scan_index order */
+	for (int i = 0; i < 3; i++) {
+		for (int j = i + 1; j < 3; j++) {
+			if (a->axis[order[j]]->scan_index < a->axis[order[i]]->scan_index)
+				swap(order[i], order[j]);
+		}
+	}
+	for (int i = 0; i < 3; i++) {
+		unsigned int bytes = a->axis[order[i]]->scan_type.storagebits / 8;
+
+		offset = ALIGN(offset, bytes);
+		a->offset[order[i]] = offset;
+		offset += bytes;
+	}
+
+	chan.indio_dev = a->indio_dev;
+	chan.channel = a->axis[0];
+	type = iio_read_channel_scale(&chan, &val, &val2);
+	switch (type) {
+	case IIO_VAL_INT:
+		a->scale_nano = (s64)val * NSEC_PER_SEC;
+		break;
+	case IIO_VAL_INT_PLUS_MICRO:
+		a->scale_nano = (s64)val * NSEC_PER_SEC + (s64)val2 * 1000;
+		break;
+	case IIO_VAL_INT_PLUS_NANO:
+		a->scale_nano = (s64)val * NSEC_PER_SEC + val2;
+		break;
+	case IIO_VAL_FRACTIONAL:
+		a->scale_nano = div_s64((s64)val * NSEC_PER_SEC, val2);
+		break;
+	case IIO_VAL_FRACTIONAL_LOG2:
+		a->scale_nano = ((s64)val * NSEC_PER_SEC) >> val2;
+		break;
+	default:
+		goto err_put;
+	}
+
+	return 0;
+
+err_put:
+	put_device(a->dev);
+	a->dev = NULL;
+	a->indio_dev = NULL;
+	return -EINVAL;
+}
+
+/* cmx_accel_attach - Start our buffer once the accelerometer has a trigger */
+static int cmx_accel_attach(struct cmx_accel *a)
+{
+	int ret;
+
+	if (!a->indio_dev->trig)
+		return -EAGAIN;
+
+	a->buffer.scan_mask = bitmap_zalloc(cmx_masklength(a->indio_dev), GFP_KERNEL);
+	if (!a->buffer.scan_mask)
+		return -ENOMEM;
+	for (int i = 0; i < 3; i++)
+		set_bit(a->axis[i]->scan_index, a->buffer.scan_mask);
+
+	iio_buffer_init(&a->buffer);
+	a->buffer.access = &cmx_accel_access;
+
+	ret = iio_update_buffers(a->indio_dev, &a->buffer, NULL);
+	if (ret) {
+		iio_buffer_put(&a->buffer);
+		return ret;
+	}
+
+	a->attached = true;
+	return 0;
+}
+
+static void cmx_accel_detach(struct cmx_accel *a)
+{
+	if (a->attached) {
+		iio_update_buffers(a->indio_dev, NULL, &a->buffer);
+		iio_buffer_put(&a->buffer);
+		a->attached = false;
+	}
+	if (a->dev) {
+		put_device(a->dev);
+		a->dev = NULL;
+		a->indio_dev = NULL;
+	}
+}
+
+static bool cmx_fusion_running(void)
+{
+	return READ_ONCE(fusion.accel[CMX_ACCEL_BASE].attached) &&
+	       READ_ONCE(fusion.accel[CMX_ACCEL_LID].attached);
+}
+
+static void cmx_fusion_attach_work(struct work_struct *work)
+{
+	char names[2][64];
+	int ret;
+
+	mutex_lock(&g_chip->lock);
+	strscpy(names[CMX_ACCEL_BASE], g_chip->base_iio_device, sizeof(names[0]));
+	strscpy(names[CMX_ACCEL_LID], g_chip->lid_iio_device, sizeof(names[0]));
+	mutex_unlock(&g_chip->lock);
+
+	for (int i = 0; i < 2; i++) {
+		struct cmx_accel *a = &fusion.accel[i];
+
+		if (READ_ONCE(a->stale)) {
+			WRITE_ONCE(a->stale, false);
+			cmx_accel_detach(a);
+		}
+		if (a->attached || !names[i][0])
+			continue;
+		if (!a->dev) {
+			ret = cmx_accel_bind(a, names[i]);
+			if (ret) {
+				pr_debug(CMX_DRIVER_NAME ": fusion: %s not usable: %d\n", names[i], ret);
+				continue;
+			}
+		}
+		ret = cmx_accel_attach(a);
+		if (ret && ret != -EAGAIN)
+			pr_warn(CMX_DRIVER_NAME ": fusion: failed to attach to %s: %d\n", names[i], ret);
+	}
+
+	if (cmx_fusion_running())
+		pr_info(CMX_DRIVER_NAME ": In-kernel fusion running\n");
+	else
+		schedule_delayed_work(&fusion.attach_work, HZ);
+}
+
+/* cmx_fusion_start - Begin attaching to the accelerometers */
+static void cmx_fusion_start(void)
+{
+	spin_lock_init(&fusion.lock);
+	INIT_WORK(&fusion.work, cmx_fusion_work);
+	INIT_DELAYED_WORK(&fusion.attach_work, cmx_fusion_attach_work);
+	cmx_mode_filter_set(&fusion.filter, CMX_MODE_LAPTOP);
+	fusion.angle = -1;
+	WRITE_ONCE(fusion.started, true);
+
+	schedule_delayed_work(&fusion.attach_work, 0);
+}
+
+/*
+ * cmx_fusion_rebind - Drop a sensor whose IIO device changed and find it again
+ * @which: CMX_ACCEL_BASE or CMX_ACCEL_LID
+ */
+static void cmx_fusion_rebind(int which)
+{
+	if (!READ_ONCE(fusion.started))
+		return;
+
+	WRITE_ONCE(fusion.accel[which].stale, true);
+	mod_delayed_work(system_wq, &fusion.attach_work, 0);
+}
+
+/* cmx_fusion_stop - Detach from the accelerometers and drain pending work */
+static void cmx_fusion_stop(void)
+{
+	WRITE_ONCE(fusion.started, false);
+	cancel_delayed_work_sync(&fusion.attach_work);
+	for (int i = 0; i < 2; i++)
+		cmx_accel_detach(&fusion.accel[i]);
+	cancel_work_sync(&fusion.work);
+}
+
+/*
+ * cmx_fusion_quiesce - Forget the samples taken before suspend
+ *
+ * The next pair fused is made of scans taken after resume, and its mode
+ * replaces the stable one outright.
+ */
+static void cmx_fusion_quiesce(void)
+{
+	unsigned long flags;
+
+	if (!READ_ONCE(fusion.started))
+		return;
+
+	spin_lock_irqsave(&fusion.lock, flags);
+	fusion.accel[CMX_ACCEL_BASE].fresh = false;
+	fusion.accel[CMX_ACCEL_LID].fresh = false;
+	fusion.resync = true;
+	spin_unlock_irqrestore(&fusion.lock, flags);
+	cancel_work_sync(&fusion.work);
+}
+
+/*
+ * Sampling trigger (sampling_trigger=1)
+ *
+ * An hrtimer-paced IIO trigger named "cmx" that the driver makes the
+ * current trigger of both accelerometers as they appear. Their buffers
+ * then produce scans as soon as anyone (cmxd, in-kernel fusion) enables
+ * them, without iio-trig-sysfs or configfs and without a userspace write
+ * per sample. The rate is the trigger's sampling_frequency attribute.
+ *
+ * The timer runs only while a buffer is attached to the trigger and the
+ * driver has not paused it: during system suspend, and while the lid
+ * switch reports closed (unless the last mode is tent or tablet, where
+ * the hall sensor can see the magnet through the back of the lid).
+ *
+ * Only an accelerometer without a trigger is bound. One that has a trigger
+ * got it from its driver (mxc4005's data-ready trigger, when it has an
+ * interrupt) or from userspace through trigger/current_trigger, and either
+ * choice is kept; unbinding puts back the empty trigger the device had.
+ * Binding takes the same lock as a current_trigger write and, like that
+ * write, is refused while the device has a buffer enabled. That is not
+ * retried on a timer: binding is looked at again when an accelerometer
+ * appears and when the last buffer on the trigger is disabled. A bound
+ * accelerometer holds a reference on the trigger and with it on this
+ * module, so the binding is dropped on remove, and the module can only be
+ * unloaded once the accelerometers' current_trigger no longer names it.
+ */
+#define CMX_SAMPLER_NAME	CMX_DRIVER_NAME
+#define CMX_SAMPLER_DEFAULT_HZ	10	/* cmxd's default sampling rate */
+#define CMX_SAMPLER_MAX_HZ	1000
+
+/* The IIO device lock, held through a direct mode claim */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 15, 0)
+#define cmx_claim_direct(indio_dev)	(iio_device_claim_direct(indio_dev) ? 0 : -EBUSY)
+#define cmx_release_direct(indio_dev)	iio_device_release_direct(indio_dev)
+#else
+#define cmx_claim_direct(indio_dev)	iio_device_claim_direct_mode(indio_dev)
+#define cmx_release_direct(indio_dev)	iio_device_release_direct_mode(indio_dev)
+#endif
+
+/* Reasons the driver holds the timer off */
+#define CMX_PAUSE_SUSPEND	BIT(0)
+#define CMX_PAUSE_LID		BIT(1)
+#define CMX_PAUSE_REMOVED	BIT(2)
+
+/**
+ * struct cmx_sampler - Driver-owned sampling trigger
+ * @trig: The IIO trigger, NULL when not registered
+ * @timer: Fires the trigger every @period
+ * @period: Sampling period
+ * @frequency: Sampling frequency (Hz)
+ * @lock: Protects @period, @frequency, @enabled and @paused and orders
+ *        timer starts against cancels; taken from input event context
+ * @enabled: At least one buffer is attached (set_trigger_state)
+ * @paused: CMX_PAUSE_* bits; any set bit stops the timer
+ * @bind_work: Binds the trigger to accelerometers that have none yet
+ * @binding: Accelerometers that appear get bound (@bind_work may be queued)
+ * @lid_handler_registered: cmx_lid_handler is registered
+ */
+static struct cmx_sampler {
+	struct iio_trigger *trig;
+	struct hrtimer timer;
+	ktime_t period;
+	unsigned int frequency;
+	spinlock_t lock;
+	bool enabled;
+	unsigned long paused;
+	struct delayed_work bind_work;
+	bool binding;
+	bool lid_handler_registered;
+} sampler = {
+	.lock = __SPIN_LOCK_UNLOCKED(sampler.lock),
+};
+
+static enum hrtimer_restart cmx_sampler_fire(struct hrtimer *timer)
+{
+	/* A stop can miss a callback that is already running */
+	if (!READ_ONCE(sampler.enabled) || READ_ONCE(sampler.paused))
+		return HRTIMER_NORESTART;
+
+	hrtimer_forward_now(timer, sampler.period);
+	iio_trigger_poll(sampler.trig);
+	return HRTIMER_RESTART;
+}
+
+/*
+ * cmx_sampler_update - Start or stop the timer to match the state; under lock
+ * @delay: Time to the first event if the timer starts
+ */
+static void cmx_sampler_update(ktime_t delay)
+{
+	lockdep_assert_held(&sampler.lock);
+
+	if (!sampler.trig)
+		return;
+	if (sampler.enabled && !sampler.paused)
+		hrtimer_start(&sampler.timer, delay, HRTIMER_MODE_REL_HARD);
+	else
+		hrtimer_try_to_cancel(&sampler.timer);
+}
+
+/*
+ * cmx_sampler_pause - Hold the timer off for a reason, or release it
+ * @reason: CMX_PAUSE_* bit
+ * @pause: Set (true) or clear (false) @reason
+ *
+ * Safe from atomic context.
+ */
+static void cmx_sampler_pause(unsigned long reason, bool pause)
+{
+	unsigned long flags, old;
+	bool changed;
+
+	spin_lock_irqsave(&sampler.lock, flags);
+	old = sampler.paused;
+	WRITE_ONCE(sampler.paused, pause ? old | reason : old & ~reason);
+	changed = !old != !sampler.paused;
+	/* What was paused is out of date: sample at once on release */
+	if (changed)
+		cmx_sampler_update(0);
+	spin_unlock_irqrestore(&sampler.lock, flags);
+
+	if (changed)
+		pr_debug(CMX_DRIVER_NAME ": sampling %s\n", pause ? "paused" : "resumed");
+}
+
+/* cmx_sampler_rebind - Bind the trigger to accelerometers that may now take it */
+static void cmx_sampler_rebind(void)
+{
+	if (READ_ONCE(sampler.binding))
+		mod_delayed_work(system_wq, &sampler.bind_work, 0);
+}
+
+static int cmx_sampler_set_state(struct iio_trigger *trig, bool state)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&sampler.lock, flags);
+	WRITE_ONCE(sampler.enabled, state);
+	cmx_sampler_update(sampler.period);
+	spin_unlock_irqrestore(&sampler.lock, flags);
+
+	/* A bind refused while a buffer was enabled may go through now */
+	if (!state)
+		cmx_sampler_rebind();
+
+	return 0;
+}
+
+static const struct iio_trigger_ops cmx_sampler_ops = {
+	.set_trigger_state = cmx_sampler_set_state,
+};
+
+static ssize_t sampling_frequency_show(struct device *dev, struct device_attribute *attr,
+				       char *buf)
+{
+	return sysfs_emit(buf, "%u\n", READ_ONCE(sampler.frequency));
+}
+
+static ssize_t sampling_frequency_store(struct device *dev, struct device_attribute *attr,
+					const char *buf, size_t len)
+{
+	unsigned long flags;
+	unsigned int hz;
+	int ret;
+
+	ret = kstrtouint(buf, 10, &hz);
+	if (ret)
+		return ret;
+	if (!hz || hz > CMX_SAMPLER_MAX_HZ)
+		return -EINVAL;
+
+	spin_lock_irqsave(&sampler.lock, flags);
+	WRITE_ONCE(sampler.frequency, hz);
+	sampler.period = ns_to_ktime(NSEC_PER_SEC / hz);
+	cmx_sampler_update(sampler.period);
+	spin_unlock_irqrestore(&sampler.lock, flags);
+
+	return len;
+}
+static DEVICE_ATTR_RW(sampling_frequency);
+
+static struct attribute *cmx_sampler_attrs[] = {
+	&dev_attr_sampling_frequency.attr,
+	NULL
+};
+ATTRIBUTE_GROUPS(cmx_sampler);
+
+/*
+ * cmx_sampler_bind - Make our trigger the current trigger of an accelerometer
+ * that has none
+ * @indio_dev: Accelerometer
+ *
+ * Returns: 0 on success (or if already bound), -EBUSY while a buffer is
+ * enabled, -EEXIST if the device has another trigger, or the driver's
+ * validate_trigger() error
+ */
+static int cmx_sampler_bind(struct iio_dev *indio_dev)
+{
+	int ret;
+
+	ret = cmx_claim_direct(indio_dev);
+	if (ret)
+		return ret;
+
+	if (indio_dev->trig == sampler.trig)
+		ret = 0;
+	else if (indio_dev->trig)
+		ret = -EEXIST;
+	else if (indio_dev->info->validate_trigger)
+		ret = indio_dev->info->validate_trigger(indio_dev, sampler.trig);
+
+	if (!ret && !indio_dev->trig)
+		indio_dev->trig = iio_trigger_get(sampler.trig);
+
+	cmx_release_direct(indio_dev);
+	return ret;
+}
+
+/* cmx_sampler_unbind - Put back the empty trigger of an idle accelerometer */
+static void cmx_sampler_unbind(struct iio_dev *indio_dev)
+{
+	if (cmx_claim_direct(indio_dev)) {
+		if (READ_ONCE(indio_dev->trig) == sampler.trig)
+			pr_warn(CMX_DRIVER_NAME ": %s still samples through our trigger\n",
+				dev_name(&indio_dev->dev));
+		return;
+	}
+
+	if (indio_dev->trig == sampler.trig) {
+		indio_dev->trig = NULL;
+		iio_trigger_put(sampler.trig);
+	}
+
+	cmx_release_direct(indio_dev);
+}
+
+/*
+ * cmx_sampler_for_each - Run @fn on each accelerometer currently present
+ *
+ * Returns: The first error @fn returned, 0 if none did
+ */
+static int cmx_sampler_for_each(int (*fn)(struct iio_dev *indio_dev))
+{
+	char names[2][64];
+	struct device *dev;
+	int ret = 0, err;
+
+	mutex_lock(&g_chip->lock);
+	strscpy(names[0], g_chip->base_iio_device, sizeof(names[0]));
+	strscpy(names[1], g_chip->lid_iio_device, sizeof(names[1]));
+	mutex_unlock(&g_chip->lock);
+
+	for (int i = 0; i < 2; i++) {
+		if (!names[i][0])
+			continue;
+		dev = bus_find_device_by_name(&iio_bus_type, NULL, names[i]);
+		if (!dev)
+			continue;
+		err = fn(dev_to_iio_dev(dev));
+		if (err) {
+			pr_debug(CMX_DRIVER_NAME ": trigger: %s: %d\n", names[i], err);
+			if (!ret)
+				ret = err;
+		}
+		put_device(dev);
+	}
+
+	return ret;
+}
+
+static int cmx_sampler_unbind_one(struct iio_dev *indio_dev)
+{
+	cmx_sampler_unbind(indio_dev);
+	return 0;
+}
+
+static void cmx_sampler_bind_work(struct work_struct *work)
+{
+	cmx_sampler_for_each(cmx_sampler_bind);
+}
+
+/*
+ * Lid switch: any input device with SW_LID (the ACPI lid button) pauses
+ * the trigger while it reports closed.
+ */
+static void cmx_lid_event(struct input_handle *handle, unsigned int type,
+			  unsigned int code, int value)
+{
+	if (type != EV_SW || code != SW_LID)
+		return;
+
+	/* Folded back, the hall sensor sees the magnet through the lid */
+	if (value && is_tablet_mode(READ_ONCE(shared.mode)))
+		return;
+
+	cmx_sampler_pause(CMX_PAUSE_LID, value);
+}
+
+static int cmx_lid_connect(struct input_handler *handler, struct input_dev *dev,
+			   const struct input_device_id *id)
+{
+	struct input_handle *handle;
+	int ret;
+
+	handle = kzalloc(sizeof(*handle), GFP_KERNEL);
+	if (!handle)
+		return -ENOMEM;
+
+	handle->dev = dev;
+	handle->handler = handler;
+	handle->name = CMX_DRIVER_NAME "-lid";
+
+	ret = input_register_handle(handle);
+	if (ret)
+		goto err_free;
+	ret = input_open_device(handle);
+	if (ret)
+		goto err_unregister;
+
+	/* Start from the switch's current position */
+	cmx_lid_event(handle, EV_SW, SW_LID, test_bit(SW_LID, dev->sw));
+	return 0;
+
+err_unregister:
+	input_unregister_handle(handle);
+err_free:
+	kfree(handle);
+	return ret;
+}
+
+static void cmx_lid_disconnect(struct input_handle *handle)
+{
+	cmx_sampler_pause(CMX_PAUSE_LID, false);
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(handle);
+}
+
+static const struct input_device_id cmx_lid_ids[] = {
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT | INPUT_DEVICE_ID_MATCH_SWBIT,
+		.evbit = { BIT_MASK(EV_SW) },
+		.swbit = { [BIT_WORD(SW_LID)] = BIT_MASK(SW_LID) },
+	},
+	{ }
+};
+
+static struct input_handler cmx_lid_handler = {
+	.event = cmx_lid_event,
+	.connect = cmx_lid_connect,
+	.disconnect = cmx_lid_disconnect,
+	.name = CMX_DRIVER_NAME "-lid",
+	.id_table = cmx_lid_ids,
+};
+
+/*
+ * cmx_sampler_register - Create the trigger and start binding it
+ * @parent: Platform device
+ *
+ * Returns: 0 on success, negative error code on failure
+ */
+static int cmx_sampler_register(struct device *parent)
+{
+	struct iio_trigger *trig;
+	int ret;
+
+	sampler.frequency = CMX_SAMPLER_DEFAULT_HZ;
+	sampler.period = ns_to_ktime(NSEC_PER_SEC / CMX_SAMPLER_DEFAULT_HZ);
+	sampler.enabled = false;
+	sampler.paused = 0;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 13, 0)
+	hrtimer_setup(&sampler.timer, cmx_sampler_fire, CLOCK_MONOTONIC, HRTIMER_MODE_REL_HARD);
+#else
+	hrtimer_init(&sampler.timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_HARD);
+	sampler.timer.function = cmx_sampler_fire;
+#endif
+	INIT_DELAYED_WORK(&sampler.bind_work, cmx_sampler_bind_work);
+
+	trig = iio_trigger_alloc(parent, "%s", CMX_SAMPLER_NAME);
+	if (!trig)
+		return -ENOMEM;
+	trig->ops = &cmx_sampler_ops;
+	trig->dev.groups = cmx_sampler_groups;
+
+	/* Userspace may attach to it as soon as it is registered */
+	sampler.trig = trig;
+	ret = iio_trigger_register(trig);
+	if (ret) {
+		sampler.trig = NULL;
+		iio_trigger_free(trig);
+		return ret;
+	}
+	WRITE_ONCE(sampler.binding, true);
+
+	if (lid_pause) {
+		ret = input_register_handler(&cmx_lid_handler);
+		if (ret)
+			pr_warn(CMX_DRIVER_NAME ": Not following the lid switch: %d\n", ret);
+		else
+			sampler.lid_handler_registered = true;
+	}
+
+	schedule_delayed_work(&sampler.bind_work, 0);
+	return 0;
+}
+
+/* cmx_sampler_unregister - Unbind the accelerometers and remove the trigger */
+static void cmx_sampler_unregister(void)
+{
+	struct iio_trigger *trig = sampler.trig;
+
+	if (!trig)
+		return;
+
+	WRITE_ONCE(sampler.binding, false);
+	cancel_delayed_work_sync(&sampler.bind_work);
+	if (sampler.lid_handler_registered) {
+		input_unregister_handler(&cmx_lid_handler);
+		sampler.lid_handler_registered = false;
+	}
+
+	/* The timer stays off from here on, whoever still holds the trigger */
+	cmx_sampler_pause(CMX_PAUSE_REMOVED, true);
+	hrtimer_cancel(&sampler.timer);
+
+	cmx_sampler_for_each(cmx_sampler_unbind_one);
+
+	iio_trigger_unregister(trig);
+	iio_trigger_free(trig);
+	sampler.trig = NULL;
+}
+
+/*
+ * Hinge angle device
+ *
+ * A virtual IIO device, "cmx-hinge", exporting what the accelerometers
+ * are fused into: in_angl_raw is the hinge angle in 0.1 degree steps
+ * (in_angl_scale converts to radians) and in_positionrelative_mode_raw the
+ * mode as an index into valid_modes. Both follow whoever publishes the
+ * state, cmxd through version 2 state records or in-kernel fusion; the
+ * angle reads -ENODATA until one of them has reported it.
+ *
+ * Its buffer captures one scan per trigger event. The "cmx-hinge-update"
+ * trigger fires after every state update, so a buffer attached to it sees
+ * each update once; the "cmx" sampling trigger gives fixed-rate scans
+ * instead. Neither is made the current trigger: as with the sampling
+ * trigger, an enabled buffer would pin the module.
+ */
+#define CMX_HINGE_NAME		CMX_DRIVER_NAME "-hinge"
+
+enum cmx_hinge_scan {
+	CMX_HINGE_ANGLE,
+	CMX_HINGE_MODE,
+	CMX_HINGE_TIMESTAMP,
+};
+
+static const struct iio_chan_spec cmx_hinge_channels[] = {
+	{
+		.type = IIO_ANGL,
+		.info_mask_separate = BIT(IIO_CHAN_INFO_RAW) | BIT(IIO_CHAN_INFO_SCALE),
+		.scan_index = CMX_HINGE_ANGLE,
+		.scan_type = {
+			.sign = 's',
+			.realbits = 16,
+			.storagebits = 16,
+			.endianness = IIO_CPU,
+		},
+	},
+	{
+		.type = IIO_POSITIONRELATIVE,
+		.extend_name = "mode",
+		.info_mask_separate = BIT(IIO_CHAN_INFO_RAW),
+		.scan_index = CMX_HINGE_MODE,
+		.scan_type = {
+			.sign = 'u',
+			.realbits = 8,
+			.storagebits = 8,
+			.endianness = IIO_CPU,
+		},
+	},
+	IIO_CHAN_SOFT_TIMESTAMP(CMX_HINGE_TIMESTAMP),
+};
+
+/* Scans always carry both channels; the core demuxes what a buffer asked for */
+static const unsigned long cmx_hinge_scan_masks[] = {
+	BIT(CMX_HINGE_ANGLE) | BIT(CMX_HINGE_MODE),
+	0
+};
+
+static int cmx_hinge_read_raw(struct iio_dev *indio_dev,
+			      struct iio_chan_spec const *chan,
+			      int *val, int *val2, long mask)
+{
+	struct cmx_shared snap;
+
+	switch (mask) {
+	case IIO_CHAN_INFO_RAW:
+		cmx_shared_read(&snap);
+		if (chan->type == IIO_ANGL) {
+			if (snap.angle == CMX_ANGLE_UNKNOWN)
+				return -ENODATA;
+			*val = snap.angle;
+		} else {
+			*val = snap.mode;
+		}
+		return IIO_VAL_INT;
+	case IIO_CHAN_INFO_SCALE:
+		/* 0.1 degree in radians */
+		*val = 0;
+		*val2 = 1745329;
+		return IIO_VAL_INT_PLUS_NANO;
+	default:
+		return -EINVAL;
+	}
+}
+
+static const struct iio_info cmx_hinge_info = {
+	.read_raw = cmx_hinge_read_raw,
+};
+
+/*
+ * cmx_hinge_trigger_handler - Push the current angle and mode
+ *
+ * Registered without a top half: the update trigger is polled nested from
+ * process context, which would skip it, so the timestamp is taken here.
+ */
+static irqreturn_t cmx_hinge_trigger_handler(int irq, void *p)
+{
+	struct iio_poll_func *pf = p;
+	struct iio_dev *indio_dev = pf->indio_dev;
+	struct cmx_shared snap;
+	struct {
+		s16 angle;
+		u8 mode;
+		s64 timestamp __aligned(8);
+	} scan = { };
+
+	cmx_shared_read(&snap);
+	scan.angle = snap.angle;
+	scan.mode = snap.mode;
+	iio_push_to_buffers_with_timestamp(indio_dev, &scan, iio_get_time_ns(indio_dev));
+
+	iio_trigger_notify_done(indio_dev->trig);
+	return IRQ_HANDLED;
+}
+
+/*
+ * cmx_hinge_register - Create the hinge device and its update trigger
+ * @parent: Platform device; both go away with it
+ *
+ * Returns: 0 on success, negative error code on failure
+ */
+static int cmx_hinge_register(struct device *parent)
+{
+	struct iio_dev *indio_dev;
+	struct iio_trigger *trig;
+	int ret;
+
+	indio_dev = devm_iio_device_alloc(parent, 0);
+	if (!indio_dev)
+		return -ENOMEM;
+
+	indio_dev->name = CMX_HINGE_NAME;
+	indio_dev->info = &cmx_hinge_info;
+	indio_dev->modes = INDIO_DIRECT_MODE;
+	indio_dev->channels = cmx_hinge_channels;
+	indio_dev->num_channels = ARRAY_SIZE(cmx_hinge_channels);
+	indio_dev->available_scan_masks = cmx_hinge_scan_masks;
+
+	ret = devm_iio_triggered_buffer_setup(parent, indio_dev, NULL,
+					      cmx_hinge_trigger_handler, NULL);
+	if (ret)
+		return ret;
+
+	trig = devm_iio_trigger_alloc(parent, "%s-update", CMX_HINGE_NAME);
+	if (!trig)
+		return -ENOMEM;
+
+	ret = devm_iio_trigger_register(parent, trig);
+	if (ret)
+		return ret;
+
+	ret = devm_iio_device_register(parent, indio_dev);
+	if (ret)
+		return ret;
+
+	mutex_lock(&hinge_lock);
+	hinge_trig = trig;
+	mutex_unlock(&hinge_lock);
+	return 0;
+}
+
+/* cmx_hinge_unregister - Stop polling the update trigger before devres frees it */
+static void cmx_hinge_unregister(void)
+{
+	mutex_lock(&hinge_lock);
+	hinge_trig = NULL;
+	mutex_unlock(&hinge_lock);
+}
+
+/* show_fusion - Report whether in-kernel fusion is off, waiting or running */
+static ssize_t show_fusion(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+	if (!kernel_fusion)
+		return sysfs_emit(buf, "off\n");
+	if (!cmx_fusion_running())
+		return sysfs_emit(buf, "waiting\n");
+	return sysfs_emit(buf, "running\n");
+}
+
+/* show_resume_seq - Count resumes from system sleep; pollable */
+static ssize_t show_resume_seq(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+	struct cmx_shared snap;
+
+	cmx_shared_read(&snap);
+	return sysfs_emit(buf, "%u\n", snap.resume_seq);
+}
+
+/*
+ * Vector watchers
+ *
+ * Nothing in the driver consumes base_vec and lid_vec, so cmxd may stop
+ * mirroring them while nobody looks. vec_watchers counts who does: each
+ * /dev/cmx file open for reading, plus one for CMX_VEC_LEASE_MS after any
+ * read of base_vec, lid_vec or state. Every change is sysfs_notify()'d so
+ * cmxd resumes mirroring at once; the first text read after a quiet spell
+ * may show an old vector, the ones after it are current.
+ */
+#define CMX_VEC_LEASE_MS	10000
+
+static atomic_t vec_readers = ATOMIC_INIT(0);
+static atomic64_t vec_lease_until = ATOMIC64_INIT(0);	/* ktime_get_ns() */
+
+static void cmx_vec_watchers_changed(void)
+{
+	if (g_chip && g_chip->pdev)
+		sysfs_notify(&g_chip->pdev->dev.kobj, NULL, "vec_watchers");
+}
+
+static void cmx_vec_lease_expired(struct work_struct *work)
+{
+	cmx_vec_watchers_changed();
+}
+static DECLARE_DELAYED_WORK(vec_lease_work, cmx_vec_lease_expired);
+
+/* cmx_vec_touch - A read of the vectors starts or renews the lease */
+static void cmx_vec_touch(void)
+{
+	u64 now = ktime_get_ns();
+	u64 old = atomic64_xchg(&vec_lease_until, now + CMX_VEC_LEASE_MS * NSEC_PER_MSEC);
+
+	mod_delayed_work(system_wq, &vec_lease_work, msecs_to_jiffies(CMX_VEC_LEASE_MS) + 1);
+	if (old <= now)
+		cmx_vec_watchers_changed();
+}
+
+/* show_vec_watchers - Readers of the raw vectors; pollable */
+static ssize_t show_vec_watchers(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
 {
-	return (strcmp(mode, "tablet") == 0 || strcmp(mode, "tent") == 0);
+	bool leased = (u64)atomic64_read(&vec_lease_until) > ktime_get_ns();
+
+	return sysfs_emit(buf, "%d\n", atomic_read(&vec_readers) + leased);
 }
 
 static ssize_t show_base_vec(struct kobject *k, struct kobj_attribute *a, char *buf)
 {
-	return scnprintf(buf, PAGE_SIZE, "%d %d %d\n", g_base.x, g_base.y, g_base.z);
+	struct cmx_shared snap;
+
+	cmx_vec_touch();
+	cmx_shared_read(&snap);
+	return scnprintf(buf, PAGE_SIZE, "%d %d %d\n", snap.base.x, snap.base.y, snap.base.z);
 }
 
 static ssize_t store_base_vec(struct kobject *k, struct kobj_attribute *a,
 			       const char *b, size_t l)
 {
 	struct vec3 v;
-	int n;
+	bool revalidate;
+	u64 now;
+	int n, mode;
 
 	n = sscanf(b, "%d %d %d", &v.x, &v.y, &v.z);
-	if (n != 3)
+	if (n != 3) {
+		atomic64_inc(&stats.parse_errors);
 		return -EINVAL;
+	}
+
+	/* The driver's own samples win while in-kernel fusion runs */
+	if (cmx_fusion_running()) {
+		atomic64_inc(&stats.ignored);
+		return l;
+	}
 
-	mutex_lock(&tm_lock);
-	g_base = v;
-	mutex_unlock(&tm_lock);
+	now = ktime_get_ns();
+	write_seqlock(&state_lock);
+	shared.base = v;
+	shared.base_ns = now;
+	revalidate = shared.stale == CMX_STALE_BASE;
+	shared.stale &= ~CMX_STALE_BASE;
+	mode = shared.mode;
+	cmx_state_advance(CMX_SRC_BASE_VEC, now);
+	write_sequnlock(&state_lock);
+	cmx_state_published();
+
+	/* The last vector refreshed after resume settles the tablet state */
+	if (revalidate)
+		cmx_sync_tablet_mode(mode, false);
 	
 	return l;
 }
 
 static ssize_t show_lid_vec(struct kobject *k, struct kobj_attribute *a, char *buf)
 {
-	return scnprintf(buf, PAGE_SIZE, "%d %d %d\n", g_lid.x, g_lid.y, g_lid.z);
+	struct cmx_shared snap;
+
+	cmx_vec_touch();
+	cmx_shared_read(&snap);
+	return scnprintf(buf, PAGE_SIZE, "%d %d %d\n", snap.lid.x, snap.lid.y, snap.lid.z);
 }
 
 static ssize_t store_lid_vec(struct kobject *k, struct kobj_attribute *a,
 			     const char *b, size_t l)
 {
 	struct vec3 v;
-	int n;
+	bool revalidate;
+	u64 now;
+	int n, mode;
 
 	n = sscanf(b, "%d %d %d", &v.x, &v.y, &v.z);
-	if (n != 3)
+	if (n != 3) {
+		atomic64_inc(&stats.parse_errors);
 		return -EINVAL;
+	}
+
+	/* The driver's own samples win while in-kernel fusion runs */
+	if (cmx_fusion_running()) {
+		atomic64_inc(&stats.ignored);
+		return l;
+	}
 
-	mutex_lock(&tm_lock);
-	g_lid = v;
-	mutex_unlock(&tm_lock);
+	now = ktime_get_ns();
+	write_seqlock(&state_lock);
+	shared.lid = v;
+	shared.lid_ns = now;
+	revalidate = shared.stale == CMX_STALE_LID;
+	shared.stale &= ~CMX_STALE_LID;
+	mode = shared.mode;
+	cmx_state_advance(CMX_SRC_LID_VEC, now);
+	write_sequnlock(&state_lock);
+	cmx_state_published();
+
+	/* The last vector refreshed after resume settles the tablet state */
+	if (revalidate)
+		cmx_sync_tablet_mode(mode, false);
 	
 	return l;
 }
@@ -215,34 +1731,46 @@ static ssize_t store_lid_vec(struct kobject *k, struct kobj_attribute *a,
 /* show_mode - Show current device mode */
 static ssize_t show_mode(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
 {
-	return snprintf(buf, PAGE_SIZE, "%s\n", current_mode);
+	return snprintf(buf, PAGE_SIZE, "%s\n", valid_modes[READ_ONCE(shared.mode)]);
 }
 
 /* store_mode - Set device mode and send input events */
 static ssize_t store_mode(struct kobject *kobj, struct kobj_attribute *attr,
 			  const char *buf, size_t len)
 {
-	char mode_str[16], old_mode[16];
-	bool old_is_tablet, new_is_tablet;
-	int ret;
+	char mode_str[16];
+	int mode, old_mode;
+	bool stale;
+	u64 now;
 	
-	ret = sscanf(buf, "%15s", mode_str);
-	if (ret != 1)
+	mode = -EINVAL;
+	if (sscanf(buf, "%15s", mode_str) == 1)
+		mode = sysfs_match_string(valid_modes, mode_str);
+	if (mode < 0) {
+		atomic64_inc(&stats.parse_errors);
 		return -EINVAL;
+	}
 	
-	if (sysfs_match_string(valid_modes, mode_str) < 0)
-		return -EINVAL;
+	/* The driver owns the mode while in-kernel fusion runs */
+	if (cmx_fusion_running()) {
+		atomic64_inc(&stats.ignored);
+		return len;
+	}
 	
-	mutex_lock(&tm_lock);
-	strcpy(old_mode, current_mode);
-	strcpy(current_mode, mode_str);
-	mutex_unlock(&tm_lock);
+	now = ktime_get_ns();
+	write_seqlock(&state_lock);
+	old_mode = shared.mode;
+	shared.mode = mode;
+	shared.mode_ns = now;
+	stale = shared.stale;
+	cmx_state_advance(CMX_SRC_MODE, now);
+	write_sequnlock(&state_lock);
+	cmx_state_published();
 	
 	/* Send input event only if tablet mode state changed */
-	old_is_tablet = is_tablet_mode(old_mode);
-	new_is_tablet = is_tablet_mode(mode_str);
-	if (old_is_tablet != new_is_tablet)
-		notify_tablet_mode_change(new_is_tablet);
+	cmx_sync_tablet_mode(mode, stale);
+	
+	notify_state_change(old_mode != mode, false);
 	
 	return len;
 }
@@ -250,7 +1778,7 @@ static ssize_t store_mode(struct kobject *kobj, struct kobj_attribute *attr,
 /* show_orientation - Show current device orientation */
 static ssize_t show_orientation(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
 {
-	return snprintf(buf, PAGE_SIZE, "%s\n", current_orientation);
+	return snprintf(buf, PAGE_SIZE, "%s\n", valid_orientations[READ_ONCE(shared.orientation)]);
 }
 
 /* store_orientation - Set device orientation with validation */
@@ -258,38 +1786,68 @@ static ssize_t store_orientation(struct kobject *kobj, struct kobj_attribute *at
 				 const char *buf, size_t len)
 {
 	char orientation_str[32];
-	int ret;
+	bool changed;
+	int orientation;
+	u64 now;
 	
-	ret = sscanf(buf, "%31s", orientation_str);
-	if (ret != 1)
+	orientation = -EINVAL;
+	if (sscanf(buf, "%31s", orientation_str) == 1)
+		orientation = sysfs_match_string(valid_orientations, orientation_str);
+	if (orientation < 0) {
+		atomic64_inc(&stats.parse_errors);
 		return -EINVAL;
+	}
 	
-	if (sysfs_match_string(valid_orientations, orientation_str) < 0)
-		return -EINVAL;
+	now = ktime_get_ns();
+	write_seqlock(&state_lock);
+	changed = shared.orientation != orientation;
+	shared.orientation = orientation;
+	shared.orientation_ns = now;
+	cmx_state_advance(CMX_SRC_ORIENTATION, now);
+	write_sequnlock(&state_lock);
+	cmx_state_published();
 	
-	mutex_lock(&tm_lock);
-	strcpy(current_orientation, orientation_str);
-	mutex_unlock(&tm_lock);
+	notify_state_change(false, changed);
 	
 	return len;
 }
 
-/* show_iio_base_device - Show base IIO device path */
-static ssize_t show_iio_base_device(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+/* show_chip_name - Show one of the resolved device names, or not_detected */
+static ssize_t show_chip_name(const char *name, char *buf)
 {
-	if (!g_chip || strlen(g_chip->base_iio_device) == 0) {
+	ssize_t ret;
+
+	if (!g_chip)
 		return snprintf(buf, PAGE_SIZE, "not_detected\n");
-	}
-	return snprintf(buf, PAGE_SIZE, "%s\n", g_chip->base_iio_device);
+
+	mutex_lock(&g_chip->lock);
+	ret = snprintf(buf, PAGE_SIZE, "%s\n", name[0] ? name : "not_detected");
+	mutex_unlock(&g_chip->lock);
+	return ret;
+}
+
+/* show_iio_base_device - Show base IIO device name */
+static ssize_t show_iio_base_device(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+	return show_chip_name(g_chip ? g_chip->base_iio_device : "", buf);
 }
 
-/* show_iio_lid_device - Show lid IIO device path */
+/* show_iio_lid_device - Show lid IIO device name */
 static ssize_t show_iio_lid_device(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
 {
-	if (!g_chip || strlen(g_chip->lid_iio_device) == 0) {
-		return snprintf(buf, PAGE_SIZE, "not_detected\n");
-	}
-	return snprintf(buf, PAGE_SIZE, "%s\n", g_chip->lid_iio_device);
+	return show_chip_name(g_chip ? g_chip->lid_iio_device : "", buf);
+}
+
+/* show_base_i2c - Show base sensor I2C bus and address */
+static ssize_t show_base_i2c(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+	return show_chip_name(g_chip ? g_chip->base_i2c : "", buf);
+}
+
+/* show_lid_i2c - Show lid sensor I2C bus and address */
+static ssize_t show_lid_i2c(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+	return show_chip_name(g_chip ? g_chip->lid_i2c : "", buf);
 }
 
 /* show_enable - Show whether tablet mode events are enabled */
@@ -314,6 +1872,165 @@ static ssize_t store_enable(struct kobject *kobj, struct kobj_attribute *attr, c
 	return len;
 }
 
+/*
+ * bin_attribute callbacks take a const attribute from 6.13, first through
+ * the transitional read_new/write_new members.
+ */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 13, 0)
+#define CMX_BIN_ATTR_CONST const
+#else
+#define CMX_BIN_ATTR_CONST
+#endif
+
+/*
+ * cmx_get_state - Snapshot the current state as a struct cmx_state
+ * @s: Record to fill
+ */
+static void cmx_get_state(struct cmx_state *s)
+{
+	struct cmx_shared snap;
+
+	cmx_shared_read(&snap);
+
+	memset(s, 0, sizeof(*s));
+	s->version = CMX_STATE_VERSION;
+	s->seq = snap.seq;
+	s->timestamp = snap.timestamp;
+	s->base[0] = snap.base.x;
+	s->base[1] = snap.base.y;
+	s->base[2] = snap.base.z;
+	s->lid[0] = snap.lid.x;
+	s->lid[1] = snap.lid.y;
+	s->lid[2] = snap.lid.z;
+	s->mode = snap.mode;
+	s->orientation = snap.orientation;
+	s->angle = snap.angle;
+}
+
+/*
+ * cmx_set_state - Apply vectors, mode and orientation from one struct cmx_state
+ * @s: Record written by userspace
+ *
+ * SW_TABLET_MODE is reported only when the tablet state actually changes,
+ * and not before the vectors have been refreshed after resume.
+ *
+ * Returns: 0 on success, -EINVAL if the record is malformed
+ */
+static int cmx_set_state(const struct cmx_state *s)
+{
+	bool mode_changed = false, orientation_changed = false;
+	bool fusing, stale;
+	int mode;
+	u64 now;
+
+	if (s->version < 1 || s->version > CMX_STATE_VERSION ||
+	    memchr_inv(s->reserved, 0, sizeof(s->reserved)) ||
+	    (s->version == 1 && s->angle) ||
+	    (s->version >= 2 && (s->angle < CMX_ANGLE_UNKNOWN || s->angle > 3600)) ||
+	    (s->mode != CMX_STATE_KEEP && s->mode >= ARRAY_SIZE(valid_modes) - 1) ||
+	    (s->orientation != CMX_STATE_KEEP && s->orientation >= ARRAY_SIZE(valid_orientations) - 1)) {
+		atomic64_inc(&stats.parse_errors);
+		return -EINVAL;
+	}
+
+	/* Only orientation is taken from userspace while in-kernel fusion runs */
+	fusing = cmx_fusion_running();
+	if (fusing)
+		atomic64_inc(&stats.ignored);
+
+	now = ktime_get_ns();
+	write_seqlock(&state_lock);
+	if (!fusing) {
+		shared.base = (struct vec3){ s->base[0], s->base[1], s->base[2] };
+		shared.lid = (struct vec3){ s->lid[0], s->lid[1], s->lid[2] };
+		shared.timestamp = s->timestamp;
+		shared.base_ns = now;
+		shared.lid_ns = now;
+		if (s->version >= 2)
+			shared.angle = s->angle;
+		shared.stale = 0;
+	}
+
+	if (!fusing && s->mode != CMX_STATE_KEEP) {
+		mode_changed = shared.mode != s->mode;
+		shared.mode = s->mode;
+		shared.mode_ns = now;
+	}
+	if (s->orientation != CMX_STATE_KEEP) {
+		orientation_changed = shared.orientation != s->orientation;
+		shared.orientation = s->orientation;
+		shared.orientation_ns = now;
+	}
+	mode = shared.mode;
+	stale = shared.stale;
+
+	/* Take the writer's sequence, but never let it look unchanged */
+	cmx_stats_account(CMX_SRC_STATE, now);
+	shared.seq = s->seq != shared.seq ? s->seq : shared.seq + 1;
+	write_sequnlock(&state_lock);
+	cmx_state_published();
+
+	cmx_sync_tablet_mode(mode, stale);
+
+	notify_state_change(mode_changed, orientation_changed);
+
+	return 0;
+}
+
+/* state_read - Report the current state as a struct cmx_state */
+static ssize_t state_read(struct file *filp, struct kobject *kobj,
+			  CMX_BIN_ATTR_CONST struct bin_attribute *attr,
+			  char *buf, loff_t off, size_t count)
+{
+	struct cmx_state s;
+
+	if (off >= (loff_t)sizeof(s))
+		return 0;
+	count = min_t(size_t, count, sizeof(s) - off);
+
+	cmx_vec_touch();
+	cmx_get_state(&s);
+	memcpy(buf, (const char *)&s + off, count);
+	return count;
+}
+
+/*
+ * state_write - Apply a struct cmx_state written to the "state" attribute
+ *
+ * The whole record must be written at offset 0.
+ */
+static ssize_t state_write(struct file *filp, struct kobject *kobj,
+			   CMX_BIN_ATTR_CONST struct bin_attribute *attr,
+			   char *buf, loff_t off, size_t count)
+{
+	struct cmx_state s;
+	int ret;
+
+	if (off != 0 || count != sizeof(s)) {
+		atomic64_inc(&stats.parse_errors);
+		return -EINVAL;
+	}
+	memcpy(&s, buf, sizeof(s));
+
+	ret = cmx_set_state(&s);
+	if (ret)
+		return ret;
+
+	return count;
+}
+
+static struct bin_attribute state_attr = {
+	.attr = { .name = "state", .mode = 0644 },
+	.size = sizeof(struct cmx_state),
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 13, 0) && LINUX_VERSION_CODE < KERNEL_VERSION(6, 16, 0)
+	.read_new = state_read,
+	.write_new = state_write,
+#else
+	.read = state_read,
+	.write = state_write,
+#endif
+};
+
 /* Basic attribute definitions */
 static struct kobj_attribute base_vec_attr = __ATTR(base_vec, 0644, show_base_vec, store_base_vec);
 static struct kobj_attribute lid_vec_attr = __ATTR(lid_vec, 0644, show_lid_vec, store_lid_vec);
@@ -321,7 +2038,12 @@ static struct kobj_attribute mode_attr = __ATTR(mode, 0644, show_mode, store_mod
 static struct kobj_attribute orientation_attr = __ATTR(orientation, 0644, show_orientation, store_orientation);
 static struct kobj_attribute iio_base_device_attr = __ATTR(iio_base_device, 0444, show_iio_base_device, NULL);
 static struct kobj_attribute iio_lid_device_attr = __ATTR(iio_lid_device, 0444, show_iio_lid_device, NULL);
+static struct kobj_attribute base_i2c_attr = __ATTR(base_i2c, 0444, show_base_i2c, NULL);
+static struct kobj_attribute lid_i2c_attr = __ATTR(lid_i2c, 0444, show_lid_i2c, NULL);
 static struct kobj_attribute enable_attr = __ATTR(enable, 0644, show_enable, store_enable);
+static struct kobj_attribute fusion_attr = __ATTR(fusion, 0444, show_fusion, NULL);
+static struct kobj_attribute resume_seq_attr = __ATTR(resume_seq, 0444, show_resume_seq, NULL);
+static struct kobj_attribute vec_watchers_attr = __ATTR(vec_watchers, 0444, show_vec_watchers, NULL);
 
 static struct attribute *tablet_mode_attrs[] = {
 	&base_vec_attr.attr,
@@ -330,7 +2052,12 @@ static struct attribute *tablet_mode_attrs[] = {
 	&orientation_attr.attr,
 	&iio_base_device_attr.attr,
 	&iio_lid_device_attr.attr,
+	&base_i2c_attr.attr,
+	&lid_i2c_attr.attr,
 	&enable_attr.attr,
+	&fusion_attr.attr,
+	&resume_seq_attr.attr,
+	&vec_watchers_attr.attr,
 	NULL,
 };
 
@@ -339,40 +2066,449 @@ static struct attribute_group tablet_mode_attr_group = {
 };
 
 /*
- * cmx_discover_iio_devices - Find existing IIO accelerometer devices
+ * /dev/cmx - the same struct cmx_state as the "state" attribute, for
+ * processes that want to sleep until it changes. read() returns the record
+ * once per shared.seq change (the first read after open returns at once)
+ * and blocks otherwise, poll() reports EPOLLIN when a change is pending,
+ * and write() applies a record like the attribute does.
+ */
+
+/*
+ * misc_deregister() leaves files that are already open working, and they
+ * may outlive the platform device (cmxd keeps its handle open for good).
+ * cmx_remove() moves the generation under cmx_dev_lock once everything
+ * else is torn down, and clears tm_input before devm frees it; files
+ * from an older generation then fail with -ENODEV. Writes hold the lock
+ * across cmx_set_state(), so none is still using tm_input by then.
+ */
+static DEFINE_MUTEX(cmx_dev_lock);
+static unsigned int cmx_dev_generation;
+
+/**
+ * struct cmx_reader - Per-open-file state for /dev/cmx
+ * @seen_seq: shared.seq of the last record returned by read()
+ * @primed: A record has been read since open
+ * @watching: Opened for reading; counted in vec_readers
+ * @generation: cmx_dev_generation at open
+ */
+struct cmx_reader {
+	u32 seen_seq;
+	bool primed;
+	bool watching;
+	unsigned int generation;
+};
+
+/* The device this file was opened on has been removed */
+static bool cmx_reader_gone(const struct cmx_reader *r)
+{
+	return READ_ONCE(cmx_dev_generation) != r->generation;
+}
+
+static bool cmx_reader_pending(const struct cmx_reader *r)
+{
+	return !r->primed || READ_ONCE(shared.seq) != r->seen_seq;
+}
+
+static int cmx_dev_open(struct inode *inode, struct file *filp)
+{
+	struct cmx_reader *r;
+
+	r = kzalloc(sizeof(*r), GFP_KERNEL);
+	if (!r)
+		return -ENOMEM;
+
+	filp->private_data = r;
+	r->generation = READ_ONCE(cmx_dev_generation);
+	if (filp->f_mode & FMODE_READ) {
+		r->watching = true;
+		atomic_inc(&vec_readers);
+		cmx_vec_watchers_changed();
+	}
+	return 0;
+}
+
+static int cmx_dev_release(struct inode *inode, struct file *filp)
+{
+	struct cmx_reader *r = filp->private_data;
+
+	if (r->watching) {
+		atomic_dec(&vec_readers);
+		mutex_lock(&cmx_dev_lock);
+		if (!cmx_reader_gone(r))
+			cmx_vec_watchers_changed();
+		mutex_unlock(&cmx_dev_lock);
+	}
+	kfree(r);
+	return 0;
+}
+
+static ssize_t cmx_dev_read(struct file *filp, char __user *buf, size_t count, loff_t *ppos)
+{
+	struct cmx_reader *r = filp->private_data;
+	struct cmx_state s;
+	int ret;
+
+	if (count < sizeof(s))
+		return -EINVAL;
+
+	if (!cmx_reader_pending(r) && !cmx_reader_gone(r)) {
+		if (filp->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		ret = wait_event_interruptible(state_wait, cmx_reader_pending(r) || cmx_reader_gone(r));
+		if (ret)
+			return ret;
+	}
+	if (cmx_reader_gone(r))
+		return -ENODEV;
+
+	cmx_get_state(&s);
+	if (copy_to_user(buf, &s, sizeof(s)))
+		return -EFAULT;
+
+	r->seen_seq = s.seq;
+	r->primed = true;
+	return sizeof(s);
+}
+
+static ssize_t cmx_dev_write(struct file *filp, const char __user *buf, size_t count, loff_t *ppos)
+{
+	struct cmx_reader *r = filp->private_data;
+	struct cmx_state s;
+	int ret;
+
+	if (count != sizeof(s)) {
+		atomic64_inc(&stats.parse_errors);
+		return -EINVAL;
+	}
+	if (copy_from_user(&s, buf, sizeof(s)))
+		return -EFAULT;
+
+	mutex_lock(&cmx_dev_lock);
+	ret = cmx_reader_gone(r) ? -ENODEV : cmx_set_state(&s);
+	mutex_unlock(&cmx_dev_lock);
+	if (ret)
+		return ret;
+
+	return count;
+}
+
+static __poll_t cmx_dev_poll(struct file *filp, poll_table *wait)
+{
+	struct cmx_reader *r = filp->private_data;
+	__poll_t mask = EPOLLOUT | EPOLLWRNORM;
+
+	poll_wait(filp, &state_wait, wait);
+	if (cmx_reader_gone(r))
+		return EPOLLERR;
+	if (cmx_reader_pending(r))
+		mask |= EPOLLIN | EPOLLRDNORM;
+
+	return mask;
+}
+
+static const struct file_operations cmx_dev_fops = {
+	.owner = THIS_MODULE,
+	.open = cmx_dev_open,
+	.release = cmx_dev_release,
+	.read = cmx_dev_read,
+	.write = cmx_dev_write,
+	.poll = cmx_dev_poll,
+	.llseek = noop_llseek,
+};
+
+static struct miscdevice cmx_miscdev = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = CMX_DRIVER_NAME,
+	.fops = &cmx_dev_fops,
+	.mode = 0644,
+};
+
+/*
+ * debugfs: /sys/kernel/debug/cmx/
+ *
+ *   stats      update counts and average rates per source since load (or
+ *              the last reset), parse failures, ignored writes,
+ *              SW_TABLET_MODE toggles and the age of each field; writing
+ *              anything resets the counters
+ *   intervals  histogram of the time between consecutive updates
+ */
+
+/* cmx_ms_since - Milliseconds from @then to @now, as shown in debugfs */
+static u64 cmx_ms_since(u64 now, u64 then)
+{
+	return div_u64(now - then, NSEC_PER_MSEC);
+}
+
+static void cmx_stats_show_age(struct seq_file *m, const char *name, u64 now, u64 then)
+{
+	if (then)
+		seq_printf(m, "%-20s %llu ms\n", name, cmx_ms_since(now, then));
+	else
+		seq_printf(m, "%-20s never\n", name);
+}
+
+static int cmx_stats_show(struct seq_file *m, void *unused)
+{
+	u64 updates[CMX_SRC_COUNT], total = 0, elapsed_ms, now;
+	struct cmx_shared snap;
+	unsigned int seq;
+	u64 last_ns;
+
+	do {
+		seq = read_seqbegin(&state_lock);
+		snap = shared;
+		memcpy(updates, stats.updates, sizeof(updates));
+		last_ns = stats.last_ns;
+	} while (read_seqretry(&state_lock, seq));
+
+	now = ktime_get_ns();
+	elapsed_ms = max_t(u64, cmx_ms_since(now, READ_ONCE(stats.since_ns)), 1);
+
+	seq_printf(m, "%-20s %12s %10s\n", "source", "updates", "per_sec");
+	for (int i = 0; i < CMX_SRC_COUNT; i++) {
+		u64 centi = div64_u64(updates[i] * 100000, elapsed_ms);
+		u32 frac;
+		u64 whole = div_u64_rem(centi, 100, &frac);
+
+		seq_printf(m, "%-20s %12llu %7llu.%02u\n", cmx_source_names[i],
+			   updates[i], whole, frac);
+		total += updates[i];
+	}
+	seq_printf(m, "%-20s %12llu\n\n", "total", total);
+
+	seq_printf(m, "%-20s %lld\n", "parse_errors", atomic64_read(&stats.parse_errors));
+	seq_printf(m, "%-20s %lld\n", "ignored_writes", atomic64_read(&stats.ignored));
+	seq_printf(m, "%-20s %lld\n", "tablet_toggles", atomic64_read(&stats.toggles));
+	seq_printf(m, "%-20s %llu s\n", "counting_for", div_u64(elapsed_ms, MSEC_PER_SEC));
+	seq_printf(m, "%-20s %u\n", "seq", snap.seq);
+	seq_printf(m, "%-20s %u\n", "resumes", snap.resume_seq);
+	seq_printf(m, "%-20s %s\n\n", "stale_vectors", snap.stale ? "yes" : "no");
+
+	cmx_stats_show_age(m, "last_update", now, last_ns);
+	cmx_stats_show_age(m, "base_vec_age", now, snap.base_ns);
+	cmx_stats_show_age(m, "lid_vec_age", now, snap.lid_ns);
+	cmx_stats_show_age(m, "mode_age", now, snap.mode_ns);
+	cmx_stats_show_age(m, "orientation_age", now, snap.orientation_ns);
+
+	return 0;
+}
+
+static int cmx_stats_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, cmx_stats_show, inode->i_private);
+}
+
+/* cmx_stats_write - Any write starts a new counting period */
+static ssize_t cmx_stats_write(struct file *filp, const char __user *buf,
+			       size_t count, loff_t *ppos)
+{
+	write_seqlock(&state_lock);
+	memset(stats.updates, 0, sizeof(stats.updates));
+	memset(stats.intervals, 0, sizeof(stats.intervals));
+	stats.last_ns = 0;
+	WRITE_ONCE(stats.since_ns, ktime_get_ns());
+	write_sequnlock(&state_lock);
+
+	atomic64_set(&stats.parse_errors, 0);
+	atomic64_set(&stats.ignored, 0);
+	atomic64_set(&stats.toggles, 0);
+
+	return count;
+}
+
+static const struct file_operations cmx_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = cmx_stats_open,
+	.read = seq_read,
+	.write = cmx_stats_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int cmx_intervals_show(struct seq_file *m, void *unused)
+{
+	u64 intervals[CMX_INTERVAL_BUCKETS];
+	unsigned int seq;
+
+	do {
+		seq = read_seqbegin(&state_lock);
+		memcpy(intervals, stats.intervals, sizeof(intervals));
+	} while (read_seqretry(&state_lock, seq));
+
+	for (int i = 0; i < CMX_INTERVAL_BUCKETS - 1; i++)
+		seq_printf(m, "<%5lu ms %12llu\n", 1UL << i, intervals[i]);
+	seq_printf(m, ">=%4lu ms %12llu\n", 1UL << (CMX_INTERVAL_BUCKETS - 2),
+		   intervals[CMX_INTERVAL_BUCKETS - 1]);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(cmx_intervals);
+
+/* cmx_debugfs_init - Create /sys/kernel/debug/cmx; failures are not fatal */
+static void cmx_debugfs_init(void)
+{
+	WRITE_ONCE(stats.since_ns, ktime_get_ns());
+
+	cmx_debugfs = debugfs_create_dir(CMX_DRIVER_NAME, NULL);
+	debugfs_create_file("stats", 0600, cmx_debugfs, NULL, &cmx_stats_fops);
+	debugfs_create_file("intervals", 0400, cmx_debugfs, NULL, &cmx_intervals_fops);
+}
+
+static void cmx_debugfs_cleanup(void)
+{
+	debugfs_remove_recursive(cmx_debugfs);
+	cmx_debugfs = NULL;
+}
+
+/*
+ * cmx_smi_instance - Which accelerometer an IIO device is, if either
+ * @dev: Device on the IIO bus
+ * @client: Set to the I2C client behind it
+ *
+ * Returns: CMX_SMI_LID or CMX_SMI_BASE, or -ENODEV for any other device
+ */
+static int cmx_smi_instance(struct device *dev, struct i2c_client **client)
+{
+	const char *name, *dot;
+	int instance;
+
+	/* Triggers live on the IIO bus too, often with the same parent */
+	if (!str_has_prefix(dev_name(dev), "iio:device") || !dev->parent)
+		return -ENODEV;
+
+	*client = i2c_verify_client(dev->parent);
+	if (!*client || strcmp((*client)->name, CMX_SMI_CLIENT_TYPE))
+		return -ENODEV;
+
+	name = dev_name(&(*client)->dev);
+	dot = strrchr(name, '.');
+	if (!str_has_prefix(name, CMX_SMI_CLIENT_PREFIX) || !dot ||
+	    kstrtoint(dot + 1, 10, &instance) ||
+	    (instance != CMX_SMI_LID && instance != CMX_SMI_BASE))
+		return -ENODEV;
+
+	return instance;
+}
+
+/*
+ * cmx_update_iio_device - Record an accelerometer's IIO device appearing or going
+ * @chip: Driver context
+ * @dev: Device on the IIO bus
+ * @present: The device was added (true) or is being removed (false)
+ */
+static void cmx_update_iio_device(struct cmx *chip, struct device *dev, bool present)
+{
+	struct i2c_client *client;
+	char *name, *i2c;
+	int instance;
+
+	instance = cmx_smi_instance(dev, &client);
+	if (instance < 0)
+		return;
+
+	name = instance == CMX_SMI_LID ? chip->lid_iio_device : chip->base_iio_device;
+	i2c = instance == CMX_SMI_LID ? chip->lid_i2c : chip->base_i2c;
+
+	mutex_lock(&chip->lock);
+	if (present) {
+		strscpy(name, dev_name(dev), sizeof(chip->lid_iio_device));
+		snprintf(i2c, sizeof(chip->lid_i2c), "i2c-%d:0x%02x",
+			 client->adapter->nr, client->addr);
+	} else if (!strcmp(name, dev_name(dev))) {
+		name[0] = '\0';
+		i2c[0] = '\0';
+	} else {
+		mutex_unlock(&chip->lock);
+		return;
+	}
+	mutex_unlock(&chip->lock);
+
+	pr_info(CMX_DRIVER_NAME ": %s accelerometer %s: %s on %s\n",
+		instance == CMX_SMI_LID ? "lid" : "base", present ? "found" : "removed",
+		dev_name(dev), dev_name(&client->dev));
+
+	sysfs_notify(&chip->pdev->dev.kobj, NULL,
+		     instance == CMX_SMI_LID ? "iio_lid_device" : "iio_base_device");
+	if (present)
+		cmx_sampler_rebind();
+	if (kernel_fusion)
+		cmx_fusion_rebind(instance == CMX_SMI_LID ? CMX_ACCEL_LID : CMX_ACCEL_BASE);
+}
+
+/* cmx_iio_notify - IIO bus notifier: follow the accelerometers across rebinds */
+static int cmx_iio_notify(struct notifier_block *nb, unsigned long action, void *data)
+{
+	struct cmx *chip = container_of(nb, struct cmx, iio_nb);
+
+	switch (action) {
+	case BUS_NOTIFY_ADD_DEVICE:
+		cmx_update_iio_device(chip, data, true);
+		break;
+	case BUS_NOTIFY_DEL_DEVICE:
+		cmx_update_iio_device(chip, data, false);
+		break;
+	}
+
+	return NOTIFY_DONE;
+}
+
+static int cmx_match_existing(struct device *dev, void *data)
+{
+	cmx_update_iio_device(data, dev, true);
+	return 0;
+}
+
+/*
+ * cmx_discover_iio_devices - Find the accelerometers and keep following them
  *
- * Stores device names for IIO devices created by serial_multi_instantiate for
- * use by userspace daemon. Device assignment based on creation order:
- * - iio:device0 = lid sensor (first device created)
- * - iio:device1 = base sensor (second device created)
+ * Resolves the IIO devices of the serial-multi-instantiate clients by their
+ * client names rather than by creation order, so other IIO devices
+ * enumerating first don't matter. A bus notifier is registered before the
+ * scan of existing devices, so none can slip in between; it also picks up
+ * the new IIO device after an unbind/bind of the mxc4005 driver.
  *
  * Returns: 0 on success, negative error code on failure
  */
 static int cmx_discover_iio_devices(void)
 {
 	struct cmx *chip = g_chip;
+	int ret;
 	
 	if (!chip) {
 		pr_err(CMX_DRIVER_NAME ": No chip context available\n");
 		return -EINVAL;
 	}
 	
-	/* Store device names for userspace daemon */
-	strcpy(chip->lid_iio_device, LID_IIO_DEVICE_NAME);
-	strcpy(chip->base_iio_device, BASE_IIO_DEVICE_NAME);
+	chip->iio_nb.notifier_call = cmx_iio_notify;
+	ret = bus_register_notifier(&iio_bus_type, &chip->iio_nb);
+	if (ret)
+		return ret;
+	
+	bus_for_each_dev(&iio_bus_type, NULL, chip, cmx_match_existing);
 	
-	pr_info(CMX_DRIVER_NAME ": IIO device assignments: lid=%s, base=%s\n",
-		chip->lid_iio_device, chip->base_iio_device);
+	mutex_lock(&chip->lock);
+	if (!chip->lid_iio_device[0] || !chip->base_iio_device[0])
+		pr_info(CMX_DRIVER_NAME ": Waiting for accelerometers: lid=%s, base=%s\n",
+			chip->lid_iio_device[0] ? chip->lid_iio_device : "-",
+			chip->base_iio_device[0] ? chip->base_iio_device : "-");
+	mutex_unlock(&chip->lock);
 	
 	return 0;
 }
 
+/* cmx_release_iio_devices - Stop following the accelerometers */
+static void cmx_release_iio_devices(void)
+{
+	if (g_chip)
+		bus_unregister_notifier(&iio_bus_type, &g_chip->iio_nb);
+}
+
 /*
  * cmx_init_tablet_mode - Initialize tablet mode detection
  * @pdev: Platform device for device registration
  *
  * Creates and registers input device for SW_TABLET_MODE events.
- * Creates sysfs attributes for userspace daemon communication.
+ * Creates sysfs attributes and /dev/cmx for userspace communication.
  *
  * Returns: 0 on success, negative error code on failure
  */
@@ -396,6 +2532,9 @@ static int cmx_init_tablet_mode(struct platform_device *pdev)
 	
 	/* Set up input capabilities */
 	input_set_capability(tm_input, EV_SW, SW_TABLET_MODE);
+	input_set_abs_params(tm_input, CMX_ABS_ANGLE, CMX_ANGLE_UNKNOWN, 3600, CMX_ABS_ANGLE_FUZZ, 0);
+	input_abs_set_res(tm_input, CMX_ABS_ANGLE, 10);		/* units per degree */
+	input_set_abs_params(tm_input, CMX_ABS_MODE, 0, CMX_MODE_TABLET, 0, 0);
 	
 	ret = input_register_device(tm_input);
 	if (ret) {
@@ -407,6 +2546,7 @@ static int cmx_init_tablet_mode(struct platform_device *pdev)
 	input_report_switch(tm_input, SW_TABLET_MODE, 0);
 	input_sync(tm_input);
 	pr_debug(CMX_DRIVER_NAME ": Initial mode set to laptop (tablet mode disabled)\n");
+	cmx_report_axes();
 	
 	/* Create sysfs interface under platform driver */
 	ret = sysfs_create_group(&pdev->dev.kobj, &tablet_mode_attr_group);
@@ -416,6 +2556,23 @@ static int cmx_init_tablet_mode(struct platform_device *pdev)
 		return ret;
 	}
 	
+	ret = sysfs_create_bin_file(&pdev->dev.kobj, &state_attr);
+	if (ret) {
+		pr_err(CMX_DRIVER_NAME ": Failed to create state attribute: %d\n", ret);
+		sysfs_remove_group(&pdev->dev.kobj, &tablet_mode_attr_group);
+		input_unregister_device(tm_input);
+		return ret;
+	}
+	
+	ret = misc_register(&cmx_miscdev);
+	if (ret) {
+		pr_err(CMX_DRIVER_NAME ": Failed to register /dev/" CMX_DRIVER_NAME ": %d\n", ret);
+		sysfs_remove_bin_file(&pdev->dev.kobj, &state_attr);
+		sysfs_remove_group(&pdev->dev.kobj, &tablet_mode_attr_group);
+		input_unregister_device(tm_input);
+		return ret;
+	}
+	
 	pr_debug(CMX_DRIVER_NAME ": Tablet mode detection initialized successfully\n");
 	
 	return 0;
@@ -424,14 +2581,19 @@ static int cmx_init_tablet_mode(struct platform_device *pdev)
 /*
  * cmx_cleanup_tablet_mode - Clean up tablet mode resources
  *
- * Removes sysfs attribute group. Input device cleanup handled via devm.
+ * Removes /dev/cmx and the sysfs attribute group. Input device cleanup
+ * handled via devm.
  */
 static void cmx_cleanup_tablet_mode(void)
 {
+	misc_deregister(&cmx_miscdev);
+	
 	/* Remove sysfs interface */
 	if (g_chip && g_chip->pdev) {
+		sysfs_remove_bin_file(&g_chip->pdev->dev.kobj, &state_attr);
 		sysfs_remove_group(&g_chip->pdev->dev.kobj, &tablet_mode_attr_group);
 	}
+	cancel_delayed_work_sync(&vec_lease_work);
 	
 	/* Input device will be cleaned up automatically via devm */
 }
@@ -461,7 +2623,7 @@ static int cmx_probe(struct platform_device *pdev)
 	g_chip = chip;
 	mutex_init(&chip->lock);
 
-	/* Discover existing IIO devices created by serial_multi_instantiate */
+	/* Find the accelerometers created by serial_multi_instantiate */
 	ret = cmx_discover_iio_devices();
 	if (ret) {
 		dev_err(&pdev->dev, "Failed to setup accelerometers: %d\n", ret);
@@ -472,12 +2634,29 @@ static int cmx_probe(struct platform_device *pdev)
 	ret = cmx_init_tablet_mode(pdev);
 	if (ret) {
 		dev_err(&pdev->dev, "Failed to initialize tablet mode detection: %d\n", ret);
-		goto err_cleanup;
+		goto err_release;
+	}
+
+	if (sampling_trigger) {
+		ret = cmx_sampler_register(&pdev->dev);
+		if (ret)
+			dev_warn(&pdev->dev, "No sampling trigger, userspace must attach one: %d\n", ret);
 	}
 
+	ret = cmx_hinge_register(&pdev->dev);
+	if (ret)
+		dev_warn(&pdev->dev, "No hinge angle device: %d\n", ret);
+
+	cmx_debugfs_init();
+
+	if (kernel_fusion)
+		cmx_fusion_start();
+
 	dev_info(&pdev->dev, "Tablet mode detection initialized\n");
 	return 0;
 
+err_release:
+	cmx_release_iio_devices();
 err_cleanup:
 	g_chip = NULL;
 	return ret;
@@ -493,21 +2672,74 @@ static void cmx_remove(struct platform_device *pdev)
 {
 	dev_dbg(&pdev->dev, "Chuwi Minibook X integrated driver removing\n");
 
+	/* Stop following the accelerometers, then stop fusing their data */
+	cmx_release_iio_devices();
+	if (kernel_fusion)
+		cmx_fusion_stop();
+	cmx_sampler_unregister();
+	cmx_hinge_unregister();
+
 	/* Cleanup tablet mode detection */
+	cmx_debugfs_cleanup();
 	cmx_cleanup_tablet_mode();
 
+	/* Cut off /dev/cmx files still open, before devm frees tm_input */
+	mutex_lock(&cmx_dev_lock);
+	WRITE_ONCE(cmx_dev_generation, cmx_dev_generation + 1);
+	tm_input = NULL;
+	mutex_unlock(&cmx_dev_lock);
+	wake_up_interruptible(&state_wait);
+
 	/* Clear global reference */
 	g_chip = NULL;
 
 	dev_dbg(&pdev->dev, "Chuwi Minibook X integrated driver removed\n");
 }
 
+/*
+ * cmx_suspend - Stop sampling for the duration of system sleep
+ *
+ * The vectors are marked stale: whatever the posture is after resume,
+ * SW_TABLET_MODE is not reported from the old samples.
+ */
+static int cmx_suspend(struct device *dev)
+{
+	cmx_sampler_pause(CMX_PAUSE_SUSPEND, true);
+	if (kernel_fusion)
+		cmx_fusion_quiesce();
+
+	write_seqlock(&state_lock);
+	shared.stale = CMX_STALE_ALL;
+	write_sequnlock(&state_lock);
+	return 0;
+}
+
+/*
+ * cmx_resume - Sample at once and tell userspace the system slept
+ *
+ * Releasing the pause fires the sampling trigger immediately, so a fresh
+ * pair is on its way before resume_seq wakes its pollers.
+ */
+static int cmx_resume(struct device *dev)
+{
+	write_seqlock(&state_lock);
+	shared.resume_seq++;
+	write_sequnlock(&state_lock);
+
+	cmx_sampler_pause(CMX_PAUSE_SUSPEND, false);
+	sysfs_notify(&dev->kobj, NULL, "resume_seq");
+	return 0;
+}
+
+static DEFINE_SIMPLE_DEV_PM_OPS(cmx_pm_ops, cmx_suspend, cmx_resume);
+
 /* Platform driver structure */
 static struct platform_driver cmx_driver = {
 	.probe = cmx_probe,
 	.remove = cmx_remove,
 	.driver = {
 		.name = CMX_DRIVER_NAME,
+		.pm = pm_sleep_ptr(&cmx_pm_ops),
 	},
 };
 
@@ -0,0 +1,205 @@
+#!/bin/bash
+# Load/unload smoke test for the cmx module
+#
+# Builds the module against the running kernel (failing on any compiler
+# warning), loads it with the given module parameters and exercises
+# /dev/cmx, the state attribute, the cmx-hinge IIO device, the sampling
+# trigger, the IIO bus notifier (mxc4005 unbind/bind) and suspend/resume
+# (through /sys/power/pm_test), then unbinds it with /dev/cmx still open
+# and unloads it. Fails if the kernel log shows a warning, oops or lockdep
+# splat in between. cmxd must not be running: the test expects to be the
+# only writer of the state.
+#
+# Usage: sudo ./smoke-test.sh [module parameters...]
+#   e.g. sudo ./smoke-test.sh kernel_fusion=1
+
+set -e
+
+CMX_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+KDIR="${KDIR:-/lib/modules/$(uname -r)/build}"
+PLATFORM="/sys/devices/platform/cmx"
+IIO="/sys/bus/iio/devices"
+MXC4005="/sys/bus/i2c/drivers/mxc4005"
+BUILD_LOG="$(mktemp)"
+RECORD="$(mktemp)"
+trap 'rm -f "$BUILD_LOG" "$RECORD"' EXIT
+
+fail() {
+    echo "FAIL: $*"
+    exit 1
+}
+
+# Little-endian integers for struct cmx_state
+le8()  { printf "\\$(printf %03o $(( $1 & 255 )))"; }
+le16() { le8 "$1"; le8 $(( $1 >> 8 )); }
+le32() { le16 "$1"; le16 $(( $1 >> 16 )); }
+le64() { le32 "$1"; le32 $(( $1 >> 32 )); }
+
+# state_record SEQ MODE ANGLE - version 2 record, laptop-flat vectors, orientation kept
+state_record() {
+    le32 2; le32 "$1"; le64 0
+    le32 0; le32 0; le32 1000000
+    le32 0; le32 0; le32 -1000000
+    le8 "$2"; le8 255; le16 "$3"; le32 0
+}
+
+# Field of the record in $RECORD: record_field OFFSET TYPE (od -t type)
+record_field() {
+    od -An -t "$2" -j "$1" -N "${2#?}" "$RECORD" | tr -d ' '
+}
+
+# IIO directory whose name attribute is $2 (devices when $1 is iio:device, else trigger)
+iio_find() {
+    for d in "$IIO"/$1*; do
+        if [ "$(cat "$d/name" 2>/dev/null)" = "$2" ]; then
+            echo "$d"
+            return 0
+        fi
+    done
+    return 1
+}
+
+echo "=== CMX Smoke Test ==="
+echo
+
+[ "$(id -u)" = 0 ] || fail "must run as root"
+if pgrep -x cmxd > /dev/null; then
+    fail "stop cmxd first"
+fi
+
+echo "Building against $KDIR..."
+make -C "$KDIR" M="$CMX_DIR" modules 2>&1 | tee "$BUILD_LOG"
+if grep -q "warning:" "$BUILD_LOG"; then
+    fail "build produced warnings"
+fi
+echo
+
+echo "Loading module ($*)..."
+rmmod cmx 2>/dev/null || true
+echo "cmx-smoke: start" > /dev/kmsg
+insmod "$CMX_DIR/cmx.ko" "$@"
+sleep 2
+
+[ -d "$PLATFORM" ] || fail "$PLATFORM not found"
+[ -c /dev/cmx ] || fail "/dev/cmx is not a character device"
+echo "Accelerometers: base=$(cat "$PLATFORM/iio_base_device") lid=$(cat "$PLATFORM/iio_lid_device")"
+echo "Fusion: $(cat "$PLATFORM/fusion")"
+echo
+
+echo "--- /dev/cmx and state"
+dd if=/dev/cmx of="$RECORD" bs=48 count=1 iflag=nonblock status=none
+[ "$(stat -c %s "$RECORD")" = 48 ] || fail "first /dev/cmx read did not return a record"
+[ "$(record_field 0 u4)" = 2 ] || fail "/dev/cmx record is not version 2"
+seq=$(record_field 4 u4)
+
+if [ "$(cat "$PLATFORM/fusion")" != "off" ]; then
+    echo "In-kernel fusion owns the state; skipping state writes"
+else
+    if dd if=/dev/cmx of=/dev/null bs=48 count=1 iflag=nonblock status=none 2>/dev/null; then
+        fail "second /dev/cmx read did not block"
+    fi
+
+    state_record $(( seq + 1 )) 4 3000 | dd of=/dev/cmx bs=48 count=1 iflag=fullblock status=none
+    [ "$(cat "$PLATFORM/mode")" = "tablet" ] || fail "mode did not follow a /dev/cmx write"
+    dd if="$PLATFORM/state" of="$RECORD" bs=48 count=1 status=none
+    [ "$(record_field 42 d2)" = 3000 ] || fail "state does not carry the angle"
+
+    echo laptop > "$PLATFORM/mode"
+    dd if=/dev/cmx of="$RECORD" bs=48 count=1 iflag=nonblock status=none
+    [ "$(record_field 40 u1)" = 1 ] || fail "/dev/cmx did not report the mode write"
+
+    if echo "0 0" > "$PLATFORM/base_vec" 2>/dev/null; then
+        fail "malformed base_vec write accepted"
+    fi
+fi
+echo "ok"
+echo
+
+echo "--- cmx-hinge"
+hinge=$(iio_find iio:device cmx-hinge) || fail "no cmx-hinge IIO device"
+mode_index=$(dd if="$PLATFORM/state" bs=1 skip=40 count=1 status=none | od -An -t u1 | tr -d ' ')
+[ "$(cat "$hinge/in_positionrelative_mode_raw")" = "$mode_index" ] || fail "hinge mode disagrees with state"
+echo "angle: $(cat "$hinge/in_angl_raw" 2>/dev/null || echo unknown) (scale $(cat "$hinge/in_angl_scale"))"
+[ -n "$(iio_find trigger cmx-hinge-update)" ] || fail "no cmx-hinge-update trigger"
+echo "ok"
+echo
+
+echo "--- Sampling trigger"
+if trig=$(iio_find trigger cmx); then
+    echo "frequency: $(cat "$trig/sampling_frequency") Hz"
+    echo 20 > "$trig/sampling_frequency"
+    [ "$(cat "$trig/sampling_frequency")" = 20 ] || fail "sampling_frequency did not take"
+    if echo 0 > "$trig/sampling_frequency" 2>/dev/null; then
+        fail "sampling_frequency accepted 0"
+    fi
+    echo 10 > "$trig/sampling_frequency"
+    echo "ok"
+else
+    echo "not registered (sampling_trigger=0?)"
+fi
+echo
+
+echo "--- IIO bus notifier"
+lid=$(cat "$PLATFORM/iio_lid_device")
+if [ "$lid" = "not_detected" ] || [ ! -d "$MXC4005" ]; then
+    echo "no lid accelerometer; skipped"
+else
+    client=$(basename "$(readlink -f "$IIO/$lid/..")")
+    echo "$client" > "$MXC4005/unbind"
+    sleep 1
+    [ "$(cat "$PLATFORM/iio_lid_device")" = "not_detected" ] || fail "lid device not dropped on unbind"
+    echo "$client" > "$MXC4005/bind"
+    sleep 2
+    lid=$(cat "$PLATFORM/iio_lid_device")
+    [ "$lid" != "not_detected" ] || fail "lid device not found again on bind"
+    if [ -n "$trig" ]; then
+        echo "lid $lid trigger: $(cat "$IIO/$lid/trigger/current_trigger")"
+    fi
+    echo "ok"
+fi
+echo
+
+echo "--- Suspend/resume"
+if [ -w /sys/power/pm_test ]; then
+    resumes=$(cat "$PLATFORM/resume_seq")
+    echo devices > /sys/power/pm_test
+    echo freeze > /sys/power/state || true
+    echo none > /sys/power/pm_test
+    [ "$(cat "$PLATFORM/resume_seq")" = $(( resumes + 1 )) ] || fail "resume_seq did not advance"
+    echo "ok"
+else
+    echo "no /sys/power/pm_test (CONFIG_PM_DEBUG); skipped"
+fi
+echo
+
+echo "--- Unbind and unload"
+# A handle kept open across the unbind, as cmxd keeps its own
+exec 3<> /dev/cmx
+# Removal detaches fusion's buffers and drops the driver's own bindings
+echo cmx > /sys/bus/platform/drivers/cmx/unbind
+[ ! -e /dev/cmx ] || fail "/dev/cmx still present after unbind"
+if state_record 1 1 900 | dd bs=48 count=1 iflag=fullblock status=none >&3 2>/dev/null; then
+    fail "write through a handle from before the unbind succeeded"
+fi
+if dd bs=48 count=1 status=none <&3 >/dev/null 2>&1; then
+    fail "read through a handle from before the unbind succeeded"
+fi
+exec 3>&-
+[ ! -e "$PLATFORM/mode" ] || fail "attributes still present after unbind"
+[ -z "$(iio_find iio:device cmx-hinge)" ] || fail "cmx-hinge still present after unbind"
+# Anything else naming cmx as current_trigger still holds the module
+for d in "$IIO"/iio:device*; do
+    if [ "$(cat "$d/trigger/current_trigger" 2>/dev/null)" = "cmx" ]; then
+        echo > "$d/trigger/current_trigger"
+    fi
+done
+rmmod cmx
+[ ! -d "$PLATFORM" ] || fail "$PLATFORM still present after rmmod"
+echo "ok"
+echo
+
+if dmesg | sed -n '/cmx-smoke: start/,$p' | grep -E "WARNING:|BUG:|Oops|Call Trace|possible .*locking"; then
+    fail "kernel log shows problems"
+fi
+
+echo "=== Smoke Test Passed ==="
@@ -0,0 +1,292 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Event Loop Backend Benchmark
+ *
+ * Runs the shape of cmxd's main loop against stand-ins: two pipes fed by a
+ * producer thread play the IIO buffers, regular files play the kernel
+ * module's base_vec/lid_vec attributes, and socketpairs play event clients
+ * that get a message every --event-every fused samples. Each cycle waits,
+ * drains both "buffers", rewrites both vectors and occasionally broadcasts.
+ *
+ * Reports syscalls per fused sample (counted for poll; io_uring_enter()
+ * calls plus the synchronous client sends for io_uring) and the loop thread's CPU time extrapolated to one
+ * hour. io_uring hands blocking file writes to io-wq worker threads, so the
+ * whole-process CPU (minus the producer) is reported as well. Confirm the
+ * counts with: strace -f -c ./bench-event-loop ...
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include "cmxd-uring.h"
+
+#define SCAN_SIZE   16      /* 3 x le:s16 + pad + s64 timestamp */
+#define CLIENTS     2
+
+struct bench_config {
+    unsigned int rate_hz;           /* Scans per second per sensor */
+    unsigned int seconds;
+    unsigned int event_every;       /* Fused samples per client broadcast */
+    int use_uring;
+};
+
+static int sensor_pipes[2][2];
+static volatile int producing = 1;
+static double producer_cpu = 0.0;
+
+static double now_sec(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double rusage_cpu(int who)
+{
+    struct rusage ru;
+    getrusage(who, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+static void bench_log(const char *level, const char *fmt, ...)
+{
+    va_list args;
+
+    if (strcmp(level, "DEBUG") == 0) {
+        return;
+    }
+    va_start(args, fmt);
+    fprintf(stderr, "[%s] ", level);
+    vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+/* Write one scan to each sensor pipe at the configured rate */
+static void *producer_thread(void *arg)
+{
+    const struct bench_config *cfg = arg;
+    struct timespec next;
+    uint8_t scan[SCAN_SIZE] = { 0 };
+    uint64_t seq = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (producing) {
+        memcpy(scan + 8, &seq, sizeof(seq));
+        if (write(sensor_pipes[0][1], scan, sizeof(scan)) < 0 ||
+            write(sensor_pipes[1][1], scan, sizeof(scan)) < 0) {
+            break;
+        }
+        seq++;
+
+        next.tv_nsec += 1000000000L / cfg->rate_hz;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+
+    producer_cpu = rusage_cpu(RUSAGE_THREAD);
+    return NULL;
+}
+
+/* Format a vector like cmxd_write_vector() does */
+static size_t format_vector(char *out, size_t size, uint64_t seq)
+{
+    return (size_t)snprintf(out, size, "%d %d %d\n", (int)(seq % 997), -(int)(seq % 991), 9800);
+}
+
+static int run(const struct bench_config *cfg)
+{
+    char attr_paths[2][64] = { "/tmp/bench-base_vec.XXXXXX", "/tmp/bench-lid_vec.XXXXXX" };
+    int attr_fds[2], clients[CLIENTS][2];
+    uint8_t buffer[CMXD_URING_READ_SIZE];
+    struct pollfd fds[2];
+    pthread_t producer;
+    uint64_t fused = 0, syscalls = 0, pending[2] = { 0, 0 };
+    double wall_start, cpu_start, proc_start;
+
+    for (int i = 0; i < 2; i++) {
+        attr_fds[i] = mkstemp(attr_paths[i]);
+        if (attr_fds[i] < 0 || pipe2(sensor_pipes[i], O_CLOEXEC) < 0) {
+            perror("setup");
+            return -1;
+        }
+        unlink(attr_paths[i]);
+        fcntl(sensor_pipes[i][0], F_SETFL, O_NONBLOCK);
+        fds[i].fd = sensor_pipes[i][0];
+        fds[i].events = POLLIN;
+    }
+    for (int i = 0; i < CLIENTS; i++) {
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, clients[i]) < 0) {
+            perror("socketpair");
+            return -1;
+        }
+        fcntl(clients[i][1], F_SETFL, O_NONBLOCK);
+    }
+
+    if (cfg->use_uring && cmxd_uring_init(bench_log) < 0) {
+        fprintf(stderr, "io_uring backend unavailable\n");
+        return -1;
+    }
+
+    pthread_create(&producer, NULL, producer_thread, (void *)cfg);
+    wall_start = now_sec(CLOCK_MONOTONIC);
+    cpu_start = rusage_cpu(RUSAGE_THREAD);
+    proc_start = rusage_cpu(RUSAGE_SELF);
+
+    while (now_sec(CLOCK_MONOTONIC) - wall_start < cfg->seconds) {
+        int ready;
+
+        if (cfg->use_uring) {
+            const size_t read_sizes[2] = { sizeof(buffer), sizeof(buffer) };
+            ready = cmxd_uring_wait(fds, 2, read_sizes, 1000);
+        } else {
+            ready = poll(fds, 2, 1000);
+            syscalls++;
+        }
+        if (ready < 0 && errno != EINTR) {
+            perror("wait");
+            break;
+        }
+
+        /* Drain each sensor and rewrite its vector */
+        for (int i = 0; i < 2; i++) {
+            char vec[32];
+            ssize_t len;
+
+            if (!(fds[i].revents & POLLIN)) {
+                continue;
+            }
+            if (cfg->use_uring) {
+                cmxd_uring_read_data(i, &len);
+            } else {
+                len = read(fds[i].fd, buffer, sizeof(buffer));
+                syscalls++;
+            }
+            if (len <= 0) {
+                continue;
+            }
+            pending[i] += (uint64_t)len / SCAN_SIZE;
+
+            size_t vlen = format_vector(vec, sizeof(vec), pending[i]);
+            if (!cfg->use_uring || cmxd_uring_queue_write(attr_fds[i], vec, vlen, NULL, NULL) < 0) {
+                if (pwrite(attr_fds[i], vec, vlen, 0) < 0) {
+                    perror("pwrite");
+                }
+                syscalls++;
+            }
+        }
+
+        /* Pair scans and broadcast every so often */
+        while (pending[0] > 0 && pending[1] > 0) {
+            pending[0]--;
+            pending[1]--;
+            fused++;
+            if (cfg->event_every && fused % cfg->event_every == 0) {
+                static const char msg[] = "EVENT mode laptop tablet\n";
+                /* cmxd sends to socket clients synchronously with either backend */
+                for (int c = 0; c < CLIENTS; c++) {
+                    send(clients[c][0], msg, sizeof(msg) - 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+                    syscalls++;
+                }
+            }
+        }
+
+        /* Clients consume off the clock; not part of the daemon's cost */
+    }
+
+    double wall = now_sec(CLOCK_MONOTONIC) - wall_start;
+    double cpu = rusage_cpu(RUSAGE_THREAD) - cpu_start;
+    producing = 0;
+    pthread_join(producer, NULL);
+    double proc = rusage_cpu(RUSAGE_SELF) - proc_start - producer_cpu;
+
+    if (cfg->use_uring) {
+        const struct cmxd_uring_stats *st = cmxd_uring_get_stats();
+        syscalls += st->enters;
+        cmxd_uring_cleanup();
+    }
+
+    printf("backend          %s\n", cfg->use_uring ? "io_uring" : "poll");
+    printf("rate             %u Hz per sensor, %.1f s\n", cfg->rate_hz, wall);
+    printf("fused samples    %llu\n", (unsigned long long)fused);
+    printf("syscalls         %llu (%.2f per fused sample)\n", (unsigned long long)syscalls,
+           fused ? (double)syscalls / fused : 0.0);
+    printf("loop CPU         %.3f s (%.1f s per hour)\n", cpu, cpu * 3600.0 / wall);
+    printf("process CPU      %.3f s (%.1f s per hour, incl. kernel workers)\n", proc, proc * 3600.0 / wall);
+
+    for (int i = 0; i < 2; i++) {
+        close(attr_fds[i]);
+        close(sensor_pipes[i][0]);
+        close(sensor_pipes[i][1]);
+    }
+    for (int i = 0; i < CLIENTS; i++) {
+        close(clients[i][0]);
+        close(clients[i][1]);
+    }
+    return 0;
+}
+
+static void usage(const char *prog)
+{
+    printf("Usage: %s [-b poll|uring] [-r HZ] [-d SECONDS] [-e N]\n", prog);
+    printf("  -b, --backend      Event loop backend (default: poll)\n");
+    printf("  -r, --rate         Scans per second per sensor (default: 100)\n");
+    printf("  -d, --duration     Seconds to run (default: 10)\n");
+    printf("  -e, --event-every  Fused samples per client broadcast, 0 = never (default: 50)\n");
+}
+
+int main(int argc, char **argv)
+{
+    struct bench_config cfg = { .rate_hz = 100, .seconds = 10, .event_every = 50, .use_uring = 0 };
+    static const struct option options[] = {
+        {"backend",     required_argument, 0, 'b'},
+        {"rate",        required_argument, 0, 'r'},
+        {"duration",    required_argument, 0, 'd'},
+        {"event-every", required_argument, 0, 'e'},
+        {"help",        no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "b:r:d:e:h", options, NULL)) != -1) {
+        switch (opt) {
+            case 'b':
+                cfg.use_uring = strcmp(optarg, "uring") == 0 || strcmp(optarg, "io_uring") == 0;
+                break;
+            case 'r':
+                cfg.rate_hz = (unsigned int)strtoul(optarg, NULL, 10);
+                break;
+            case 'd':
+                cfg.seconds = (unsigned int)strtoul(optarg, NULL, 10);
+                break;
+            case 'e':
+                cfg.event_every = (unsigned int)strtoul(optarg, NULL, 10);
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (cfg.rate_hz == 0 || cfg.seconds == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    return run(&cfg) < 0 ? 1 : 0;
+}
@@ -0,0 +1,325 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Per-Pair Fusion Microbenchmark
+ *
+ * Runs the fusion and classification that cmxd does for every base/lid
+ * pair two ways over the same synthetic samples: the per-call path the
+ * daemon used before fused frames (every helper rescales the raw samples
+ * and recomputes magnitudes, dot product and acos), and the frame path
+ * (scale once, derive each quantity on first use). Each pass starts from
+ * a fresh fold-back and mode state, so their hinge angles, modes and
+ * orientations must match exactly; the report lists any pair where they
+ * don't. The integer path (cmxd-fixed.c) is timed alongside; it makes no
+ * libm calls and takes about 0.6 of the frame path's time on the tour
+ * script, a little of which is the counting below. replay-fusion checks
+ * its decisions.
+ *
+ * The build force-includes bench-math-count.h, so sqrt() and acos() calls
+ * are counted per pair alongside the time. The counting adds a few
+ * nanoseconds per call to both paths.
+ *
+ *     ./bench-fusion -s tour -i 50
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <getopt.h>
+#include <time.h>
+#include "cmxd-data.h"
+#include "cmxd-synth.h"
+#include "cmxd-calculations.h"
+#include "cmxd-fixed.h"
+#include "cmxd-modes.h"
+#include "cmxd-orientation.h"
+#include "cmxd-protocol.h"
+
+unsigned long long bench_sqrt_calls;
+unsigned long long bench_acos_calls;
+
+struct bench_config {
+    struct cmxd_synth_config synth;
+    unsigned int iterations;
+};
+
+/* What one pair decides */
+struct decision {
+    double hinge_angle;
+    const char *mode;
+    const char *orientation;
+};
+
+struct path_result {
+    uint64_t ns;
+    unsigned long long sqrt_calls;
+    unsigned long long acos_calls;
+};
+
+static volatile double sink;
+static int32_t fixed_scale_q;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void bench_log(const char *level, const char *fmt, ...)
+{
+    va_list args;
+
+    if (strcmp(level, "ERROR") != 0 && strcmp(level, "WARN") != 0) {
+        return;
+    }
+    va_start(args, fmt);
+    fprintf(stderr, "[%s] ", level);
+    vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+/* process_sensor_pair() before fused frames */
+static void decide_per_call(const struct accel_sample *base, const struct accel_sample *lid, double scale,
+                            struct decision *d)
+{
+    double bx, by, bz, lx, ly, lz;
+    double lid_horizontal;
+
+    d->hinge_angle = cmxd_calculate_hinge_angle_360(base, lid, scale, scale);
+    cmxd_convert_to_ms2(base, scale, &bx, &by, &bz);
+    cmxd_convert_to_ms2(lid, scale, &lx, &ly, &lz);
+    double base_mag = cmxd_calculate_magnitude(bx, by, bz);
+    double lid_mag = cmxd_calculate_magnitude(lx, ly, lz);
+
+    double raw_hinge_angle = cmxd_calculate_hinge_angle(base, lid, scale, scale);
+    double base_horizontal = cmxd_calculate_horizontal_magnitude(bx, by);
+    if (raw_hinge_angle >= 70 && raw_hinge_angle <= 110) {
+        lid_horizontal = cmxd_calculate_horizontal_magnitude(ly, lz);
+    } else {
+        lid_horizontal = cmxd_calculate_horizontal_magnitude(lx, ly);
+    }
+
+    d->mode = CMXD_PROTOCOL_MODE_LAPTOP;
+    if (d->hinge_angle >= 0) {
+        int code = cmxd_get_device_orientation(lid->x, lid->y, lid->z);
+        d->mode = cmxd_get_stable_device_mode_with_gravity(d->hinge_angle, code, base_mag, lid_mag,
+                                                           base_horizontal + lid_horizontal);
+    }
+    d->orientation = cmxd_get_orientation_with_sensor_switching(lid->x, lid->y, lid->z,
+                                                                base->x, base->y, base->z, d->mode);
+
+    /* The rate controller reads the scaled vectors too */
+    sink = bx + by + bz + lx + ly + lz;
+}
+
+/* process_sensor_pair() now */
+static void decide_frame(const struct accel_sample *base, const struct accel_sample *lid, double scale,
+                         struct decision *d)
+{
+    struct cmxd_frame frame;
+
+    cmxd_frame_init(&frame, base, lid, scale, scale);
+    d->hinge_angle = cmxd_frame_hinge_angle_360(&frame);
+
+    d->mode = CMXD_PROTOCOL_MODE_LAPTOP;
+    if (d->hinge_angle >= 0) {
+        int code = cmxd_get_device_orientation(frame.lid[0], frame.lid[1], frame.lid[2]);
+        d->mode = cmxd_get_stable_device_mode_for_frame(&frame, d->hinge_angle, code);
+    }
+    d->orientation = cmxd_get_orientation_for_frame(&frame, d->mode);
+
+    sink = frame.base[0] + frame.base[1] + frame.base[2] + frame.lid[0] + frame.lid[1] + frame.lid[2];
+}
+
+/* process_sensor_pair() with --fixed-point; the scale is converted once */
+static void decide_fixed(const struct accel_sample *base, const struct accel_sample *lid, double scale,
+                         struct decision *d)
+{
+    struct cmx_pair pair;
+
+    (void)scale;
+    cmxd_fixed_pair_init(&pair, base, lid, fixed_scale_q, fixed_scale_q);
+    int angle = cmxd_fixed_hinge_angle_360(&pair);
+    d->hinge_angle = angle < 0 ? -1.0 : angle / 10.0;
+
+    d->mode = CMXD_PROTOCOL_MODE_LAPTOP;
+    if (angle >= 0) {
+        int code = cmxd_get_device_orientation_fixed(pair.lid);
+        d->mode = cmxd_get_stable_device_mode_for_fixed_pair(&pair, angle, code);
+    }
+    d->orientation = cmxd_get_orientation_for_fixed_pair(&pair, d->mode);
+
+    sink = pair.base[0] + pair.base[1] + pair.base[2] + pair.lid[0] + pair.lid[1] + pair.lid[2];
+}
+
+typedef void (*decide_fn)(const struct accel_sample *base, const struct accel_sample *lid, double scale,
+                          struct decision *d);
+
+/* One pass over every pair from a clean mode state; decisions are kept if out is set */
+static void run_pass(decide_fn decide, const struct accel_sample *base, const struct accel_sample *lid,
+                     size_t count, struct decision *out, struct path_result *res)
+{
+    struct decision d;
+    unsigned long long sqrt_start = bench_sqrt_calls, acos_start = bench_acos_calls;
+
+    cmxd_calculations_reset();
+    cmxd_fixed_reset();
+    cmxd_modes_init();
+    cmxd_orientation_init();
+
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < count; i++) {
+        decide(&base[i], &lid[i], CMXD_SYNTH_SCALE, out ? &out[i] : &d);
+    }
+    res->ns += now_ns() - start;
+    res->sqrt_calls += bench_sqrt_calls - sqrt_start;
+    res->acos_calls += bench_acos_calls - acos_start;
+}
+
+static int run(const struct bench_config *cfg)
+{
+    if (cmxd_synth_init(&cfg->synth, bench_log) < 0) {
+        return -1;
+    }
+    fixed_scale_q = cmxd_fixed_scale(CMXD_SYNTH_SCALE);
+
+    uint64_t period_ns = 1000000000ULL / cfg->synth.rate_hz;
+    size_t count = (size_t)(cmxd_synth_script_ns() / period_ns) + 1;
+    struct accel_sample *base = calloc(count, sizeof(*base));
+    struct accel_sample *lid = calloc(count, sizeof(*lid));
+    struct decision *per_call = calloc(count, sizeof(*per_call));
+    struct decision *framed = calloc(count, sizeof(*framed));
+    if (!base || !lid || !per_call || !framed) {
+        fprintf(stderr, "Out of memory for %zu pairs\n", count);
+        return -1;
+    }
+
+    uint64_t start = cmxd_synth_start_ns();
+    for (size_t i = 0; i < count; i++) {
+        cmxd_synth_sample(false, start + i * period_ns, &base[i]);
+        cmxd_synth_sample(true, start + i * period_ns, &lid[i]);
+    }
+
+    /* First pass of each path: check they decide the same */
+    struct path_result per_call_res = { 0 }, frame_res = { 0 }, fixed_res = { 0 };
+    run_pass(decide_per_call, base, lid, count, per_call, &per_call_res);
+    run_pass(decide_frame, base, lid, count, framed, &frame_res);
+    run_pass(decide_fixed, base, lid, count, NULL, &fixed_res);
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (per_call[i].hinge_angle != framed[i].hinge_angle ||
+            strcmp(per_call[i].mode, framed[i].mode) != 0 ||
+            strcmp(per_call[i].orientation, framed[i].orientation) != 0) {
+            if (mismatches++ < 10) {
+                printf("  pair %zu: per-call %.6f %s %s, frame %.6f %s %s\n", i,
+                       per_call[i].hinge_angle, per_call[i].mode, per_call[i].orientation,
+                       framed[i].hinge_angle, framed[i].mode, framed[i].orientation);
+            }
+        }
+    }
+
+    /* Alternate the paths so frequency scaling hits both alike */
+    for (unsigned int it = 1; it < cfg->iterations; it++) {
+        run_pass(decide_per_call, base, lid, count, NULL, &per_call_res);
+        run_pass(decide_frame, base, lid, count, NULL, &frame_res);
+        run_pass(decide_fixed, base, lid, count, NULL, &fixed_res);
+    }
+
+    double pairs = (double)count * cfg->iterations;
+    printf("\nsource           %s, %zu pairs at %u Hz, noise %.3f, shake %.3f\n",
+           cfg->synth.script[0] ? cfg->synth.script : "tour", count, cfg->synth.rate_hz,
+           cfg->synth.noise, cfg->synth.shake);
+    printf("iterations       %u\n", cfg->iterations);
+    printf("mismatches       %zu\n", mismatches);
+    printf("\n%-10s %10s %10s %10s\n", "path", "ns/pair", "sqrt/pair", "acos/pair");
+    printf("%-10s %10.1f %10.2f %10.2f\n", "per-call", per_call_res.ns / pairs,
+           per_call_res.sqrt_calls / pairs, per_call_res.acos_calls / pairs);
+    printf("%-10s %10.1f %10.2f %10.2f\n", "frame", frame_res.ns / pairs,
+           frame_res.sqrt_calls / pairs, frame_res.acos_calls / pairs);
+    printf("%-10s %10.1f %10.2f %10.2f\n", "fixed", fixed_res.ns / pairs,
+           fixed_res.sqrt_calls / pairs, fixed_res.acos_calls / pairs);
+    if (frame_res.ns && fixed_res.ns) {
+        printf("speedup          %.2fx frame\n", (double)per_call_res.ns / frame_res.ns);
+        printf("fixed/frame      %.2fx the time\n", (double)fixed_res.ns / frame_res.ns);
+    }
+
+    free(base);
+    free(lid);
+    free(per_call);
+    free(framed);
+    return mismatches ? 1 : 0;
+}
+
+static void usage(const char *prog)
+{
+    printf("Usage: %s [OPTIONS]\n", prog);
+    printf("  -s, --script NAME|FILE  Motion script (default: tour)\n");
+    printf("  -r, --rate HZ           Pairs per second of script time (default: 1000)\n");
+    printf("  -i, --iterations N      Passes over the script per path (default: 20)\n");
+    printf("  -n, --noise MS2         Sensor noise RMS in m/s^2 (default: 0.05)\n");
+    printf("  -k, --shake MS2         Hand tremor amplitude in m/s^2 (default: 0)\n");
+    printf("  -S, --seed N            Noise seed (default: 1)\n");
+    printf("\nBuilt-in scripts:\n");
+    cmxd_synth_list_scripts(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    struct bench_config cfg = {
+        .synth = {
+            .rate_hz = 1000,
+            .noise = 0.05,
+            .shake = 0.0,
+            .seed = 1,
+        },
+        .iterations = 20,
+    };
+    static const struct option options[] = {
+        {"script",     required_argument, 0, 's'},
+        {"rate",       required_argument, 0, 'r'},
+        {"iterations", required_argument, 0, 'i'},
+        {"noise",      required_argument, 0, 'n'},
+        {"shake",      required_argument, 0, 'k'},
+        {"seed",       required_argument, 0, 'S'},
+        {"help",       no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "s:r:i:n:k:S:h", options, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                snprintf(cfg.synth.script, sizeof(cfg.synth.script), "%s", optarg);
+                break;
+            case 'r':
+                cfg.synth.rate_hz = (unsigned int)strtoul(optarg, NULL, 10);
+                break;
+            case 'i':
+                cfg.iterations = (unsigned int)strtoul(optarg, NULL, 10);
+                break;
+            case 'n':
+                cfg.synth.noise = strtod(optarg, NULL);
+                break;
+            case 'k':
+                cfg.synth.shake = strtod(optarg, NULL);
+                break;
+            case 'S':
+                cfg.synth.seed = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (cfg.iterations == 0 || cfg.synth.rate_hz == 0 || cfg.synth.rate_hz > CMXD_SYNTH_MAX_HZ) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    return run(&cfg) == 0 ? 0 : 1;
+}
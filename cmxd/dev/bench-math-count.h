@@ -0,0 +1,35 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * libm Call Counting for bench-fusion
+ *
+ * Force-included (-include) into every source of the bench-fusion build so
+ * sqrt() and acos() calls made by the fusion code are counted. The counters
+ * live in bench-fusion.c.
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#ifndef BENCH_MATH_COUNT_H
+#define BENCH_MATH_COUNT_H
+
+#include <math.h>
+
+extern unsigned long long bench_sqrt_calls;
+extern unsigned long long bench_acos_calls;
+
+static inline double bench_sqrt(double x)
+{
+    bench_sqrt_calls++;
+    return (sqrt)(x);
+}
+
+static inline double bench_acos(double x)
+{
+    bench_acos_calls++;
+    return (acos)(x);
+}
+
+#define sqrt(x) bench_sqrt(x)
+#define acos(x) bench_acos(x)
+
+#endif /* BENCH_MATH_COUNT_H */
@@ -0,0 +1,456 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Sensor Pipeline Throughput Benchmark
+ *
+ * Feeds the synthetic motion source through the same stages as cmxd's main
+ * loop: buffer drain, vector writes, timestamp pairing, fusion (hinge angle,
+ * magnitudes, gravity confidence), mode and orientation classification, and
+ * publishing changes through the sysfs writers and the Unix socket event
+ * server. Sysfs attributes are regular files in a scratch directory and one
+ * client stays connected to the event socket.
+ *
+ * Unpaced (the default) the generator returns full batches as fast as they
+ * are read, so the result is the pipeline's throughput ceiling and the time
+ * spent per fused sample in each stage. With --paced the generator follows
+ * the wall clock at --rate and the report shows whether the pipeline keeps
+ * up (dropped scans) at that rate.
+ *
+ * Every published mode change is listed with the scripted move that caused
+ * it, in sample time, so detection latency can be compared between runs.
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <errno.h>
+#include <getopt.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "cmxd-data.h"
+#include "cmxd-synth.h"
+#include "cmxd-pairing.h"
+#include "cmxd-calculations.h"
+#include "cmxd-modes.h"
+#include "cmxd-orientation.h"
+#include "cmxd-events.h"
+#include "cmxd-protocol.h"
+
+enum {
+    STAGE_ACQUIRE,          /* Drain both buffers */
+    STAGE_VECTORS,          /* Scale and write the newest vectors */
+    STAGE_PAIR,             /* Timestamp pairing */
+    STAGE_FUSE,             /* Scaling and hinge angle */
+    STAGE_CLASSIFY,         /* Gravity confidence, mode and orientation */
+    STAGE_PUBLISH,          /* Sysfs writes and socket events on change */
+    STAGE_COUNT
+};
+
+static const char *stage_names[STAGE_COUNT] = {
+    "acquire", "vectors", "pair", "fuse", "classify", "publish"
+};
+
+struct bench_config {
+    struct cmxd_synth_config synth;
+    unsigned int seconds;
+    int quiet;                      /* Don't list mode changes */
+};
+
+static uint64_t stage_ns[STAGE_COUNT];
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void bench_log(const char *level, const char *fmt, ...)
+{
+    va_list args;
+
+    /* Per-event INFO lines would dominate the publish stage */
+    if (strcmp(level, "ERROR") != 0 && strcmp(level, "WARN") != 0) {
+        return;
+    }
+    va_start(args, fmt);
+    fprintf(stderr, "[%s] ", level);
+    vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+/* Time a stage and charge it */
+#define STAGE(stage, ...) do {                      \
+        uint64_t stage_start_ = now_ns();           \
+        __VA_ARGS__;                                \
+        stage_ns[stage] += now_ns() - stage_start_; \
+    } while (0)
+
+/* Fused quantities, computed the way process_sensor_pair() does */
+struct fused {
+    struct cmxd_frame frame;
+    double hinge_angle;
+};
+
+static void fuse_pair(const struct accel_sample *base, const struct accel_sample *lid, double scale,
+                      struct fused *f)
+{
+    cmxd_frame_init(&f->frame, base, lid, scale, scale);
+    f->hinge_angle = cmxd_frame_hinge_angle_360(&f->frame);
+}
+
+static int make_attributes(const char *dir)
+{
+    static const char *attrs[] = { "base_vec", "lid_vec", "mode", "orientation" };
+    char path[PATH_MAX];
+
+    for (size_t i = 0; i < sizeof(attrs) / sizeof(attrs[0]); i++) {
+        snprintf(path, sizeof(path), "%s/%s", dir, attrs[i]);
+        FILE *fp = fopen(path, "w");
+        if (!fp) {
+            perror(path);
+            return -1;
+        }
+        fclose(fp);
+    }
+    return 0;
+}
+
+static int connect_client(const char *socket_path)
+{
+    struct sockaddr_un addr;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+
+    if (fd < 0) {
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-truncation"
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path);
+#pragma GCC diagnostic pop
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Keep the client's receive queue from filling up */
+static void drain_client(int fd)
+{
+    char buf[4096];
+
+    while (read(fd, buf, sizeof(buf)) > 0) {
+    }
+}
+
+static int run(const struct bench_config *cfg)
+{
+    char dir[] = "/tmp/bench-pipeline.XXXXXX";
+    struct cmxd_data_config data_cfg;
+    struct cmxd_events_config events_cfg;
+    struct iio_buffer base_buf, lid_buf;
+    struct accel_sample base_batch[CMXD_IIO_MAX_BATCH], lid_batch[CMXD_IIO_MAX_BATCH];
+    struct cmxd_pairing pairing;
+    struct cmxd_pair_config pair_cfg = {
+        .tolerance_ns = CMXD_PAIR_DEFAULT_TOLERANCE_MS * 1000000ULL,
+        .max_staleness_ns = CMXD_PAIR_DEFAULT_STALENESS_MS * 1000000ULL,
+        .interpolate = true,
+    };
+    struct pollfd fds[2];
+    uint64_t fused_count = 0, mode_changes = 0, first_ts = 0;
+    uint64_t wall_start, wall_ns;
+    char last_mode[32] = "";
+    char last_truth[CMXD_SYNTH_LABEL_MAX] = "";
+    uint64_t truth_since = 0;
+    double scale;
+    int client;
+
+    if (!mkdtemp(dir) || make_attributes(dir) < 0) {
+        perror("scratch directory");
+        return -1;
+    }
+
+    if (cmxd_synth_init(&cfg->synth, bench_log) < 0) {
+        return -1;
+    }
+
+    memset(&data_cfg, 0, sizeof(data_cfg));
+    snprintf(data_cfg.sysfs_path, sizeof(data_cfg.sysfs_path), "%s", dir);
+    data_cfg.buffer_length = cfg->synth.buffer_length;
+    data_cfg.buffer_watermark = cfg->synth.watermark;
+    data_cfg.source = cmxd_synth_source();
+    cmxd_data_init(&data_cfg, bench_log);
+
+    memset(&events_cfg, 0, sizeof(events_cfg));
+    events_cfg.enable_unix_socket = 1;
+    snprintf(events_cfg.unix_socket_path, sizeof(events_cfg.unix_socket_path), "%s/cmxd.sock", dir);
+    if (cmxd_events_init(&events_cfg, bench_log) < 0) {
+        return -1;
+    }
+    client = connect_client(events_cfg.unix_socket_path);
+    if (client < 0) {
+        fprintf(stderr, "Failed to connect to the event socket\n");
+    }
+    /* Let the event server accept the client before scans start */
+    usleep(100000);
+
+    cmxd_modes_init();
+    cmxd_orientation_init();
+    cmxd_pairing_init(&pairing, &pair_cfg);
+
+    if (cmxd_setup_iio_buffer(&base_buf, CMXD_SYNTH_BASE_DEVICE, NULL) < 0 ||
+        cmxd_setup_iio_buffer(&lid_buf, CMXD_SYNTH_LID_DEVICE, NULL) < 0) {
+        return -1;
+    }
+    scale = cmxd_read_accel_scale(CMXD_SYNTH_BASE_DEVICE);
+    fds[0].fd = base_buf.buffer_fd;
+    fds[1].fd = lid_buf.buffer_fd;
+    fds[0].events = fds[1].events = POLLIN;
+
+    wall_start = now_ns();
+    while ((wall_ns = now_ns() - wall_start) < cfg->seconds * 1000000000ULL) {
+        int base_count = 0, lid_count = 0;
+        struct accel_sample base_sample, lid_sample;
+
+        if (poll(fds, 2, 1000) < 0 && errno != EINTR) {
+            perror("poll");
+            break;
+        }
+
+        STAGE(STAGE_ACQUIRE, {
+            if (fds[0].revents & POLLIN) {
+                base_count = cmxd_read_iio_buffer_samples(&base_buf, base_batch, CMXD_IIO_MAX_BATCH);
+            }
+            if (fds[1].revents & POLLIN) {
+                lid_count = cmxd_read_iio_buffer_samples(&lid_buf, lid_batch, CMXD_IIO_MAX_BATCH);
+            }
+        });
+        if (base_count < 0 || lid_count < 0) {
+            break;
+        }
+
+        STAGE(STAGE_VECTORS, {
+            int x, y, z;
+            if (base_count > 0) {
+                const struct accel_sample *s = &base_batch[base_count - 1];
+                cmxd_apply_scale(s->x, s->y, s->z, scale, &x, &y, &z);
+                cmxd_write_vector("base", x, y, z);
+            }
+            if (lid_count > 0) {
+                const struct accel_sample *s = &lid_batch[lid_count - 1];
+                cmxd_apply_scale(s->x, s->y, s->z, scale, &x, &y, &z);
+                cmxd_write_vector("lid", x, y, z);
+            }
+        });
+
+        STAGE(STAGE_PAIR, {
+            cmxd_pairing_push(&pairing, CMXD_PAIR_BASE, base_batch, base_count);
+            cmxd_pairing_push(&pairing, CMXD_PAIR_LID, lid_batch, lid_count);
+        });
+
+        for (;;) {
+            struct fused f;
+            const char *mode = CMXD_PROTOCOL_MODE_LAPTOP;
+            const char *orientation;
+            bool more;
+
+            STAGE(STAGE_PAIR, more = cmxd_pairing_next(&pairing, &base_sample, &lid_sample));
+            if (!more) {
+                break;
+            }
+            if (fused_count++ == 0) {
+                first_ts = base_sample.timestamp;
+            }
+
+            STAGE(STAGE_FUSE, fuse_pair(&base_sample, &lid_sample, scale, &f));
+
+            STAGE(STAGE_CLASSIFY, {
+                if (f.hinge_angle >= 0) {
+                    const double *lid = f.frame.lid;
+                    int code = cmxd_get_device_orientation(lid[0], lid[1], lid[2]);
+                    mode = cmxd_get_stable_device_mode_for_frame(&f.frame, f.hinge_angle, code);
+                }
+                orientation = cmxd_get_orientation_for_frame(&f.frame, mode);
+            });
+
+            /* The daemon keeps the last good mode over indeterminate readings */
+            if (strcmp(mode, CMXD_MODE_INDETERMINATE) == 0) {
+                mode = last_mode[0] ? last_mode : CMXD_PROTOCOL_MODE_LAPTOP;
+            }
+
+            /* Track when the script started moving toward each labelled state */
+            struct cmxd_synth_truth truth;
+            cmxd_synth_truth_at(base_sample.timestamp, &truth);
+            if (strcmp(truth.label, last_truth) != 0) {
+                snprintf(last_truth, sizeof(last_truth), "%s", truth.label);
+                truth_since = truth.segment_start;
+            }
+
+            if (strcmp(mode, last_mode) != 0) {
+                mode_changes++;
+                if (!cfg->quiet) {
+                    double at_ms = (base_sample.timestamp - truth_since) / 1e6;
+                    printf("  %8.3f s  %-8s -> %-8s hinge %6.1f  %.0f ms into the %u ms move to %s\n",
+                           (base_sample.timestamp - first_ts) / 1e9, last_mode[0] ? last_mode : "-",
+                           mode, f.hinge_angle, at_ms, truth.segment_ms, truth.label);
+                }
+                snprintf(last_mode, sizeof(last_mode), "%s", mode);
+            }
+
+            STAGE(STAGE_PUBLISH, {
+                cmxd_write_mode_with_events(mode);
+                cmxd_write_orientation_with_events(orientation);
+            });
+        }
+
+        if (client >= 0) {
+            drain_client(client);
+        }
+    }
+
+    uint64_t total = 0;
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        total += stage_ns[i];
+    }
+
+    printf("\nsource           %s, %u Hz %s, noise %.3f, shake %.3f\n",
+           cfg->synth.script[0] ? cfg->synth.script : "tour", cfg->synth.rate_hz,
+           cfg->synth.paced ? "paced" : "unpaced", cfg->synth.noise, cfg->synth.shake);
+    printf("duration         %.2f s\n", wall_ns / 1e9);
+    printf("fused samples    %llu (%.0f per second)\n", (unsigned long long)fused_count,
+           fused_count * 1e9 / wall_ns);
+    printf("pairing          %llu matched, %llu interpolated, %llu stale, %llu/%llu unpaired\n",
+           (unsigned long long)pairing.stats.matched, (unsigned long long)pairing.stats.interpolated,
+           (unsigned long long)pairing.stats.stale, (unsigned long long)pairing.stats.unpaired[0],
+           (unsigned long long)pairing.stats.unpaired[1]);
+    printf("dropped scans    %llu base, %llu lid\n", (unsigned long long)base_buf.stats.samples_lost,
+           (unsigned long long)lid_buf.stats.samples_lost);
+    printf("mode changes     %llu\n", (unsigned long long)mode_changes);
+    printf("\n%-10s %12s %10s %7s\n", "stage", "total ms", "ns/sample", "share");
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        printf("%-10s %12.1f %10.1f %6.1f%%\n", stage_names[i], stage_ns[i] / 1e6,
+               fused_count ? (double)stage_ns[i] / fused_count : 0.0,
+               total ? 100.0 * stage_ns[i] / total : 0.0);
+    }
+    printf("%-10s %12.1f %10.1f\n", "all", total / 1e6, fused_count ? (double)total / fused_count : 0.0);
+    if (total) {
+        printf("ceiling          %.0f fused samples per second on one core\n", fused_count * 1e9 / total);
+    }
+
+    cmxd_cleanup_iio_buffer(&base_buf);
+    cmxd_cleanup_iio_buffer(&lid_buf);
+    if (client >= 0) {
+        close(client);
+    }
+    cmxd_events_cleanup();
+    cmxd_data_cleanup();
+
+    char cmd[PATH_MAX + 16];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", dir);
+    if (system(cmd) != 0) {
+        fprintf(stderr, "Failed to remove %s\n", dir);
+    }
+    return 0;
+}
+
+static void usage(const char *prog)
+{
+    printf("Usage: %s [OPTIONS]\n", prog);
+    printf("  -s, --script NAME|FILE  Motion script (default: tour)\n");
+    printf("  -r, --rate HZ           Scans per second per sensor (default: 10000)\n");
+    printf("  -p, --paced             Follow the wall clock instead of running flat out\n");
+    printf("  -d, --duration SECONDS  Run time (default: 5)\n");
+    printf("  -b, --buffer-length N   Paced backlog before scans drop (default: %d)\n", CMXD_IIO_MAX_BATCH);
+    printf("  -w, --watermark N       Paced scans per wakeup (default: 16)\n");
+    printf("  -n, --noise MS2         Sensor noise RMS in m/s^2 (default: 0.05)\n");
+    printf("  -k, --shake MS2         Hand tremor amplitude in m/s^2 (default: 0)\n");
+    printf("  -S, --seed N            Noise seed (default: 1)\n");
+    printf("  -q, --quiet             Don't list mode changes\n");
+    printf("\nBuilt-in scripts:\n");
+    cmxd_synth_list_scripts(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    struct bench_config cfg = {
+        .synth = {
+            .rate_hz = 10000,
+            .paced = false,
+            .buffer_length = CMXD_IIO_MAX_BATCH,
+            .watermark = 16,
+            .noise = 0.05,
+            .shake = 0.0,
+            .seed = 1,
+        },
+        .seconds = 5,
+        .quiet = 0,
+    };
+    static const struct option options[] = {
+        {"script",        required_argument, 0, 's'},
+        {"rate",          required_argument, 0, 'r'},
+        {"paced",         no_argument,       0, 'p'},
+        {"duration",      required_argument, 0, 'd'},
+        {"buffer-length", required_argument, 0, 'b'},
+        {"watermark",     required_argument, 0, 'w'},
+        {"noise",         required_argument, 0, 'n'},
+        {"shake",         required_argument, 0, 'k'},
+        {"seed",          required_argument, 0, 'S'},
+        {"quiet",         no_argument,       0, 'q'},
+        {"help",          no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "s:r:pd:b:w:n:k:S:qh", options, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                snprintf(cfg.synth.script, sizeof(cfg.synth.script), "%s", optarg);
+                break;
+            case 'r':
+                cfg.synth.rate_hz = (unsigned int)strtoul(optarg, NULL, 10);
+                break;
+            case 'p':
+                cfg.synth.paced = true;
+                break;
+            case 'd':
+                cfg.seconds = (unsigned int)strtoul(optarg, NULL, 10);
+                break;
+            case 'b':
+                cfg.synth.buffer_length = atoi(optarg);
+                break;
+            case 'w':
+                cfg.synth.watermark = atoi(optarg);
+                break;
+            case 'n':
+                cfg.synth.noise = strtod(optarg, NULL);
+                break;
+            case 'k':
+                cfg.synth.shake = strtod(optarg, NULL);
+                break;
+            case 'S':
+                cfg.synth.seed = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+            case 'q':
+                cfg.quiet = 1;
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (cfg.seconds == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    return run(&cfg) < 0 ? 1 : 0;
+}
@@ -0,0 +1,927 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Fake Device Tree for Running cmxd Without Hardware
+ *
+ * Builds a directory tree that looks like the parts of /sys, /dev and /proc
+ * cmxd uses - the cmx module attributes, two buffered IIO accelerometers
+ * with scan_elements, a sysfs trigger, an hrtimer trigger and its configfs
+ * directory - and then plays the kernel's role against it: attribute writes
+ * are picked up with inotify, and while a buffer is enabled scans from the
+ * synthetic motion script are written to a FIFO standing in for the
+ * device's /dev/iio:deviceN node, paced by the trigger the daemon attached.
+ *
+ * Run a command with CMXD_ROOT pointing at the tree:
+ *
+ *     ./fake-root -s tour -d 30 -- ../cmxd -v
+ *
+ * or build the tree and leave it running for a daemon started elsewhere:
+ *
+ *     ./fake-root -o /tmp/cmx-root
+ *
+ * The daemon runs unmodified, so its real syscall and I/O pattern (reads
+ * per wakeup, sysfs writes per sample, trigger retuning) can be measured
+ * and the report counts what it did to the tree. Differences from a real
+ * kernel: attributes are regular files and the daemon rewrites them with
+ * pwrite() at offset 0, so a shorter value leaves the tail of the previous
+ * one behind (only the first line is meaningful); scans below the
+ * watermark stay queued here rather than being readable early; and
+ * identical back-to-back inotify events are merged, so bursts of sysfs
+ * trigger writes may produce fewer scans. The binary "state" attribute is
+ * created too (drop it with --no-state to exercise the text attributes);
+ * --chardev adds /dev/cmx as a plain file, so reads never block; and
+ * --kernel-trigger adds the module's "cmx" trigger, already current on
+ * both devices, which then replaces the daemon's hrtimer trigger.
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <ftw.h>
+#include <endian.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include "cmxd-data.h"
+#include "cmxd-synth.h"
+#include "cmxd-paths.h"
+
+#define SCAN_SIZE           16          /* s16 x, y, z, pad, s64 timestamp */
+#define SYSFS_TRIGGER_NAME  "sysfstrig0"
+#define DEFAULT_HZ          100
+
+struct fake_device {
+    const char *name;
+    bool lid;
+    int fifo_fd;                        /* Our end of the /dev node, O_RDWR */
+    bool enabled;
+    char trigger[32];
+    int watermark;
+    uint8_t pending[CMXD_IIO_MAX_BATCH * SCAN_SIZE];
+    int pending_count;
+    uint64_t scans, dropped, writes, enables;
+};
+
+/* Attributes whose writes we act on or count */
+enum watch_kind {
+    WATCH_DEVICE,                       /* buffer/enable, watermark, current_trigger */
+    WATCH_TRIGGER_NOW,
+    WATCH_HRTIMER_FREQ,
+    WATCH_MODULE_ATTR,
+    WATCH_STATE,
+};
+
+struct watch {
+    int wd;
+    enum watch_kind kind;
+    char path[PATH_MAX];
+    const char *label;
+    uint64_t count;
+};
+
+struct fake_config {
+    struct cmxd_synth_config synth;
+    char root[PATH_MAX];
+    bool keep;                          /* Tree given with -o; don't remove it */
+    bool state;                         /* Create the binary state attribute */
+    bool chardev;                       /* Create /dev/cmx */
+    bool kernel_trigger;                /* Create the module's trigger */
+    unsigned int seconds;               /* 0 runs until the command exits or SIGINT */
+};
+
+static struct fake_device devices[2] = {
+    { .name = "iio:device0", .lid = false, .fifo_fd = -1 },
+    { .name = "iio:device1", .lid = true,  .fifo_fd = -1 },
+};
+
+static struct watch watches[32];
+static int watch_count = 0;
+static char root[PATH_MAX];
+static unsigned int hrtimer_hz = DEFAULT_HZ;
+static uint64_t hrtimer_retunes = 0;
+static bool with_state = true;
+static bool with_chardev = false;
+static const char *timer_trigger = CMXD_HRTIMER_TRIGGER_NAME;  /* Trigger our timer paces */
+static int timer_trigger_id = 1;
+static int state_mode = 1, state_orientation = 1;   /* laptop, landscape */
+static int state_angle = CMXD_ANGLE_UNKNOWN;        /* 0.1 degrees */
+
+/* Index order of the module's valid_modes[] and valid_orientations[] */
+static const char *const kernel_modes[] = { "closing", "laptop", "flat", "tent", "tablet" };
+static const char *const kernel_orientations[] = {
+    "portrait", "landscape", "portrait-flipped", "landscape-flipped"
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void fake_log(const char *level, const char *fmt, ...)
+{
+    va_list args;
+
+    if (strcmp(level, "ERROR") != 0 && strcmp(level, "WARN") != 0) {
+        return;
+    }
+    va_start(args, fmt);
+    fprintf(stderr, "[%s] ", level);
+    vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+/*
+ * =============================================================================
+ * TREE
+ * =============================================================================
+ */
+
+static int tree_path(char *buf, size_t size, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+static int tree_path(char *buf, size_t size, const char *fmt, ...)
+{
+    va_list args;
+    int len = snprintf(buf, size, "%s", root);
+    int n;
+
+    va_start(args, fmt);
+    n = vsnprintf(buf + len, size - len, fmt, args);
+    va_end(args);
+    return (n < 0 || (size_t)n >= size - len) ? -1 : 0;
+}
+
+/* mkdir -p for the directory holding path */
+static int make_parents(const char *path)
+{
+    char dir[PATH_MAX];
+
+    snprintf(dir, sizeof(dir), "%s", path);
+    for (char *p = dir + 1; *p; p++) {
+        if (*p != '/') {
+            continue;
+        }
+        *p = '\0';
+        if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+            fprintf(stderr, "mkdir %s: %s\n", dir, strerror(errno));
+            return -1;
+        }
+        *p = '/';
+    }
+    return 0;
+}
+
+static int put_file(const char *value, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static int put_file(const char *value, const char *fmt, ...)
+{
+    char rel[PATH_MAX], path[PATH_MAX];
+    va_list args;
+    FILE *fp;
+
+    va_start(args, fmt);
+    vsnprintf(rel, sizeof(rel), fmt, args);
+    va_end(args);
+
+    if (tree_path(path, sizeof(path), "%s", rel) < 0 || make_parents(path) < 0) {
+        return -1;
+    }
+    fp = fopen(path, "w");
+    if (!fp) {
+        fprintf(stderr, "create %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    fputs(value, fp);
+    fclose(fp);
+    return 0;
+}
+
+static int put_state(const struct cmxd_kernel_state *state, const char *rel)
+{
+    char path[PATH_MAX];
+    FILE *fp;
+
+    if (tree_path(path, sizeof(path), "%s", rel) < 0 || make_parents(path) < 0) {
+        return -1;
+    }
+    fp = fopen(path, "w");
+    if (!fp) {
+        fprintf(stderr, "create %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    fwrite(state, sizeof(*state), 1, fp);
+    fclose(fp);
+    return 0;
+}
+
+static int build_device(struct fake_device *dev)
+{
+    static const char *axes[] = { "x", "y", "z" };
+    const char *d = dev->name;
+    struct accel_sample s;
+    char value[32];
+    char path[PATH_MAX];
+    int rc = 0;
+
+    cmxd_synth_sample(dev->lid, now_ns(), &s);
+    int raw[3] = { s.x, s.y, s.z };
+
+    for (int i = 0; i < 3; i++) {
+        snprintf(value, sizeof(value), "%d\n", raw[i]);
+        rc |= put_file(value, IIO_DEVICES_PATH "/%s/in_accel_%s_raw", d, axes[i]);
+        snprintf(value, sizeof(value), "%d\n", i);
+        rc |= put_file(value, IIO_DEVICES_PATH "/%s/scan_elements/in_accel_%s_index", d, axes[i]);
+        rc |= put_file("le:s16/16>>0\n", IIO_DEVICES_PATH "/%s/scan_elements/in_accel_%s_type", d, axes[i]);
+        rc |= put_file("0\n", IIO_DEVICES_PATH "/%s/scan_elements/in_accel_%s_en", d, axes[i]);
+    }
+    rc |= put_file("3\n", IIO_DEVICES_PATH "/%s/scan_elements/in_timestamp_index", d);
+    rc |= put_file("le:s64/64>>0\n", IIO_DEVICES_PATH "/%s/scan_elements/in_timestamp_type", d);
+    rc |= put_file("0\n", IIO_DEVICES_PATH "/%s/scan_elements/in_timestamp_en", d);
+
+    snprintf(value, sizeof(value), "%f\n", CMXD_SYNTH_SCALE);
+    rc |= put_file(value, IIO_DEVICES_PATH "/%s/in_accel_scale", d);
+    rc |= put_file("100\n", IIO_DEVICES_PATH "/%s/in_accel_sampling_frequency", d);
+    rc |= put_file("mxc4005\n", IIO_DEVICES_PATH "/%s/name", d);
+    rc |= put_file("0\n", IIO_DEVICES_PATH "/%s/buffer/enable", d);
+    rc |= put_file("2\n", IIO_DEVICES_PATH "/%s/buffer/length", d);
+    rc |= put_file("1\n", IIO_DEVICES_PATH "/%s/buffer/watermark", d);
+    rc |= put_file("\n", IIO_DEVICES_PATH "/%s/trigger/current_trigger", d);
+    if (rc) {
+        return -1;
+    }
+
+    /* The scan stream; opened read-write so the daemon never sees a hangup */
+    tree_path(path, sizeof(path), IIO_DEV_CHAR_TEMPLATE, d);
+    if (make_parents(path) < 0 || (mkfifo(path, 0660) < 0 && errno != EEXIST)) {
+        fprintf(stderr, "mkfifo %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    dev->fifo_fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (dev->fifo_fd < 0) {
+        fprintf(stderr, "open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static int build_tree(void)
+{
+    char value[64];
+    int rc = 0;
+
+    for (int i = 0; i < 2; i++) {
+        if (build_device(&devices[i]) < 0) {
+            return -1;
+        }
+    }
+
+    /* A sysfs trigger, as iio_sysfs_trigger/add_trigger would have made */
+    rc |= put_file(SYSFS_TRIGGER_NAME "\n", IIO_DEVICES_PATH "/trigger0/name");
+    rc |= put_file("0\n", IIO_DEVICES_PATH "/trigger0/trigger_now");
+    rc |= put_file("", IIO_SYSFS_TRIGGER_ADD_PATH);
+
+    /*
+     * The daemon expects its hrtimer trigger to appear as soon as it mkdirs
+     * the configfs entry, so the trigger node exists up front.
+     */
+    rc |= put_file(CMXD_HRTIMER_TRIGGER_NAME "\n", IIO_DEVICES_PATH "/trigger1/name");
+    snprintf(value, sizeof(value), "%u\n", hrtimer_hz);
+    rc |= put_file(value, IIO_DEVICES_PATH "/trigger1/sampling_frequency");
+    rc |= put_file("", IIO_CONFIGFS_HRTIMER_PATH "/.keep");
+
+    /* The module's trigger, bound to both accelerometers at probe */
+    if (timer_trigger_id == 2) {
+        rc |= put_file(CMXD_KERNEL_TRIGGER_NAME "\n", IIO_DEVICES_PATH "/trigger2/name");
+        rc |= put_file(value, IIO_DEVICES_PATH "/trigger2/sampling_frequency");
+        for (int i = 0; i < 2; i++) {
+            rc |= put_file(CMXD_KERNEL_TRIGGER_NAME "\n", IIO_DEVICES_PATH "/%s/trigger/current_trigger",
+                           devices[i].name);
+        }
+    }
+
+    /* The cmx platform device */
+    rc |= put_file("0 0 0\n", CMXD_DEFAULT_SYSFS_PATH "/base_vec");
+    rc |= put_file("0 0 0\n", CMXD_DEFAULT_SYSFS_PATH "/lid_vec");
+    rc |= put_file("laptop\n", CMXD_DEFAULT_SYSFS_PATH "/mode");
+    rc |= put_file("landscape\n", CMXD_DEFAULT_SYSFS_PATH "/orientation");
+    rc |= put_file("iio:device0\n", CMXD_DEFAULT_SYSFS_PATH "/iio_base_device");
+    rc |= put_file("iio:device1\n", CMXD_DEFAULT_SYSFS_PATH "/iio_lid_device");
+    rc |= put_file("i2c-12:0x15\n", CMXD_DEFAULT_SYSFS_PATH "/base_i2c");
+    rc |= put_file("i2c-13:0x15\n", CMXD_DEFAULT_SYSFS_PATH "/lid_i2c");
+    if (with_state || with_chardev) {
+        struct cmxd_kernel_state state = {
+            .version = CMXD_STATE_VERSION,
+            .mode = (uint8_t)state_mode,
+            .orientation = (uint8_t)state_orientation,
+            .angle = (int16_t)state_angle,
+        };
+        if (with_state) {
+            rc |= put_state(&state, CMXD_DEFAULT_SYSFS_PATH "/state");
+        }
+        if (with_chardev) {
+            rc |= put_state(&state, CMXD_DEV_PATH);
+        }
+    }
+
+    /* A fresh boot for the discovery cache, and an empty /run */
+    snprintf(value, sizeof(value), "%08x-0000-4000-8000-%012llx\n",
+             (unsigned int)getpid(), (unsigned long long)now_ns() & 0xffffffffffffULL);
+    rc |= put_file(value, PROC_BOOT_ID_PATH);
+    rc |= put_file("", "/run/.keep");
+
+    return rc ? -1 : 0;
+}
+
+static int remove_entry(const char *path, const struct stat *st, int flag, struct FTW *ftw)
+{
+    (void)st; (void)flag; (void)ftw;
+    if (remove(path) < 0) {
+        fprintf(stderr, "remove %s: %s\n", path, strerror(errno));
+    }
+    return 0;
+}
+
+/*
+ * =============================================================================
+ * KERNEL SIDE
+ * =============================================================================
+ */
+
+/*
+ * First line of an attribute; later bytes are left over from longer writes.
+ * Read-only, so reading never raises another inotify event.
+ */
+static int read_attr(const char *path, char *buf, size_t size)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    ssize_t len;
+
+    if (fd < 0) {
+        return -1;
+    }
+    len = read(fd, buf, size - 1);
+    close(fd);
+    if (len < 0) {
+        return -1;
+    }
+    buf[len] = '\0';
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+/* Apply a state record the way the module does: 0xff keeps the old value */
+static void read_state(const char *path)
+{
+    struct cmxd_kernel_state state;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    ssize_t len;
+
+    if (fd < 0) {
+        return;
+    }
+    len = pread(fd, &state, sizeof(state), 0);
+    close(fd);
+    if (len != (ssize_t)sizeof(state) || state.version != CMXD_STATE_VERSION) {
+        return;
+    }
+    if (state.mode < sizeof(kernel_modes) / sizeof(kernel_modes[0])) {
+        state_mode = state.mode;
+    }
+    if (state.orientation < sizeof(kernel_orientations) / sizeof(kernel_orientations[0])) {
+        state_orientation = state.orientation;
+    }
+    state_angle = state.angle;
+}
+
+static int read_attr_int(const char *path, int fallback)
+{
+    char value[32];
+
+    if (read_attr(path, value, sizeof(value)) < 0 || !value[0]) {
+        return fallback;
+    }
+    return atoi(value);
+}
+
+static void flush_device(struct fake_device *dev)
+{
+    ssize_t len;
+
+    if (dev->pending_count == 0) {
+        return;
+    }
+    len = write(dev->fifo_fd, dev->pending, (size_t)dev->pending_count * SCAN_SIZE);
+    dev->writes++;
+    if (len < 0) {
+        /* Reader fell behind a full pipe: the kfifo would overflow the same way */
+        dev->dropped += (uint64_t)dev->pending_count;
+    } else if (len < (ssize_t)dev->pending_count * SCAN_SIZE) {
+        dev->dropped += (uint64_t)dev->pending_count - (uint64_t)len / SCAN_SIZE;
+    }
+    dev->pending_count = 0;
+}
+
+static void emit_scan(struct fake_device *dev, uint64_t timestamp)
+{
+    struct accel_sample s;
+    uint8_t *scan = dev->pending + dev->pending_count * SCAN_SIZE;
+    uint16_t v;
+    uint64_t ts = htole64(timestamp);
+
+    cmxd_synth_sample(dev->lid, timestamp, &s);
+    memset(scan, 0, SCAN_SIZE);
+    v = htole16((uint16_t)(int16_t)s.x);
+    memcpy(scan + 0, &v, 2);
+    v = htole16((uint16_t)(int16_t)s.y);
+    memcpy(scan + 2, &v, 2);
+    v = htole16((uint16_t)(int16_t)s.z);
+    memcpy(scan + 4, &v, 2);
+    memcpy(scan + 8, &ts, 8);
+
+    dev->scans++;
+    if (++dev->pending_count >= dev->watermark || dev->pending_count >= CMXD_IIO_MAX_BATCH) {
+        flush_device(dev);
+    }
+}
+
+/* Re-read a device's buffer state after the daemon wrote to it */
+static void sync_device(struct fake_device *dev)
+{
+    char path[PATH_MAX];
+    bool enabled;
+
+    tree_path(path, sizeof(path), IIO_TRIGGER_CURRENT_TEMPLATE, dev->name);
+    read_attr(path, dev->trigger, sizeof(dev->trigger));
+
+    tree_path(path, sizeof(path), IIO_BUFFER_WATERMARK_TEMPLATE, dev->name);
+    dev->watermark = read_attr_int(path, 1);
+    if (dev->watermark < 1) {
+        dev->watermark = 1;
+    }
+
+    tree_path(path, sizeof(path), IIO_BUFFER_ENABLE_TEMPLATE, dev->name);
+    enabled = read_attr_int(path, 0) != 0;
+    if (enabled && !dev->enabled) {
+        /* Enabling resets the kfifo: drop whatever the daemon left unread */
+        uint8_t junk[4096];
+        while (read(dev->fifo_fd, junk, sizeof(junk)) > 0) {
+        }
+        dev->enables++;
+    }
+    if (!enabled) {
+        dev->pending_count = 0;
+    }
+    dev->enabled = enabled;
+}
+
+static bool attached(const struct fake_device *dev, const char *trigger)
+{
+    return dev->enabled && strcmp(dev->trigger, trigger) == 0;
+}
+
+/* Run the hrtimer while a buffer is attached to it, at its current rate */
+static void update_hrtimer(int timer_fd)
+{
+    struct itimerspec its = { 0 };
+    bool running = attached(&devices[0], timer_trigger) ||
+                   attached(&devices[1], timer_trigger);
+
+    if (running && hrtimer_hz > 0) {
+        uint64_t period = 1000000000ULL / hrtimer_hz;
+        its.it_interval.tv_sec = (time_t)(period / 1000000000ULL);
+        its.it_interval.tv_nsec = (long)(period % 1000000000ULL);
+        its.it_value = its.it_interval;
+    }
+    timerfd_settime(timer_fd, 0, &its, NULL);
+}
+
+static void fire_trigger(const char *trigger)
+{
+    uint64_t ts = now_ns();
+
+    for (int i = 0; i < 2; i++) {
+        if (attached(&devices[i], trigger)) {
+            emit_scan(&devices[i], ts);
+        }
+    }
+}
+
+static int add_watch(int inotify_fd, enum watch_kind kind, const char *label, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+static int add_watch(int inotify_fd, enum watch_kind kind, const char *label, const char *fmt, ...)
+{
+    struct watch *w = &watches[watch_count];
+    char rel[PATH_MAX];
+    va_list args;
+
+    va_start(args, fmt);
+    vsnprintf(rel, sizeof(rel), fmt, args);
+    va_end(args);
+
+    tree_path(w->path, sizeof(w->path), "%s", rel);
+    w->wd = inotify_add_watch(inotify_fd, w->path, IN_MODIFY | IN_CLOSE_WRITE);
+    if (w->wd < 0) {
+        fprintf(stderr, "inotify %s: %s\n", w->path, strerror(errno));
+        return -1;
+    }
+    w->kind = kind;
+    w->label = label;
+    w->count = 0;
+    watch_count++;
+    return 0;
+}
+
+static int setup_watches(int inotify_fd)
+{
+    static const char *module_attrs[] = { "base_vec", "lid_vec", "mode", "orientation" };
+    int rc = 0;
+
+    for (int i = 0; i < 2; i++) {
+        rc |= add_watch(inotify_fd, WATCH_DEVICE, NULL, IIO_BUFFER_ENABLE_TEMPLATE, devices[i].name);
+        rc |= add_watch(inotify_fd, WATCH_DEVICE, NULL, IIO_BUFFER_WATERMARK_TEMPLATE, devices[i].name);
+        rc |= add_watch(inotify_fd, WATCH_DEVICE, NULL, IIO_TRIGGER_CURRENT_TEMPLATE, devices[i].name);
+    }
+    rc |= add_watch(inotify_fd, WATCH_TRIGGER_NOW, "trigger_now", IIO_TRIGGER_NOW_TEMPLATE, 0);
+    rc |= add_watch(inotify_fd, WATCH_HRTIMER_FREQ, "sampling_frequency", IIO_TRIGGER_SAMPLING_FREQ_TEMPLATE,
+                    timer_trigger_id);
+    for (size_t i = 0; i < sizeof(module_attrs) / sizeof(module_attrs[0]); i++) {
+        rc |= add_watch(inotify_fd, WATCH_MODULE_ATTR, module_attrs[i],
+                        CMXD_DEFAULT_SYSFS_PATH "/%s", module_attrs[i]);
+    }
+    if (with_state) {
+        rc |= add_watch(inotify_fd, WATCH_STATE, "state", CMXD_DEFAULT_SYSFS_PATH "/state");
+    }
+    if (with_chardev) {
+        rc |= add_watch(inotify_fd, WATCH_STATE, CMXD_DEV_PATH, CMXD_DEV_PATH);
+    }
+    return rc ? -1 : 0;
+}
+
+static void handle_inotify(int inotify_fd, int timer_fd)
+{
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+
+    while ((len = read(inotify_fd, events, sizeof(events))) > 0) {
+        for (char *p = events; p < events + len; ) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            p += sizeof(*ev) + ev->len;
+
+            for (int i = 0; i < watch_count; i++) {
+                struct watch *w = &watches[i];
+
+                if (w->wd != ev->wd) {
+                    continue;
+                }
+                switch (w->kind) {
+                    case WATCH_DEVICE:
+                        for (int d = 0; d < 2; d++) {
+                            sync_device(&devices[d]);
+                        }
+                        update_hrtimer(timer_fd);
+                        break;
+                    case WATCH_TRIGGER_NOW:
+                        /* Pulses are single pwrite()s; only MODIFY marks one */
+                        if (ev->mask & IN_MODIFY) {
+                            w->count++;
+                            fire_trigger(SYSFS_TRIGGER_NAME);
+                        }
+                        break;
+                    case WATCH_HRTIMER_FREQ: {
+                        int hz;
+                        if (ev->mask & IN_MODIFY) {
+                            w->count++;
+                        }
+                        hz = read_attr_int(w->path, (int)hrtimer_hz);
+                        if (hz > 0 && (unsigned int)hz != hrtimer_hz) {
+                            hrtimer_hz = (unsigned int)hz;
+                            hrtimer_retunes++;
+                            update_hrtimer(timer_fd);
+                        }
+                        break;
+                    }
+                    case WATCH_MODULE_ATTR:
+                        if (ev->mask & IN_MODIFY) {
+                            w->count++;
+                        }
+                        break;
+                    case WATCH_STATE:
+                        if (ev->mask & IN_MODIFY) {
+                            w->count++;
+                            read_state(w->path);
+                        }
+                        break;
+                }
+            }
+        }
+    }
+}
+
+/*
+ * =============================================================================
+ * RUN
+ * =============================================================================
+ */
+
+static pid_t spawn(char **argv, const sigset_t *old_mask)
+{
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        sigprocmask(SIG_SETMASK, old_mask, NULL);
+        execvp(argv[0], argv);
+        fprintf(stderr, "exec %s: %s\n", argv[0], strerror(errno));
+        _exit(127);
+    }
+    if (pid < 0) {
+        fprintf(stderr, "fork: %s\n", strerror(errno));
+    }
+    return pid;
+}
+
+static void report(double seconds, int status, pid_t child)
+{
+    char path[PATH_MAX];
+    char value[64];
+
+    printf("\nfake-root: %s, %.1f s\n", root, seconds);
+    if (child > 0) {
+        if (WIFEXITED(status)) {
+            printf("  command exited with status %d\n", WEXITSTATUS(status));
+        } else if (WIFSIGNALED(status)) {
+            printf("  command killed by signal %d\n", WTERMSIG(status));
+        }
+    }
+    for (int i = 0; i < 2; i++) {
+        const struct fake_device *dev = &devices[i];
+        printf("  %-12s %-5s scans=%llu (%.1f/s) writes=%llu dropped=%llu enables=%llu trigger=%s\n",
+               dev->name, dev->lid ? "lid" : "base",
+               (unsigned long long)dev->scans, seconds > 0 ? dev->scans / seconds : 0.0,
+               (unsigned long long)dev->writes, (unsigned long long)dev->dropped,
+               (unsigned long long)dev->enables, dev->trigger[0] ? dev->trigger : "-");
+    }
+    printf("  hrtimer      %s at %u Hz, retuned %llu times\n", timer_trigger, hrtimer_hz,
+           (unsigned long long)hrtimer_retunes);
+    for (int i = 0; i < watch_count; i++) {
+        const struct watch *w = &watches[i];
+        if (w->label) {
+            printf("  %-18s %llu writes (%.1f/s)\n", w->label,
+                   (unsigned long long)w->count, seconds > 0 ? w->count / seconds : 0.0);
+        }
+    }
+    if (with_state || with_chardev) {
+        /* Whichever the daemon picked, its last record was applied on receipt */
+        printf("  final mode   %s, orientation %s, angle %.1f (state)\n",
+               kernel_modes[state_mode], kernel_orientations[state_orientation], state_angle / 10.0);
+        return;
+    }
+    tree_path(path, sizeof(path), CMXD_DEFAULT_SYSFS_PATH "/mode");
+    read_attr(path, value, sizeof(value));
+    printf("  final mode   %s", value);
+    tree_path(path, sizeof(path), CMXD_DEFAULT_SYSFS_PATH "/orientation");
+    read_attr(path, value, sizeof(value));
+    printf(", orientation %s\n", value);
+}
+
+static int run(struct fake_config *cfg, char **command)
+{
+    sigset_t mask, old_mask;
+    struct pollfd fds[3];
+    int inotify_fd, timer_fd, signal_fd;
+    pid_t child = 0;
+    int status = 0;
+    uint64_t start, deadline;
+    bool running = true;
+
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (inotify_fd < 0 || timer_fd < 0 || setup_watches(inotify_fd) < 0) {
+        fprintf(stderr, "Failed to watch the tree: %s\n", strerror(errno));
+        return -1;
+    }
+
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, &old_mask);
+    signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd < 0) {
+        fprintf(stderr, "signalfd: %s\n", strerror(errno));
+        return -1;
+    }
+
+    setenv(CMXD_ROOT_ENV, root, 1);
+    if (command[0]) {
+        child = spawn(command, &old_mask);
+        if (child < 0) {
+            return -1;
+        }
+    } else {
+        printf("Fake tree ready; run the daemon with %s=%s (Ctrl-C to stop)\n", CMXD_ROOT_ENV, root);
+        fflush(stdout);
+    }
+
+    start = now_ns();
+    deadline = cfg->seconds ? start + (uint64_t)cfg->seconds * 1000000000ULL : 0;
+
+    fds[0] = (struct pollfd){ .fd = inotify_fd, .events = POLLIN };
+    fds[1] = (struct pollfd){ .fd = timer_fd, .events = POLLIN };
+    fds[2] = (struct pollfd){ .fd = signal_fd, .events = POLLIN };
+
+    while (running) {
+        int timeout = -1;
+
+        if (deadline) {
+            uint64_t now = now_ns();
+            if (now >= deadline) {
+                break;
+            }
+            timeout = (int)((deadline - now + 999999) / 1000000);
+        }
+        if (poll(fds, 3, timeout) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            handle_inotify(inotify_fd, timer_fd);
+        }
+        if (fds[1].revents & POLLIN) {
+            uint64_t expirations;
+            if (read(timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+                /* Missed periods are skipped, as the kernel's hrtimer trigger does */
+                fire_trigger(timer_trigger);
+            }
+        }
+        if (fds[2].revents & POLLIN) {
+            struct signalfd_siginfo si;
+            while (read(signal_fd, &si, sizeof(si)) == sizeof(si)) {
+                if (si.ssi_signo != SIGCHLD) {
+                    running = false;
+                } else if (child > 0 && waitpid(child, &status, WNOHANG) == child) {
+                    running = false;
+                    child = -child;
+                }
+            }
+        }
+    }
+
+    if (child > 0) {
+        kill(child, SIGTERM);
+        waitpid(child, &status, 0);
+    } else if (child < 0) {
+        child = -child;
+    }
+
+    /* Pick up the daemon's shutdown writes */
+    handle_inotify(inotify_fd, timer_fd);
+    report((now_ns() - start) / 1e9, status, child);
+
+    close(signal_fd);
+    close(timer_fd);
+    close(inotify_fd);
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+    if (child > 0 && (!WIFEXITED(status) || WEXITSTATUS(status) != 0)) {
+        return -1;
+    }
+    return 0;
+}
+
+static void usage(const char *prog)
+{
+    printf("Usage: %s [OPTIONS] [-- COMMAND [ARGS...]]\n", prog);
+    printf("  -o, --root DIR          Build the tree in DIR and keep it (default: temporary)\n");
+    printf("  -d, --duration SECONDS  Stop after SECONDS (default: when COMMAND exits or on Ctrl-C)\n");
+    printf("  -s, --script NAME|FILE  Motion script (default: tour)\n");
+    printf("  -n, --noise MS2         Sensor noise RMS in m/s^2 (default: 0.05)\n");
+    printf("  -k, --shake MS2         Hand tremor amplitude in m/s^2 (default: 0)\n");
+    printf("  -S, --seed N            Noise seed (default: 1)\n");
+    printf("      --no-state          Leave out the binary state attribute\n");
+    printf("      --chardev           Add %s (preferred by the daemon over the attribute)\n", CMXD_DEV_PATH);
+    printf("      --kernel-trigger    Add the module's \"%s\" trigger, bound to both devices\n", CMXD_KERNEL_TRIGGER_NAME);
+    printf("\nCOMMAND runs with %s set to the tree and is sent SIGTERM at the deadline.\n", CMXD_ROOT_ENV);
+    printf("\nBuilt-in scripts:\n");
+    cmxd_synth_list_scripts(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    struct fake_config cfg = {
+        .synth = {
+            .rate_hz = DEFAULT_HZ,
+            .paced = false,
+            .noise = 0.05,
+            .shake = 0.0,
+            .seed = 1,
+        },
+        .keep = false,
+        .state = true,
+        .chardev = false,
+        .kernel_trigger = false,
+        .seconds = 0,
+    };
+    static const struct option options[] = {
+        {"root",     required_argument, 0, 'o'},
+        {"duration", required_argument, 0, 'd'},
+        {"script",   required_argument, 0, 's'},
+        {"noise",    required_argument, 0, 'n'},
+        {"shake",    required_argument, 0, 'k'},
+        {"seed",     required_argument, 0, 'S'},
+        {"no-state", no_argument,       0, 'N'},
+        {"chardev",  no_argument,       0, 'C'},
+        {"kernel-trigger", no_argument, 0, 'K'},
+        {"help",     no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+    int opt;
+    int rc;
+
+    while ((opt = getopt_long(argc, argv, "+o:d:s:n:k:S:h", options, NULL)) != -1) {
+        switch (opt) {
+            case 'o':
+                snprintf(cfg.root, sizeof(cfg.root), "%s", optarg);
+                cfg.keep = true;
+                break;
+            case 'd':
+                cfg.seconds = (unsigned int)strtoul(optarg, NULL, 10);
+                break;
+            case 's':
+                snprintf(cfg.synth.script, sizeof(cfg.synth.script), "%s", optarg);
+                break;
+            case 'n':
+                cfg.synth.noise = strtod(optarg, NULL);
+                break;
+            case 'k':
+                cfg.synth.shake = strtod(optarg, NULL);
+                break;
+            case 'S':
+                cfg.synth.seed = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+            case 'N':
+                cfg.state = false;
+                break;
+            case 'C':
+                cfg.chardev = true;
+                break;
+            case 'K':
+                cfg.kernel_trigger = true;
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (cmxd_synth_init(&cfg.synth, fake_log) < 0) {
+        return 1;
+    }
+
+    if (cfg.keep) {
+        if (mkdir(cfg.root, 0755) < 0 && errno != EEXIST) {
+            fprintf(stderr, "mkdir %s: %s\n", cfg.root, strerror(errno));
+            return 1;
+        }
+        if (!realpath(cfg.root, root)) {
+            fprintf(stderr, "realpath %s: %s\n", cfg.root, strerror(errno));
+            return 1;
+        }
+    } else {
+        snprintf(root, sizeof(root), "/tmp/cmxd-root.XXXXXX");
+        if (!mkdtemp(root)) {
+            fprintf(stderr, "mkdtemp: %s\n", strerror(errno));
+            return 1;
+        }
+    }
+
+    with_state = cfg.state;
+    with_chardev = cfg.chardev;
+    if (cfg.kernel_trigger) {
+        timer_trigger = CMXD_KERNEL_TRIGGER_NAME;
+        timer_trigger_id = 2;
+    }
+    rc = build_tree() < 0 ? -1 : run(&cfg, argv + optind);
+
+    for (int i = 0; i < 2; i++) {
+        if (devices[i].fifo_fd >= 0) {
+            close(devices[i].fifo_fd);
+        }
+    }
+    if (!cfg.keep) {
+        nftw(root, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    }
+    return rc < 0 ? 1 : 0;
+}
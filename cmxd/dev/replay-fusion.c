@@ -0,0 +1,361 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Fixed-Point Fusion Replay Check
+ *
+ * Replays synthetic motion scripts through both of cmxd's fusion paths,
+ * the double-precision frame (cmxd-calculations.c) and the integer one
+ * (cmxd-fixed.c), each followed by the same mode and orientation stages,
+ * and compares what they decide pair by pair. Every built-in script is
+ * replayed with several noise seeds, quietly and with hand tremor, unless
+ * a script is given.
+ *
+ * The integer path is the kernel module's (cmx/cmx-fusion.h). It reports
+ * angles in tenths of a degree, so its hinge angle must stay within
+ * --max-error (0.1 degrees) of the double one on every pair; the rounding
+ * alone accounts for 0.05. Its vectors are whole mm/s^2, so a reading
+ * that sits on a threshold can fall on the other side of it:
+ *  - Gravity compensation jumps by up to 7.5 degrees at the edge of its
+ *    zone, so where only one path applies it the angles before
+ *    compensation are compared instead, and the pair counted as a tie.
+ *  - The mode stage can decide such a pair differently for a pair or
+ *    two: pairs decided differently are counted, and the paths must agree
+ *    again within --slip pairs.
+ * A replay that breaks either bound is listed and the exit status is 1.
+ *
+ *     ./replay-fusion
+ *     ./replay-fusion -s tablet -k 1.0 -S 7
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <getopt.h>
+#include "cmxd-data.h"
+#include "cmxd-synth.h"
+#include "cmxd-calculations.h"
+#include "cmxd-fixed.h"
+#include "cmxd-modes.h"
+#include "cmxd-orientation.h"
+#include "cmxd-protocol.h"
+
+static const char *const builtin_scripts[] = {
+    "open", "flat", "tent", "tablet", "slam", "rotate", "tour"
+};
+
+#define SCRIPT_COUNT (int)(sizeof(builtin_scripts) / sizeof(builtin_scripts[0]))
+
+struct replay_config {
+    const char *script;             /* NULL: every built-in script */
+    unsigned int rate_hz;
+    unsigned int seeds;             /* Seeds per script, starting at seed */
+    uint32_t seed;
+    double noise;
+    double shake;                   /* Negative: replay quiet and with tremor */
+    unsigned int slip;              /* Longest run of pairs the paths may disagree for */
+    double max_error;               /* Largest hinge angle difference allowed, degrees */
+};
+
+/* What one pair decides */
+struct decision {
+    double hinge_angle;
+    double sensor_angle;            /* Before gravity compensation, 0-180 */
+    bool compensated;
+    const char *mode;
+    const char *orientation;
+};
+
+struct replay_totals {
+    unsigned long long pairs;
+    unsigned long long diverged;    /* Replays disagreeing for more than slip pairs */
+    unsigned long long mismatches;  /* Pairs decided differently */
+    size_t longest;                 /* Longest run of them */
+    unsigned long long angle_off;   /* Angles more than max_error apart, or only one valid */
+    unsigned long long ties;        /* Pairs only one path compensated */
+    unsigned long long strayed;     /* Replays with any such pair */
+    double max_angle_error;
+};
+
+static void replay_log(const char *level, const char *fmt, ...)
+{
+    va_list args;
+
+    if (strcmp(level, "ERROR") != 0 && strcmp(level, "WARN") != 0) {
+        return;
+    }
+    va_start(args, fmt);
+    fprintf(stderr, "[%s] ", level);
+    vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+static void decide_double(const struct accel_sample *base, const struct accel_sample *lid, struct decision *d)
+{
+    struct cmxd_frame frame;
+
+    cmxd_frame_init(&frame, base, lid, CMXD_SYNTH_SCALE, CMXD_SYNTH_SCALE);
+    d->hinge_angle = cmxd_frame_hinge_angle_360(&frame);
+    d->sensor_angle = cmxd_frame_hinge_angle(&frame);
+    d->compensated = cmxd_frame_gravity_compensated_hinge_angle(&frame) != d->sensor_angle;
+    d->mode = CMXD_PROTOCOL_MODE_LAPTOP;
+    if (d->hinge_angle >= 0) {
+        int code = cmxd_get_device_orientation(frame.lid[0], frame.lid[1], frame.lid[2]);
+        d->mode = cmxd_get_stable_device_mode_for_frame(&frame, d->hinge_angle, code);
+    }
+    d->orientation = cmxd_get_orientation_for_frame(&frame, d->mode);
+}
+
+static void decide_fixed(const struct accel_sample *base, const struct accel_sample *lid, int32_t scale_q,
+                         struct decision *d)
+{
+    struct cmx_pair pair;
+
+    cmxd_fixed_pair_init(&pair, base, lid, scale_q, scale_q);
+    int angle = cmxd_fixed_hinge_angle_360(&pair);
+    d->hinge_angle = angle < 0 ? -1.0 : angle / 10.0;
+    d->sensor_angle = pair.sensor_angle < 0 ? -1.0 : pair.sensor_angle / 100.0;
+    d->compensated = cmx_pair_compensated(&pair) != pair.sensor_angle;
+    d->mode = CMXD_PROTOCOL_MODE_LAPTOP;
+    if (angle >= 0) {
+        int code = cmxd_get_device_orientation_fixed(pair.lid);
+        d->mode = cmxd_get_stable_device_mode_for_fixed_pair(&pair, angle, code);
+    }
+    d->orientation = cmxd_get_orientation_for_fixed_pair(&pair, d->mode);
+}
+
+static bool same_decision(const struct decision *a, const struct decision *b)
+{
+    return strcmp(a->mode, b->mode) == 0 && strcmp(a->orientation, b->orientation) == 0;
+}
+
+/* Replay one script, seed and tremor level through both paths */
+static int replay_one(const char *script, uint32_t seed, const struct replay_config *cfg, double shake,
+                      struct replay_totals *totals)
+{
+    const unsigned int rate_hz = cfg->rate_hz;
+    const double noise = cfg->noise;
+    struct cmxd_synth_config synth = {
+        .rate_hz = rate_hz,
+        .noise = noise,
+        .shake = shake,
+        .seed = seed,
+    };
+    snprintf(synth.script, sizeof(synth.script), "%s", script);
+    if (cmxd_synth_init(&synth, replay_log) < 0) {
+        return -1;
+    }
+
+    uint64_t period_ns = 1000000000ULL / rate_hz;
+    size_t count = (size_t)(cmxd_synth_script_ns() / period_ns) + 1;
+    struct accel_sample *base = calloc(count, sizeof(*base));
+    struct accel_sample *lid = calloc(count, sizeof(*lid));
+    struct decision *doubles = calloc(count, sizeof(*doubles));
+    struct decision *fixed = calloc(count, sizeof(*fixed));
+    if (!base || !lid || !doubles || !fixed) {
+        fprintf(stderr, "Out of memory for %zu pairs\n", count);
+        free(base);
+        free(lid);
+        free(doubles);
+        free(fixed);
+        return -1;
+    }
+    uint64_t start = cmxd_synth_start_ns();
+    for (size_t i = 0; i < count; i++) {
+        cmxd_synth_sample(false, start + i * period_ns, &base[i]);
+        cmxd_synth_sample(true, start + i * period_ns, &lid[i]);
+    }
+
+    cmxd_calculations_reset();
+    cmxd_modes_init();
+    cmxd_orientation_init();
+    for (size_t i = 0; i < count; i++) {
+        decide_double(&base[i], &lid[i], &doubles[i]);
+    }
+
+    int32_t scale_q = cmxd_fixed_scale(CMXD_SYNTH_SCALE);
+    unsigned long long mismatches = 0, angle_off = 0, ties = 0;
+    size_t run = 0, longest = 0, longest_end = 0, worst = 0;
+    double max_error = 0.0;
+    cmxd_fixed_reset();
+    cmxd_modes_init();
+    cmxd_orientation_init();
+    for (size_t i = 0; i < count; i++) {
+        decide_fixed(&base[i], &lid[i], scale_q, &fixed[i]);
+
+        if (fixed[i].hinge_angle >= 0 && doubles[i].hinge_angle >= 0) {
+            double error = fabs(fixed[i].hinge_angle - doubles[i].hinge_angle);
+            if (fixed[i].compensated != doubles[i].compensated) {
+                /* On the edge of the compensation zone: compare where both start */
+                error = fabs(fixed[i].sensor_angle - doubles[i].sensor_angle);
+                ties++;
+            }
+            if (error > max_error) {
+                max_error = error;
+                worst = i;
+            }
+            angle_off += error > cfg->max_error + 1e-9;
+        } else if ((fixed[i].hinge_angle < 0) != (doubles[i].hinge_angle < 0)) {
+            angle_off++;
+            worst = i;
+        }
+        if (same_decision(&fixed[i], &doubles[i])) {
+            run = 0;
+            continue;
+        }
+        mismatches++;
+        if (++run > longest) {
+            longest = run;
+            longest_end = i;
+        }
+    }
+
+    bool diverged = longest > cfg->slip;
+    printf("  %-8s seed %-4u shake %.2f  %7zu pairs  %4llu differ  longest %3zu  max angle error %.3f°  %llu ties\n",
+           script, seed, shake, count, mismatches, longest, max_error, ties);
+    if (angle_off) {
+        printf("    %llu pairs over %.2f°, pair %zu: double %.3f, fixed %.1f\n", angle_off, cfg->max_error, worst,
+               doubles[worst].hinge_angle, fixed[worst].hinge_angle);
+    }
+    if (diverged) {
+        size_t i = longest_end;
+        printf("    pairs %zu-%zu: double %.2f %s %s, fixed %.1f %s %s\n", i + 1 - longest, i,
+               doubles[i].hinge_angle, doubles[i].mode, doubles[i].orientation,
+               fixed[i].hinge_angle, fixed[i].mode, fixed[i].orientation);
+    }
+
+    totals->pairs += count;
+    totals->diverged += diverged;
+    totals->mismatches += mismatches;
+    if (longest > totals->longest) {
+        totals->longest = longest;
+    }
+    totals->angle_off += angle_off;
+    totals->ties += ties;
+    totals->strayed += angle_off > 0;
+    if (max_error > totals->max_angle_error) {
+        totals->max_angle_error = max_error;
+    }
+
+    free(base);
+    free(lid);
+    free(doubles);
+    free(fixed);
+    return 0;
+}
+
+static int run(const struct replay_config *cfg)
+{
+    struct replay_totals totals = { 0 };
+    const double tremors[] = { 0.0, 0.5 };
+    int first = 0, last = SCRIPT_COUNT;
+
+    for (int s = first; s < last; s++) {
+        const char *script = cfg->script ? cfg->script : builtin_scripts[s];
+        for (unsigned int k = 0; k < cfg->seeds; k++) {
+            for (int t = 0; t < 2; t++) {
+                double shake = cfg->shake >= 0.0 ? cfg->shake : tremors[t];
+                if (replay_one(script, cfg->seed + k, cfg, shake, &totals) < 0) {
+                    return -1;
+                }
+                if (cfg->shake >= 0.0) {
+                    break;
+                }
+            }
+        }
+        if (cfg->script) {
+            break;
+        }
+    }
+
+    printf("\npairs            %llu\n", totals.pairs);
+    printf("diverged         %llu\n", totals.diverged);
+    printf("pairs differ     %llu, at most %zu in a row\n", totals.mismatches, totals.longest);
+    printf("angle error      max %.3f°, %llu pairs over %.2f° in %llu replays\n", totals.max_angle_error,
+           totals.angle_off, cfg->max_error, totals.strayed);
+    printf("compensation     %llu pairs on the zone's edge, compared before it\n", totals.ties);
+    return totals.diverged || totals.strayed ? 1 : 0;
+}
+
+static void usage(const char *prog)
+{
+    printf("Usage: %s [OPTIONS]\n", prog);
+    printf("  -s, --script NAME|FILE  Replay one script (default: every built-in script)\n");
+    printf("  -r, --rate HZ           Pairs per second of script time (default: 200)\n");
+    printf("  -n, --noise MS2         Sensor noise RMS in m/s^2 (default: 0.05)\n");
+    printf("  -k, --shake MS2         Hand tremor amplitude (default: replay 0 and 0.5)\n");
+    printf("  -S, --seed N            First noise seed (default: 1)\n");
+    printf("  -c, --seeds N           Seeds per script (default: 3)\n");
+    printf("  -w, --slip PAIRS        Longest disagreement allowed (default: 10)\n");
+    printf("  -e, --max-error DEG     Largest hinge angle difference allowed (default: 0.1)\n");
+    printf("\nBuilt-in scripts:\n");
+    cmxd_synth_list_scripts(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    struct replay_config cfg = {
+        .script = NULL,
+        .rate_hz = 200,
+        .seeds = 3,
+        .seed = 1,
+        .noise = 0.05,
+        .shake = -1.0,
+        .slip = 10,
+        .max_error = 0.1,
+    };
+    static const struct option options[] = {
+        {"script", required_argument, 0, 's'},
+        {"rate",   required_argument, 0, 'r'},
+        {"noise",  required_argument, 0, 'n'},
+        {"shake",  required_argument, 0, 'k'},
+        {"seed",   required_argument, 0, 'S'},
+        {"seeds",  required_argument, 0, 'c'},
+        {"slip",   required_argument, 0, 'w'},
+        {"max-error", required_argument, 0, 'e'},
+        {"help",   no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "s:r:n:k:S:c:w:e:h", options, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                cfg.script = optarg;
+                break;
+            case 'r':
+                cfg.rate_hz = (unsigned int)strtoul(optarg, NULL, 10);
+                break;
+            case 'n':
+                cfg.noise = strtod(optarg, NULL);
+                break;
+            case 'k':
+                cfg.shake = strtod(optarg, NULL);
+                break;
+            case 'S':
+                cfg.seed = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+            case 'c':
+                cfg.seeds = (unsigned int)strtoul(optarg, NULL, 10);
+                break;
+            case 'w':
+                cfg.slip = (unsigned int)strtoul(optarg, NULL, 10);
+                break;
+            case 'e':
+                cfg.max_error = strtod(optarg, NULL);
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (cfg.rate_hz == 0 || cfg.rate_hz > CMXD_SYNTH_MAX_HZ || cfg.seeds == 0 || cfg.max_error < 0.0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    return run(&cfg) == 0 ? 0 : 1;
+}
@@ -0,0 +1,255 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Cache Module - Warm-Restart Discovery Snapshot
+ *
+ * The snapshot is a single fixed-size record on tmpfs. It is trusted only
+ * for the boot that wrote it, and each device entry only while the device
+ * node still has the same identity: a re-probed sensor gets a new node and
+ * forces full discovery. Saving goes through a temporary file and rename so
+ * a crash never leaves a torn snapshot behind.
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#include "cmxd-cache.h"
+#include "cmxd-paths.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#define CMXD_CACHE_MAGIC    0x434d5844  /* "CMXD" */
+#define CMXD_CACHE_VERSION  1
+
+/* Module state */
+static log_func_t log_function = NULL;
+
+/* Logging macros using the configured log function */
+#define log_warn(fmt, ...)  do { if (log_function) log_function("WARN", fmt, ##__VA_ARGS__); } while(0)
+#define log_debug(fmt, ...) do { if (log_function) log_function("DEBUG", fmt, ##__VA_ARGS__); } while(0)
+
+void cmxd_cache_init(log_func_t log_func)
+{
+    log_function = log_func;
+}
+
+static int read_boot_id(char *boot_id, size_t size)
+{
+    char path[PATH_MAX];
+    ssize_t len;
+    int fd;
+
+    cmxd_path(path, sizeof(path), PROC_BOOT_ID_PATH);
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    len = read(fd, boot_id, size - 1);
+    close(fd);
+    if (len <= 0) {
+        return -1;
+    }
+    boot_id[len] = '\0';
+    boot_id[strcspn(boot_id, "\n")] = '\0';
+    return 0;
+}
+
+/* Identity of the device's /dev node */
+static int stat_device_node(const char *name, uint64_t *rdev, uint64_t *ino)
+{
+    char path[PATH_MAX];
+    struct stat st;
+
+    cmxd_path(path, sizeof(path), IIO_DEV_CHAR_TEMPLATE, name);
+    if (stat(path, &st) < 0) {
+        return -1;
+    }
+    *rdev = (uint64_t)st.st_rdev;
+    *ino = (uint64_t)st.st_ino;
+    return 0;
+}
+
+static bool device_still_valid(const struct cmxd_cache_device *dev)
+{
+    uint64_t rdev, ino;
+
+    return dev->name[0] && dev->channel_count > 0 && dev->channel_count <= CMXD_SCAN_MAX_CHANNELS &&
+           stat_device_node(dev->name, &rdev, &ino) == 0 && rdev == dev->rdev && ino == dev->ino;
+}
+
+/*
+ * =============================================================================
+ * SNAPSHOT FILE
+ * =============================================================================
+ */
+
+/* Load and revalidate the snapshot. Returns 0 when it can be used as is. */
+int cmxd_cache_load(struct cmxd_cache *cache)
+{
+    char path[PATH_MAX];
+    char boot_id[sizeof(cache->boot_id)];
+    ssize_t len;
+    int fd;
+
+    memset(cache, 0, sizeof(*cache));
+
+    cmxd_path(path, sizeof(path), CMXD_CACHE_PATH);
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    len = read(fd, cache, sizeof(*cache));
+    close(fd);
+
+    if (len != (ssize_t)sizeof(*cache) || cache->magic != CMXD_CACHE_MAGIC ||
+        cache->version != CMXD_CACHE_VERSION || cache->size != sizeof(*cache)) {
+        log_debug("Discovery cache unreadable or from another version, ignoring");
+        goto invalid;
+    }
+
+    /* Terminate every string before it is used, whatever the file held */
+    cache->boot_id[sizeof(cache->boot_id) - 1] = '\0';
+    cache->base.name[sizeof(cache->base.name) - 1] = '\0';
+    cache->lid.name[sizeof(cache->lid.name) - 1] = '\0';
+    cache->trigger_name[sizeof(cache->trigger_name) - 1] = '\0';
+    cache->mode[sizeof(cache->mode) - 1] = '\0';
+    cache->orientation[sizeof(cache->orientation) - 1] = '\0';
+
+    /* Device numbering is only stable within one boot */
+    if (read_boot_id(boot_id, sizeof(boot_id)) < 0 || strcmp(boot_id, cache->boot_id) != 0) {
+        log_debug("Discovery cache is from a previous boot, ignoring");
+        goto invalid;
+    }
+
+    if (!device_still_valid(&cache->base) || !device_still_valid(&cache->lid)) {
+        log_debug("Sensors changed since the discovery cache was written, ignoring");
+        goto invalid;
+    }
+
+    return 0;
+
+invalid:
+    memset(cache, 0, sizeof(*cache));
+    return -1;
+}
+
+/* Write the snapshot atomically */
+int cmxd_cache_save(struct cmxd_cache *cache)
+{
+    char path[PATH_MAX];
+    char tmp_path[PATH_MAX];
+    char runtime_dir[PATH_MAX];
+    ssize_t len;
+    int fd;
+
+    cache->magic = CMXD_CACHE_MAGIC;
+    cache->version = CMXD_CACHE_VERSION;
+    cache->size = sizeof(*cache);
+    if (read_boot_id(cache->boot_id, sizeof(cache->boot_id)) < 0) {
+        return -1;
+    }
+
+    cmxd_path(path, sizeof(path), CMXD_CACHE_PATH);
+    cmxd_path(tmp_path, sizeof(tmp_path), CMXD_CACHE_PATH ".tmp");
+    cmxd_path(runtime_dir, sizeof(runtime_dir), CMXD_RUNTIME_DIR);
+
+    if (mkdir(runtime_dir, 0755) < 0 && errno != EEXIST) {
+        log_warn("Failed to create runtime directory %s: %s", runtime_dir, strerror(errno));
+        return -1;
+    }
+
+    fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        log_warn("Failed to write discovery cache: %s", strerror(errno));
+        return -1;
+    }
+    len = write(fd, cache, sizeof(*cache));
+    close(fd);
+
+    if (len != (ssize_t)sizeof(*cache) || rename(tmp_path, path) < 0) {
+        log_warn("Failed to write discovery cache: %s", len < 0 ? strerror(errno) : "short write");
+        unlink(tmp_path);
+        return -1;
+    }
+
+    return 0;
+}
+
+void cmxd_cache_invalidate(void)
+{
+    char path[PATH_MAX];
+
+    cmxd_path(path, sizeof(path), CMXD_CACHE_PATH);
+    if (unlink(path) < 0 && errno != ENOENT) {
+        log_warn("Failed to remove discovery cache: %s", strerror(errno));
+    }
+}
+
+/*
+ * =============================================================================
+ * SNAPSHOT CONTENTS
+ * =============================================================================
+ */
+
+/* Record a set-up buffer's device, layout and scale */
+int cmxd_cache_set_device(struct cmxd_cache_device *dev, const struct iio_buffer *buf, double scale)
+{
+    const struct cmxd_scan_layout *layout = &buf->layout;
+
+    memset(dev, 0, sizeof(*dev));
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-truncation"
+    snprintf(dev->name, sizeof(dev->name), "%s", buf->device_name);
+#pragma GCC diagnostic pop
+    if (stat_device_node(dev->name, &dev->rdev, &dev->ino) < 0) {
+        return -1;
+    }
+    dev->scale = scale;
+
+    for (int i = 0; i < layout->channel_count; i++) {
+        const struct cmxd_scan_channel *ch = &layout->channels[i];
+        struct cmxd_cache_channel *cc = &dev->channels[i];
+
+        snprintf(cc->name, sizeof(cc->name), "%s", ch->name);
+        cc->index = ch->index;
+        if (cmxd_scan_format_type(ch, cc->type, sizeof(cc->type)) < 0) {
+            return -1;
+        }
+    }
+    dev->channel_count = layout->channel_count;
+    return 0;
+}
+
+/* Rebuild a scan layout from its cached elements */
+int cmxd_cache_device_layout(const struct cmxd_cache_device *dev, struct cmxd_scan_layout *layout)
+{
+    cmxd_scan_layout_init(layout);
+
+    for (int i = 0; i < dev->channel_count; i++) {
+        const struct cmxd_cache_channel *cc = &dev->channels[i];
+        char name[CMXD_SCAN_NAME_MAX];
+        char type[CMXD_CACHE_TYPE_MAX];
+
+        /* Copy with termination; the file is not trusted blindly */
+        snprintf(name, sizeof(name), "%.*s", (int)sizeof(cc->name) - 1, cc->name);
+        snprintf(type, sizeof(type), "%.*s", (int)sizeof(cc->type) - 1, cc->type);
+        if (cmxd_scan_layout_add(layout, name, cc->index, type) < 0) {
+            return -1;
+        }
+    }
+
+    return cmxd_scan_layout_finalize(layout);
+}
+
+/* Track the published state; returns true when it changed */
+bool cmxd_cache_set_state(struct cmxd_cache *cache, const char *mode, const char *orientation)
+{
+    if (strcmp(cache->mode, mode) == 0 && strcmp(cache->orientation, orientation) == 0) {
+        return false;
+    }
+    snprintf(cache->mode, sizeof(cache->mode), "%s", mode);
+    snprintf(cache->orientation, sizeof(cache->orientation), "%s", orientation);
+    return true;
+}
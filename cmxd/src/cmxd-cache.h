@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Warm-restart discovery cache for CMXD (Chuwi Minibook X Daemon)
+ *
+ * Persists what startup discovered (device assignments, scan layouts,
+ * scales, trigger) plus the last published mode and orientation under
+ * /run/cmxd, so a restarted daemon can skip rediscovery and republish its
+ * state immediately.
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#ifndef CMXD_CACHE_H
+#define CMXD_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cmxd-data.h"
+
+#define CMXD_CACHE_TYPE_MAX     24
+
+/* One scan element as read from scan_elements/ */
+struct cmxd_cache_channel {
+    char name[CMXD_SCAN_NAME_MAX];
+    int index;
+    char type[CMXD_CACHE_TYPE_MAX];
+};
+
+/* Everything discovered about one accelerometer */
+struct cmxd_cache_device {
+    char name[64];                  /* e.g. "iio:device0" */
+    uint64_t rdev;                  /* /dev node identity; changes when the device is re-created */
+    uint64_t ino;
+    double scale;
+    int channel_count;
+    struct cmxd_cache_channel channels[CMXD_SCAN_MAX_CHANNELS];
+};
+
+struct cmxd_cache {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;                  /* sizeof(struct cmxd_cache) of the writer */
+    char boot_id[40];
+    struct cmxd_cache_device base;
+    struct cmxd_cache_device lid;
+    char trigger_name[64];
+    char mode[32];                  /* Last published state, empty if unknown */
+    char orientation[32];
+};
+
+void cmxd_cache_init(log_func_t log_function);
+int cmxd_cache_load(struct cmxd_cache *cache);
+int cmxd_cache_save(struct cmxd_cache *cache);
+void cmxd_cache_invalidate(void);
+
+int cmxd_cache_set_device(struct cmxd_cache_device *dev, const struct iio_buffer *buf, double scale);
+int cmxd_cache_device_layout(const struct cmxd_cache_device *dev, struct cmxd_scan_layout *layout);
+bool cmxd_cache_set_state(struct cmxd_cache *cache, const char *mode, const char *orientation);
+
+#endif /* CMXD_CACHE_H */
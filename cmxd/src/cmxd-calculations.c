@@ -17,6 +17,8 @@
 #define M_PI 3.14159265358979323846
 #endif
 
+static double unfold_hinge_angle(double base_angle, double cross_y);
+
 /*
  * =============================================================================
  * BASIC 3D VECTOR OPERATIONS
@@ -322,6 +324,21 @@ double cmxd_calculate_hinge_angle_360(const cmxd_accel_sample *base, const cmxd_
     /* Cross product base × lid gives us the hinge axis direction */
     double cross_y = base_z * lid_x - base_x * lid_z;
     
+    return unfold_hinge_angle(base_angle, cross_y);
+}
+
+/* Fold direction of the last sample, shared by both 0-360° calculations */
+static bool was_folded_back = false;
+
+/* Forget the fold direction, as if the lid had last been seen opening normally */
+void cmxd_calculations_reset(void)
+{
+    was_folded_back = false;
+}
+
+/* Map a 0-180° angle to 0-360° from the Y component of base × lid */
+static double unfold_hinge_angle(double base_angle, double cross_y)
+{
     /* Use the Y component of cross product to determine fold direction */
     /* When laptop opens normally: cross_y should be positive */
     /* When folding back (tent/tablet): cross_y becomes negative */
@@ -338,7 +355,6 @@ double cmxd_calculate_hinge_angle_360(const cmxd_accel_sample *base, const cmxd_
      */
     
     bool is_folded_back;
-    static bool was_folded_back = false;
     
     if (was_folded_back) {
         /* Currently in fold-back mode - need cross_y clearly positive to exit */
@@ -382,4 +398,184 @@ void cmxd_convert_to_ms2(const cmxd_accel_sample *sample, double scale,
 double cmxd_calculate_horizontal_magnitude(double x_ms, double y_ms)
 {
     return sqrt(x_ms * x_ms + y_ms * y_ms);
-}
\ No newline at end of file
+}
+
+/*
+ * =============================================================================
+ * FUSED SAMPLE FRAMES
+ * =============================================================================
+ */
+
+/* Scale one base/lid pair to m/s^2; nothing else is computed yet */
+void cmxd_frame_init(struct cmxd_frame *frame, const cmxd_accel_sample *base, const cmxd_accel_sample *lid,
+                     double base_scale, double lid_scale)
+{
+    cmxd_convert_to_ms2(base, base_scale, &frame->base[0], &frame->base[1], &frame->base[2]);
+    cmxd_convert_to_ms2(lid, lid_scale, &frame->lid[0], &frame->lid[1], &frame->lid[2]);
+    frame->have = 0;
+}
+
+/* Compute whichever of the requested CMXD_FRAME_* fields are still missing */
+void cmxd_frame_need(struct cmxd_frame *frame, unsigned int fields)
+{
+    const double *b = frame->base;
+    const double *l = frame->lid;
+    unsigned int missing = fields & ~frame->have;
+    
+    if (!missing) {
+        return;
+    }
+    
+    /* Dependencies first */
+    if (missing & (CMXD_FRAME_NORM | CMXD_FRAME_ANGLE | CMXD_FRAME_TOTAL_HORIZONTAL)) {
+        missing |= CMXD_FRAME_MAG & ~frame->have;
+    }
+    if (missing & (CMXD_FRAME_ANGLE | CMXD_FRAME_TOTAL_HORIZONTAL)) {
+        missing |= (CMXD_FRAME_DOT | CMXD_FRAME_ANGLE) & ~frame->have;
+    }
+    if (missing & CMXD_FRAME_TOTAL_HORIZONTAL) {
+        missing |= CMXD_FRAME_HORIZONTAL & ~frame->have;
+    }
+    
+    if (missing & CMXD_FRAME_MAG) {
+        frame->base_mag = cmxd_calculate_magnitude(b[0], b[1], b[2]);
+        frame->lid_mag = cmxd_calculate_magnitude(l[0], l[1], l[2]);
+    }
+    if (missing & CMXD_FRAME_NORM) {
+        /* Same guard as cmxd_normalize_vector(), without the second sqrt */
+        for (int i = 0; i < 3; i++) {
+            frame->base_norm[i] = frame->base_mag < 1e-6 ? 0.0 : b[i] / frame->base_mag;
+            frame->lid_norm[i] = frame->lid_mag < 1e-6 ? 0.0 : l[i] / frame->lid_mag;
+        }
+    }
+    if (missing & CMXD_FRAME_DOT) {
+        frame->dot = cmxd_calculate_dot_product(b[0], b[1], b[2], l[0], l[1], l[2]);
+    }
+    if (missing & CMXD_FRAME_CROSS) {
+        frame->cross[0] = b[1] * l[2] - b[2] * l[1];
+        frame->cross[1] = b[2] * l[0] - b[0] * l[2];
+        frame->cross[2] = b[0] * l[1] - b[1] * l[0];
+    }
+    if (missing & CMXD_FRAME_HORIZONTAL) {
+        frame->base_horizontal = cmxd_calculate_horizontal_magnitude(b[0], b[1]);
+        frame->lid_horizontal = cmxd_calculate_horizontal_magnitude(l[0], l[1]);
+    }
+    if (missing & CMXD_FRAME_ANGLE) {
+        double cos_angle = frame->dot / (frame->base_mag * frame->lid_mag);
+        frame->sensor_angle = acos(cmxd_clamp(cos_angle, -1.0, 1.0)) * 180.0 / M_PI;
+    }
+    frame->have |= missing & ~CMXD_FRAME_TOTAL_HORIZONTAL;
+    
+    if (missing & CMXD_FRAME_TOTAL_HORIZONTAL) {
+        /*
+         * The base should be flat, so its X/Y are horizontal. With the lid
+         * roughly upright (laptop) its X reading is the expected gravity and
+         * only Y/Z indicate motion; otherwise use its X/Y like the base.
+         */
+        double raw_hinge_angle = cmxd_frame_hinge_angle(frame);
+        double lid_horizontal = frame->lid_horizontal;
+        if (raw_hinge_angle >= 70 && raw_hinge_angle <= 110) {
+            lid_horizontal = cmxd_calculate_horizontal_magnitude(l[1], l[2]);
+        }
+        frame->total_horizontal = frame->base_horizontal + lid_horizontal;
+        frame->have |= CMXD_FRAME_TOTAL_HORIZONTAL;
+    }
+}
+
+/* Frame version of cmxd_calculate_hinge_angle(): 0-180°, or -1 if a reading is implausible */
+double cmxd_frame_hinge_angle(struct cmxd_frame *frame)
+{
+    cmxd_frame_need(frame, CMXD_FRAME_ANGLE);
+    
+    if (frame->base_mag < 1.0 || frame->lid_mag < 1.0) {
+        debug_log("Invalid accelerometer readings: base_mag=%.3f, lid_mag=%.3f", 
+                 frame->base_mag, frame->lid_mag);
+        return -1.0;
+    }
+    return frame->sensor_angle;
+}
+
+/* Frame version of cmxd_detect_device_rotation() */
+bool cmxd_frame_detect_device_rotation(struct cmxd_frame *frame)
+{
+    cmxd_frame_need(frame, CMXD_FRAME_ANGLE);
+    
+    /* Horizontal components only matter in the laptop/flat transition zone */
+    if (!(frame->sensor_angle >= 90.0 && frame->sensor_angle <= 110.0)) {
+        return false;
+    }
+    
+    cmxd_frame_need(frame, CMXD_FRAME_HORIZONTAL);
+    bool base_unusual = (frame->base_horizontal > 6.0);
+    bool lid_unusual = (frame->lid_horizontal > 8.0);
+    
+    if (!(base_unusual || lid_unusual)) {
+        return false;
+    }
+    debug_log("Device rotation detected - angle=%.1f°, base_h=%.1f, lid_h=%.1f", 
+             frame->sensor_angle, frame->base_horizontal, frame->lid_horizontal);
+    return true;
+}
+
+/* Frame version of cmxd_calculate_gravity_compensated_hinge_angle() */
+double cmxd_frame_gravity_compensated_hinge_angle(struct cmxd_frame *frame)
+{
+    double normal_angle = cmxd_frame_hinge_angle(frame);
+    
+    if (!cmxd_frame_detect_device_rotation(frame)) {
+        return normal_angle;
+    }
+    debug_log("Device rotation detected - applying gravity compensation");
+    
+    /* Same empirical correction as the per-call version */
+    double total_horizontal = frame->base_horizontal + frame->lid_horizontal;
+    double tilt_factor = 1.0;
+    if (total_horizontal > 10.0) {
+        tilt_factor = 1.0 + (total_horizontal - 10.0) * 0.05;
+        tilt_factor = cmxd_clamp(tilt_factor, 1.0, 1.3);
+    }
+    
+    double zone_boost = 0.0;
+    if (normal_angle >= 95.0 && normal_angle <= 110.0) {
+        zone_boost = (normal_angle - 95.0) * 0.5;
+    }
+    
+    double compensated_angle = normal_angle * tilt_factor + zone_boost;
+    compensated_angle = cmxd_clamp(compensated_angle, normal_angle, normal_angle + 50.0);
+    
+    if (compensated_angle > normal_angle + 2.0) {
+        debug_log("Applied tilt compensation: raw=%.1f° -> compensated=%.1f° (factor=%.2f, boost=%.1f°)", 
+                 normal_angle, compensated_angle, tilt_factor, zone_boost);
+        return compensated_angle;
+    }
+    debug_log("Compensation calculated but minimal: raw=%.1f° (factor=%.2f, boost=%.1f°)", 
+             normal_angle, tilt_factor, zone_boost);
+    return normal_angle;
+}
+
+/*
+ * Frame version of cmxd_calculate_hinge_angle_360(). Not cached: it steps
+ * the fold-back hysteresis, so call it once per frame.
+ */
+double cmxd_frame_hinge_angle_360(struct cmxd_frame *frame)
+{
+    double base_angle = cmxd_frame_gravity_compensated_hinge_angle(frame);
+    
+    if (base_angle < 0) {
+        return base_angle; /* Error case */
+    }
+    
+    cmxd_frame_need(frame, CMXD_FRAME_CROSS);
+    return unfold_hinge_angle(base_angle, frame->cross[1]);
+}
+
+/* Frame version of cmxd_calculate_tilt_angle() for the base */
+double cmxd_frame_base_tilt_angle(struct cmxd_frame *frame)
+{
+    cmxd_frame_need(frame, CMXD_FRAME_NORM);
+    
+    if (frame->base_mag < 1e-6) {
+        return -1.0; /* Invalid reading */
+    }
+    return acos(cmxd_clamp(fabs(frame->base_norm[2]), 0.0, 1.0)) * 180.0 / M_PI;
+}
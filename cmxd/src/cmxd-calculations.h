@@ -21,6 +21,45 @@
 /* Alias for backward compatibility in calculations */
 typedef struct accel_sample cmxd_accel_sample;
 
+/* Fields of struct cmxd_frame computed on first use */
+#define CMXD_FRAME_MAG          (1u << 0)   /* base_mag, lid_mag */
+#define CMXD_FRAME_NORM         (1u << 1)   /* base_norm, lid_norm */
+#define CMXD_FRAME_DOT          (1u << 2)   /* dot */
+#define CMXD_FRAME_CROSS        (1u << 3)   /* cross */
+#define CMXD_FRAME_HORIZONTAL   (1u << 4)   /* base_horizontal, lid_horizontal */
+#define CMXD_FRAME_ANGLE        (1u << 5)   /* sensor_angle */
+#define CMXD_FRAME_TOTAL_HORIZONTAL (1u << 6) /* total_horizontal */
+
+/*
+ * One fused base/lid pair. The vectors are scaled to m/s^2 once by
+ * cmxd_frame_init(); everything else is derived from them the first time a
+ * stage asks for it, so each quantity is computed at most once per pair no
+ * matter how many of the angle, mode and orientation stages read it.
+ */
+struct cmxd_frame {
+    double base[3];                 /* Base vector, m/s^2 */
+    double lid[3];                  /* Lid vector, m/s^2 */
+    unsigned int have;              /* CMXD_FRAME_* fields already computed */
+    
+    double base_mag, lid_mag;
+    double base_norm[3], lid_norm[3]; /* Zero if the magnitude is too small */
+    double dot;                     /* base . lid */
+    double cross[3];                /* base x lid; Y is along the hinge */
+    double base_horizontal;         /* |(x, y)| of the base */
+    double lid_horizontal;          /* |(x, y)| of the lid */
+    double sensor_angle;            /* Unchecked 0-180° angle between the vectors */
+    double total_horizontal;        /* Horizontal acceleration used for gravity confidence */
+};
+
+void cmxd_frame_init(struct cmxd_frame *frame, const cmxd_accel_sample *base, const cmxd_accel_sample *lid,
+                     double base_scale, double lid_scale);
+void cmxd_frame_need(struct cmxd_frame *frame, unsigned int fields);
+double cmxd_frame_hinge_angle(struct cmxd_frame *frame);
+double cmxd_frame_hinge_angle_360(struct cmxd_frame *frame);
+bool cmxd_frame_detect_device_rotation(struct cmxd_frame *frame);
+double cmxd_frame_gravity_compensated_hinge_angle(struct cmxd_frame *frame);
+double cmxd_frame_base_tilt_angle(struct cmxd_frame *frame);
+
 /* Basic 3D vector operations */
 double cmxd_calculate_magnitude(double x, double y, double z);
 int cmxd_normalize_vector(double x, double y, double z, 
@@ -28,6 +67,12 @@ int cmxd_normalize_vector(double x, double y, double z,
 double cmxd_calculate_dot_product(double x1, double y1, double z1,
                                  double x2, double y2, double z2);
 
+/*
+ * Per-call versions of the above, scaling the raw samples again on every
+ * call. Kept for the analysis tools and as the reference the frame path is
+ * benchmarked against; the daemon uses the frame functions.
+ */
+
 /* Simplified hinge angle calculations */
 double cmxd_calculate_hinge_angle(const cmxd_accel_sample *base, const cmxd_accel_sample *lid, 
                                  double base_scale, double lid_scale);
@@ -51,5 +96,6 @@ double cmxd_calculate_horizontal_magnitude(double x_ms, double y_ms);
 
 /* Module configuration */
 void cmxd_calculations_set_log_debug(void (*func)(const char *fmt, ...));
+void cmxd_calculations_reset(void);
 
 #endif /* CMXD_CALCULATIONS_H */
\ No newline at end of file
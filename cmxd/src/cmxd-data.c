@@ -9,6 +9,9 @@
 
 #include "cmxd-data.h"
 #include "cmxd-paths.h"
+#ifdef ENABLE_IO_URING
+#include "cmxd-uring.h"
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,14 +19,36 @@
 #include <errno.h>
 #include <sys/stat.h>
 #include <fcntl.h>
-#include <endian.h>
 #include <stdarg.h>
 #include <math.h>
+#include <limits.h>
+#include <dirent.h>
+#include <sys/ioctl.h>
+#include <linux/iio/events.h>
 
 /* Module state */
 static struct cmxd_data_config *data_config = NULL;
 static log_func_t log_function = NULL;
 
+/* Active sampling trigger */
+static char active_trigger_name[64] = "";
+static bool hrtimer_trigger_active = false;
+static bool hrtimer_trigger_owned = false;
+
+/*
+ * With /dev/cmx or the binary "state" attribute, vector, mode and
+ * orientation writes only update this record; cmxd_commit_state() sends it
+ * in one write.
+ */
+static int state_support = -1;          /* -1 until probed */
+static uint32_t state_version;          /* Record version the kernel speaks */
+static struct cmxd_kernel_state pending_state;
+static bool state_dirty = false;
+static int16_t committed_angle = CMXD_ANGLE_UNKNOWN;   /* Angle of the last record sent */
+
+/* Angle change (tenths of a degree) that on its own is worth a commit */
+#define ANGLE_COMMIT_DEADBAND 5
+
 /* Logging macros using the configured log function */
 #define log_error(fmt, ...) do { if (log_function) log_function("ERROR", fmt, ##__VA_ARGS__); } while(0)
 #define log_warn(fmt, ...)  do { if (log_function) log_function("WARN", fmt, ##__VA_ARGS__); } while(0)
@@ -41,6 +66,10 @@ void cmxd_data_init(struct cmxd_data_config *config, log_func_t log_func)
 {
     data_config = config;
     log_function = log_func;
+    state_support = -1;
+    state_dirty = false;
+    memset(&pending_state, 0, sizeof(pending_state));
+    committed_angle = CMXD_ANGLE_UNKNOWN;
 }
 
 /*
@@ -68,6 +97,41 @@ int cmxd_safe_fclose(FILE *f, const char *path)
     return 0;
 }
 
+/* Write an integer to a sysfs attribute, reporting errors surfaced on close */
+static int write_sysfs_int(const char *path, int value)
+{
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        return -1;
+    }
+    
+    if (fprintf(fp, "%d", value) < 0) {
+        fclose(fp);
+        return -1;
+    }
+    
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+/* Read a single-line sysfs attribute with the trailing newline removed */
+static int read_sysfs_string(const char *path, char *value, size_t size)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return -1;
+    }
+    
+    if (!fgets(value, size, fp)) {
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    
+    char *newline = strchr(value, '\n');
+    if (newline) *newline = '\0';
+    return 0;
+}
+
 /*
  * =============================================================================
  * DATA PROCESSING AND SCALING
@@ -81,8 +145,11 @@ double cmxd_read_accel_scale(const char *device_name)
     FILE *fp;
     double scale = 0.0;
     
-    snprintf(scale_path, sizeof(scale_path), 
-             "/sys/bus/iio/devices/%s/in_accel_scale", device_name);
+    if (data_config && data_config->source && data_config->source->read_scale) {
+        return data_config->source->read_scale(device_name);
+    }
+    
+    cmxd_path(scale_path, sizeof(scale_path), IIO_ACCEL_SCALE_TEMPLATE, device_name);
     
     fp = cmxd_safe_fopen(scale_path, "r");
     if (fp) {
@@ -123,254 +190,1058 @@ void cmxd_apply_scale(int raw_x, int raw_y, int raw_z, double scale,
  * =============================================================================
  */
 
-/* Write vector to kernel module sysfs */
-int cmxd_write_vector(const char *name, int x, int y, int z)
+/*
+ * Attributes written on every sample are opened once and rewritten in place
+ * with pwrite(). sysfs runs the store callback for each write at offset 0,
+ * so no seek or reopen is needed; a handle is only reopened if the attribute
+ * went away underneath it (module reload, device removal).
+ */
+struct sysfs_handle {
+    char path[PATH_MAX];
+    int fd;
+};
+
+static struct sysfs_handle base_vec_handle = { .fd = -1 };
+static struct sysfs_handle lid_vec_handle = { .fd = -1 };
+static struct sysfs_handle mode_handle = { .fd = -1 };
+static struct sysfs_handle orientation_handle = { .fd = -1 };
+static struct sysfs_handle trigger_now_handle = { .fd = -1 };
+static struct sysfs_handle trigger_freq_handle = { .fd = -1 };
+static struct sysfs_handle state_handle = { .fd = -1 };
+static struct sysfs_handle resume_handle = { .fd = -1 };
+static unsigned long resume_seq_seen;
+static struct sysfs_handle watchers_handle = { .fd = -1 };
+
+/* Same order as valid_modes[] and valid_orientations[] in cmx.c */
+static const char *const kernel_modes[] = {
+    "closing", "laptop", "flat", "tent", "tablet"
+};
+static const char *const kernel_orientations[] = {
+    "portrait", "landscape", "portrait-flipped", "landscape-flipped"
+};
+
+static void sysfs_handle_close(struct sysfs_handle *h)
+{
+    if (h->fd >= 0) {
+        close(h->fd);
+        h->fd = -1;
+    }
+}
+
+/* Bind a handle to an attribute under the kernel module's sysfs directory */
+static int sysfs_handle_bind(struct sysfs_handle *h, const char *attr)
+{
+    if (h->path[0]) {
+        return 0;
+    }
+    
+    if (!data_config) {
+        log_error("Data module not initialized");
+        return -1;
+    }
+    
+    if ((size_t)snprintf(h->path, sizeof(h->path), "%s/%s", data_config->sysfs_path, attr) >= sizeof(h->path)) {
+        log_error("Path too long for %s", attr);
+        h->path[0] = '\0';
+        return -1;
+    }
+    return 0;
+}
+
+#ifdef ENABLE_IO_URING
+/* Completion of a queued attribute write; a replaced attribute is reopened next time */
+static void sysfs_handle_write_done(void *ctx, int fd, int res)
+{
+    struct sysfs_handle *h = ctx;
+    
+    if (res >= 0) {
+        return;
+    }
+    log_error("Failed to write to %s: %s", h->path, strerror(-res));
+    if ((res == -ENODEV || res == -ESTALE || res == -EBADF) && h->fd == fd) {
+        sysfs_handle_close(h);
+    }
+}
+#endif
+
+/* Write a preformatted value, reopening once if the attribute was replaced */
+static int sysfs_handle_write(struct sysfs_handle *h, const char *data, size_t len)
+{
+#ifdef ENABLE_IO_URING
+    /* Batched with the next ring submission; errors arrive with the completion */
+    if (cmxd_uring_active()) {
+        if (h->fd < 0) {
+            h->fd = open(h->path, O_WRONLY | O_CLOEXEC);
+        }
+        if (h->fd >= 0 && cmxd_uring_queue_write(h->fd, data, len, sysfs_handle_write_done, h) == 0) {
+            return 0;
+        }
+    }
+#endif
+    
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (h->fd < 0) {
+            h->fd = open(h->path, O_WRONLY | O_CLOEXEC);
+            if (h->fd < 0) {
+                log_error("Failed to open %s: %s", h->path, strerror(errno));
+                return -1;
+            }
+        }
+    
+        ssize_t written = pwrite(h->fd, data, len, 0);
+        if (written == (ssize_t)len) {
+            return 0;
+        }
+    
+        if (written >= 0) {
+            log_error("Short write to %s: %zd of %zu bytes", h->path, written, len);
+            return -1;
+        }
+        if (errno != ENODEV && errno != ESTALE && errno != EBADF) {
+            log_error("Failed to write to %s: %s", h->path, strerror(errno));
+            return -1;
+        }
+    
+        log_debug("Reopening %s after %s", h->path, strerror(errno));
+        sysfs_handle_close(h);
+    }
+    
+    log_error("Failed to write to %s after reopen", h->path);
+    return -1;
+}
+
+/* Format a decimal integer without stdio; returns the number of characters */
+static size_t format_int(char *out, int value)
+{
+    char digits[12];
+    size_t n = 0, len = 0;
+    unsigned int v = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+    
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    
+    if (value < 0) {
+        out[len++] = '-';
+    }
+    while (n) {
+        out[len++] = digits[--n];
+    }
+    return len;
+}
+
+/* Write a newline-terminated string attribute */
+static int sysfs_handle_write_string(struct sysfs_handle *h, const char *value)
+{
+    char line[64];
+    size_t len = strlen(value);
+    
+    if (len >= sizeof(line) - 1) {
+        log_error("Value too long for %s: %s", h->path, value);
+        return -1;
+    }
+    memcpy(line, value, len);
+    line[len++] = '\n';
+    return sysfs_handle_write(h, line, len);
+}
+
+/* Index of value in one of the kernel's string lists */
+static int kernel_index(const char *const *list, int count, const char *value)
+{
+    for (int i = 0; i < count; i++) {
+        if (strcmp(list[i], value) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Read one state record from path; 0 if it is a version we can write */
+static int state_probe(const char *path, struct cmxd_kernel_state *out)
+{
+    /* /dev/cmx returns the first record at once; don't block if it didn't */
+    int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    ssize_t len;
+    
+    if (fd < 0) {
+        return -1;
+    }
+    len = read(fd, out, sizeof(*out));
+    close(fd);
+    
+    return (len == (ssize_t)sizeof(*out) && out->version >= 1 &&
+            out->version <= CMXD_STATE_VERSION) ? 0 : -1;
+}
+
+/*
+ * Probe for a binary state channel once: /dev/cmx, then the "state"
+ * attribute. The kernel's current state seeds the record so a commit never
+ * pushes vectors we haven't set.
+ */
+bool cmxd_state_supported(void)
+{
+    struct cmxd_kernel_state current;
+    
+    if (state_support >= 0) {
+        return state_support > 0;
+    }
+    if (!data_config) {
+        return false;
+    }
+    
+    state_support = 0;
+    if (cmxd_path(state_handle.path, sizeof(state_handle.path), CMXD_DEV_PATH) < 0 ||
+        state_probe(state_handle.path, &current) < 0) {
+        state_handle.path[0] = '\0';
+        if (sysfs_handle_bind(&state_handle, "state") < 0 ||
+            state_probe(state_handle.path, &current) < 0) {
+            log_debug("No binary state channel, using text attributes");
+            return false;
+        }
+    }
+    
+    /* Answer in the kernel's version; a version 1 module has no angle */
+    state_version = current.version;
+    pending_state = current;
+    pending_state.mode = CMXD_STATE_KEEP;
+    pending_state.orientation = CMXD_STATE_KEEP;
+    if (state_version < 2) {
+        pending_state.angle = 0;
+    }
+    memset(pending_state.reserved, 0, sizeof(pending_state.reserved));
+    state_support = 1;
+    
+    log_info("Writing kernel state v%u through %s (seq %u)", state_version, state_handle.path, current.seq);
+    return true;
+}
+
+/* Send everything staged since the last commit as one state record */
+int cmxd_commit_state(uint64_t timestamp)
+{
+    if (!state_dirty || !cmxd_state_supported()) {
+        return 0;
+    }
+    
+    pending_state.version = state_version;
+    pending_state.seq++;
+    pending_state.timestamp = timestamp;
+    if (sysfs_handle_write(&state_handle, (const char *)&pending_state, sizeof(pending_state)) < 0) {
+        /* Keep mode and orientation staged so the next commit retries them */
+        return -1;
+    }
+    
+    pending_state.mode = CMXD_STATE_KEEP;
+    pending_state.orientation = CMXD_STATE_KEEP;
+    committed_angle = pending_state.angle;
+    state_dirty = false;
+    return 0;
+}
+
+/* Write vector to kernel module sysfs */
+int cmxd_write_vector(const char *name, int x, int y, int z)
+{
+    struct sysfs_handle *h;
+    int32_t *staged;
+    char line[40];
+    size_t len;
+    
+    if (strcmp(name, "base") == 0) {
+        h = &base_vec_handle;
+        staged = pending_state.base;
+    } else if (strcmp(name, "lid") == 0) {
+        h = &lid_vec_handle;
+        staged = pending_state.lid;
+    } else {
+        log_error("Unknown vector %s", name);
+        return -1;
+    }
+    
+    if (cmxd_state_supported()) {
+        staged[0] = x;
+        staged[1] = y;
+        staged[2] = z;
+        state_dirty = true;
+        return 0;
+    }
+    
+    if (!h->path[0]) {
+        char attr[16];
+        snprintf(attr, sizeof(attr), "%s_vec", name);
+        if (sysfs_handle_bind(h, attr) < 0) return -1;
+    }
+    
+    len = format_int(line, x);
+    line[len++] = ' ';
+    len += format_int(line + len, y);
+    line[len++] = ' ';
+    len += format_int(line + len, z);
+    line[len++] = '\n';
+    
+    return sysfs_handle_write(h, line, len);
+}
+
+/* Write mode to kernel module sysfs */
+int cmxd_write_mode(const char *mode)
+{
+    if (cmxd_state_supported()) {
+        int index = kernel_index(kernel_modes, (int)(sizeof(kernel_modes) / sizeof(kernel_modes[0])), mode);
+        if (index < 0) {
+            log_error("Mode not accepted by the kernel module: %s", mode);
+            return -1;
+        }
+        pending_state.mode = (uint8_t)index;
+        state_dirty = true;
+        return 0;
+    }
+    
+    if (sysfs_handle_bind(&mode_handle, "mode") < 0) return -1;
+    
+    /* Mode write debug output shown in main loop */
+    return sysfs_handle_write_string(&mode_handle, mode);
+}
+
+/* Write orientation to kernel module sysfs */
+int cmxd_write_orientation(const char *orientation)
+{
+    if (cmxd_state_supported()) {
+        int index = kernel_index(kernel_orientations,
+                                 (int)(sizeof(kernel_orientations) / sizeof(kernel_orientations[0])), orientation);
+        if (index < 0) {
+            log_error("Orientation not accepted by the kernel module: %s", orientation);
+            return -1;
+        }
+        pending_state.orientation = (uint8_t)index;
+        state_dirty = true;
+        return 0;
+    }
+    
+    if (sysfs_handle_bind(&orientation_handle, "orientation") < 0) return -1;
+    
+    /* Orientation write debug output shown in main loop */
+    return sysfs_handle_write_string(&orientation_handle, orientation);
+}
+
+/*
+ * Stage the hinge angle (degrees, negative if unreliable) for the next
+ * commit. Only version 2 state records carry it; otherwise a no-op.
+ * Jitter below half a degree rides along with the next commit instead
+ * of forcing one, so skipped vector writes really save a write.
+ */
+int cmxd_write_angle(double angle)
+{
+    int16_t staged;
+    
+    if (!cmxd_state_supported() || state_version < 2) {
+        return 0;
+    }
+    
+    if (angle < 0.0) {
+        staged = CMXD_ANGLE_UNKNOWN;
+    } else if (angle >= 360.0) {
+        staged = 3600;
+    } else {
+        staged = (int16_t)(angle * 10.0 + 0.5);
+    }
+    pending_state.angle = staged;
+    
+    if ((staged == CMXD_ANGLE_UNKNOWN) != (committed_angle == CMXD_ANGLE_UNKNOWN) ||
+        abs(staged - committed_angle) >= ANGLE_COMMIT_DEADBAND) {
+        state_dirty = true;
+    }
+    return 0;
+}
+
+/* Unsigned value of a pollable attribute; reading also re-arms POLLPRI */
+static int read_pollable_ulong(int fd, unsigned long *value)
+{
+    char buf[24];
+    ssize_t len = pread(fd, buf, sizeof(buf) - 1, 0);
+    
+    if (len <= 0) {
+        return -1;
+    }
+    buf[len] = '\0';
+    *value = strtoul(buf, NULL, 10);
+    return 0;
+}
+
+/*
+ * The module's resume_seq, opened for POLLPRI; -1 if the module has none.
+ * The value read here is what cmxd_resumed() compares against.
+ */
+int cmxd_resume_fd(void)
+{
+    if (resume_handle.fd >= 0) {
+        return resume_handle.fd;
+    }
+    if (sysfs_handle_bind(&resume_handle, "resume_seq") < 0) {
+        return -1;
+    }
+    
+    resume_handle.fd = open(resume_handle.path, O_RDONLY | O_CLOEXEC);
+    if (resume_handle.fd < 0) {
+        log_debug("No resume_seq attribute, not following system sleep");
+        return -1;
+    }
+    if (read_pollable_ulong(resume_handle.fd, &resume_seq_seen) < 0) {
+        sysfs_handle_close(&resume_handle);
+        return -1;
+    }
+    return resume_handle.fd;
+}
+
+/* True once for each resume from system sleep since the last call */
+bool cmxd_resumed(void)
+{
+    unsigned long seq;
+    
+    if (resume_handle.fd < 0 || read_pollable_ulong(resume_handle.fd, &seq) < 0 || seq == resume_seq_seen) {
+        return false;
+    }
+    resume_seq_seen = seq;
+    return true;
+}
+
+/* The module's vec_watchers, opened for POLLPRI; -1 if the module has none */
+int cmxd_vec_watchers_fd(void)
+{
+    if (watchers_handle.fd >= 0) {
+        return watchers_handle.fd;
+    }
+    if (sysfs_handle_bind(&watchers_handle, "vec_watchers") < 0) {
+        return -1;
+    }
+    
+    watchers_handle.fd = open(watchers_handle.path, O_RDONLY | O_CLOEXEC);
+    if (watchers_handle.fd < 0) {
+        log_debug("No vec_watchers attribute");
+        return -1;
+    }
+    return watchers_handle.fd;
+}
+
+/* Readers of the raw vectors the module reports, or -1 if unknown */
+int cmxd_vec_watchers(void)
+{
+    unsigned long watchers;
+    
+    if (watchers_handle.fd < 0 || read_pollable_ulong(watchers_handle.fd, &watchers) < 0) {
+        return -1;
+    }
+    return watchers > INT_MAX ? INT_MAX : (int)watchers;
+}
+
+/* Close all cached sysfs handles */
+void cmxd_data_cleanup(void)
+{
+    sysfs_handle_close(&base_vec_handle);
+    sysfs_handle_close(&lid_vec_handle);
+    sysfs_handle_close(&mode_handle);
+    sysfs_handle_close(&orientation_handle);
+    sysfs_handle_close(&trigger_now_handle);
+    sysfs_handle_close(&trigger_freq_handle);
+    sysfs_handle_close(&state_handle);
+    sysfs_handle_close(&resume_handle);
+    sysfs_handle_close(&watchers_handle);
+}
+
+/*
+ * =============================================================================
+ * IIO THRESHOLD EVENTS
+ * =============================================================================
+ */
+
+/* Record the accelerometer threshold/motion events the driver exposes */
+static void probe_iio_events(struct iio_buffer *buf)
+{
+    char path[PATH_MAX];
+    DIR *dir;
+    struct dirent *entry;
+    
+    buf->event_attr_count = 0;
+    
+    cmxd_path(path, sizeof(path), IIO_EVENTS_TEMPLATE, buf->device_name);
+    dir = opendir(path);
+    if (!dir) {
+        log_debug("No IIO events for %s", buf->device_name);
+        return;
+    }
+    
+    while ((entry = readdir(dir)) != NULL && buf->event_attr_count < CMXD_IIO_MAX_EVENT_ATTRS) {
+        size_t len = strlen(entry->d_name);
+        
+        if (strncmp(entry->d_name, "in_accel", 8) != 0 || len <= 3 ||
+            strcmp(entry->d_name + len - 3, "_en") != 0 ||
+            (!strstr(entry->d_name, "_thresh_") && !strstr(entry->d_name, "_mag_")) ||
+            len - 3 >= sizeof(buf->event_attrs[0])) {
+            continue;
+        }
+        
+        memcpy(buf->event_attrs[buf->event_attr_count], entry->d_name, len - 3);
+        buf->event_attrs[buf->event_attr_count][len - 3] = '\0';
+        log_debug("IIO event for %s: %s", buf->device_name, buf->event_attrs[buf->event_attr_count]);
+        buf->event_attr_count++;
+    }
+    closedir(dir);
+}
+
+/* Whether the sensor can wake us through threshold events */
+bool cmxd_iio_events_available(const struct iio_buffer *buf)
+{
+    return buf->event_attr_count > 0;
+}
+
+/*
+ * Arm every threshold event around the last reading. Per-axis rising/falling
+ * thresholds are placed 'margin' raw units above/below the current value;
+ * events without a per-axis value keep the driver's threshold.
+ */
+int cmxd_arm_iio_events(struct iio_buffer *buf, const struct accel_sample *last, int margin)
+{
+    char path[PATH_MAX];
+    int armed = 0;
+    
+    if (buf->event_fd < 0) {
+        if (ioctl(buf->buffer_fd, IIO_GET_EVENT_FD_IOCTL, &buf->event_fd) < 0) {
+            log_warn("Failed to get event fd for %s: %s", buf->device_name, strerror(errno));
+            buf->event_fd = -1;
+            return -1;
+        }
+        fcntl(buf->event_fd, F_SETFL, fcntl(buf->event_fd, F_GETFL) | O_NONBLOCK);
+    }
+    
+    for (int i = 0; i < buf->event_attr_count; i++) {
+        const char *attr = buf->event_attrs[i];
+        char axis, direction[16];
+        
+        if (sscanf(attr, "in_accel_%c_thresh_%15s", &axis, direction) == 2) {
+            int value = axis == 'x' ? last->x : axis == 'y' ? last->y : last->z;
+            
+            if (strcmp(direction, "rising") == 0) {
+                value += margin;
+            } else if (strcmp(direction, "falling") == 0) {
+                value -= margin;
+            }
+            
+            cmxd_path(path, sizeof(path), IIO_EVENT_ATTR_TEMPLATE, buf->device_name, attr, "value");
+            if (access(path, W_OK) == 0 && write_sysfs_int(path, value) < 0) {
+                log_warn("Failed to set %s threshold for %s: %s", attr, buf->device_name, strerror(errno));
+            }
+        }
+        
+        cmxd_path(path, sizeof(path), IIO_EVENT_ATTR_TEMPLATE, buf->device_name, attr, "en");
+        if (write_sysfs_int(path, 1) < 0) {
+            log_warn("Failed to enable %s for %s: %s", attr, buf->device_name, strerror(errno));
+            continue;
+        }
+        armed++;
+    }
+    
+    if (armed == 0) {
+        return -1;
+    }
+    
+    buf->events_armed = true;
+    return 0;
+}
+
+/* Disable threshold events and discard anything still queued */
+void cmxd_disarm_iio_events(struct iio_buffer *buf)
+{
+    char path[PATH_MAX];
+    
+    if (!buf->events_armed) {
+        return;
+    }
+    
+    for (int i = 0; i < buf->event_attr_count; i++) {
+        cmxd_path(path, sizeof(path), IIO_EVENT_ATTR_TEMPLATE, buf->device_name, buf->event_attrs[i], "en");
+        write_sysfs_int(path, 0);
+    }
+    cmxd_read_iio_events(buf);
+    buf->events_armed = false;
+}
+
+/* Drain queued events; returns the number read */
+int cmxd_read_iio_events(struct iio_buffer *buf)
+{
+    struct iio_event_data events[8];
+    ssize_t bytes_read;
+    int count = 0;
+    
+    if (buf->event_fd < 0) {
+        return 0;
+    }
+    
+    while ((bytes_read = read(buf->event_fd, events, sizeof(events))) > 0) {
+        int n = bytes_read / sizeof(events[0]);
+        for (int i = 0; i < n; i++) {
+            log_debug("IIO event on %s: type=%d dir=%d", buf->device_name,
+                      (int)IIO_EVENT_CODE_EXTRACT_TYPE(events[i].id),
+                      (int)IIO_EVENT_CODE_EXTRACT_DIR(events[i].id));
+        }
+        count += n;
+    }
+    
+    return count;
+}
+
+/* Detach the buffer from its trigger so no scans (and no wakeups) occur */
+static int iio_source_suspend(struct iio_buffer *buf)
+{
+    char path[PATH_MAX];
+    
+    cmxd_path(path, sizeof(path), IIO_BUFFER_ENABLE_TEMPLATE, buf->device_name);
+    if (write_sysfs_int(path, 0) < 0) {
+        log_error("Failed to disable buffer for %s: %s", buf->device_name, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* Re-enable a suspended buffer */
+static int iio_source_resume(struct iio_buffer *buf)
+{
+    char path[PATH_MAX];
+    
+    cmxd_path(path, sizeof(path), IIO_BUFFER_ENABLE_TEMPLATE, buf->device_name);
+    if (write_sysfs_int(path, 1) < 0) {
+        log_error("Failed to re-enable buffer for %s: %s", buf->device_name, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int cmxd_suspend_iio_buffer(struct iio_buffer *buf)
+{
+    return buf->source && buf->source->suspend ? buf->source->suspend(buf) : 0;
+}
+
+/* Resume a suspended buffer; the sampling gap is not counted as loss */
+int cmxd_resume_iio_buffer(struct iio_buffer *buf)
+{
+    if (buf->source && buf->source->resume && buf->source->resume(buf) < 0) {
+        return -1;
+    }
+    
+    buf->last_timestamp = 0;
+    buf->saturated = 0;
+    return 0;
+}
+
+/*
+ * =============================================================================
+ * IIO BUFFER MANAGEMENT
+ * =============================================================================
+ */
+
+/*
+ * Find the lowest-numbered iio-trig-sysfs trigger, identified by its name
+ * rather than its index since other triggers share the triggerN namespace.
+ * Returns the triggerN index and fills name, or -1 if there is none.
+ */
+static int find_sysfs_trigger(char *name, size_t name_size)
+{
+    char path[PATH_MAX];
+    char trigger_name[64];
+    struct dirent *entry;
+    int found = -1;
+    
+    char devices_path[PATH_MAX];
+    cmxd_path(devices_path, sizeof(devices_path), IIO_DEVICES_PATH);
+    DIR *dir = opendir(devices_path);
+    if (!dir) {
+        return -1;
+    }
+    
+    while ((entry = readdir(dir)) != NULL) {
+        int id;
+        
+        if (sscanf(entry->d_name, "trigger%d", &id) != 1 || (found >= 0 && id > found)) {
+            continue;
+        }
+        
+        cmxd_path(path, sizeof(path), IIO_TRIGGER_NAME_TEMPLATE, id);
+        if (read_sysfs_string(path, trigger_name, sizeof(trigger_name)) == 0 &&
+            strncmp(trigger_name, "sysfstrig", 9) == 0) {
+            found = id;
+            if (name) {
+                snprintf(name, name_size, "%s", trigger_name);
+            }
+        }
+    }
+    
+    closedir(dir);
+    return found;
+}
+
+/* Ensure IIO sysfs trigger exists (create if needed, but don't manage lifecycle) */
+int cmxd_ensure_iio_trigger_exists(void) {
+    char trigger_name[64];
+    
+    /* Check if a sysfs trigger already exists */
+    if (find_sysfs_trigger(trigger_name, sizeof(trigger_name)) >= 0) {
+        log_debug("Using existing trigger: %s", trigger_name);
+        return 0;
+    }
+    
+    /* No trigger exists, create trigger0 */
+    char add_path[PATH_MAX];
+    cmxd_path(add_path, sizeof(add_path), IIO_SYSFS_TRIGGER_ADD_PATH);
+    FILE *fp = fopen(add_path, "w");
+    if (!fp) {
+        log_error("Failed to open trigger creation interface: %s", strerror(errno));
+        return -1;
+    }
+    
+    if (fprintf(fp, "0\n") < 0) {
+        log_error("Failed to create trigger: %s", strerror(errno));
+        fclose(fp);
+        return -1;
+    }
+    
+    fclose(fp);
+    
+    /* Verify the trigger was created */
+    if (find_sysfs_trigger(trigger_name, sizeof(trigger_name)) >= 0) {
+        log_info("Created persistent IIO trigger: %s", trigger_name);
+        return 0;
+    } else {
+        log_error("Trigger creation failed - sysfstrig0 not found");
+        return -1;
+    }
+}
+
+/* Find the triggerN index whose name attribute matches, -1 if absent */
+static int find_iio_trigger_by_name(const char *name)
+{
+    char path[PATH_MAX];
+    char trigger_name[64];
+    struct dirent *entry;
+    int found = -1;
+    
+    char devices_path[PATH_MAX];
+    cmxd_path(devices_path, sizeof(devices_path), IIO_DEVICES_PATH);
+    DIR *dir = opendir(devices_path);
+    if (!dir) {
+        return -1;
+    }
+    
+    while ((entry = readdir(dir)) != NULL) {
+        int id;
+        
+        if (sscanf(entry->d_name, "trigger%d", &id) != 1) {
+            continue;
+        }
+        
+        cmxd_path(path, sizeof(path), IIO_TRIGGER_NAME_TEMPLATE, id);
+        if (read_sysfs_string(path, trigger_name, sizeof(trigger_name)) == 0 &&
+            strcmp(trigger_name, name) == 0) {
+            found = id;
+            break;
+        }
+    }
+    
+    closedir(dir);
+    return found;
+}
+
+/* Create (or adopt) our configfs hrtimer trigger and program its rate */
+static int setup_hrtimer_trigger(unsigned int sampling_hz)
 {
     char path[PATH_MAX];
-    FILE *f;
+    int trigger_id;
     
-    if (!data_config) {
-        log_error("Data module not initialized");
-        return -1;
+    cmxd_path(path, sizeof(path), IIO_CONFIGFS_HRTIMER_TEMPLATE, CMXD_HRTIMER_TRIGGER_NAME);
+    if (mkdir(path, 0755) < 0) {
+        if (errno != EEXIST) {
+            log_warn("Cannot create hrtimer trigger %s: %s", path, strerror(errno));
+            if (errno == ENOENT) {
+                log_warn("Check that configfs is mounted and iio-trig-hrtimer is loaded");
+            }
+            return -1;
+        }
+        /* Left behind by a previous instance - adopt it */
+        log_debug("Adopting existing hrtimer trigger %s", CMXD_HRTIMER_TRIGGER_NAME);
     }
+    hrtimer_trigger_owned = true;
     
-    if ((size_t)snprintf(path, sizeof(path), "%s/%s_vec", data_config->sysfs_path, name) >= sizeof(path)) {
-        log_error("Path too long for %s vector", name);
+    trigger_id = find_iio_trigger_by_name(CMXD_HRTIMER_TRIGGER_NAME);
+    if (trigger_id < 0) {
+        log_warn("hrtimer trigger %s did not appear under %s", CMXD_HRTIMER_TRIGGER_NAME, IIO_DEVICES_PATH);
+        cmxd_cleanup_iio_trigger();
         return -1;
     }
     
-    f = cmxd_safe_fopen(path, "w");
-    if (!f) return -1;
-    
-    if (fprintf(f, "%d %d %d\n", x, y, z) < 0) {
-        log_error("Failed to write to %s: %s", path, strerror(errno));
-        cmxd_safe_fclose(f, path);
+    cmxd_path(trigger_freq_handle.path, sizeof(trigger_freq_handle.path),
+              IIO_TRIGGER_SAMPLING_FREQ_TEMPLATE, trigger_id);
+    if (write_sysfs_int(trigger_freq_handle.path, (int)sampling_hz) < 0) {
+        log_warn("Failed to set hrtimer trigger frequency %u Hz: %s", sampling_hz, strerror(errno));
+        cmxd_cleanup_iio_trigger();
         return -1;
     }
     
-    if (cmxd_safe_fclose(f, path) < 0) return -1;
-
-    /* Sensor write debug output reduced for cleaner format */
+    snprintf(active_trigger_name, sizeof(active_trigger_name), "%s", CMXD_HRTIMER_TRIGGER_NAME);
+    hrtimer_trigger_active = true;
+    log_info("Using hrtimer trigger %s (trigger%d) at %u Hz", active_trigger_name, trigger_id, sampling_hz);
     return 0;
 }
 
-/* Write mode to kernel module sysfs */
-int cmxd_write_mode(const char *mode)
+/*
+ * Use the hrtimer trigger the cmx module registers and binds to both
+ * accelerometers. We only tune its rate; it is never ours to remove.
+ */
+static int setup_kernel_trigger(unsigned int sampling_hz)
 {
-    char path[PATH_MAX];
-    FILE *f;
-    
-    if (!data_config) {
-        log_error("Data module not initialized");
-        return -1;
-    }
+    int trigger_id = find_iio_trigger_by_name(CMXD_KERNEL_TRIGGER_NAME);
     
-    if ((size_t)snprintf(path, sizeof(path), "%s/mode", data_config->sysfs_path) >= sizeof(path)) {
-        log_error("Path too long for mode");
+    if (trigger_id < 0) {
+        log_debug("cmx module trigger not present");
         return -1;
     }
     
-    f = cmxd_safe_fopen(path, "w");
-    if (!f) return -1;
-    
-    if (fprintf(f, "%s\n", mode) < 0) {
-        log_error("Failed to write mode to %s: %s", path, strerror(errno));
-        cmxd_safe_fclose(f, path);
+    cmxd_path(trigger_freq_handle.path, sizeof(trigger_freq_handle.path),
+              IIO_TRIGGER_SAMPLING_FREQ_TEMPLATE, trigger_id);
+    if (write_sysfs_int(trigger_freq_handle.path, (int)sampling_hz) < 0) {
+        log_warn("Failed to set cmx trigger frequency %u Hz: %s", sampling_hz, strerror(errno));
+        trigger_freq_handle.path[0] = '\0';
         return -1;
     }
     
-    if (cmxd_safe_fclose(f, path) < 0) return -1;
-    
-    /* Mode write debug output shown in main loop */
+    snprintf(active_trigger_name, sizeof(active_trigger_name), "%s", CMXD_KERNEL_TRIGGER_NAME);
+    hrtimer_trigger_active = true;
+    log_info("Using cmx module trigger (trigger%d) at %u Hz", trigger_id, sampling_hz);
     return 0;
 }
 
-/* Write orientation to kernel module sysfs */
-int cmxd_write_orientation(const char *orientation)
+/* Select the sampling trigger: the module's, our hrtimer trigger, then sysfs */
+int cmxd_setup_iio_trigger(void)
 {
-    char path[PATH_MAX];
-    FILE *f;
+    unsigned int sampling_hz = CMXD_DEFAULT_SAMPLING_HZ;
     
-    if (!data_config) {
-        log_error("Data module not initialized");
-        return -1;
+    if (data_config && data_config->sampling_hz > 0) {
+        sampling_hz = data_config->sampling_hz;
     }
     
-    if ((size_t)snprintf(path, sizeof(path), "%s/orientation", data_config->sysfs_path) >= sizeof(path)) {
-        log_error("Path too long for orientation");
-        return -1;
+    if (!data_config || data_config->trigger_type == CMXD_TRIGGER_HRTIMER) {
+        if (setup_kernel_trigger(sampling_hz) == 0 || setup_hrtimer_trigger(sampling_hz) == 0) {
+            return 0;
+        }
+        log_warn("hrtimer trigger unavailable, falling back to sysfs trigger");
     }
     
-    f = cmxd_safe_fopen(path, "w");
-    if (!f) return -1;
+    active_trigger_name[0] = '\0';
+    hrtimer_trigger_active = false;
+    return cmxd_ensure_iio_trigger_exists();
+}
+
+/* Whether samples are paced by the kernel (no trigger_now writes needed) */
+bool cmxd_iio_trigger_is_hrtimer(void)
+{
+    return hrtimer_trigger_active;
+}
+
+/* Retune the hrtimer trigger; takes effect without re-enabling the buffers */
+int cmxd_set_trigger_frequency(unsigned int sampling_hz)
+{
+    char line[16];
+    size_t len;
     
-    if (fprintf(f, "%s\n", orientation) < 0) {
-        log_error("Failed to write orientation to %s: %s", path, strerror(errno));
-        cmxd_safe_fclose(f, path);
+    if (!hrtimer_trigger_active || !trigger_freq_handle.path[0]) {
         return -1;
     }
     
-    if (cmxd_safe_fclose(f, path) < 0) return -1;
-    
-    /* Orientation write debug output shown in main loop */
-    return 0;
+    len = format_int(line, (int)sampling_hz);
+    line[len++] = '\n';
+    return sysfs_handle_write(&trigger_freq_handle, line, len);
 }
 
-/*
- * =============================================================================
- * IIO DEVICE DISCOVERY AND MANAGEMENT
- * =============================================================================
- */
-
-/* Find IIO device for given I2C bus/address */
-int cmxd_find_iio_device_for_i2c(int bus, int addr, char *device_name, size_t name_size)
+/* Remove the hrtimer trigger we own; buffers must already be detached */
+void cmxd_cleanup_iio_trigger(void)
 {
     char path[PATH_MAX];
-    char link_target[PATH_MAX];
-    char i2c_name[64];
-    ssize_t link_len;
     
-    /* Expected I2C device name format */
-    snprintf(i2c_name, sizeof(i2c_name), "%d-%04x", bus, addr);
+    /* The trigger directory goes away below; drop the cached frequency handle */
+    sysfs_handle_close(&trigger_freq_handle);
+    trigger_freq_handle.path[0] = '\0';
     
-    /* Search through IIO devices to find one with matching I2C device */
-    for (int i = 0; i < 10; i++) {
-        snprintf(path, sizeof(path), IIO_DEVICE_TEMPLATE, i);
-        
-        /* Read the symlink to see if it points to our I2C device */
-        link_len = readlink(path, link_target, sizeof(link_target) - 1);
-        if (link_len > 0) {
-            link_target[link_len] = '\0';
-            
-            /* Check if the link target contains our I2C device name */
-            if (strstr(link_target, i2c_name)) {
-                snprintf(device_name, name_size, "iio:device%d", i);
-                return 0;
-            }
+    if (hrtimer_trigger_owned) {
+        cmxd_path(path, sizeof(path), IIO_CONFIGFS_HRTIMER_TEMPLATE, CMXD_HRTIMER_TRIGGER_NAME);
+        if (rmdir(path) < 0 && errno != ENOENT) {
+            log_warn("Failed to remove hrtimer trigger %s: %s", path, strerror(errno));
+        } else {
+            log_debug("Removed hrtimer trigger %s", CMXD_HRTIMER_TRIGGER_NAME);
         }
+        hrtimer_trigger_owned = false;
     }
     
-    return -1;
+    hrtimer_trigger_active = false;
+    active_trigger_name[0] = '\0';
 }
 
-/*
- * =============================================================================
- * IIO BUFFER MANAGEMENT
- * =============================================================================
- */
-
-/* Ensure IIO sysfs trigger exists (create if needed, but don't manage lifecycle) */
-int cmxd_ensure_iio_trigger_exists(void) {
+/* Match the sensor's own output data rate to the hrtimer trigger */
+static void configure_sensor_sampling_frequency(const char *device_name)
+{
     char path[PATH_MAX];
-    int trigger_id;
     
-    /* Check if any trigger already exists (0-9) */
-    for (trigger_id = 0; trigger_id < 10; trigger_id++) {
-        snprintf(path, sizeof(path), IIO_TRIGGER_TEMPLATE, trigger_id);
-        if (access(path, F_OK) == 0) {
-            log_debug("Using existing trigger: sysfstrig%d", trigger_id);
-            return 0;  /* Found existing trigger */
-        }
+    cmxd_path(path, sizeof(path), IIO_ACCEL_SAMPLING_FREQ_TEMPLATE, device_name);
+    if (access(path, F_OK) != 0) {
+        log_debug("%s has no in_accel_sampling_frequency, relying on trigger rate", device_name);
+        return;
     }
     
-    /* No trigger exists, create trigger0 */
-    FILE *fp = fopen(IIO_SYSFS_TRIGGER_ADD_PATH, "w");
-    if (!fp) {
-        log_error("Failed to open trigger creation interface: %s", strerror(errno));
-        return -1;
+    if (write_sysfs_int(path, (int)data_config->sampling_hz) < 0) {
+        log_warn("Failed to set sampling frequency %u Hz on %s: %s",
+                 data_config->sampling_hz, device_name, strerror(errno));
     }
+}
+
+/* Configure kernel FIFO length and watermark (buffer must be disabled) */
+static void configure_iio_buffer_batching(struct iio_buffer *buf)
+{
+    char path[PATH_MAX];
+    int length = CMXD_IIO_DEFAULT_BUFFER_LENGTH;
+    int watermark = CMXD_IIO_DEFAULT_WATERMARK;
     
-    if (fprintf(fp, "0\n") < 0) {
-        log_error("Failed to create trigger: %s", strerror(errno));
-        fclose(fp);
-        return -1;
+    if (data_config && data_config->buffer_length > 0) {
+        length = data_config->buffer_length;
+    }
+    if (data_config && data_config->buffer_watermark > 0) {
+        watermark = data_config->buffer_watermark;
     }
     
-    fclose(fp);
+    if (length > CMXD_IIO_MAX_BATCH) {
+        length = CMXD_IIO_MAX_BATCH;
+    }
+    if (watermark > length) {
+        log_warn("Watermark %d exceeds buffer length %d, clamping", watermark, length);
+        watermark = length;
+    }
     
-    /* Verify the trigger was created */
-    snprintf(path, sizeof(path), IIO_TRIGGER0_PATH);
-    if (access(path, F_OK) == 0) {
-        log_info("Created persistent IIO trigger: sysfstrig0");
-        return 0;
-    } else {
-        log_error("Trigger creation failed - trigger0 not found");
-        return -1;
+    cmxd_path(path, sizeof(path), IIO_BUFFER_LENGTH_TEMPLATE, buf->device_name);
+    if (write_sysfs_int(path, length) < 0) {
+        log_warn("Failed to set buffer length %d for %s: %s", length, buf->device_name, strerror(errno));
+    }
+    
+    /* Watermark first appeared in Linux 4.2; older kernels wake per scan */
+    cmxd_path(path, sizeof(path), IIO_BUFFER_WATERMARK_TEMPLATE, buf->device_name);
+    if (write_sysfs_int(path, watermark) < 0) {
+        log_warn("Failed to set buffer watermark %d for %s: %s", watermark, buf->device_name, strerror(errno));
+        watermark = 1;
     }
+    
+    buf->buffer_length = length;
+    buf->watermark = watermark;
+    log_debug("Buffer batching for %s: length=%d watermark=%d", buf->device_name, length, watermark);
 }
 
-/* Setup IIO buffer for a device */
-int cmxd_setup_iio_buffer(struct iio_buffer *buf, const char *device_name) {
+/*
+ * Build the scan layout from every enabled element in scan_elements/.
+ * Elements enabled by other consumers are included so offsets stay correct.
+ */
+static int load_iio_scan_layout(struct iio_buffer *buf)
+{
     char path[PATH_MAX];
-    FILE *fp;
+    char value[64];
+    DIR *dir;
+    struct dirent *entry;
     
-    memset(buf, 0, sizeof(*buf));
-    strncpy(buf->device_name, device_name, sizeof(buf->device_name) - 1);
-    buf->buffer_fd = -1;
-    buf->trigger_fd = -1;
+    cmxd_scan_layout_init(&buf->layout);
     
-    /* Get device number from device name */
-    int device_num;
-    if (sscanf(device_name, "iio:device%d", &device_num) != 1) {
-        log_error("Invalid device name format: %s", device_name);
+    cmxd_path(path, sizeof(path), IIO_SCAN_ELEMENTS_TEMPLATE, buf->device_name);
+    dir = opendir(path);
+    if (!dir) {
+        log_error("Failed to open %s: %s", path, strerror(errno));
         return -1;
     }
     
-    /* Use the first available trigger (we ensured one exists) */
-    int trigger_id;
-    for (trigger_id = 0; trigger_id < 10; trigger_id++) {
-        snprintf(path, sizeof(path), IIO_TRIGGER_TEMPLATE, trigger_id);
-        if (access(path, F_OK) == 0) {
-            snprintf(buf->trigger_name, sizeof(buf->trigger_name), "sysfstrig%d", trigger_id);
-            log_debug("Using trigger: %s", buf->trigger_name);
-            break;
+    while ((entry = readdir(dir)) != NULL) {
+        char name[CMXD_SCAN_NAME_MAX];
+        size_t len = strlen(entry->d_name);
+        int index;
+        
+        if (len <= 3 || len - 3 >= sizeof(name) || strcmp(entry->d_name + len - 3, "_en") != 0) {
+            continue;
+        }
+        memcpy(name, entry->d_name, len - 3);
+        name[len - 3] = '\0';
+        
+        cmxd_path(path, sizeof(path), IIO_SCAN_ELEMENT_TEMPLATE, buf->device_name, name, "en");
+        if (read_sysfs_string(path, value, sizeof(value)) < 0 || strcmp(value, "1") != 0) {
+            continue;
+        }
+        
+        cmxd_path(path, sizeof(path), IIO_SCAN_ELEMENT_TEMPLATE, buf->device_name, name, "index");
+        if (read_sysfs_string(path, value, sizeof(value)) < 0 || sscanf(value, "%d", &index) != 1) {
+            log_error("Failed to read scan index of %s for %s", name, buf->device_name);
+            closedir(dir);
+            return -1;
+        }
+        
+        cmxd_path(path, sizeof(path), IIO_SCAN_ELEMENT_TEMPLATE, buf->device_name, name, "type");
+        if (read_sysfs_string(path, value, sizeof(value)) < 0 ||
+            cmxd_scan_layout_add(&buf->layout, name, index, value) < 0) {
+            log_error("Unsupported scan type of %s for %s: %s", name, buf->device_name, value);
+            closedir(dir);
+            return -1;
         }
     }
+    closedir(dir);
     
-    if (trigger_id >= 10) {
-        log_error("No trigger found for %s - triggers must be available", device_name);
+    if (cmxd_scan_layout_finalize(&buf->layout) < 0) {
+        log_error("Scan layout of %s lacks decodable accelerometer channels", buf->device_name);
         return -1;
     }
-    
-    /* Read scan element indices */
-    snprintf(path, sizeof(path), IIO_SCAN_ACCEL_X_INDEX_TEMPLATE, device_name);
-    fp = fopen(path, "r");
-    if (!fp || fscanf(fp, "%d", &buf->x_index) != 1) {
-        log_error("Failed to read X index for %s", device_name);
-        if (fp) fclose(fp);
-        return -1;
+    if (buf->layout.timestamp_offset < 0) {
+        log_warn("No timestamp in scans from %s; overflow tracking disabled", buf->device_name);
     }
-    fclose(fp);
     
-    snprintf(path, sizeof(path), IIO_SCAN_ACCEL_Y_INDEX_TEMPLATE, device_name);
-    fp = fopen(path, "r");
-    if (!fp || fscanf(fp, "%d", &buf->y_index) != 1) {
-        log_error("Failed to read Y index for %s", device_name);
-        if (fp) fclose(fp);
-        return -1;
+    for (int i = 0; i < buf->layout.channel_count; i++) {
+        const struct cmxd_scan_channel *ch = &buf->layout.channels[i];
+        log_debug("Scan element %s: index=%d offset=%d %s:%c%d/%d>>%d", ch->name, ch->index, ch->offset,
+                  ch->big_endian ? "be" : "le", ch->is_signed ? 's' : 'u',
+                  ch->bits, ch->storage_bytes * 8, ch->shift);
     }
-    fclose(fp);
+    log_debug("Scan size for %s: %d bytes", buf->device_name, buf->layout.scan_size);
     
-    snprintf(path, sizeof(path), IIO_SCAN_ACCEL_Z_INDEX_TEMPLATE, device_name);
-    fp = fopen(path, "r");
-    if (!fp || fscanf(fp, "%d", &buf->z_index) != 1) {
-        log_error("Failed to read Z index for %s", device_name);
-        if (fp) fclose(fp);
+    return 0;
+}
+
+/*
+ * Set up buffered capture for one device. A layout restored from the
+ * discovery cache may be passed to skip reading scan_elements/.
+ */
+static int iio_source_setup(struct iio_buffer *buf, const char *device_name,
+                            const struct cmxd_scan_layout *known_layout) {
+    char path[PATH_MAX];
+    FILE *fp;
+    
+    /* Get device number from device name */
+    int device_num;
+    if (sscanf(device_name, "iio:device%d", &device_num) != 1) {
+        log_error("Invalid device name format: %s", device_name);
         return -1;
     }
-    fclose(fp);
     
-    snprintf(path, sizeof(path), IIO_SCAN_TIMESTAMP_INDEX_TEMPLATE, device_name);
-    fp = fopen(path, "r");
-    if (!fp || fscanf(fp, "%d", &buf->timestamp_index) != 1) {
-        log_error("Failed to read timestamp index for %s", device_name);
-        if (fp) fclose(fp);
-        return -1;
+    if (active_trigger_name[0]) {
+        /* Kernel-paced trigger selected by cmxd_setup_iio_trigger() */
+        snprintf(buf->trigger_name, sizeof(buf->trigger_name), "%s", active_trigger_name);
+        log_debug("Using trigger: %s", buf->trigger_name);
+        if (data_config && data_config->sampling_hz > 0) {
+            configure_sensor_sampling_frequency(device_name);
+        }
+    } else {
+        /* Use the first sysfs trigger (we ensured one exists) */
+        if (find_sysfs_trigger(buf->trigger_name, sizeof(buf->trigger_name)) < 0) {
+            log_error("No trigger found for %s - triggers must be available", device_name);
+            return -1;
+        }
+        log_debug("Using trigger: %s", buf->trigger_name);
     }
-    fclose(fp);
     
     /* Enable scan elements */
-    snprintf(path, sizeof(path), IIO_SCAN_ACCEL_X_EN_TEMPLATE, device_name);
+    cmxd_path(path, sizeof(path), IIO_SCAN_ACCEL_X_EN_TEMPLATE, device_name);
     fp = fopen(path, "w");
     if (!fp || fprintf(fp, "1") < 0) {
         log_error("Failed to enable X scan element for %s", device_name);
@@ -379,7 +1250,7 @@ int cmxd_setup_iio_buffer(struct iio_buffer *buf, const char *device_name) {
     }
     fclose(fp);
     
-    snprintf(path, sizeof(path), IIO_SCAN_ACCEL_Y_EN_TEMPLATE, device_name);
+    cmxd_path(path, sizeof(path), IIO_SCAN_ACCEL_Y_EN_TEMPLATE, device_name);
     fp = fopen(path, "w");
     if (!fp || fprintf(fp, "1") < 0) {
         log_error("Failed to enable Y scan element for %s", device_name);
@@ -388,7 +1259,7 @@ int cmxd_setup_iio_buffer(struct iio_buffer *buf, const char *device_name) {
     }
     fclose(fp);
     
-    snprintf(path, sizeof(path), IIO_SCAN_ACCEL_Z_EN_TEMPLATE, device_name);
+    cmxd_path(path, sizeof(path), IIO_SCAN_ACCEL_Z_EN_TEMPLATE, device_name);
     fp = fopen(path, "w");
     if (!fp || fprintf(fp, "1") < 0) {
         log_error("Failed to enable Z scan element for %s", device_name);
@@ -397,7 +1268,7 @@ int cmxd_setup_iio_buffer(struct iio_buffer *buf, const char *device_name) {
     }
     fclose(fp);
     
-    snprintf(path, sizeof(path), IIO_SCAN_TIMESTAMP_EN_TEMPLATE, device_name);
+    cmxd_path(path, sizeof(path), IIO_SCAN_TIMESTAMP_EN_TEMPLATE, device_name);
     fp = fopen(path, "w");
     if (!fp || fprintf(fp, "1") < 0) {
         log_error("Failed to enable timestamp scan element for %s", device_name);
@@ -406,18 +1277,44 @@ int cmxd_setup_iio_buffer(struct iio_buffer *buf, const char *device_name) {
     }
     fclose(fp);
     
-    /* Set current trigger */
-    snprintf(path, sizeof(path), IIO_TRIGGER_CURRENT_TEMPLATE, device_name);
-    fp = fopen(path, "w");
-    if (!fp || fprintf(fp, "%s", buf->trigger_name) < 0) {
-        log_error("Failed to set trigger for %s", device_name);
-        if (fp) fclose(fp);
+    /* Derive offsets and decoders from what the kernel reports as enabled */
+    if (known_layout) {
+        buf->layout = *known_layout;
+        if (buf->layout.x) {
+            /* Rebind the channel pointers to this copy */
+            buf->layout.x = &buf->layout.channels[known_layout->x - known_layout->channels];
+            buf->layout.y = &buf->layout.channels[known_layout->y - known_layout->channels];
+            buf->layout.z = &buf->layout.channels[known_layout->z - known_layout->channels];
+        }
+    } else if (load_iio_scan_layout(buf) < 0) {
         return -1;
     }
-    fclose(fp);
+    buf->sample_size = buf->layout.scan_size;
+    
+    /*
+     * Set current trigger. The cmx module binds its own up front, and the
+     * write would fail with EBUSY while its in-kernel fusion buffer is on.
+     */
+    cmxd_path(path, sizeof(path), IIO_TRIGGER_CURRENT_TEMPLATE, device_name);
+    char current[64];
+    if (read_sysfs_string(path, current, sizeof(current)) == 0 &&
+        strcmp(current, buf->trigger_name) == 0) {
+        log_debug("%s already uses trigger %s", device_name, current);
+    } else {
+        fp = fopen(path, "w");
+        if (!fp || fprintf(fp, "%s", buf->trigger_name) < 0) {
+            log_error("Failed to set trigger for %s", device_name);
+            if (fp) fclose(fp);
+            return -1;
+        }
+        fclose(fp);
+    }
+    
+    /* Length and watermark are only writable while the buffer is disabled */
+    configure_iio_buffer_batching(buf);
     
     /* Enable buffer */
-    snprintf(path, sizeof(path), IIO_BUFFER_ENABLE_TEMPLATE, device_name);
+    cmxd_path(path, sizeof(path), IIO_BUFFER_ENABLE_TEMPLATE, device_name);
     fp = fopen(path, "w");
     if (!fp || fprintf(fp, "1") < 0) {
         log_error("Failed to enable buffer for %s", device_name);
@@ -427,7 +1324,7 @@ int cmxd_setup_iio_buffer(struct iio_buffer *buf, const char *device_name) {
     fclose(fp);
     
     /* Open buffer for reading */
-    snprintf(path, sizeof(path), IIO_DEV_CHAR_TEMPLATE, device_name);
+    cmxd_path(path, sizeof(path), IIO_DEV_CHAR_TEMPLATE, device_name);
     buf->buffer_fd = open(path, O_RDONLY | O_NONBLOCK);
     if (buf->buffer_fd < 0) {
         if (errno == ENOENT) {
@@ -449,23 +1346,61 @@ int cmxd_setup_iio_buffer(struct iio_buffer *buf, const char *device_name) {
     /* Open trigger for control (optional) */
     buf->trigger_fd = -1;  /* We don't need to control the sysfs trigger directly */
     
-    buf->sample_size = 16; /* 3 * 2 bytes + 8 bytes timestamp + padding */
-    buf->enabled = 1;
+    probe_iio_events(buf);
     
     log_debug("IIO buffer setup complete for %s", device_name);
     return 0;
 }
 
-/* Read sample from IIO buffer */
-int cmxd_read_iio_buffer_sample(struct iio_buffer *buf, struct accel_sample *sample) {
-    uint8_t buffer[16];
-    ssize_t bytes_read;
+/* Update inter-scan period estimate and overflow accounting for one scan */
+static void track_iio_scan_timing(struct iio_buffer *buf, uint64_t timestamp, int first_in_batch)
+{
+    if (buf->last_timestamp && timestamp > buf->last_timestamp) {
+        uint64_t delta = timestamp - buf->last_timestamp;
+        
+        if (first_in_batch && buf->saturated && buf->period_ns) {
+            /* The FIFO was full after the previous drain; new scans were dropped */
+            uint64_t missed = (delta + buf->period_ns / 2) / buf->period_ns;
+            if (missed > 1) {
+                buf->stats.samples_lost += missed - 1;
+            }
+        } else if (!buf->period_ns) {
+            buf->period_ns = delta;
+        } else if (delta < buf->period_ns + buf->period_ns / 2) {
+            /* Smooth only over regular intervals so gaps don't inflate the period */
+            buf->period_ns = (buf->period_ns * 7 + delta) / 8;
+        }
+    }
     
-    if (!buf->enabled || buf->buffer_fd < 0) {
-        return -1;
+    buf->last_timestamp = timestamp;
+}
+
+/* Bytes to request per read: the whole kernel FIFO, bounded by max_samples */
+size_t cmxd_iio_buffer_read_size(const struct iio_buffer *buf, int max_samples)
+{
+    int max_scans;
+    
+    if (buf->sample_size <= 0) {
+        return 0;
     }
     
-    bytes_read = read(buf->buffer_fd, buffer, buf->sample_size);
+    max_scans = buf->buffer_length > 0 ? buf->buffer_length : 1;
+    if (max_scans > max_samples) {
+        max_scans = max_samples;
+    }
+    if (max_scans > CMXD_IIO_MAX_BATCH * CMXD_SCAN_MAX_BYTES / buf->sample_size) {
+        max_scans = CMXD_IIO_MAX_BATCH * CMXD_SCAN_MAX_BYTES / buf->sample_size;
+    }
+    return (size_t)max_scans * buf->sample_size;
+}
+
+/* Drain all queued scans from an IIO buffer with a single read() */
+static int iio_source_read(struct iio_buffer *buf, struct accel_sample *samples, int max_samples) {
+    uint8_t buffer[CMXD_IIO_MAX_BATCH * CMXD_SCAN_MAX_BYTES];
+    ssize_t bytes_read;
+    
+
+    bytes_read = read(buf->buffer_fd, buffer, cmxd_iio_buffer_read_size(buf, max_samples));
     if (bytes_read < 0) {
         if (errno == EAGAIN || errno == EWOULDBLOCK) {
             return 0; /* No data available */
@@ -474,45 +1409,74 @@ int cmxd_read_iio_buffer_sample(struct iio_buffer *buf, struct accel_sample *sam
         return -1;
     }
     
-    if (bytes_read != buf->sample_size) {
-        log_warn("Unexpected buffer read size: %zd (expected %d)", bytes_read, buf->sample_size);
+    return cmxd_decode_iio_buffer_samples(buf, buffer, bytes_read, samples, max_samples);
+}
+
+/* Decode scans read from an IIO buffer and account them in the buffer stats */
+int cmxd_decode_iio_buffer_samples(struct iio_buffer *buf, const uint8_t *data, ssize_t bytes_read,
+                                   struct accel_sample *samples, int max_samples) {
+    int count;
+    
+    if (bytes_read <= 0 || bytes_read % buf->sample_size != 0 ||
+        bytes_read / buf->sample_size > max_samples) {
+        log_warn("Unexpected buffer read size: %zd (scan size %d)", bytes_read, buf->sample_size);
         return -1;
     }
     
-    /* Parse accelerometer values based on indices */
-    sample->x = cmxd_parse_accel_value(&buffer[buf->x_index * 2]);
-    sample->y = cmxd_parse_accel_value(&buffer[buf->y_index * 2]);
-    sample->z = cmxd_parse_accel_value(&buffer[buf->z_index * 2]);
+    count = cmxd_scan_decode_batch(&buf->layout, data, bytes_read / buf->sample_size, samples);
+    if (buf->layout.timestamp_offset >= 0) {
+        for (int i = 0; i < count; i++) {
+            track_iio_scan_timing(buf, samples[i].timestamp, i == 0);
+        }
+    }
+    
+    /* A drain that fills the whole kernel FIFO means scans may have been dropped */
+    buf->saturated = (count >= buf->buffer_length && buf->buffer_length > 1);
+    if (buf->saturated) {
+        buf->stats.overruns++;
+    }
     
-    /* Parse timestamp (little-endian 64-bit) */
-    sample->timestamp = le64toh(*(uint64_t*)&buffer[buf->timestamp_index * 2]);
+    buf->stats.wakeups++;
+    buf->stats.samples += count;
     
-    return 1; /* Sample read successfully */
+    return count;
 }
 
-/* Cleanup IIO buffer */
-void cmxd_cleanup_iio_buffer(struct iio_buffer *buf) {
+/* Drain all queued scans from a buffer's source */
+int cmxd_read_iio_buffer_samples(struct iio_buffer *buf, struct accel_sample *samples, int max_samples) {
+    if (!buf->enabled || !buf->source || buf->buffer_fd < 0) {
+        return -1;
+    }
+    
+    return buf->source->read(buf, samples, max_samples);
+}
+
+/* Read sample from IIO buffer */
+int cmxd_read_iio_buffer_sample(struct iio_buffer *buf, struct accel_sample *sample) {
+    return cmxd_read_iio_buffer_samples(buf, sample, 1);
+}
+
+/* Detach the device from its trigger and close its file descriptors */
+static void iio_source_cleanup(struct iio_buffer *buf) {
     char path[PATH_MAX];
     FILE *fp;
     
-    if (!buf->enabled) {
-        return;
-    }
-    
     /* Disable buffer */
-    snprintf(path, sizeof(path), IIO_BUFFER_ENABLE_TEMPLATE, buf->device_name);
+    cmxd_path(path, sizeof(path), IIO_BUFFER_ENABLE_TEMPLATE, buf->device_name);
     fp = fopen(path, "w");
     if (fp) {
         fprintf(fp, "0");
         fclose(fp);
     }
     
-    /* Clear trigger */
-    snprintf(path, sizeof(path), IIO_TRIGGER_CURRENT_TEMPLATE, buf->device_name);
-    fp = fopen(path, "w");
-    if (fp) {
-        fprintf(fp, "\n");
-        fclose(fp);
+    /* Clear trigger, unless it is the module's: that binding outlives us */
+    if (strcmp(buf->trigger_name, CMXD_KERNEL_TRIGGER_NAME) != 0) {
+        cmxd_path(path, sizeof(path), IIO_TRIGGER_CURRENT_TEMPLATE, buf->device_name);
+        fp = fopen(path, "w");
+        if (fp) {
+            fprintf(fp, "\n");
+            fclose(fp);
+        }
     }
     
     /* Close file descriptors */
@@ -526,21 +1490,54 @@ void cmxd_cleanup_iio_buffer(struct iio_buffer *buf) {
         buf->trigger_fd = -1;
     }
     
-    buf->enabled = 0;
-    log_info("IIO buffer cleaned up for %s", buf->device_name);
+    if (buf->event_fd >= 0) {
+        close(buf->event_fd);
+        buf->event_fd = -1;
+    }
+}
+
+static const struct cmxd_sample_source iio_source = {
+    .name = "iio",
+    .setup = iio_source_setup,
+    .read = iio_source_read,
+    .suspend = iio_source_suspend,
+    .resume = iio_source_resume,
+    .cleanup = iio_source_cleanup,
+};
+
+/* Set up a buffer on the configured sample source (the IIO device by default) */
+int cmxd_setup_iio_buffer(struct iio_buffer *buf, const char *device_name,
+                          const struct cmxd_scan_layout *known_layout) {
+    memset(buf, 0, sizeof(*buf));
+    strncpy(buf->device_name, device_name, sizeof(buf->device_name) - 1);
+    buf->buffer_fd = -1;
+    buf->trigger_fd = -1;
+    buf->event_fd = -1;
+    buf->source = data_config && data_config->source ? data_config->source : &iio_source;
+    
+    if (buf->source->setup(buf, device_name, known_layout) < 0) {
+        return -1;
+    }
+    
+    buf->enabled = 1;
+    return 0;
 }
 
-/* Parse accelerometer value from buffer data (big-endian 12-bit) */
-int cmxd_parse_accel_value(const uint8_t *data) {
-    uint16_t raw = be16toh(*(uint16_t*)data);
-    raw >>= 4; /* Right shift by 4 bits for be:s12/16>>4 format */
+/* Cleanup IIO buffer */
+void cmxd_cleanup_iio_buffer(struct iio_buffer *buf) {
+    if (!buf->enabled) {
+        return;
+    }
     
-    /* Sign extend from 12-bit to 16-bit */
-    if (raw & 0x800) {
-        raw |= 0xF000;
+    /* Leave no threshold events armed behind us */
+    cmxd_disarm_iio_events(buf);
+    
+    if (buf->source) {
+        buf->source->cleanup(buf);
     }
     
-    return (int16_t)raw;
+    buf->enabled = 0;
+    log_info("IIO buffer cleaned up for %s", buf->device_name);
 }
 
 /*
@@ -549,21 +1546,6 @@ int cmxd_parse_accel_value(const uint8_t *data) {
  * =============================================================================
  */
 
-/* Wait for a path to exist */
-int cmxd_wait_for_path(const char *path, int timeout_sec)
-{
-    int tries = timeout_sec * 2; /* Check every 0.5 seconds */
-    
-    while (tries-- > 0) {
-        if (access(path, F_OK) == 0) {
-            return 0;
-        }
-        usleep(500000); /* 0.5 seconds */
-    }
-    
-    return -1;
-}
-
 /* Validate that paths exist and are accessible */
 int cmxd_validate_paths(const char *base_dev, const char *lid_dev)
 {
@@ -576,13 +1558,13 @@ int cmxd_validate_paths(const char *base_dev, const char *lid_dev)
     }
     
     /* Check IIO devices */
-    snprintf(path, sizeof(path), IIO_DEVICE_PATH_TEMPLATE, base_dev);
+    cmxd_path(path, sizeof(path), IIO_DEVICE_PATH_TEMPLATE, base_dev);
     if (stat(path, &st) < 0) {
         log_error("Base IIO device not found: %s", path);
         return -1;
     }
     
-    snprintf(path, sizeof(path), IIO_DEVICE_PATH_TEMPLATE, lid_dev);
+    cmxd_path(path, sizeof(path), IIO_DEVICE_PATH_TEMPLATE, lid_dev);
     if (stat(path, &st) < 0) {
         log_error("Lid IIO device not found: %s", path);
         return -1;
@@ -604,8 +1586,6 @@ int cmxd_read_kernel_device_assignments(char *base_dev, size_t base_size,
     char path[PATH_MAX];
     FILE *fp;
     char device_info[64];
-    int bus;
-    unsigned int addr;
     
     if (!data_config) {
         log_error("Data module not initialized");
@@ -630,20 +1610,15 @@ int cmxd_read_kernel_device_assignments(char *base_dev, size_t base_size,
         char *newline = strchr(device_info, '\n');
         if (newline) *newline = '\0';
         
-        /* Check if it's already an IIO device name */
+        /* The driver resolves the device itself; wait until it has */
         if (strncmp(device_info, "iio:device", 10) == 0) {
             strncpy(base_dev, device_info, base_size - 1);
             base_dev[base_size - 1] = '\0';
             log_info("Base device from kernel: %s", base_dev);
-        } else if (sscanf(device_info, "i2c-%d:0x%x", &bus, &addr) == 2) {
-            /* Fallback: I2C info, need to find IIO device */
-            if (cmxd_find_iio_device_for_i2c(bus, addr, base_dev, base_size) == 0) {
-                log_info("Base device from kernel: %s (i2c %d-0x%02x)", base_dev, bus, addr);
-            } else {
-                log_warn("Could not find IIO device for base i2c %d-0x%02x", bus, addr);
-                fclose(fp);
-                return -1;
-            }
+        } else if (strcmp(device_info, "not_detected") == 0) {
+            log_debug("Base accelerometer not detected by kernel module yet");
+            fclose(fp);
+            return -1;
         } else {
             log_warn("Invalid base device format in kernel module: %s", device_info);
             fclose(fp);
@@ -668,20 +1643,15 @@ int cmxd_read_kernel_device_assignments(char *base_dev, size_t base_size,
         char *newline = strchr(device_info, '\n');
         if (newline) *newline = '\0';
         
-        /* Check if it's already an IIO device name */
+        /* The driver resolves the device itself; wait until it has */
         if (strncmp(device_info, "iio:device", 10) == 0) {
             strncpy(lid_dev, device_info, lid_size - 1);
             lid_dev[lid_size - 1] = '\0';
             log_info("Lid device from kernel: %s", lid_dev);
-        } else if (sscanf(device_info, "i2c-%d:0x%x", &bus, &addr) == 2) {
-            /* Fallback: I2C info, need to find IIO device */
-            if (cmxd_find_iio_device_for_i2c(bus, addr, lid_dev, lid_size) == 0) {
-                log_info("Lid device from kernel: %s (i2c %d-0x%02x)", lid_dev, bus, addr);
-            } else {
-                log_warn("Could not find IIO device for lid i2c %d-0x%02x", bus, addr);
-                fclose(fp);
-                return -1;
-            }
+        } else if (strcmp(device_info, "not_detected") == 0) {
+            log_debug("Lid accelerometer not detected by kernel module yet");
+            fclose(fp);
+            return -1;
         } else {
             log_warn("Invalid lid device format in kernel module: %s", device_info);
             fclose(fp);
@@ -701,23 +1671,25 @@ int cmxd_read_kernel_device_assignments(char *base_dev, size_t base_size,
 
 /* Trigger IIO sampling by writing to trigger now file */
 int cmxd_trigger_iio_sampling(void) {
-    FILE *fp;
-    char path[PATH_MAX];
-    int trigger_id;
+    static const char one = '1';
     
-    /* Find the first available trigger */
-    for (trigger_id = 0; trigger_id < 10; trigger_id++) {
-        snprintf(path, sizeof(path), IIO_TRIGGER_NOW_TEMPLATE, trigger_id);
-        fp = fopen(path, "w");
-        if (fp) {
-            if (fprintf(fp, "1") >= 0) {
-                fclose(fp);
-                return 0;
-            }
-            fclose(fp);
+    /* Resolve the first sysfs trigger once; the handle is reused afterwards */
+    if (!trigger_now_handle.path[0]) {
+        int trigger_id = find_sysfs_trigger(NULL, 0);
+        if (trigger_id < 0) {
+            log_error("No trigger available for sampling");
+            return -1;
         }
+        cmxd_path(trigger_now_handle.path, sizeof(trigger_now_handle.path),
+                  IIO_TRIGGER_NOW_TEMPLATE, trigger_id);
+        log_debug("Using %s for sampling", trigger_now_handle.path);
     }
     
-    log_error("No trigger available for sampling");
-    return -1;
+    if (sysfs_handle_write(&trigger_now_handle, &one, 1) < 0) {
+        /* Trigger may have been removed; search again next time */
+        sysfs_handle_close(&trigger_now_handle);
+        trigger_now_handle.path[0] = '\0';
+        return -1;
+    }
+    return 0;
 }
\ No newline at end of file
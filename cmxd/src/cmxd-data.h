@@ -15,6 +15,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <limits.h>
+#include <sys/types.h>
+
+#include "cmxd-scan.h"
 
 #ifndef PATH_MAX
 #define PATH_MAX 4096
@@ -22,6 +25,49 @@
 
 #define DEVICE_NAME_MAX 128
 
+/* Batched acquisition limits (scans per IIO buffer) */
+#define CMXD_IIO_MAX_BATCH              128
+#define CMXD_IIO_DEFAULT_BUFFER_LENGTH  32
+#define CMXD_IIO_DEFAULT_WATERMARK      1
+
+/* Threshold/motion event attributes tracked per sensor */
+#define CMXD_IIO_MAX_EVENT_ATTRS        8
+
+/* Sampling trigger types */
+#define CMXD_TRIGGER_HRTIMER            0   /* cmx module's trigger, else our own via configfs */
+#define CMXD_TRIGGER_SYSFS              1   /* iio-trig-sysfs, fired from userspace */
+
+#define CMXD_DEFAULT_SAMPLING_HZ        10
+#define CMXD_MAX_SAMPLING_HZ            1000
+
+/* Per-buffer acquisition statistics */
+struct iio_buffer_stats {
+    uint64_t wakeups;           /* read() calls that returned data */
+    uint64_t samples;           /* Scans decoded */
+    uint64_t overruns;          /* Drains that found the kernel FIFO full */
+    uint64_t samples_lost;      /* Estimated scans dropped while the FIFO was full */
+};
+
+struct iio_buffer;
+struct accel_sample;
+
+/*
+ * Where an iio_buffer's scans come from. The default source is the IIO
+ * character device; others (such as the synthetic generator) provide their
+ * own pollable buffer_fd and fill samples directly. suspend, resume and
+ * read_scale are optional.
+ */
+struct cmxd_sample_source {
+    const char *name;
+    int (*setup)(struct iio_buffer *buf, const char *device_name,
+                 const struct cmxd_scan_layout *known_layout);
+    int (*read)(struct iio_buffer *buf, struct accel_sample *samples, int max_samples);
+    int (*suspend)(struct iio_buffer *buf);
+    int (*resume)(struct iio_buffer *buf);
+    void (*cleanup)(struct iio_buffer *buf);
+    double (*read_scale)(const char *device_name);
+};
+
 /* 
  * IIO buffer structure for event-driven accelerometer reading.
  * Contains file descriptors, device configuration, and data layout information.
@@ -31,9 +77,24 @@ struct iio_buffer {
     int buffer_fd;
     int trigger_fd;
     char trigger_name[64];
-    int x_index, y_index, z_index, timestamp_index;
-    int sample_size;
+    struct cmxd_scan_layout layout;  /* Enabled scan elements and decoders */
+    int sample_size;            /* Bytes per scan (layout.scan_size) */
+    int buffer_length;          /* Kernel FIFO length in scans */
+    int watermark;              /* Scans queued before poll() wakes us */
     int enabled;
+    /* Overflow tracking */
+    uint64_t last_timestamp;    /* Timestamp of the newest scan read */
+    uint64_t period_ns;         /* Smoothed inter-scan interval */
+    int saturated;              /* Last drain emptied a full FIFO */
+    struct iio_buffer_stats stats;
+    /* Threshold events used to wake from deep idle */
+    int event_fd;               /* From IIO_GET_EVENT_FD_IOCTL, -1 until armed once */
+    int event_attr_count;
+    char event_attrs[CMXD_IIO_MAX_EVENT_ATTRS][CMXD_SCAN_NAME_MAX]; /* e.g. "in_accel_x_thresh_rising" */
+    bool events_armed;
+    /* Scan source and its private state */
+    const struct cmxd_sample_source *source;
+    void *source_data;
 };
 
 /* Accelerometer sample with timestamp */
@@ -42,15 +103,44 @@ struct accel_sample {
     uint64_t timestamp;
 };
 
+/*
+ * Record written to /dev/cmx or the cmx module's binary "state" attribute:
+ * vectors, mode, orientation and hinge angle in one write. Must match
+ * struct cmx_state in cmx/cmx.c; mode and orientation index the kernel's
+ * string lists. Version 1 modules have no angle field (it must be zero).
+ */
+#define CMXD_STATE_VERSION  2
+#define CMXD_STATE_KEEP     0xff    /* Leave mode or orientation unchanged */
+#define CMXD_ANGLE_UNKNOWN  (-1)    /* No reliable hinge angle */
+
+struct cmxd_kernel_state {
+    uint32_t version;
+    uint32_t seq;
+    uint64_t timestamp;         /* Sample timestamp, ns */
+    int32_t base[3];            /* micro-g */
+    int32_t lid[3];
+    uint8_t mode;
+    uint8_t orientation;
+    int16_t angle;              /* 0.1 degrees, version 2 */
+    uint8_t reserved[4];
+};
+_Static_assert(sizeof(struct cmxd_kernel_state) == 48, "must match struct cmx_state");
+
 /* Module configuration */
 struct cmxd_data_config {
     char sysfs_path[PATH_MAX];
+    int buffer_length;          /* IIO buffer length in scans */
+    int buffer_watermark;       /* IIO buffer watermark in scans */
+    int trigger_type;           /* CMXD_TRIGGER_* preferred trigger */
+    unsigned int sampling_hz;   /* hrtimer trigger and sensor sampling rate */
+    const struct cmxd_sample_source *source; /* NULL reads the IIO devices */
     int verbose;
 };
 
 typedef void (*log_func_t)(const char *level, const char *fmt, ...);
 
 void cmxd_data_init(struct cmxd_data_config *config, log_func_t log_function);
+void cmxd_data_cleanup(void);
 
 FILE *cmxd_safe_fopen(const char *path, const char *mode);
 int cmxd_safe_fclose(FILE *f, const char *path);
@@ -63,17 +153,36 @@ void cmxd_apply_scale(int raw_x, int raw_y, int raw_z, double scale,
 int cmxd_write_vector(const char *name, int x, int y, int z);
 int cmxd_write_mode(const char *mode);
 int cmxd_write_orientation(const char *orientation);
-
-int cmxd_find_iio_device_for_i2c(int bus, int addr, char *device_name, size_t name_size);
+int cmxd_write_angle(double angle);
+int cmxd_commit_state(uint64_t timestamp);
+bool cmxd_state_supported(void);
+int cmxd_resume_fd(void);
+bool cmxd_resumed(void);
+int cmxd_vec_watchers_fd(void);
+int cmxd_vec_watchers(void);
 
 int cmxd_ensure_iio_trigger_exists(void);
+int cmxd_setup_iio_trigger(void);
+bool cmxd_iio_trigger_is_hrtimer(void);
+int cmxd_set_trigger_frequency(unsigned int sampling_hz);
+void cmxd_cleanup_iio_trigger(void);
 int cmxd_trigger_iio_sampling(void);
-int cmxd_setup_iio_buffer(struct iio_buffer *buf, const char *device_name);
+int cmxd_setup_iio_buffer(struct iio_buffer *buf, const char *device_name,
+                          const struct cmxd_scan_layout *known_layout);
 int cmxd_read_iio_buffer_sample(struct iio_buffer *buf, struct accel_sample *sample);
+int cmxd_read_iio_buffer_samples(struct iio_buffer *buf, struct accel_sample *samples, int max_samples);
+size_t cmxd_iio_buffer_read_size(const struct iio_buffer *buf, int max_samples);
+int cmxd_decode_iio_buffer_samples(struct iio_buffer *buf, const uint8_t *data, ssize_t bytes_read,
+                                   struct accel_sample *samples, int max_samples);
 void cmxd_cleanup_iio_buffer(struct iio_buffer *buf);
+int cmxd_suspend_iio_buffer(struct iio_buffer *buf);
+int cmxd_resume_iio_buffer(struct iio_buffer *buf);
+
+bool cmxd_iio_events_available(const struct iio_buffer *buf);
+int cmxd_arm_iio_events(struct iio_buffer *buf, const struct accel_sample *last, int margin);
+void cmxd_disarm_iio_events(struct iio_buffer *buf);
+int cmxd_read_iio_events(struct iio_buffer *buf);
 
-int cmxd_parse_accel_value(const uint8_t *data);
-int cmxd_wait_for_path(const char *path, int timeout_sec);
 int cmxd_validate_paths(const char *base_dev, const char *lid_dev);
 
 int cmxd_read_kernel_device_assignments(char *base_dev, size_t base_size, 
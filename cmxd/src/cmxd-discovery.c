@@ -0,0 +1,212 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Discovery Module - Kernel Uevent Listener
+ *
+ * Subscribes to the kernel's NETLINK_KOBJECT_UEVENT multicast group. Waits
+ * re-check their condition whenever the kernel reports a device change, so
+ * startup proceeds the moment a device is ready instead of at the next
+ * sleep interval, and the main loop can react to sensors being removed and
+ * re-added. Only messages sent by the kernel itself are accepted.
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#include "cmxd-discovery.h"
+#include "cmxd-paths.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+
+/* Kernel uevent multicast group (group 2 carries udev's re-broadcasts) */
+#define UEVENT_KERNEL_GROUP 1
+
+/* Module state */
+static int uevent_fd = -1;
+static log_func_t log_function = NULL;
+
+/* Logging macros using the configured log function */
+#define log_error(fmt, ...) do { if (log_function) log_function("ERROR", fmt, ##__VA_ARGS__); } while(0)
+#define log_warn(fmt, ...)  do { if (log_function) log_function("WARN", fmt, ##__VA_ARGS__); } while(0)
+#define log_debug(fmt, ...) do { if (log_function) log_function("DEBUG", fmt, ##__VA_ARGS__); } while(0)
+
+/*
+ * =============================================================================
+ * UEVENT SOCKET
+ * =============================================================================
+ */
+
+int cmxd_discovery_open(log_func_t log_func)
+{
+    struct sockaddr_nl addr = {
+        .nl_family = AF_NETLINK,
+        .nl_groups = UEVENT_KERNEL_GROUP,
+    };
+
+    log_function = log_func;
+
+    uevent_fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if (uevent_fd < 0) {
+        log_warn("Failed to open uevent socket: %s", strerror(errno));
+        return -1;
+    }
+
+    if (bind(uevent_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        log_warn("Failed to bind uevent socket: %s", strerror(errno));
+        close(uevent_fd);
+        uevent_fd = -1;
+        return -1;
+    }
+
+    return 0;
+}
+
+void cmxd_discovery_close(void)
+{
+    if (uevent_fd >= 0) {
+        close(uevent_fd);
+        uevent_fd = -1;
+    }
+}
+
+int cmxd_discovery_fd(void)
+{
+    return uevent_fd;
+}
+
+/*
+ * Receive one uevent. Returns 1 when an event was parsed, 0 when none is
+ * pending and -1 on socket errors.
+ */
+int cmxd_discovery_read(struct cmxd_uevent *event)
+{
+    char buf[4096];
+    struct sockaddr_nl sender;
+    struct iovec iov = { .iov_base = buf, .iov_len = sizeof(buf) - 1 };
+    struct msghdr msg = {
+        .msg_name = &sender,
+        .msg_namelen = sizeof(sender),
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+    };
+
+    if (uevent_fd < 0) {
+        return -1;
+    }
+
+    for (;;) {
+        ssize_t len = recvmsg(uevent_fd, &msg, 0);
+        if (len < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == ENOBUFS) {
+                /* Overflowed; callers re-check state on every event anyway */
+                log_warn("Uevent socket overflowed, some device events were lost");
+                continue;
+            }
+            log_error("Failed to read uevent: %s", strerror(errno));
+            return -1;
+        }
+
+        /* Only trust the kernel (port id 0) */
+        if (msg.msg_namelen != sizeof(sender) || sender.nl_pid != 0) {
+            continue;
+        }
+        buf[len] = '\0';
+
+        memset(event, 0, sizeof(*event));
+        /* Payload: "action@devpath\0KEY=value\0KEY=value\0..." */
+        for (char *p = buf + strlen(buf) + 1; p < buf + len; p += strlen(p) + 1) {
+            if (strncmp(p, "ACTION=", 7) == 0) {
+                snprintf(event->action, sizeof(event->action), "%s", p + 7);
+            } else if (strncmp(p, "SUBSYSTEM=", 10) == 0) {
+                snprintf(event->subsystem, sizeof(event->subsystem), "%s", p + 10);
+            } else if (strncmp(p, "DEVPATH=", 8) == 0) {
+                snprintf(event->devpath, sizeof(event->devpath), "%s", p + 8);
+            }
+        }
+        if (!event->action[0] || !event->devpath[0]) {
+            continue;
+        }
+
+        const char *name = strrchr(event->devpath, '/');
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-truncation"
+        snprintf(event->kernel_name, sizeof(event->kernel_name), "%s", name ? name + 1 : event->devpath);
+#pragma GCC diagnostic pop
+        log_debug("uevent: %s %s (%s)", event->action, event->kernel_name, event->subsystem);
+        return 1;
+    }
+}
+
+/*
+ * =============================================================================
+ * WAITING FOR DEVICES
+ * =============================================================================
+ */
+
+static long elapsed_ms(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+/*
+ * Wait until ready() holds, re-checking after every uevent. Returns 0 when
+ * ready and -1 on timeout (timeout_ms < 0 waits forever).
+ */
+int cmxd_discovery_wait(cmxd_discovery_ready_fn ready, void *ctx, int timeout_ms)
+{
+    struct timespec start;
+    struct cmxd_uevent event;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    while (!ready(ctx)) {
+        int remaining = -1;
+
+        if (timeout_ms >= 0) {
+            remaining = timeout_ms - (int)elapsed_ms(&start);
+            if (remaining <= 0) {
+                return -1;
+            }
+        }
+
+        if (uevent_fd < 0) {
+            /* No uevents available: fall back to a coarse re-check */
+            usleep(100000);
+            continue;
+        }
+
+        struct pollfd pfd = { .fd = uevent_fd, .events = POLLIN };
+        int ret = poll(&pfd, 1, remaining);
+        if (ret < 0 && errno != EINTR) {
+            log_error("Poll on uevent socket failed: %s", strerror(errno));
+            return -1;
+        }
+
+        /* Drain everything queued; the condition is re-checked either way */
+        while (cmxd_discovery_read(&event) > 0) {
+        }
+    }
+
+    return 0;
+}
+
+/* An IIO accelerometer is usable once its raw channel attributes exist */
+bool cmxd_iio_device_ready(const char *device_name)
+{
+    char path[PATH_MAX];
+
+    cmxd_path(path, sizeof(path), IIO_ACCEL_X_RAW_TEMPLATE, device_name);
+    return access(path, F_OK) == 0;
+}
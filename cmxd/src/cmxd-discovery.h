@@ -0,0 +1,40 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Device discovery for CMXD (Chuwi Minibook X Daemon)
+ *
+ * Listens for kernel uevents so the daemon can start as soon as the cmx
+ * platform device and the IIO accelerometers appear, and notice when a
+ * sensor goes away or comes back while running.
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#ifndef CMXD_DISCOVERY_H
+#define CMXD_DISCOVERY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "cmxd-data.h"
+
+/* One kernel uevent, reduced to the fields cmxd looks at */
+struct cmxd_uevent {
+    char action[16];                /* "add", "remove", "bind", ... */
+    char subsystem[32];             /* "iio", "platform", ... */
+    char devpath[256];              /* Path below /sys */
+    char kernel_name[DEVICE_NAME_MAX]; /* Last devpath component, e.g. "iio:device0" */
+};
+
+/* Readiness check re-run on every uevent while waiting */
+typedef bool (*cmxd_discovery_ready_fn)(void *ctx);
+
+int cmxd_discovery_open(log_func_t log_function);
+void cmxd_discovery_close(void);
+int cmxd_discovery_fd(void);
+
+int cmxd_discovery_read(struct cmxd_uevent *event);
+int cmxd_discovery_wait(cmxd_discovery_ready_fn ready, void *ctx, int timeout_ms);
+
+bool cmxd_iio_device_ready(const char *device_name);
+
+#endif /* CMXD_DISCOVERY_H */
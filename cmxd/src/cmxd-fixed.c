@@ -0,0 +1,66 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Fixed-Point Fusion Module - Integer Hinge Angle and Gravity Quantities
+ *
+ * Scales raw samples with Q16 constants and hands them to cmx-fusion.h,
+ * the kernel module's fusion, which mirrors the struct cmxd_frame
+ * functions in cmxd-calculations.c. Only the state cmxd keeps between
+ * pairs lives here; the mode filter's is in cmxd-modes.c as for doubles.
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#include "cmxd-fixed.h"
+#include <math.h>
+
+/* Fold direction of the last sample for cmxd_fixed_hinge_angle_360() */
+static bool was_folded_back = false;
+
+/* Forget the fold direction, as cmxd_calculations_reset() does */
+void cmxd_fixed_reset(void)
+{
+    was_folded_back = false;
+}
+
+/* A scale read as m/s^2 per LSB, as a Q16 mm/s^2 per LSB constant (once, at startup) */
+int32_t cmxd_fixed_scale(double scale)
+{
+    return (int32_t)llround(scale * 1000.0 * (1 << CMXD_FIXED_SCALE_SHIFT));
+}
+
+/* Round a Q16 mm/s^2 value to mm/s^2 */
+static int32_t scale_down(int64_t value_q)
+{
+    return (int32_t)((value_q + (1LL << (CMXD_FIXED_SCALE_SHIFT - 1))) >> CMXD_FIXED_SCALE_SHIFT);
+}
+
+/* Scale one base/lid pair to mm/s^2 with the Q16 scales and fuse it */
+void cmxd_fixed_pair_init(struct cmx_pair *pair, const struct accel_sample *base,
+                          const struct accel_sample *lid, int32_t base_scale_q, int32_t lid_scale_q)
+{
+    const int raw_base[3] = { base->x, base->y, base->z };
+    const int raw_lid[3] = { lid->x, lid->y, lid->z };
+
+    for (int i = 0; i < 3; i++) {
+        pair->base[i] = scale_down((int64_t)raw_base[i] * base_scale_q);
+        pair->lid[i] = scale_down((int64_t)raw_lid[i] * lid_scale_q);
+    }
+    cmx_pair_fuse(pair);
+}
+
+/* cmxd_frame_hinge_angle_360(): 0-3600, -1 without an angle; steps the fold-back hysteresis */
+int cmxd_fixed_hinge_angle_360(const struct cmx_pair *pair)
+{
+    return cmx_pair_angle_360(pair, &was_folded_back);
+}
+
+/*
+ * cmxd_frame_base_tilt_angle() < 45 degrees: |z| / |base| > cos 45, or
+ * z^2 > |base|^2 / 2. A base with no reading counts, as its -1 does.
+ */
+bool cmxd_fixed_base_below_45(const struct cmx_pair *pair)
+{
+    int64_t z = pair->base[2];
+
+    return pair->base_mag2 == 0 || (uint64_t)(2 * z * z) > pair->base_mag2;
+}
@@ -0,0 +1,33 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Fixed-point fusion for CMXD (Chuwi Minibook X Daemon)
+ *
+ * Integer counterpart of the struct cmxd_frame path: scale factors as Q16
+ * constants, vectors in mm/s^2 and angles in tenths of a degree. The
+ * arithmetic is the kernel module's own, from cmx/cmx-fusion.h, so the
+ * two integer paths can't drift apart. Nothing here touches floating
+ * point per pair; bench-fusion has it at about 0.6 of the frame path's
+ * time per pair.
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#ifndef CMXD_FIXED_H
+#define CMXD_FIXED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cmx-fusion.h"            /* struct cmx_pair, shared with the kernel module */
+#include "cmxd-data.h"             /* struct accel_sample */
+
+#define CMXD_FIXED_SCALE_SHIFT  16      /* Scale factors are Q16 mm/s^2 per LSB */
+
+void cmxd_fixed_reset(void);
+int32_t cmxd_fixed_scale(double scale);
+
+void cmxd_fixed_pair_init(struct cmx_pair *pair, const struct accel_sample *base,
+                          const struct accel_sample *lid, int32_t base_scale_q, int32_t lid_scale_q);
+int cmxd_fixed_hinge_angle_360(const struct cmx_pair *pair);
+bool cmxd_fixed_base_below_45(const struct cmx_pair *pair);
+
+#endif /* CMXD_FIXED_H */
@@ -0,0 +1,151 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Vector Mirror Module - Which Raw Vectors Reach the Kernel
+ *
+ * Writing both vectors on every sample is most of the daemon's kernel
+ * traffic, yet only base_vec, lid_vec and /dev/cmx readers ever look at
+ * them. The policies trade that visibility against writes: all of them,
+ * none, one sample in N, only vectors that moved past a dead-band, or all
+ * of them while the module's vec_watchers reports a reader. A skipped
+ * vector leaves the kernel holding the last one written.
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#include "cmxd-mirror.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Parse "all", "off", "every[:N]", "deadband[:M/S2]" or "on-demand".
+ * Returns 0, or -1 if the policy or its argument is invalid.
+ */
+int cmxd_mirror_parse(const char *spec, struct cmxd_mirror_config *config)
+{
+    const char *arg = strchr(spec, ':');
+    size_t name_len = arg ? (size_t)(arg - spec) : strlen(spec);
+    char *endptr;
+    
+    config->every = CMXD_MIRROR_DEFAULT_EVERY;
+    config->deadband = CMXD_MIRROR_DEFAULT_DEADBAND;
+    
+    if (name_len == 3 && strncmp(spec, "all", 3) == 0 && !arg) {
+        config->policy = CMXD_MIRROR_ALL;
+    } else if (name_len == 3 && strncmp(spec, "off", 3) == 0 && !arg) {
+        config->policy = CMXD_MIRROR_OFF;
+    } else if (name_len == 9 && strncmp(spec, "on-demand", 9) == 0 && !arg) {
+        config->policy = CMXD_MIRROR_ON_DEMAND;
+    } else if (name_len == 5 && strncmp(spec, "every", 5) == 0) {
+        config->policy = CMXD_MIRROR_DECIMATE;
+        if (arg) {
+            unsigned long n = strtoul(arg + 1, &endptr, 10);
+            if (endptr == arg + 1 || *endptr || n == 0 || n > 100000) {
+                return -1;
+            }
+            config->every = (unsigned int)n;
+        }
+    } else if (name_len == 8 && strncmp(spec, "deadband", 8) == 0) {
+        config->policy = CMXD_MIRROR_DEADBAND;
+        if (arg) {
+            double d = strtod(arg + 1, &endptr);
+            if (endptr == arg + 1 || *endptr || !(d > 0.0) || d > 100.0) {
+                return -1;
+            }
+            config->deadband = d;
+        }
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/* Policy in the form cmxd_mirror_parse() accepts, for logging */
+void cmxd_mirror_describe(const struct cmxd_mirror_config *config, char *buf, size_t size)
+{
+    switch (config->policy) {
+    case CMXD_MIRROR_OFF:
+        snprintf(buf, size, "off");
+        break;
+    case CMXD_MIRROR_DECIMATE:
+        snprintf(buf, size, "every:%u", config->every);
+        break;
+    case CMXD_MIRROR_DEADBAND:
+        snprintf(buf, size, "deadband:%.2f", config->deadband);
+        break;
+    case CMXD_MIRROR_ON_DEMAND:
+        snprintf(buf, size, "on-demand");
+        break;
+    default:
+        snprintf(buf, size, "all");
+        break;
+    }
+}
+
+void cmxd_mirror_init(struct cmxd_mirror *m, const struct cmxd_mirror_config *config)
+{
+    memset(m, 0, sizeof(*m));
+    m->config = *config;
+}
+
+/* Any component further than the dead-band from the last vector written */
+static bool moved(const struct cmxd_mirror *m, int sensor, const int vec[3])
+{
+    /* Vectors are scaled like cmxd_apply_scale(): m/s^2 * 1e6 */
+    long threshold = (long)(m->config.deadband * 1e6);
+    
+    for (int i = 0; i < 3; i++) {
+        if (labs((long)vec[i] - m->last[sensor][i]) > threshold) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Whether to write this sensor's newest vector to the kernel. The first
+ * vector of each sensor is always written, so the kernel never holds a
+ * placeholder.
+ */
+bool cmxd_mirror_want(struct cmxd_mirror *m, int sensor, const int vec[3])
+{
+    bool want;
+    
+    m->stats.offered++;
+    
+    switch (m->config.policy) {
+    case CMXD_MIRROR_OFF:
+        want = false;
+        break;
+    case CMXD_MIRROR_DECIMATE:
+        want = ++m->skipped[sensor] >= m->config.every;
+        break;
+    case CMXD_MIRROR_DEADBAND:
+        want = moved(m, sensor, vec);
+        break;
+    case CMXD_MIRROR_ON_DEMAND:
+        want = m->watched;
+        break;
+    default:
+        want = true;
+        break;
+    }
+    if (!m->have_last[sensor]) {
+        want = true;
+    }
+    if (!want) {
+        return false;
+    }
+    
+    memcpy(m->last[sensor], vec, sizeof(m->last[sensor]));
+    m->have_last[sensor] = true;
+    m->skipped[sensor] = 0;
+    m->stats.mirrored++;
+    return true;
+}
+
+/* ON_DEMAND: a reader appeared or the last one left */
+void cmxd_mirror_set_watched(struct cmxd_mirror *m, bool watched)
+{
+    m->watched = watched;
+}
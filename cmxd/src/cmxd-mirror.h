@@ -0,0 +1,57 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Vector mirroring policy for CMXD (Chuwi Minibook X Daemon)
+ *
+ * Decides which fused samples have their raw base and lid vectors written
+ * to the kernel module. Nothing in the driver consumes them; they are kept
+ * for base_vec, lid_vec and /dev/cmx readers, so most writes can be skipped.
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#ifndef CMXD_MIRROR_H
+#define CMXD_MIRROR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CMXD_MIRROR_ALL         0       /* Every sample */
+#define CMXD_MIRROR_OFF         1       /* Never */
+#define CMXD_MIRROR_DECIMATE    2       /* Every Nth sample */
+#define CMXD_MIRROR_DEADBAND    3       /* When a component moves past a threshold */
+#define CMXD_MIRROR_ON_DEMAND   4       /* While the module reports vec_watchers */
+
+#define CMXD_MIRROR_BASE        0
+#define CMXD_MIRROR_LID         1
+
+#define CMXD_MIRROR_DEFAULT_EVERY       10
+#define CMXD_MIRROR_DEFAULT_DEADBAND    0.2     /* m/s^2 */
+
+struct cmxd_mirror_config {
+    int policy;                     /* CMXD_MIRROR_* */
+    unsigned int every;             /* DECIMATE: mirror one sample in this many */
+    double deadband;                /* DEADBAND: m/s^2 a component must move */
+};
+
+struct cmxd_mirror_stats {
+    uint64_t offered;               /* Vectors seen, both sensors */
+    uint64_t mirrored;              /* Vectors written */
+};
+
+struct cmxd_mirror {
+    struct cmxd_mirror_config config;
+    int last[2][3];                 /* Last vector written per sensor, scaled */
+    bool have_last[2];
+    unsigned int skipped[2];        /* DECIMATE: samples since the last write */
+    bool watched;                   /* ON_DEMAND: someone reads the vectors */
+    struct cmxd_mirror_stats stats;
+};
+
+int cmxd_mirror_parse(const char *spec, struct cmxd_mirror_config *config);
+void cmxd_mirror_describe(const struct cmxd_mirror_config *config, char *buf, size_t size);
+void cmxd_mirror_init(struct cmxd_mirror *m, const struct cmxd_mirror_config *config);
+bool cmxd_mirror_want(struct cmxd_mirror *m, int sensor, const int vec[3]);
+void cmxd_mirror_set_watched(struct cmxd_mirror *m, bool watched);
+
+#endif /* CMXD_MIRROR_H */
@@ -9,6 +9,8 @@
  */
 
 #include "cmxd-modes.h"
+#include "cmxd-calculations.h"
+#include "cmxd-fixed.h"
 #include "cmxd-protocol.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -68,7 +70,8 @@ static int get_mode_index(const char* mode)
     if (!mode) return 1; /* Default to laptop */
     
     for (int i = 0; i < mode_sequence_length; i++) {
-        if (strcmp(mode, mode_sequence[i]) == 0) {
+        /* The state only ever holds these pointers; strcmp() for anything else */
+        if (mode == mode_sequence[i] || (mode_sequence[i] && strcmp(mode, mode_sequence[i]) == 0)) {
             return i;
         }
     }
@@ -149,6 +152,7 @@ const int CMXD_ORIENTATION_FREEZE_DURATION = 0;
 static const char* current_mode = CMXD_PROTOCOL_MODE_LAPTOP;
 static const char* candidate_mode = NULL;
 static int stability_count = 0;
+static bool resync_pending = false;     /* Next confident reading sets the mode */
 static bool verbose_logging = false;
 
 static void (*log_debug_func)(const char *fmt, ...) = NULL;
@@ -176,9 +180,37 @@ void cmxd_modes_init(void)
     current_mode = CMXD_PROTOCOL_MODE_LAPTOP;
     candidate_mode = NULL;
     stability_count = 0;
+    resync_pending = false;
     verbose_logging = false;
 }
 
+/*
+ * Forget the mode history after system sleep: the posture may have changed
+ * any amount, so the next confident reading is taken as is, without the
+ * adjacency rule, hysteresis or the stability count.
+ */
+void cmxd_modes_resync(void)
+{
+    candidate_mode = NULL;
+    stability_count = 0;
+    resync_pending = true;
+}
+
+/* Mode the angle alone suggests, without hysteresis */
+static const char *angle_based_mode(double angle)
+{
+    if (angle < CMXD_MODE_CLOSING_MAX) {
+        return CMXD_PROTOCOL_MODE_CLOSING;
+    } else if (angle < CMXD_MODE_LAPTOP_MAX) {
+        return CMXD_PROTOCOL_MODE_LAPTOP;
+    } else if (angle < CMXD_MODE_FLAT_MAX) {
+        return CMXD_PROTOCOL_MODE_FLAT;
+    } else if (angle < CMXD_MODE_TENT_MAX) {
+        return CMXD_PROTOCOL_MODE_TENT;
+    }
+    return CMXD_PROTOCOL_MODE_TABLET;
+}
+
 /* Simplified mode determination based on angle */
 const char* cmxd_get_device_mode(double angle, const char* current_mode_param)
 {
@@ -280,6 +312,18 @@ const char* cmxd_get_stable_device_mode_with_gravity(double angle, int orientati
 {
     (void)orientation;  /* Not used in simplified version */
     
+    if (resync_pending) {
+        const char *fresh_mode = angle_based_mode(angle);
+        if (is_gravity_confident_for_mode(base_mag, lid_mag, total_horizontal, fresh_mode)) {
+            debug_log("Resync after resume: %s -> %s (angle=%.1f°)", current_mode, fresh_mode, angle);
+            current_mode = fresh_mode;
+            candidate_mode = NULL;
+            stability_count = 0;
+            resync_pending = false;
+            return current_mode;
+        }
+    }
+    
     /* Use mode-aware gravity confidence checking - more tolerant for current mode */
     bool gravity_confident_for_current = is_gravity_confident_for_mode(base_mag, lid_mag, total_horizontal, current_mode);
     
@@ -289,26 +333,15 @@ const char* cmxd_get_stable_device_mode_with_gravity(double angle, int orientati
         /* Gravity vectors are unreliable for current mode - but check if they'd be OK for target mode */
         
         /* Determine what mode the angle suggests */
-        const char* angle_based_mode;
-        if (angle < CMXD_MODE_CLOSING_MAX) {
-            angle_based_mode = CMXD_PROTOCOL_MODE_CLOSING;
-        } else if (angle < CMXD_MODE_LAPTOP_MAX) {
-            angle_based_mode = CMXD_PROTOCOL_MODE_LAPTOP;
-        } else if (angle < CMXD_MODE_FLAT_MAX) {
-            angle_based_mode = CMXD_PROTOCOL_MODE_FLAT;
-        } else if (angle < CMXD_MODE_TENT_MAX) {
-            angle_based_mode = CMXD_PROTOCOL_MODE_TENT;
-        } else {
-            angle_based_mode = CMXD_PROTOCOL_MODE_TABLET;
-        }
+        const char* target_mode = angle_based_mode(angle);
         
         /* Check if gravity would be confident for the target mode */
-        bool gravity_confident_for_target = is_gravity_confident_for_mode(base_mag, lid_mag, total_horizontal, angle_based_mode);
+        bool gravity_confident_for_target = is_gravity_confident_for_mode(base_mag, lid_mag, total_horizontal, target_mode);
         
         if (gravity_confident_for_target) {
             /* Readings are OK for the target mode - allow normal mode detection */
             new_mode = cmxd_get_device_mode(angle, current_mode);
-            debug_log("Gravity OK for target mode %s (h_accel=%.1f) -> transitioning", angle_based_mode, total_horizontal);
+            debug_log("Gravity OK for target mode %s (h_accel=%.1f) -> transitioning", target_mode, total_horizontal);
         } else {
             /* Use lenient confidence check to see if we should enter true indeterminate state */
             /* Check if readings would be acceptable for tent mode (most lenient) */
@@ -323,7 +356,7 @@ const char* cmxd_get_stable_device_mode_with_gravity(double angle, int orientati
                 /* Moderately unreliable for both current and target mode - stick to current mode */
                 new_mode = current_mode;
                 debug_log("Gravity unstable for both %s and target %s mode (h_accel=%.1f) -> staying in %s", 
-                         current_mode, angle_based_mode, total_horizontal, current_mode);
+                         current_mode, target_mode, total_horizontal, current_mode);
             }
         }
     } else {
@@ -369,6 +402,48 @@ const char* cmxd_get_stable_device_mode_with_gravity(double angle, int orientati
     return current_mode;  /* Keep current mode until stable */
 }
 
+/* Stable device mode for a fused frame, taking the gravity confidence inputs from it */
+const char* cmxd_get_stable_device_mode_for_frame(struct cmxd_frame *frame, double angle, int orientation)
+{
+    cmxd_frame_need(frame, CMXD_FRAME_MAG | CMXD_FRAME_TOTAL_HORIZONTAL);
+    return cmxd_get_stable_device_mode_with_gravity(angle, orientation, frame->base_mag, frame->lid_mag,
+                                                    frame->total_horizontal);
+}
+
+/*
+ * Same for a fixed-point pair, through the kernel module's integer filter
+ * (cmx-fusion.h); angle in tenths of a degree. The filter runs on this
+ * module's state, so the two paths can take turns and
+ * cmxd_get_last_mode() and cmxd_modes_resync() serve both.
+ */
+const char* cmxd_get_stable_device_mode_for_fixed_pair(const struct cmx_pair *pair, int angle, int orientation)
+{
+    (void)orientation;  /* Not used, as for doubles */
+    
+    struct cmx_mode_filter filter = {
+        .mode = get_mode_index(current_mode),
+        .candidate = candidate_mode ? get_mode_index(candidate_mode) : -1,
+        .stability = stability_count,
+    };
+    int previous = filter.mode;
+    
+    if (resync_pending && cmx_mode_filter_resync(&filter, pair, angle) >= 0) {
+        debug_log("Resync after resume: %s -> %s (angle=%d.%d°)", current_mode, mode_sequence[filter.mode],
+                  angle / 10, angle % 10);
+        resync_pending = false;
+    } else {
+        cmx_mode_filter_step(&filter, pair, angle);
+    }
+    
+    if (filter.mode != previous) {
+        debug_log("Mode change confirmed: %s -> %s", current_mode, mode_sequence[filter.mode]);
+    }
+    current_mode = mode_sequence[filter.mode];
+    candidate_mode = filter.candidate < 0 ? NULL : mode_sequence[filter.candidate];
+    stability_count = filter.stability;
+    return current_mode;
+}
+
 const char* cmxd_get_last_mode(void)
 {
     return current_mode;
@@ -14,6 +14,9 @@
 #include <stdbool.h>
 #include "cmxd-protocol.h"  /* For mode constants */
 
+struct cmxd_frame;
+struct cmx_pair;
+
 #define CMXD_MODE_UNKNOWN -1
 #define CMXD_MODE_INDETERMINATE "indeterminate"
 
@@ -37,12 +40,16 @@ extern const int CMXD_MODE_STABILITY_SAMPLES;
 extern const int CMXD_ORIENTATION_FREEZE_DURATION;
 
 void cmxd_modes_init(void);
+void cmxd_modes_resync(void);
 
 const char* cmxd_get_device_mode(double angle, const char* current_mode);
 const char* cmxd_get_stable_device_mode(double angle, int orientation);
 const char* cmxd_get_stable_device_mode_with_gravity(double angle, int orientation, 
                                                     double base_mag, double lid_mag, double total_horizontal);
 
+const char* cmxd_get_stable_device_mode_for_frame(struct cmxd_frame *frame, double angle, int orientation);
+const char* cmxd_get_stable_device_mode_for_fixed_pair(const struct cmx_pair *pair, int angle, int orientation);
+
 const char* cmxd_get_last_mode(void);
 
 void cmxd_modes_set_verbose(bool verbose);
@@ -11,6 +11,7 @@
 
 #include "cmxd-orientation.h"
 #include "cmxd-calculations.h"
+#include "cmxd-fixed.h"
 #include "cmxd-protocol.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -56,6 +57,9 @@ void cmxd_orientation_init(void)
  * =============================================================================
  */
 
+static const char* apply_tablet_protection(const char* orientation_name, bool tilted_flat,
+                                           const char* current_mode);
+
 /* Determine raw device orientation based on accelerometer readings */
 int cmxd_get_device_orientation(double x, double y, double z)
 {
@@ -73,6 +77,22 @@ int cmxd_get_device_orientation(double x, double y, double z)
     }
 }
 
+/* Same for an integer vector, in any units */
+int cmxd_get_device_orientation_fixed(const int32_t v[3])
+{
+    int32_t abs_x = abs(v[0]);
+    int32_t abs_y = abs(v[1]);
+    int32_t abs_z = abs(v[2]);
+    
+    if (abs_z > abs_x && abs_z > abs_y) {
+        return (v[2] > 0) ? CMXD_DEVICE_Z_UP : CMXD_DEVICE_Z_DOWN;
+    } else if (abs_y > abs_x) {
+        return (v[1] > 0) ? CMXD_DEVICE_Y_UP : CMXD_DEVICE_Y_DOWN;
+    } else {
+        return (v[0] > 0) ? CMXD_DEVICE_X_UP : CMXD_DEVICE_X_DOWN;
+    }
+}
+
 /*
  * =============================================================================
  * PLATFORM ORIENTATION MAPPING
@@ -116,11 +136,17 @@ const char* cmxd_get_orientation_with_tablet_protection(double x, double y, doub
 {
     /* Calculate current orientation first */
     int orientation = cmxd_get_device_orientation(x, y, z);
-    const char* orientation_name = cmxd_get_platform_orientation(orientation);
     
     /* Calculate tilt angle for tablet mode protection */
     double tilt_angle = cmxd_calculate_tilt_angle(x, y, z);
     
+    return apply_tablet_protection(cmxd_get_platform_orientation(orientation), tilt_angle < 45.0, current_mode);
+}
+
+/* Tablet tilt lock shared by the per-call and frame versions; tilted_flat is a tilt under 45° */
+static const char* apply_tablet_protection(const char* orientation_name, bool tilted_flat,
+                                           const char* current_mode)
+{
     /* Option 3: Tilt-based orientation lock for tablet mode
      * When in tablet mode and starting in portrait, if tilt goes below 45° (lying flat),
      * lock orientation until it comes back above 45° to prevent unwanted landscape switches */
@@ -128,7 +154,7 @@ const char* cmxd_get_orientation_with_tablet_protection(double x, double y, doub
         last_known_orientation != NULL && 
         (strcmp(last_known_orientation, CMXD_PROTOCOL_ORIENTATION_PORTRAIT) == 0 || 
          strcmp(last_known_orientation, CMXD_PROTOCOL_ORIENTATION_PORTRAIT_FLIPPED) == 0) &&  /* Currently in portrait */
-        tilt_angle < 45.0 &&  /* Tilted flat (lying on table) */
+        tilted_flat &&  /* Tilted flat (lying on table) */
         (strcmp(orientation_name, CMXD_PROTOCOL_ORIENTATION_LANDSCAPE) == 0 || 
          strcmp(orientation_name, CMXD_PROTOCOL_ORIENTATION_LANDSCAPE_FLIPPED) == 0)) {         /* Trying to switch to landscape */
         
@@ -172,6 +198,48 @@ const char* cmxd_get_orientation_with_sensor_switching(double lid_x, double lid_
     return orientation_name;
 }
 
+/*
+ * Frame version of cmxd_get_orientation_with_sensor_switching(). The frame's
+ * vectors are scaled, which leaves the dominant axis and tilt unchanged, and
+ * the base tilt reuses the frame's magnitude.
+ */
+const char* cmxd_get_orientation_for_frame(struct cmxd_frame *frame, const char* current_mode)
+{
+    if (current_mode && (strcmp(current_mode, CMXD_PROTOCOL_MODE_LAPTOP) == 0 ||
+                         strcmp(current_mode, CMXD_PROTOCOL_MODE_CLOSING) == 0)) {
+        /* Laptop and closing: always landscape */
+        return CMXD_PROTOCOL_ORIENTATION_LANDSCAPE;
+    }
+    
+    if (current_mode && (strcmp(current_mode, CMXD_PROTOCOL_MODE_TABLET) == 0 || strcmp(current_mode, CMXD_PROTOCOL_MODE_TENT) == 0)) {
+        /* Tablet/Tent mode: Use base sensor with tablet protection */
+        const double *b = frame->base;
+        int orientation = cmxd_get_device_orientation(b[0], b[1], b[2]);
+        return apply_tablet_protection(cmxd_get_platform_orientation(orientation),
+                                       cmxd_frame_base_tilt_angle(frame) < 45.0, current_mode);
+    }
+    
+    /* Flat mode: Allow natural orientation detection using lid sensor */
+    return cmxd_get_orientation_simple(frame->lid[0], frame->lid[1], frame->lid[2]);
+}
+
+/* Same for a fixed-point pair, in integers throughout */
+const char* cmxd_get_orientation_for_fixed_pair(const struct cmx_pair *pair, const char* current_mode)
+{
+    if (current_mode && (strcmp(current_mode, CMXD_PROTOCOL_MODE_LAPTOP) == 0 ||
+                         strcmp(current_mode, CMXD_PROTOCOL_MODE_CLOSING) == 0)) {
+        return CMXD_PROTOCOL_ORIENTATION_LANDSCAPE;
+    }
+    
+    if (current_mode && (strcmp(current_mode, CMXD_PROTOCOL_MODE_TABLET) == 0 || strcmp(current_mode, CMXD_PROTOCOL_MODE_TENT) == 0)) {
+        int orientation = cmxd_get_device_orientation_fixed(pair->base);
+        return apply_tablet_protection(cmxd_get_platform_orientation(orientation),
+                                       cmxd_fixed_base_below_45(pair), current_mode);
+    }
+    
+    return cmxd_get_platform_orientation(cmxd_get_device_orientation_fixed(pair->lid));
+}
+
 /* Set verbose logging for orientation detection */
 void cmxd_orientation_set_verbose(bool verbose)
 {
@@ -15,6 +15,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+struct cmxd_frame;
+struct cmx_pair;
+
 #define CMXD_ORIENTATION_UNKNOWN -1
 
 /* Raw device orientation codes based on accelerometer dominant axis */
@@ -31,6 +34,7 @@ void cmxd_orientation_init(void);
 
 /* Core orientation detection functions */
 int cmxd_get_device_orientation(double x, double y, double z);
+int cmxd_get_device_orientation_fixed(const int32_t v[3]);
 const char* cmxd_get_platform_orientation(int orientation_code);
 
 /* Enhanced orientation detection with tablet mode awareness */
@@ -39,6 +43,10 @@ const char* cmxd_get_orientation_with_sensor_switching(double lid_x, double lid_
                                                       double base_x, double base_y, double base_z,
                                                       const char* current_mode);
 
+/* Same decision from a fused frame, reusing its derived quantities */
+const char* cmxd_get_orientation_for_frame(struct cmxd_frame *frame, const char* current_mode);
+const char* cmxd_get_orientation_for_fixed_pair(const struct cmx_pair *pair, const char* current_mode);
+
 /* Simple orientation detection */
 const char* cmxd_get_orientation_simple(double x, double y, double z);
 
@@ -0,0 +1,190 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Sensor Pairing Module - Timestamp Matching of Base and Lid Scans
+ *
+ * Each sensor's scans are queued in a small ring. The oldest scans of both
+ * rings are matched when their timestamps agree within the tolerance; an
+ * older scan without a match is paired with an interpolated or last-known
+ * reading of the other sensor, or discarded once that reading is too old.
+ * A scan whose partner has not arrived yet waits at most the staleness
+ * bound, so one stalled sensor cannot hold back processing indefinitely.
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#include "cmxd-pairing.h"
+#include <string.h>
+
+#define RING_MASK (CMXD_PAIR_RING_SIZE - 1)
+
+/*
+ * =============================================================================
+ * RING OPERATIONS
+ * =============================================================================
+ */
+
+static const struct accel_sample *ring_peek(const struct cmxd_pair_ring *r)
+{
+    return &r->samples[r->head];
+}
+
+static const struct accel_sample *ring_newest(const struct cmxd_pair_ring *r)
+{
+    return &r->samples[(r->head + r->count - 1) & RING_MASK];
+}
+
+static struct accel_sample ring_pop(struct cmxd_pair_ring *r)
+{
+    struct accel_sample s = r->samples[r->head];
+
+    r->head = (r->head + 1) & RING_MASK;
+    r->count--;
+    r->last = s;
+    r->have_last = true;
+    return s;
+}
+
+static uint64_t abs_diff(uint64_t a, uint64_t b)
+{
+    return a > b ? a - b : b - a;
+}
+
+/*
+ * =============================================================================
+ * PAIRING
+ * =============================================================================
+ */
+
+void cmxd_pairing_init(struct cmxd_pairing *p, const struct cmxd_pair_config *config)
+{
+    memset(p, 0, sizeof(*p));
+    p->config = *config;
+}
+
+/* Queue newly read scans; a full ring drops its oldest scan */
+void cmxd_pairing_push(struct cmxd_pairing *p, int sensor, const struct accel_sample *samples, int count)
+{
+    struct cmxd_pair_ring *r = &p->rings[sensor];
+
+    for (int i = 0; i < count; i++) {
+        if (r->count == CMXD_PAIR_RING_SIZE) {
+            r->head = (r->head + 1) & RING_MASK;
+            r->count--;
+            p->stats.dropped[sensor]++;
+        }
+        r->samples[(r->head + r->count) & RING_MASK] = samples[i];
+        r->count++;
+    }
+}
+
+/* Linear interpolation of a scan at time t between two scans */
+static void interpolate_sample(const struct accel_sample *a, const struct accel_sample *b,
+                               uint64_t t, struct accel_sample *out)
+{
+    int64_t span = (int64_t)(b->timestamp - a->timestamp);
+    int64_t pos = (int64_t)(t - a->timestamp);
+
+    out->x = a->x + (int)((int64_t)(b->x - a->x) * pos / span);
+    out->y = a->y + (int)((int64_t)(b->y - a->y) * pos / span);
+    out->z = a->z + (int)((int64_t)(b->z - a->z) * pos / span);
+    out->timestamp = t;
+}
+
+static void emit_pair(struct cmxd_pairing *p, const struct accel_sample *base_scan,
+                      const struct accel_sample *lid_scan,
+                      struct accel_sample *base, struct accel_sample *lid)
+{
+    uint64_t skew = abs_diff(base_scan->timestamp, lid_scan->timestamp);
+
+    *base = *base_scan;
+    *lid = *lid_scan;
+
+    p->stats.pairs++;
+    p->stats.skew_total_ns += skew;
+    if (skew > p->stats.skew_max_ns) {
+        p->stats.skew_max_ns = skew;
+    }
+}
+
+/*
+ * Find a partner for a scan that has no direct match. 'next' is the other
+ * sensor's oldest queued scan, if any, which is newer than 'scan'.
+ */
+static bool resolve_partner(struct cmxd_pairing *p, int sensor, const struct accel_sample *scan,
+                            const struct accel_sample *next,
+                            struct accel_sample *base, struct accel_sample *lid)
+{
+    const struct cmxd_pair_ring *other = &p->rings[!sensor];
+    const struct accel_sample *last = &other->last;
+    struct accel_sample partner;
+
+    if (!other->have_last) {
+        p->stats.unpaired[sensor]++;
+        return false;
+    }
+
+    if (p->config.interpolate && next && last->timestamp <= scan->timestamp &&
+        next->timestamp > scan->timestamp &&
+        next->timestamp - last->timestamp <= p->config.max_staleness_ns) {
+        interpolate_sample(last, next, scan->timestamp, &partner);
+        p->stats.interpolated++;
+    } else if (abs_diff(scan->timestamp, last->timestamp) <= p->config.max_staleness_ns) {
+        partner = *last;
+        p->stats.stale++;
+    } else {
+        p->stats.unpaired[sensor]++;
+        return false;
+    }
+
+    if (sensor == CMXD_PAIR_BASE) {
+        emit_pair(p, scan, &partner, base, lid);
+    } else {
+        emit_pair(p, &partner, scan, base, lid);
+    }
+    return true;
+}
+
+/* Produce the next base/lid pair; returns false when more scans are needed */
+bool cmxd_pairing_next(struct cmxd_pairing *p, struct accel_sample *base, struct accel_sample *lid)
+{
+    struct cmxd_pair_ring *base_ring = &p->rings[CMXD_PAIR_BASE];
+    struct cmxd_pair_ring *lid_ring = &p->rings[CMXD_PAIR_LID];
+
+    for (;;) {
+        if (base_ring->count && lid_ring->count) {
+            const struct accel_sample *b = ring_peek(base_ring);
+            const struct accel_sample *l = ring_peek(lid_ring);
+
+            if (abs_diff(b->timestamp, l->timestamp) <= p->config.tolerance_ns) {
+                struct accel_sample bs = ring_pop(base_ring);
+                struct accel_sample ls = ring_pop(lid_ring);
+                emit_pair(p, &bs, &ls, base, lid);
+                p->stats.matched++;
+                return true;
+            }
+
+            /* The older scan can no longer be matched directly */
+            int sensor = b->timestamp < l->timestamp ? CMXD_PAIR_BASE : CMXD_PAIR_LID;
+            struct accel_sample scan = ring_pop(&p->rings[sensor]);
+            if (resolve_partner(p, sensor, &scan, ring_peek(&p->rings[!sensor]), base, lid)) {
+                return true;
+            }
+        } else if (base_ring->count || lid_ring->count) {
+            int sensor = base_ring->count ? CMXD_PAIR_BASE : CMXD_PAIR_LID;
+            struct cmxd_pair_ring *r = &p->rings[sensor];
+
+            /* Give the other sensor until the staleness bound to deliver a partner */
+            if (r->count < CMXD_PAIR_RING_SIZE &&
+                ring_newest(r)->timestamp - ring_peek(r)->timestamp <= p->config.max_staleness_ns) {
+                return false;
+            }
+
+            struct accel_sample scan = ring_pop(r);
+            if (resolve_partner(p, sensor, &scan, NULL, base, lid)) {
+                return true;
+            }
+        } else {
+            return false;
+        }
+    }
+}
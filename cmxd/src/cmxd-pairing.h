@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Sensor pairing for CMXD (Chuwi Minibook X Daemon)
+ *
+ * Matches base and lid accelerometer scans by their IIO timestamps so that
+ * fusion always sees (near-)simultaneous readings. Scans without a partner
+ * inside the tolerance window are interpolated or paired with the last
+ * known reading of the other sensor, within a staleness bound.
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#ifndef CMXD_PAIRING_H
+#define CMXD_PAIRING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cmxd-data.h"
+
+/* Per-sensor ring size; a power of two holding two full buffer drains */
+#define CMXD_PAIR_RING_SIZE             (2 * CMXD_IIO_MAX_BATCH)
+
+#define CMXD_PAIR_DEFAULT_TOLERANCE_MS  5
+#define CMXD_PAIR_DEFAULT_STALENESS_MS  500
+
+#define CMXD_PAIR_BASE                  0
+#define CMXD_PAIR_LID                   1
+
+/* Pairing policy */
+struct cmxd_pair_config {
+    uint64_t tolerance_ns;      /* Max timestamp difference for a direct match */
+    uint64_t max_staleness_ns;  /* Max age of a last-known partner */
+    bool interpolate;           /* Interpolate the partner between two scans */
+};
+
+/* Pairing counters */
+struct cmxd_pair_stats {
+    uint64_t pairs;             /* Pairs handed to fusion */
+    uint64_t matched;           /* Direct matches within tolerance */
+    uint64_t interpolated;      /* Partner interpolated between two scans */
+    uint64_t stale;             /* Partner was the last known scan */
+    uint64_t unpaired[2];       /* Scans discarded without a usable partner */
+    uint64_t dropped[2];        /* Scans overwritten in a full ring */
+    uint64_t skew_total_ns;     /* Sum of |base - lid| over emitted pairs */
+    uint64_t skew_max_ns;       /* Largest |base - lid| of an emitted pair */
+};
+
+/* Timestamped scan queue for one sensor */
+struct cmxd_pair_ring {
+    struct accel_sample samples[CMXD_PAIR_RING_SIZE];
+    unsigned int head;          /* Index of the oldest queued scan */
+    unsigned int count;
+    struct accel_sample last;   /* Most recently consumed scan */
+    bool have_last;
+};
+
+struct cmxd_pairing {
+    struct cmxd_pair_config config;
+    struct cmxd_pair_ring rings[2];
+    struct cmxd_pair_stats stats;
+};
+
+void cmxd_pairing_init(struct cmxd_pairing *p, const struct cmxd_pair_config *config);
+void cmxd_pairing_push(struct cmxd_pairing *p, int sensor, const struct accel_sample *samples, int count);
+bool cmxd_pairing_next(struct cmxd_pairing *p, struct accel_sample *base, struct accel_sample *lid);
+
+#endif /* CMXD_PAIRING_H */
@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Path Resolution Module - Runtime Filesystem Root
+ *
+ * All sysfs, configfs, /dev, /proc and /run paths the daemon touches are
+ * built through cmxd_path(), which prefixes a runtime root. The root is
+ * empty in production; tests and benchmarks point it at a scratch tree
+ * populated with fake attribute files and FIFOs standing in for the IIO
+ * character devices.
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#include "cmxd-paths.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+static char root_prefix[PATH_MAX] = "";
+
+void cmxd_paths_set_root(const char *root)
+{
+    size_t len;
+
+    if (!root) {
+        root = "";
+    }
+    snprintf(root_prefix, sizeof(root_prefix), "%s", root);
+
+    /* "/" and "dir/" would double the separator of every absolute path */
+    len = strlen(root_prefix);
+    while (len > 0 && root_prefix[len - 1] == '/') {
+        root_prefix[--len] = '\0';
+    }
+}
+
+const char *cmxd_paths_root(void)
+{
+    return root_prefix;
+}
+
+int cmxd_path(char *buf, size_t size, const char *fmt, ...)
+{
+    va_list args;
+    size_t len = strlen(root_prefix);
+    int n;
+
+    if (len >= size) {
+        if (size > 0) {
+            buf[0] = '\0';
+        }
+        return -1;
+    }
+    memcpy(buf, root_prefix, len);
+
+    va_start(args, fmt);
+    n = vsnprintf(buf + len, size - len, fmt, args);
+    va_end(args);
+
+    if (n < 0 || (size_t)n >= size - len) {
+        return -1;
+    }
+    return (int)len + n;
+}
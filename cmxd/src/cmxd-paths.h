@@ -10,16 +10,38 @@
 #ifndef CMXD_PATHS_H
 #define CMXD_PATHS_H
 
+#include <stddef.h>
+
+/*
+ * Every absolute path below is resolved under a runtime root ("" by
+ * default). Pointing it at a directory tree that mimics /sys, /dev, /proc
+ * and /run lets the daemon run unmodified against a fake device tree.
+ */
+#define CMXD_ROOT_ENV                   "CMXD_ROOT"
+
+void cmxd_paths_set_root(const char *root);
+const char *cmxd_paths_root(void);
+
+/* snprintf() a path template and prefix the root; -1 if it does not fit */
+int cmxd_path(char *buf, size_t size, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
 /* Configuration file paths */
 #define CMXD_DEFAULT_CONFIG_FILE        "/etc/default/cmxd"
 
 /* Unix domain socket paths */
 #define CMXD_RUNTIME_DIR                "/run/cmxd"
 #define CMXD_SOCKET_PATH                CMXD_RUNTIME_DIR "/events.sock"
+#define CMXD_CACHE_PATH                 CMXD_RUNTIME_DIR "/discovery.cache"
+
+/* Changes on every boot; invalidates the discovery cache */
+#define PROC_BOOT_ID_PATH               "/proc/sys/kernel/random/boot_id"
 
 /* Default kernel module sysfs path */
 #define CMXD_DEFAULT_SYSFS_PATH         "/sys/devices/platform/cmx"
 
+/* Kernel module state device (struct cmxd_kernel_state records) */
+#define CMXD_DEV_PATH                   "/dev/cmx"
+
 /* IIO subsystem base paths */
 #define IIO_BASE_PATH                   "/sys/bus/iio"
 #define IIO_DEVICES_PATH                IIO_BASE_PATH "/devices"
@@ -33,7 +55,6 @@
 
 /* IIO device path templates (use with snprintf) */
 #define IIO_DEVICE_TEMPLATE             IIO_DEVICES_PATH "/iio:device%d/device"
-#define IIO_TRIGGER_TEMPLATE            IIO_DEVICES_PATH "/trigger%d"
 #define IIO_TRIGGER_NOW_TEMPLATE        IIO_DEVICES_PATH "/trigger%d/trigger_now"
 #define IIO_DEVICE_PATH_TEMPLATE        IIO_DEVICES_PATH "/%s"
 #define IIO_DEV_CHAR_TEMPLATE           IIO_DEV_BASE_PATH "/%s"
@@ -42,12 +63,11 @@
 #define IIO_ACCEL_X_RAW_TEMPLATE        IIO_DEVICES_PATH "/%s/in_accel_x_raw"
 #define IIO_ACCEL_Y_RAW_TEMPLATE        IIO_DEVICES_PATH "/%s/in_accel_y_raw"
 #define IIO_ACCEL_Z_RAW_TEMPLATE        IIO_DEVICES_PATH "/%s/in_accel_z_raw"
+#define IIO_ACCEL_SCALE_TEMPLATE        IIO_DEVICES_PATH "/%s/in_accel_scale"
 
 /* IIO scan elements path templates */
-#define IIO_SCAN_ACCEL_X_INDEX_TEMPLATE IIO_DEVICES_PATH "/%s/scan_elements/in_accel_x_index"
-#define IIO_SCAN_ACCEL_Y_INDEX_TEMPLATE IIO_DEVICES_PATH "/%s/scan_elements/in_accel_y_index"
-#define IIO_SCAN_ACCEL_Z_INDEX_TEMPLATE IIO_DEVICES_PATH "/%s/scan_elements/in_accel_z_index"
-#define IIO_SCAN_TIMESTAMP_INDEX_TEMPLATE IIO_DEVICES_PATH "/%s/scan_elements/in_timestamp_index"
+#define IIO_SCAN_ELEMENTS_TEMPLATE      IIO_DEVICES_PATH "/%s/scan_elements"
+#define IIO_SCAN_ELEMENT_TEMPLATE       IIO_DEVICES_PATH "/%s/scan_elements/%s_%s"
 
 #define IIO_SCAN_ACCEL_X_EN_TEMPLATE    IIO_DEVICES_PATH "/%s/scan_elements/in_accel_x_en"
 #define IIO_SCAN_ACCEL_Y_EN_TEMPLATE    IIO_DEVICES_PATH "/%s/scan_elements/in_accel_y_en"
@@ -57,12 +77,27 @@
 /* IIO buffer and trigger path templates */
 #define IIO_TRIGGER_CURRENT_TEMPLATE    IIO_DEVICES_PATH "/%s/trigger/current_trigger"
 #define IIO_BUFFER_ENABLE_TEMPLATE      IIO_DEVICES_PATH "/%s/buffer/enable"
+#define IIO_BUFFER_LENGTH_TEMPLATE      IIO_DEVICES_PATH "/%s/buffer/length"
+#define IIO_BUFFER_WATERMARK_TEMPLATE   IIO_DEVICES_PATH "/%s/buffer/watermark"
+
+/* IIO event attribute path templates */
+#define IIO_EVENTS_TEMPLATE             IIO_DEVICES_PATH "/%s/events"
+#define IIO_EVENT_ATTR_TEMPLATE         IIO_DEVICES_PATH "/%s/events/%s_%s"
 
 /* Specific trigger paths */
-#define IIO_TRIGGER0_PATH               IIO_DEVICES_PATH "/trigger0"
+#define IIO_TRIGGER_NAME_TEMPLATE       IIO_DEVICES_PATH "/trigger%d/name"
+#define IIO_TRIGGER_SAMPLING_FREQ_TEMPLATE IIO_DEVICES_PATH "/trigger%d/sampling_frequency"
+#define IIO_ACCEL_SAMPLING_FREQ_TEMPLATE IIO_DEVICES_PATH "/%s/in_accel_sampling_frequency"
+
+/* IIO configfs (iio-trig-hrtimer) paths */
+#define IIO_CONFIGFS_HRTIMER_PATH       "/sys/kernel/config/iio/triggers/hrtimer"
+#define IIO_CONFIGFS_HRTIMER_TEMPLATE   IIO_CONFIGFS_HRTIMER_PATH "/%s"
+#define CMXD_HRTIMER_TRIGGER_NAME       "cmxd"
+
+/* hrtimer trigger registered by the cmx module (sampling_trigger=1) */
+#define CMXD_KERNEL_TRIGGER_NAME        "cmx"
 
-/* Diagnostic command templates */
-#define IIO_DEVICES_LIST_CMD            "ls -la " IIO_DEVICES_PATH "/ 2>/dev/null | head -10"
+/* Diagnostic command suggested to the user */
 #define IIO_DEV_LIST_CMD                "ls -la " IIO_DEV_BASE_PATH "/iio:device*"
 
 /* Message strings for error reporting */
@@ -0,0 +1,229 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Adaptive Rate Module - Motion-Driven Sampling Rate Selection
+ *
+ * Every fused sample is compared with the mean of a short window of recent
+ * samples. A large deviation of either gravity vector or of the hinge angle,
+ * or a large spread within the window, counts as motion and selects the
+ * active rate at once. After the configured delay without motion the idle
+ * rate is selected. The caller may also park sampling entirely (deep idle)
+ * and wake it on a sensor event. The time spent in each state is accounted
+ * so the effect on wakeups can be measured.
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#include "cmxd-rate.h"
+#include <string.h>
+#include <math.h>
+
+/* Window slots */
+#define SLOT_BASE   0
+#define SLOT_LID    3
+#define SLOT_ANGLE  6
+
+/* Hinge angle difference wrapped to (-180, 180] */
+static double angle_delta(double a, double b)
+{
+    double d = fmod(a - b, 360.0);
+
+    if (d > 180.0) d -= 360.0;
+    if (d <= -180.0) d += 360.0;
+    return d;
+}
+
+/*
+ * =============================================================================
+ * MOTION DETECTION
+ * =============================================================================
+ */
+
+/* Deviation of a new observation from the window mean, per signal */
+static void window_deviation(const struct cmxd_rate_controller *rc, const double *obs,
+                             double *base_dev, double *lid_dev, double *angle_dev)
+{
+    double mean[7] = { 0 };
+
+    for (int i = 0; i < rc->window_count; i++) {
+        for (int k = 0; k < SLOT_ANGLE; k++) {
+            mean[k] += rc->window[i][k];
+        }
+        /* Average the angle relative to the new observation so 0/360 doesn't split it */
+        mean[SLOT_ANGLE] += angle_delta(rc->window[i][SLOT_ANGLE], obs[SLOT_ANGLE]);
+    }
+    for (int k = 0; k < 7; k++) {
+        mean[k] /= rc->window_count;
+    }
+
+    *base_dev = sqrt(pow(obs[0] - mean[0], 2) + pow(obs[1] - mean[1], 2) + pow(obs[2] - mean[2], 2));
+    *lid_dev = sqrt(pow(obs[3] - mean[3], 2) + pow(obs[4] - mean[4], 2) + pow(obs[5] - mean[5], 2));
+    *angle_dev = fabs(mean[SLOT_ANGLE]);
+}
+
+/* Standard deviation of one vector (three slots) across the window */
+static double window_spread(const struct cmxd_rate_controller *rc, int slot)
+{
+    double variance = 0.0;
+
+    for (int k = slot; k < slot + 3; k++) {
+        double sum = 0.0, sum_sq = 0.0;
+        for (int i = 0; i < rc->window_count; i++) {
+            sum += rc->window[i][k];
+            sum_sq += rc->window[i][k] * rc->window[i][k];
+        }
+        double mean = sum / rc->window_count;
+        variance += sum_sq / rc->window_count - mean * mean;
+    }
+
+    return variance > 0.0 ? sqrt(variance) : 0.0;
+}
+
+static bool detect_motion(struct cmxd_rate_controller *rc, const double *obs)
+{
+    const struct cmxd_rate_config *cfg = &rc->config;
+    double base_dev, lid_dev, angle_dev;
+    bool motion = false;
+
+    if (rc->window_count >= 2) {
+        window_deviation(rc, obs, &base_dev, &lid_dev, &angle_dev);
+        motion = base_dev > cfg->motion_threshold || lid_dev > cfg->motion_threshold ||
+                 (obs[SLOT_ANGLE] >= 0 && angle_dev > cfg->angle_threshold);
+    }
+
+    memcpy(rc->window[rc->window_pos], obs, sizeof(rc->window[0]));
+    rc->window_pos = (rc->window_pos + 1) % CMXD_RATE_WINDOW;
+    if (rc->window_count < CMXD_RATE_WINDOW) {
+        rc->window_count++;
+    }
+
+    /* Sustained vibration never deviates much from its own mean */
+    if (!motion && rc->window_count == CMXD_RATE_WINDOW) {
+        motion = window_spread(rc, SLOT_BASE) > cfg->motion_threshold / 2 ||
+                 window_spread(rc, SLOT_LID) > cfg->motion_threshold / 2;
+    }
+
+    return motion;
+}
+
+/*
+ * =============================================================================
+ * RATE STATE
+ * =============================================================================
+ */
+
+void cmxd_rate_init(struct cmxd_rate_controller *rc, const struct cmxd_rate_config *config, uint64_t now_ns)
+{
+    memset(rc, 0, sizeof(*rc));
+    rc->config = *config;
+    rc->state = CMXD_RATE_ACTIVE;
+    rc->last_motion_ns = now_ns;
+    rc->state_since_ns = now_ns;
+}
+
+/* Adaptation is off when there is no distinct idle rate */
+bool cmxd_rate_enabled(const struct cmxd_rate_controller *rc)
+{
+    return rc->config.idle_hz > 0 && rc->config.idle_hz < rc->config.active_hz;
+}
+
+/* Move accumulated time into the current state's counter */
+void cmxd_rate_account(struct cmxd_rate_controller *rc, uint64_t now_ns)
+{
+    if (now_ns > rc->state_since_ns) {
+        rc->stats.ns_at_rate[rc->state] += now_ns - rc->state_since_ns;
+    }
+    rc->state_since_ns = now_ns;
+}
+
+static void set_state(struct cmxd_rate_controller *rc, int state, uint64_t now_ns)
+{
+    cmxd_rate_account(rc, now_ns);
+    rc->state = state;
+    if (state == CMXD_RATE_IDLE) {
+        rc->stats.to_idle++;
+    } else if (state == CMXD_RATE_DEEP_IDLE) {
+        rc->stats.to_deep_idle++;
+    } else {
+        rc->stats.to_active++;
+    }
+}
+
+/*
+ * Feed one fused sample (vectors in m/s^2, hinge angle in degrees or
+ * negative if unknown). Returns true when the selected rate changed.
+ */
+bool cmxd_rate_observe(struct cmxd_rate_controller *rc, const double base_ms2[3], const double lid_ms2[3],
+                       double hinge_angle, uint64_t now_ns)
+{
+    double obs[7] = {
+        base_ms2[0], base_ms2[1], base_ms2[2],
+        lid_ms2[0], lid_ms2[1], lid_ms2[2],
+        hinge_angle
+    };
+    bool motion;
+
+    rc->stats.samples_at_rate[rc->state]++;
+
+    /* Stillness is tracked even at a fixed rate; deep idle depends on it */
+    motion = detect_motion(rc, obs);
+    if (motion) {
+        rc->last_motion_ns = now_ns;
+    }
+
+    if (!cmxd_rate_enabled(rc)) {
+        return false;
+    }
+
+    if (motion) {
+        if (rc->state == CMXD_RATE_IDLE) {
+            set_state(rc, CMXD_RATE_ACTIVE, now_ns);
+            return true;
+        }
+    } else if (rc->state == CMXD_RATE_ACTIVE &&
+               now_ns - rc->last_motion_ns >= (uint64_t)rc->config.idle_delay_ms * 1000000ULL) {
+        set_state(rc, CMXD_RATE_IDLE, now_ns);
+        return true;
+    }
+
+    return false;
+}
+
+unsigned int cmxd_rate_current_hz(const struct cmxd_rate_controller *rc)
+{
+    switch (rc->state) {
+        case CMXD_RATE_IDLE:
+            return rc->config.idle_hz;
+        case CMXD_RATE_DEEP_IDLE:
+            return 0;
+        default:
+            return rc->config.active_hz;
+    }
+}
+
+/* How long no motion has been observed */
+uint64_t cmxd_rate_still_ns(const struct cmxd_rate_controller *rc, uint64_t now_ns)
+{
+    return now_ns > rc->last_motion_ns ? now_ns - rc->last_motion_ns : 0;
+}
+
+/* Sampling has been parked; account the time until the next wake */
+void cmxd_rate_enter_deep_idle(struct cmxd_rate_controller *rc, uint64_t now_ns)
+{
+    if (rc->state != CMXD_RATE_DEEP_IDLE) {
+        set_state(rc, CMXD_RATE_DEEP_IDLE, now_ns);
+    }
+}
+
+/*
+ * A sensor event reported motion: resume at the active rate and start a
+ * fresh window, since the old samples predate the motion.
+ */
+void cmxd_rate_wake(struct cmxd_rate_controller *rc, uint64_t now_ns)
+{
+    rc->window_count = 0;
+    rc->window_pos = 0;
+    rc->last_motion_ns = now_ns;
+    if (rc->state != CMXD_RATE_ACTIVE) {
+        set_state(rc, CMXD_RATE_ACTIVE, now_ns);
+    }
+}
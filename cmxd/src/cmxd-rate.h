@@ -0,0 +1,72 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Motion-adaptive sampling rate for CMXD (Chuwi Minibook X Daemon)
+ *
+ * Watches short-window variance of both gravity vectors and the hinge angle
+ * and selects between an idle and an active sampling rate: idle once the
+ * device has been still for a while, active as soon as motion appears.
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#ifndef CMXD_RATE_H
+#define CMXD_RATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CMXD_RATE_WINDOW                8       /* Samples in the variance window */
+
+#define CMXD_RATE_DEFAULT_IDLE_HZ       1
+#define CMXD_RATE_DEFAULT_MOTION        0.4     /* m/s^2, gravity vector deviation */
+#define CMXD_RATE_DEFAULT_ANGLE         3.0     /* Degrees, hinge angle deviation */
+#define CMXD_RATE_DEFAULT_IDLE_DELAY_MS 3000
+
+#define CMXD_RATE_ACTIVE                0
+#define CMXD_RATE_IDLE                  1
+#define CMXD_RATE_DEEP_IDLE             2       /* Buffers off, waiting for threshold events */
+#define CMXD_RATE_STATES                3
+
+#define CMXD_RATE_DEFAULT_DEEP_IDLE_MS  0       /* Off unless configured */
+
+/* Rate selection policy */
+struct cmxd_rate_config {
+    unsigned int active_hz;         /* Rate while moving */
+    unsigned int idle_hz;           /* Rate while still; 0 disables adaptation */
+    double motion_threshold;        /* Max vector deviation (m/s^2) counted as still */
+    double angle_threshold;         /* Max hinge angle deviation (degrees) counted as still */
+    unsigned int idle_delay_ms;     /* Stillness required before dropping to idle */
+};
+
+/* Time and transitions per rate */
+struct cmxd_rate_stats {
+    uint64_t ns_at_rate[CMXD_RATE_STATES];      /* Indexed by CMXD_RATE_* state */
+    uint64_t samples_at_rate[CMXD_RATE_STATES];
+    uint64_t to_idle;
+    uint64_t to_active;
+    uint64_t to_deep_idle;
+};
+
+struct cmxd_rate_controller {
+    struct cmxd_rate_config config;
+    /* Ring of recent observations: base xyz, lid xyz, hinge angle */
+    double window[CMXD_RATE_WINDOW][7];
+    int window_count;
+    int window_pos;
+    int state;                      /* CMXD_RATE_ACTIVE, _IDLE or _DEEP_IDLE */
+    uint64_t last_motion_ns;
+    uint64_t state_since_ns;
+    struct cmxd_rate_stats stats;
+};
+
+void cmxd_rate_init(struct cmxd_rate_controller *rc, const struct cmxd_rate_config *config, uint64_t now_ns);
+bool cmxd_rate_enabled(const struct cmxd_rate_controller *rc);
+bool cmxd_rate_observe(struct cmxd_rate_controller *rc, const double base_ms2[3], const double lid_ms2[3],
+                       double hinge_angle, uint64_t now_ns);
+unsigned int cmxd_rate_current_hz(const struct cmxd_rate_controller *rc);
+uint64_t cmxd_rate_still_ns(const struct cmxd_rate_controller *rc, uint64_t now_ns);
+void cmxd_rate_enter_deep_idle(struct cmxd_rate_controller *rc, uint64_t now_ns);
+void cmxd_rate_wake(struct cmxd_rate_controller *rc, uint64_t now_ns);
+void cmxd_rate_account(struct cmxd_rate_controller *rc, uint64_t now_ns);
+
+#endif /* CMXD_RATE_H */
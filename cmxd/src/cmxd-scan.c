@@ -0,0 +1,296 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * IIO Scan Layout Engine
+ *
+ * Parses scan element descriptors ("be:s12/16>>4" style type strings and
+ * scan indices) into byte offsets using the kernel's alignment rules, and
+ * selects a decode routine per channel by endianness, container size and
+ * signedness. The common MXC4005 format gets a fully constant routine.
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#include "cmxd-scan.h"
+#include "cmxd-data.h"
+#include <stdio.h>
+#include <string.h>
+#include <endian.h>
+
+/*
+ * =============================================================================
+ * CHANNEL DECODE ROUTINES
+ * =============================================================================
+ */
+
+#define no_swap(v) (v)
+
+/* Generate signed and unsigned decoders for one endianness/container size */
+#define DEFINE_SCAN_DECODERS(name, type, to_host)                                   \
+static int32_t decode_##name##_s(const uint8_t *data, const struct cmxd_scan_channel *ch) \
+{                                                                                   \
+    type raw;                                                                       \
+    memcpy(&raw, data, sizeof(raw));                                                \
+    uint32_t v = (uint32_t)(to_host(raw) >> ch->shift);                             \
+    return (int32_t)(v << ch->sign_shift) >> ch->sign_shift;                        \
+}                                                                                   \
+static int32_t decode_##name##_u(const uint8_t *data, const struct cmxd_scan_channel *ch) \
+{                                                                                   \
+    type raw;                                                                       \
+    memcpy(&raw, data, sizeof(raw));                                                \
+    return (int32_t)((uint32_t)(to_host(raw) >> ch->shift) & ch->mask);             \
+}
+
+DEFINE_SCAN_DECODERS(u8, uint8_t, no_swap)
+DEFINE_SCAN_DECODERS(be16, uint16_t, be16toh)
+DEFINE_SCAN_DECODERS(le16, uint16_t, le16toh)
+DEFINE_SCAN_DECODERS(be32, uint32_t, be32toh)
+DEFINE_SCAN_DECODERS(le32, uint32_t, le32toh)
+
+/* MXC4005 native format be:s12/16>>4 with everything folded to constants */
+static int32_t decode_be_s12_16_shift4(const uint8_t *data, const struct cmxd_scan_channel *ch)
+{
+    uint16_t raw;
+
+    (void)ch;
+    memcpy(&raw, data, sizeof(raw));
+    return (int16_t)be16toh(raw) >> 4;
+}
+
+static uint64_t decode_timestamp_le(const uint8_t *data)
+{
+    uint64_t raw;
+    memcpy(&raw, data, sizeof(raw));
+    return le64toh(raw);
+}
+
+static uint64_t decode_timestamp_be(const uint8_t *data)
+{
+    uint64_t raw;
+    memcpy(&raw, data, sizeof(raw));
+    return be64toh(raw);
+}
+
+/* Pick the decode routine matching a channel's format */
+static cmxd_scan_decode_fn select_decoder(const struct cmxd_scan_channel *ch)
+{
+    if (ch->big_endian && ch->is_signed && ch->storage_bytes == 2 &&
+        ch->bits == 12 && ch->shift == 4) {
+        return decode_be_s12_16_shift4;
+    }
+
+    switch (ch->storage_bytes) {
+        case 1:
+            return ch->is_signed ? decode_u8_s : decode_u8_u;
+        case 2:
+            if (ch->big_endian)
+                return ch->is_signed ? decode_be16_s : decode_be16_u;
+            return ch->is_signed ? decode_le16_s : decode_le16_u;
+        case 4:
+            if (ch->big_endian)
+                return ch->is_signed ? decode_be32_s : decode_be32_u;
+            return ch->is_signed ? decode_le32_s : decode_le32_u;
+        default:
+            return NULL;
+    }
+}
+
+/*
+ * =============================================================================
+ * LAYOUT CONSTRUCTION
+ * =============================================================================
+ */
+
+void cmxd_scan_layout_init(struct cmxd_scan_layout *layout)
+{
+    memset(layout, 0, sizeof(*layout));
+    layout->timestamp_offset = -1;
+}
+
+/* Parse an IIO scan type string: [be|le]:[s|u]bits/storagebits[Xrepeat]>>shift */
+int cmxd_scan_parse_type(const char *type, struct cmxd_scan_channel *ch)
+{
+    char endian[3];
+    char sign;
+    unsigned int bits, storage_bits, shift = 0, repeat = 1;
+    int consumed = 0;
+
+    if (sscanf(type, "%2[bl]e:%c%u/%u%n", endian, &sign, &bits, &storage_bits, &consumed) != 4) {
+        return -1;
+    }
+
+    type += consumed;
+    if (*type == 'X') {
+        if (sscanf(type, "X%u%n", &repeat, &consumed) != 1 || repeat == 0) {
+            return -1;
+        }
+        type += consumed;
+    }
+    if (sscanf(type, ">>%u", &shift) != 1) {
+        return -1;
+    }
+
+    if ((sign != 's' && sign != 'u') || bits == 0 ||
+        (storage_bits != 8 && storage_bits != 16 && storage_bits != 32 && storage_bits != 64) ||
+        bits + shift > storage_bits) {
+        return -1;
+    }
+
+    ch->big_endian = (endian[0] == 'b');
+    ch->is_signed = (sign == 's');
+    ch->bits = (int)bits;
+    ch->shift = (int)shift;
+    ch->storage_bytes = (int)storage_bits / 8;
+    ch->repeat = (int)repeat;
+    return 0;
+}
+
+/* Format a channel back into scan_elements type syntax, e.g. "le:s12/16>>4" */
+int cmxd_scan_format_type(const struct cmxd_scan_channel *ch, char *type, size_t size)
+{
+    char repeat[16] = "";
+    int len;
+
+    if (ch->repeat > 1) {
+        snprintf(repeat, sizeof(repeat), "X%d", ch->repeat);
+    }
+    len = snprintf(type, size, "%ce:%c%d/%d%s>>%d", ch->big_endian ? 'b' : 'l', ch->is_signed ? 's' : 'u',
+                   ch->bits, ch->storage_bytes * 8, repeat, ch->shift);
+    return len < 0 || (size_t)len >= size ? -1 : 0;
+}
+
+/* Add one enabled scan element; offsets are assigned by finalize */
+int cmxd_scan_layout_add(struct cmxd_scan_layout *layout, const char *name, int index, const char *type)
+{
+    struct cmxd_scan_channel *ch;
+
+    if (layout->channel_count >= CMXD_SCAN_MAX_CHANNELS) {
+        return -1;
+    }
+
+    ch = &layout->channels[layout->channel_count];
+    memset(ch, 0, sizeof(*ch));
+    if (cmxd_scan_parse_type(type, ch) < 0) {
+        return -1;
+    }
+    snprintf(ch->name, sizeof(ch->name), "%s", name);
+    ch->index = index;
+
+    layout->channel_count++;
+    return 0;
+}
+
+/* Bind an accelerometer channel and precompute its decode constants */
+static const struct cmxd_scan_channel *bind_accel_channel(struct cmxd_scan_layout *layout, const char *name)
+{
+    for (int i = 0; i < layout->channel_count; i++) {
+        struct cmxd_scan_channel *ch = &layout->channels[i];
+
+        if (strcmp(ch->name, name) != 0) {
+            continue;
+        }
+        if (ch->bits > 32 || ch->repeat != 1) {
+            return NULL;
+        }
+
+        ch->mask = ch->bits == 32 ? 0xFFFFFFFFu : (1u << ch->bits) - 1;
+        ch->sign_shift = 32 - ch->bits;
+        ch->decode = select_decoder(ch);
+        return ch->decode ? ch : NULL;
+    }
+
+    return NULL;
+}
+
+/*
+ * Compute offsets in scan order. Like iio_compute_scan_bytes(), every element
+ * is aligned to its own size and the scan is padded to its largest element.
+ */
+int cmxd_scan_layout_finalize(struct cmxd_scan_layout *layout)
+{
+    int offset = 0, largest = 1;
+
+    /* Insertion sort by scan index - there are only a handful of channels */
+    for (int i = 1; i < layout->channel_count; i++) {
+        struct cmxd_scan_channel tmp = layout->channels[i];
+        int j = i - 1;
+        while (j >= 0 && layout->channels[j].index > tmp.index) {
+            layout->channels[j + 1] = layout->channels[j];
+            j--;
+        }
+        layout->channels[j + 1] = tmp;
+    }
+
+    for (int i = 0; i < layout->channel_count; i++) {
+        struct cmxd_scan_channel *ch = &layout->channels[i];
+        int length = ch->storage_bytes * ch->repeat;
+
+        if (offset % length) {
+            offset += length - offset % length;
+        }
+        ch->offset = offset;
+        offset += length;
+        if (length > largest) {
+            largest = length;
+        }
+    }
+    if (offset % largest) {
+        offset += largest - offset % largest;
+    }
+    layout->scan_size = offset;
+    if (offset == 0 || offset > CMXD_SCAN_MAX_BYTES) {
+        return -1;
+    }
+
+    layout->x = bind_accel_channel(layout, "in_accel_x");
+    layout->y = bind_accel_channel(layout, "in_accel_y");
+    layout->z = bind_accel_channel(layout, "in_accel_z");
+    if (!layout->x || !layout->y || !layout->z) {
+        return -1;
+    }
+
+    layout->timestamp_offset = -1;
+    layout->decode_timestamp = NULL;
+    for (int i = 0; i < layout->channel_count; i++) {
+        const struct cmxd_scan_channel *ch = &layout->channels[i];
+        if (strcmp(ch->name, "in_timestamp") == 0 && ch->storage_bytes == 8) {
+            layout->timestamp_offset = ch->offset;
+            layout->decode_timestamp = ch->big_endian ? decode_timestamp_be : decode_timestamp_le;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * =============================================================================
+ * SCAN DECODING
+ * =============================================================================
+ */
+
+/* Decode one scan */
+void cmxd_scan_decode(const struct cmxd_scan_layout *layout, const uint8_t *scan,
+                      struct accel_sample *sample)
+{
+    sample->x = layout->x->decode(scan + layout->x->offset, layout->x);
+    sample->y = layout->y->decode(scan + layout->y->offset, layout->y);
+    sample->z = layout->z->decode(scan + layout->z->offset, layout->z);
+    sample->timestamp = layout->decode_timestamp ?
+                        layout->decode_timestamp(scan + layout->timestamp_offset) : 0;
+}
+
+/* Decode consecutive scans in one pass; returns the number decoded */
+int cmxd_scan_decode_batch(const struct cmxd_scan_layout *layout, const uint8_t *data,
+                           int scan_count, struct accel_sample *samples)
+{
+    const struct cmxd_scan_channel *x = layout->x, *y = layout->y, *z = layout->z;
+
+    for (int i = 0; i < scan_count; i++, data += layout->scan_size) {
+        samples[i].x = x->decode(data + x->offset, x);
+        samples[i].y = y->decode(data + y->offset, y);
+        samples[i].z = z->decode(data + z->offset, z);
+        samples[i].timestamp = layout->decode_timestamp ?
+                               layout->decode_timestamp(data + layout->timestamp_offset) : 0;
+    }
+
+    return scan_count;
+}
@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * IIO scan layout decoding for CMXD (Chuwi Minibook X Daemon)
+ *
+ * Builds the byte layout of a buffered IIO scan from the scan_elements
+ * type and index descriptors, and binds a specialized decode routine to
+ * each accelerometer channel so scans are decoded without per-sample
+ * format checks.
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#ifndef CMXD_SCAN_H
+#define CMXD_SCAN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define CMXD_SCAN_MAX_CHANNELS  16
+#define CMXD_SCAN_NAME_MAX      48
+#define CMXD_SCAN_MAX_BYTES     64  /* Largest scan accepted, in bytes */
+
+struct cmxd_scan_channel;
+struct accel_sample;
+
+/* Decode one channel value from the start of its storage in a scan */
+typedef int32_t (*cmxd_scan_decode_fn)(const uint8_t *data, const struct cmxd_scan_channel *ch);
+
+/* Decode the scan timestamp from the start of its storage */
+typedef uint64_t (*cmxd_scan_timestamp_fn)(const uint8_t *data);
+
+/* One enabled scan element, as described by scan_elements/<name>_{type,index} */
+struct cmxd_scan_channel {
+    char name[CMXD_SCAN_NAME_MAX];  /* Element name, e.g. "in_accel_x" */
+    int index;                      /* Position in scan order */
+    int offset;                     /* Byte offset within the scan */
+    int storage_bytes;              /* Container size of one value */
+    int repeat;                     /* Number of values in the element */
+    int bits;                       /* Significant bits */
+    int shift;                      /* Right shift applied to the container */
+    bool is_signed;
+    bool big_endian;
+    /* Precomputed for the decode routines */
+    uint32_t mask;                  /* Low 'bits' set */
+    int sign_shift;                 /* 32 - bits, for sign extension */
+    cmxd_scan_decode_fn decode;
+};
+
+/* Layout of one buffered scan */
+struct cmxd_scan_layout {
+    struct cmxd_scan_channel channels[CMXD_SCAN_MAX_CHANNELS];
+    int channel_count;
+    int scan_size;                  /* Bytes per scan including padding */
+    /* Accelerometer and timestamp channels bound by cmxd_scan_layout_finalize() */
+    const struct cmxd_scan_channel *x, *y, *z;
+    int timestamp_offset;           /* -1 when no timestamp is enabled */
+    cmxd_scan_timestamp_fn decode_timestamp;
+};
+
+void cmxd_scan_layout_init(struct cmxd_scan_layout *layout);
+
+int cmxd_scan_parse_type(const char *type, struct cmxd_scan_channel *ch);
+int cmxd_scan_format_type(const struct cmxd_scan_channel *ch, char *type, size_t size);
+int cmxd_scan_layout_add(struct cmxd_scan_layout *layout, const char *name, int index, const char *type);
+int cmxd_scan_layout_finalize(struct cmxd_scan_layout *layout);
+
+void cmxd_scan_decode(const struct cmxd_scan_layout *layout, const uint8_t *scan,
+                      struct accel_sample *sample);
+int cmxd_scan_decode_batch(const struct cmxd_scan_layout *layout, const uint8_t *data,
+                           int scan_count, struct accel_sample *samples);
+
+#endif /* CMXD_SCAN_H */
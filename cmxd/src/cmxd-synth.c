@@ -0,0 +1,663 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Synthetic Source Module - Scripted Motion Generator
+ *
+ * Each scan is computed from its own timestamp: the script gives the pose
+ * (hinge angle and base attitude) at that instant, gravity plus hand tremor
+ * is rotated into the base frame, and the lid reading is the base reading
+ * rotated by the hinge angle about the hinge (Y) axis, which matches how the
+ * daemon derives the angle back. Per-sensor Gaussian noise is added before
+ * quantizing to raw counts. Because scans depend only on their timestamps,
+ * base and lid agree without sharing state, and the lid is offset by a
+ * quarter period so pairing has to interpolate as it does on hardware.
+ *
+ * Paced streams wake through a timerfd every watermark scans and release
+ * what the wall clock says has been sampled, dropping scans beyond the
+ * buffer length as a full kernel FIFO would. Unpaced streams stay readable
+ * and return a full batch per read, for measuring throughput ceilings.
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#include "cmxd-synth.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#define STANDARD_GRAVITY    9.80665
+#define DEG_TO_RAD          (M_PI / 180.0)
+#define NSEC_PER_SEC        1000000000ULL
+#define NSEC_PER_MSEC       1000000ULL
+
+/* Physiological tremor: a few incommensurate components around 8-12 Hz */
+#define TREMOR_HZ_X         8.7
+#define TREMOR_HZ_Y         10.3
+#define TREMOR_HZ_Z         11.9
+
+/* Per-sensor generator state */
+struct synth_stream {
+    bool lid;
+    uint64_t offset_ns;             /* Phase of this sensor's scans */
+    uint64_t next_index;            /* Index of the next scan to release */
+    uint64_t rng;                   /* xorshift64* state */
+    bool suspended;
+};
+
+struct synth_script {
+    const char *name;
+    const char *description;
+    const struct cmxd_synth_keyframe *frames;
+    int count;
+};
+
+/*
+ * =============================================================================
+ * BUILT-IN TRAJECTORIES
+ * =============================================================================
+ */
+
+/* { duration_ms, { hinge, roll, pitch, spin }, label } */
+static const struct cmxd_synth_keyframe script_open[] = {
+    {    0, {   0.0,    0.0,  0.0,   0.0 }, "closing" },
+    { 1000, {   0.0,    0.0,  0.0,   0.0 }, "closing" },
+    { 1200, { 110.0,    0.0,  0.0,   0.0 }, "laptop" },
+    { 3000, { 110.0,    0.0,  0.0,   0.0 }, "laptop" },
+    { 1200, {   0.0,    0.0,  0.0,   0.0 }, "closing" },
+};
+
+static const struct cmxd_synth_keyframe script_flat[] = {
+    {    0, { 110.0,    0.0,  0.0,   0.0 }, "laptop" },
+    { 2000, { 110.0,    0.0,  0.0,   0.0 }, "laptop" },
+    { 1500, { 180.0,    0.0,  0.0,   0.0 }, "flat" },
+    { 3000, { 180.0,    0.0,  0.0,   0.0 }, "flat" },
+    { 1500, { 110.0,    0.0,  0.0,   0.0 }, "laptop" },
+};
+
+static const struct cmxd_synth_keyframe script_tent[] = {
+    {    0, { 110.0,    0.0,  0.0,   0.0 }, "laptop" },
+    { 2000, { 110.0,    0.0,  0.0,   0.0 }, "laptop" },
+    { 2500, { 300.0, -150.0,  0.0,   0.0 }, "tent" },
+    { 3000, { 300.0, -150.0,  0.0,   0.0 }, "tent" },
+    { 2500, { 110.0,    0.0,  0.0,   0.0 }, "laptop" },
+};
+
+static const struct cmxd_synth_keyframe script_tablet[] = {
+    {    0, { 110.0,    0.0,  0.0,   0.0 }, "laptop" },
+    { 2000, { 110.0,    0.0,  0.0,   0.0 }, "laptop" },
+    { 2500, { 358.0, -180.0,  0.0,   0.0 }, "tablet" },
+    { 2000, { 358.0, -180.0,  0.0,   0.0 }, "tablet" },
+    { 1500, { 358.0, -180.0, 60.0,   0.0 }, "tablet" },
+    { 3000, { 358.0, -180.0, 60.0,   0.0 }, "tablet" },
+    { 2500, { 110.0,    0.0,  0.0,   0.0 }, "laptop" },
+};
+
+static const struct cmxd_synth_keyframe script_slam[] = {
+    {    0, { 110.0,    0.0,  0.0,   0.0 }, "laptop" },
+    { 2000, { 110.0,    0.0,  0.0,   0.0 }, "laptop" },
+    {  150, {   0.0,    0.0,  0.0,   0.0 }, "closing" },
+    { 2000, {   0.0,    0.0,  0.0,   0.0 }, "closing" },
+    { 1200, { 110.0,    0.0,  0.0,   0.0 }, "laptop" },
+};
+
+/* Tablet held upright and turned through all four orientations */
+static const struct cmxd_synth_keyframe script_rotate[] = {
+    {    0, { 358.0, -180.0, 70.0,   0.0 }, "tablet" },
+    { 2000, { 358.0, -180.0, 70.0,   0.0 }, "tablet" },
+    {  800, { 358.0, -180.0, 70.0,  90.0 }, "tablet" },
+    { 2000, { 358.0, -180.0, 70.0,  90.0 }, "tablet" },
+    {  800, { 358.0, -180.0, 70.0, 180.0 }, "tablet" },
+    { 2000, { 358.0, -180.0, 70.0, 180.0 }, "tablet" },
+    {  800, { 358.0, -180.0, 70.0, 270.0 }, "tablet" },
+    { 2000, { 358.0, -180.0, 70.0, 270.0 }, "tablet" },
+    {  800, { 358.0, -180.0, 70.0, 360.0 }, "tablet" },
+};
+
+/* Every mode in turn, ending where it started */
+static const struct cmxd_synth_keyframe script_tour[] = {
+    {    0, {   0.0,    0.0,  0.0,   0.0 }, "closing" },
+    { 1000, {   0.0,    0.0,  0.0,   0.0 }, "closing" },
+    { 1200, { 110.0,    0.0,  0.0,   0.0 }, "laptop" },
+    { 3000, { 110.0,    0.0,  0.0,   0.0 }, "laptop" },
+    { 1500, { 180.0,    0.0,  0.0,   0.0 }, "flat" },
+    { 3000, { 180.0,    0.0,  0.0,   0.0 }, "flat" },
+    { 2000, { 300.0, -150.0,  0.0,   0.0 }, "tent" },
+    { 3000, { 300.0, -150.0,  0.0,   0.0 }, "tent" },
+    { 2000, { 358.0, -180.0,  0.0,   0.0 }, "tablet" },
+    { 3000, { 358.0, -180.0,  0.0,   0.0 }, "tablet" },
+    { 1500, { 358.0, -180.0, 70.0,   0.0 }, "tablet" },
+    {  800, { 358.0, -180.0, 70.0,  90.0 }, "tablet" },
+    { 3000, { 358.0, -180.0, 70.0,  90.0 }, "tablet" },
+    {  800, { 358.0, -180.0, 70.0,   0.0 }, "tablet" },
+    { 2500, { 110.0,    0.0,  0.0,   0.0 }, "laptop" },
+    { 3000, { 110.0,    0.0,  0.0,   0.0 }, "laptop" },
+    {  150, {   0.0,    0.0,  0.0,   0.0 }, "closing" },
+};
+
+#define SCRIPT(name, desc) { #name, desc, script_##name, sizeof(script_##name) / sizeof(script_##name[0]) }
+
+static const struct synth_script builtin_scripts[] = {
+    SCRIPT(open,   "Open from closed to laptop and close again"),
+    SCRIPT(flat,   "Laptop to flat and back"),
+    SCRIPT(tent,   "Laptop to tent and back"),
+    SCRIPT(tablet, "Laptop to tablet on a table, then picked up"),
+    SCRIPT(slam,   "Laptop slammed shut in 150 ms"),
+    SCRIPT(rotate, "Upright tablet turned through all four orientations"),
+    SCRIPT(tour,   "Every mode and a rotation, ending with a slam (default)"),
+};
+
+#define BUILTIN_SCRIPT_COUNT (int)(sizeof(builtin_scripts) / sizeof(builtin_scripts[0]))
+
+/* Module state */
+static struct cmxd_synth_config synth_config;
+static struct cmxd_synth_keyframe frames[CMXD_SYNTH_MAX_KEYFRAMES];
+static uint64_t frame_end_ns[CMXD_SYNTH_MAX_KEYFRAMES];  /* Script time each move completes */
+static int frame_count = 0;
+static uint64_t script_ns = 0;
+static uint64_t start_ns = 0;                           /* Timestamp of scan 0 */
+static uint64_t period_ns = 0;
+static struct synth_stream direct_streams[2];            /* Used by cmxd_synth_sample() */
+static log_func_t log_function = NULL;
+
+/* Logging macros using the configured log function */
+#define log_error(fmt, ...) do { if (log_function) log_function("ERROR", fmt, ##__VA_ARGS__); } while(0)
+#define log_warn(fmt, ...)  do { if (log_function) log_function("WARN", fmt, ##__VA_ARGS__); } while(0)
+#define log_info(fmt, ...)  do { if (log_function) log_function("INFO", fmt, ##__VA_ARGS__); } while(0)
+#define log_debug(fmt, ...) do { if (log_function) log_function("DEBUG", fmt, ##__VA_ARGS__); } while(0)
+
+/*
+ * =============================================================================
+ * SCRIPT LOADING
+ * =============================================================================
+ */
+
+/*
+ * Script file: one keyframe per line, "duration_ms hinge roll pitch spin
+ * [label]", '#' starts a comment. Each line moves from the previous pose to
+ * its own; the first line's move starts from the last pose, so a script
+ * whose first duration is 0 jumps back to its start when it loops.
+ */
+static int load_script_file(const char *path)
+{
+    char line[256];
+    int line_no = 0;
+    FILE *fp = cmxd_safe_fopen(path, "r");
+
+    if (!fp) {
+        log_error("Failed to open motion script %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    frame_count = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        struct cmxd_synth_keyframe *kf = &frames[frame_count];
+        unsigned int duration;
+        int fields;
+
+        line_no++;
+        line[strcspn(line, "#\n")] = '\0';
+        if (line[strspn(line, " \t")] == '\0') {
+            continue;
+        }
+        if (frame_count >= CMXD_SYNTH_MAX_KEYFRAMES) {
+            log_error("%s: more than %d keyframes", path, CMXD_SYNTH_MAX_KEYFRAMES);
+            cmxd_safe_fclose(fp, path);
+            return -1;
+        }
+
+        memset(kf, 0, sizeof(*kf));
+        fields = sscanf(line, "%u %lf %lf %lf %lf %15s", &duration, &kf->pose.hinge, &kf->pose.roll,
+                        &kf->pose.pitch, &kf->pose.spin, kf->label);
+        if (fields < 5 || kf->pose.hinge < 0.0 || kf->pose.hinge > 360.0) {
+            log_error("%s:%d: expected \"duration_ms hinge(0-360) roll pitch spin [label]\"", path, line_no);
+            cmxd_safe_fclose(fp, path);
+            return -1;
+        }
+        kf->duration_ms = duration;
+        frame_count++;
+    }
+    cmxd_safe_fclose(fp, path);
+
+    if (frame_count == 0) {
+        log_error("Motion script %s has no keyframes", path);
+        return -1;
+    }
+    return 0;
+}
+
+static int load_script(const char *name)
+{
+    for (int i = 0; i < BUILTIN_SCRIPT_COUNT; i++) {
+        if (strcmp(name, builtin_scripts[i].name) == 0) {
+            memcpy(frames, builtin_scripts[i].frames, builtin_scripts[i].count * sizeof(frames[0]));
+            frame_count = builtin_scripts[i].count;
+            return 0;
+        }
+    }
+    return load_script_file(name);
+}
+
+void cmxd_synth_list_scripts(FILE *out)
+{
+    for (int i = 0; i < BUILTIN_SCRIPT_COUNT; i++) {
+        fprintf(out, "  %-8s %s\n", builtin_scripts[i].name, builtin_scripts[i].description);
+    }
+}
+
+/* Independent, reproducible noise per sensor */
+static uint64_t stream_seed(bool lid)
+{
+    return ((uint64_t)synth_config.seed << 1 | 1) * (lid ? 0x9E3779B97F4A7C15ULL : 0xBF58476D1CE4E5B9ULL);
+}
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+int cmxd_synth_init(const struct cmxd_synth_config *config, log_func_t log_func)
+{
+    log_function = log_func;
+    synth_config = *config;
+
+    if (synth_config.rate_hz == 0 || synth_config.rate_hz > CMXD_SYNTH_MAX_HZ) {
+        log_error("Synthetic rate must be 1-%d Hz", CMXD_SYNTH_MAX_HZ);
+        return -1;
+    }
+    if (synth_config.buffer_length <= 0) {
+        synth_config.buffer_length = CMXD_IIO_DEFAULT_BUFFER_LENGTH;
+    }
+    if (synth_config.watermark <= 0 || synth_config.watermark > synth_config.buffer_length) {
+        synth_config.watermark = CMXD_IIO_DEFAULT_WATERMARK;
+    }
+    if (load_script(synth_config.script[0] ? synth_config.script : "tour") < 0) {
+        return -1;
+    }
+
+    script_ns = 0;
+    for (int i = 0; i < frame_count; i++) {
+        script_ns += (uint64_t)frames[i].duration_ms * NSEC_PER_MSEC;
+        frame_end_ns[i] = script_ns;
+    }
+    if (script_ns == 0) {
+        /* A single static pose */
+        script_ns = NSEC_PER_SEC;
+        frame_end_ns[frame_count - 1] = script_ns;
+    }
+
+    period_ns = NSEC_PER_SEC / synth_config.rate_hz;
+    start_ns = monotonic_ns();
+
+    for (int i = 0; i < 2; i++) {
+        memset(&direct_streams[i], 0, sizeof(direct_streams[i]));
+        direct_streams[i].lid = i == 1;
+        direct_streams[i].rng = stream_seed(i == 1);
+    }
+
+    log_info("Synthetic source: script=%s (%d keyframes, %.1f s) rate=%uHz %s noise=%.3f shake=%.3f",
+             synth_config.script[0] ? synth_config.script : "tour", frame_count, script_ns / 1e9,
+             synth_config.rate_hz, synth_config.paced ? "paced" : "unpaced",
+             synth_config.noise, synth_config.shake);
+    return 0;
+}
+
+/*
+ * =============================================================================
+ * MOTION MODEL
+ * =============================================================================
+ */
+
+/* Ease in and out so moves start and stop without a step in velocity */
+static double smoothstep(double s)
+{
+    return s * s * (3.0 - 2.0 * s);
+}
+
+static double lerp(double a, double b, double s)
+{
+    return a + (b - a) * s;
+}
+
+void cmxd_synth_truth_at(uint64_t timestamp, struct cmxd_synth_truth *truth)
+{
+    uint64_t elapsed = timestamp > start_ns ? timestamp - start_ns : 0;
+    uint64_t t = elapsed % script_ns;
+    uint64_t move_start = 0;
+    int i = 0;
+
+    while (i < frame_count - 1 && t >= frame_end_ns[i]) {
+        move_start = frame_end_ns[i];
+        i++;
+    }
+
+    const struct cmxd_synth_keyframe *to = &frames[i];
+    const struct cmxd_synth_keyframe *from = &frames[i > 0 ? i - 1 : frame_count - 1];
+    double s = to->duration_ms ? smoothstep((double)(t - move_start) / ((double)to->duration_ms * NSEC_PER_MSEC)) : 1.0;
+
+    if (s > 1.0) {
+        s = 1.0;
+    }
+    truth->pose.hinge = lerp(from->pose.hinge, to->pose.hinge, s);
+    truth->pose.roll = lerp(from->pose.roll, to->pose.roll, s);
+    truth->pose.pitch = lerp(from->pose.pitch, to->pose.pitch, s);
+    truth->pose.spin = lerp(from->pose.spin, to->pose.spin, s);
+    truth->label = to->label[0] ? to->label : "-";
+    truth->segment_start = start_ns + (elapsed - t) + move_start;
+    truth->segment_ms = to->duration_ms;
+}
+
+uint64_t cmxd_synth_script_ns(void)
+{
+    return script_ns;
+}
+
+/* Monotonic timestamp of scan 0, where script time starts */
+uint64_t cmxd_synth_start_ns(void)
+{
+    return start_ns;
+}
+
+/* xorshift64* uniform in (0, 1] */
+static double rng_uniform(uint64_t *state)
+{
+    uint64_t x = *state;
+
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return ((x * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0) + (1.0 / 9007199254740992.0);
+}
+
+/* Standard normal deviate (Box-Muller) */
+static double rng_gaussian(uint64_t *state)
+{
+    double u1 = rng_uniform(state);
+    double u2 = rng_uniform(state);
+
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static void rotate_x(double v[3], double deg)
+{
+    double c = cos(deg * DEG_TO_RAD), s = sin(deg * DEG_TO_RAD);
+    double y = c * v[1] - s * v[2];
+    double z = s * v[1] + c * v[2];
+
+    v[1] = y;
+    v[2] = z;
+}
+
+static void rotate_y(double v[3], double deg)
+{
+    double c = cos(deg * DEG_TO_RAD), s = sin(deg * DEG_TO_RAD);
+    double x = c * v[0] + s * v[2];
+    double z = -s * v[0] + c * v[2];
+
+    v[0] = x;
+    v[2] = z;
+}
+
+static void rotate_z(double v[3], double deg)
+{
+    double c = cos(deg * DEG_TO_RAD), s = sin(deg * DEG_TO_RAD);
+    double x = c * v[0] - s * v[1];
+    double y = s * v[0] + c * v[1];
+
+    v[0] = x;
+    v[1] = y;
+}
+
+static int to_counts(double ms2)
+{
+    double counts = round(ms2 / CMXD_SYNTH_SCALE);
+
+    if (counts > 32767.0) {
+        return 32767;
+    }
+    if (counts < -32768.0) {
+        return -32768;
+    }
+    return (int)counts;
+}
+
+/* Generate the scan one sensor took at the given timestamp */
+static void generate_scan(struct synth_stream *st, uint64_t timestamp, struct accel_sample *sample)
+{
+    struct cmxd_synth_truth truth;
+    double v[3] = { 0.0, 0.0, STANDARD_GRAVITY };
+
+    cmxd_synth_truth_at(timestamp, &truth);
+
+    /* Tremor moves the whole device, so it is added before the rotation */
+    if (synth_config.shake > 0.0) {
+        double t = (double)(timestamp - start_ns) / NSEC_PER_SEC;
+        v[0] += synth_config.shake * sin(2.0 * M_PI * TREMOR_HZ_X * t);
+        v[1] += synth_config.shake * sin(2.0 * M_PI * TREMOR_HZ_Y * t + 1.1);
+        v[2] += 0.5 * synth_config.shake * sin(2.0 * M_PI * TREMOR_HZ_Z * t + 2.3);
+    }
+
+    rotate_y(v, truth.pose.roll);
+    rotate_x(v, truth.pose.pitch);
+    rotate_z(v, truth.pose.spin);
+    if (st->lid) {
+        rotate_y(v, truth.pose.hinge);
+    }
+
+    if (synth_config.noise > 0.0) {
+        for (int i = 0; i < 3; i++) {
+            v[i] += synth_config.noise * rng_gaussian(&st->rng);
+        }
+    }
+
+    sample->x = to_counts(v[0]);
+    sample->y = to_counts(v[1]);
+    sample->z = to_counts(v[2]);
+    sample->timestamp = timestamp;
+}
+
+/*
+ * =============================================================================
+ * SAMPLE SOURCE
+ * =============================================================================
+ */
+
+/* Index of the newest scan the wall clock says this sensor has taken */
+static uint64_t clock_index(const struct synth_stream *st)
+{
+    uint64_t now = monotonic_ns();
+
+    if (now < start_ns + st->offset_ns) {
+        return 0;
+    }
+    return (now - start_ns - st->offset_ns) / period_ns;
+}
+
+static int arm_timer(struct iio_buffer *buf, bool arm)
+{
+    struct itimerspec its;
+    uint64_t interval = arm ? period_ns * (uint64_t)synth_config.watermark : 0;
+
+    memset(&its, 0, sizeof(its));
+    its.it_interval.tv_sec = interval / NSEC_PER_SEC;
+    its.it_interval.tv_nsec = interval % NSEC_PER_SEC;
+    its.it_value = its.it_interval;
+    return timerfd_settime(buf->buffer_fd, 0, &its, NULL);
+}
+
+/*
+ * Scan of one sensor at any monotonic timestamp, for consumers that pace
+ * themselves instead of reading through the sample source.
+ */
+void cmxd_synth_sample(bool lid, uint64_t timestamp, struct accel_sample *sample)
+{
+    generate_scan(&direct_streams[lid ? 1 : 0], timestamp, sample);
+}
+
+static int synth_setup(struct iio_buffer *buf, const char *device_name,
+                       const struct cmxd_scan_layout *known_layout)
+{
+    struct synth_stream *st;
+    size_t len = strlen(device_name);
+
+    (void)known_layout;
+
+    if (frame_count == 0) {
+        log_error("Synthetic source used before cmxd_synth_init()");
+        return -1;
+    }
+
+    st = calloc(1, sizeof(*st));
+    if (!st) {
+        return -1;
+    }
+    st->lid = len >= 3 && strcmp(device_name + len - 3, "lid") == 0;
+    st->offset_ns = st->lid ? period_ns / 4 : 0;
+    st->rng = stream_seed(st->lid);
+    buf->source_data = st;
+
+    snprintf(buf->trigger_name, sizeof(buf->trigger_name), "synth");
+    buf->buffer_length = synth_config.buffer_length;
+    buf->watermark = synth_config.paced ? synth_config.watermark : CMXD_IIO_MAX_BATCH;
+
+    if (synth_config.paced) {
+        buf->buffer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (buf->buffer_fd < 0 || arm_timer(buf, true) < 0) {
+            log_error("Failed to create synthetic timer: %s", strerror(errno));
+            goto fail;
+        }
+        st->next_index = clock_index(st);
+    } else {
+        /* Never drained, so it always polls readable */
+        buf->buffer_fd = eventfd(1, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (buf->buffer_fd < 0) {
+            log_error("Failed to create synthetic eventfd: %s", strerror(errno));
+            goto fail;
+        }
+    }
+
+    log_debug("Synthetic %s sensor ready on %s", st->lid ? "lid" : "base", device_name);
+    return 0;
+
+fail:
+    if (buf->buffer_fd >= 0) {
+        close(buf->buffer_fd);
+        buf->buffer_fd = -1;
+    }
+    free(st);
+    buf->source_data = NULL;
+    return -1;
+}
+
+static int synth_read(struct iio_buffer *buf, struct accel_sample *samples, int max_samples)
+{
+    struct synth_stream *st = buf->source_data;
+    uint64_t available;
+    int count;
+
+    if (st->suspended) {
+        return 0;
+    }
+
+    if (synth_config.paced) {
+        uint64_t expirations;
+        uint64_t newest;
+
+        /* Acknowledge the wakeup; the clock decides how much was sampled */
+        if (read(buf->buffer_fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+            log_error("Failed to read synthetic timer: %s", strerror(errno));
+            return -1;
+        }
+        newest = clock_index(st);
+        available = newest >= st->next_index ? newest - st->next_index + 1 : 0;
+        if (available > (uint64_t)buf->buffer_length) {
+            /* Like a full FIFO: the oldest scans are gone */
+            buf->stats.overruns++;
+            buf->stats.samples_lost += available - buf->buffer_length;
+            st->next_index += available - buf->buffer_length;
+            available = buf->buffer_length;
+        }
+    } else {
+        available = CMXD_IIO_MAX_BATCH;
+    }
+
+    count = available < (uint64_t)max_samples ? (int)available : max_samples;
+    for (int i = 0; i < count; i++) {
+        generate_scan(st, start_ns + st->offset_ns + (st->next_index + i) * period_ns, &samples[i]);
+    }
+    st->next_index += count;
+
+    if (count > 0) {
+        buf->last_timestamp = samples[count - 1].timestamp;
+        buf->period_ns = period_ns;
+        buf->stats.wakeups++;
+        buf->stats.samples += count;
+    }
+    return count;
+}
+
+static int synth_suspend(struct iio_buffer *buf)
+{
+    struct synth_stream *st = buf->source_data;
+    uint64_t value;
+
+    st->suspended = true;
+    if (synth_config.paced) {
+        return arm_timer(buf, false);
+    }
+    /* Drain the eventfd so the unpaced stream stops polling readable */
+    return read(buf->buffer_fd, &value, sizeof(value)) < 0 && errno != EAGAIN ? -1 : 0;
+}
+
+static int synth_resume(struct iio_buffer *buf)
+{
+    struct synth_stream *st = buf->source_data;
+    uint64_t value = 1;
+
+    st->suspended = false;
+    if (synth_config.paced) {
+        /* Scans were not taken while suspended */
+        st->next_index = clock_index(st);
+        return arm_timer(buf, true);
+    }
+    return write(buf->buffer_fd, &value, sizeof(value)) < 0 ? -1 : 0;
+}
+
+static void synth_cleanup(struct iio_buffer *buf)
+{
+    if (buf->buffer_fd >= 0) {
+        close(buf->buffer_fd);
+        buf->buffer_fd = -1;
+    }
+    free(buf->source_data);
+    buf->source_data = NULL;
+}
+
+static double synth_read_scale(const char *device_name)
+{
+    (void)device_name;
+    return CMXD_SYNTH_SCALE;
+}
+
+static const struct cmxd_sample_source synth_source = {
+    .name = "synth",
+    .setup = synth_setup,
+    .read = synth_read,
+    .suspend = synth_suspend,
+    .resume = synth_resume,
+    .cleanup = synth_cleanup,
+    .read_scale = synth_read_scale,
+};
+
+const struct cmxd_sample_source *cmxd_synth_source(void)
+{
+    return &synth_source;
+}
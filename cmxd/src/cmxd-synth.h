@@ -0,0 +1,82 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Synthetic motion source for CMXD (Chuwi Minibook X Daemon)
+ *
+ * A sample source that generates base and lid accelerometer scans from a
+ * scripted trajectory instead of reading IIO devices: hinge angle and whole
+ * device attitude move between keyframes, with optional sensor noise and
+ * hand tremor on top. Scans are produced at any rate, either paced by the
+ * wall clock or as fast as they are read, so the pairing, fusion, mode and
+ * event stages can be exercised and load-tested without the hardware.
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#ifndef CMXD_SYNTH_H
+#define CMXD_SYNTH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cmxd-data.h"
+
+#define CMXD_SYNTH_MAX_KEYFRAMES    64
+#define CMXD_SYNTH_LABEL_MAX        16
+#define CMXD_SYNTH_MAX_HZ           100000
+
+/* LSB size of the synthetic sensors in m/s^2 (1/1024 g) */
+#define CMXD_SYNTH_SCALE            0.009576
+
+/* Device names the source accepts; the lid is the one named "...lid" */
+#define CMXD_SYNTH_BASE_DEVICE      "synth:base"
+#define CMXD_SYNTH_LID_DEVICE       "synth:lid"
+
+/*
+ * Device pose. The hinge angle uses the daemon's 0-360 convention (0 closed,
+ * 180 flat, 360 folded into a tablet). Attitude is applied to the base:
+ * roll about the hinge axis, then pitch about the base X axis, then spin
+ * about the base normal (portrait/landscape while held upright).
+ */
+struct cmxd_synth_pose {
+    double hinge;
+    double roll;
+    double pitch;
+    double spin;
+};
+
+/* Move to pose over duration_ms (eased); label names the expected mode */
+struct cmxd_synth_keyframe {
+    uint32_t duration_ms;
+    struct cmxd_synth_pose pose;
+    char label[CMXD_SYNTH_LABEL_MAX];
+};
+
+struct cmxd_synth_config {
+    char script[PATH_MAX];          /* Built-in trajectory name or script file */
+    unsigned int rate_hz;           /* Scans per second per sensor */
+    bool paced;                     /* Follow the wall clock; otherwise as fast as read */
+    int buffer_length;              /* Paced backlog kept before scans are dropped */
+    int watermark;                  /* Paced scans per wakeup */
+    double noise;                   /* Sensor noise, m/s^2 RMS */
+    double shake;                   /* Hand tremor amplitude, m/s^2 */
+    uint32_t seed;
+};
+
+/* Where the script was at a given scan timestamp */
+struct cmxd_synth_truth {
+    struct cmxd_synth_pose pose;
+    const char *label;              /* Label of the keyframe being approached */
+    uint64_t segment_start;         /* Timestamp the current move began */
+    uint32_t segment_ms;            /* Duration of the current move */
+};
+
+int cmxd_synth_init(const struct cmxd_synth_config *config, log_func_t log_function);
+const struct cmxd_sample_source *cmxd_synth_source(void);
+void cmxd_synth_sample(bool lid, uint64_t timestamp, struct accel_sample *sample);
+
+void cmxd_synth_truth_at(uint64_t timestamp, struct cmxd_synth_truth *truth);
+uint64_t cmxd_synth_script_ns(void);
+uint64_t cmxd_synth_start_ns(void);
+void cmxd_synth_list_scripts(FILE *out);
+
+#endif /* CMXD_SYNTH_H */
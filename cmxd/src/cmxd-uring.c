@@ -0,0 +1,539 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * io_uring Module - Batched Acquisition and Output
+ *
+ * Talks to the kernel ABI directly (no liburing). Each watched fd owns a
+ * slot: IIO buffer fds keep a read armed, other fds keep a poll armed. The
+ * buffer fds are switched to blocking mode so the ring parks the read until
+ * scans arrive instead of failing with EAGAIN. Writes to sysfs attributes
+ * are staged in a small pool and go out with the next wait, so a whole
+ * cycle costs a single io_uring_enter(). io-wq serializes writes to the
+ * same regular file, so attribute updates stay in order. Socket clients
+ * are sent to synchronously: the socket thread may close a client
+ * and accept() hand its fd number to another before a queued send runs.
+ *
+ * Needs IORING_FEAT_FAST_POLL and IORING_FEAT_EXT_ARG (Linux 5.11); on
+ * older kernels init fails and the caller keeps using poll().
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#include "cmxd-uring.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+/* user_data layout: operation type in the high word, index in the low word */
+#define URING_OP_SLOT       1ULL
+#define URING_OP_WRITE      2ULL
+#define URING_OP_CANCEL     3ULL
+#define URING_USER_DATA(op, index)  (((op) << 32) | (uint64_t)(index))
+
+struct uring_slot {
+    int fd;                         /* fd the armed request targets */
+    bool inflight;
+    bool cancelling;
+    bool is_read;
+    ssize_t len;                    /* Last read result */
+    uint8_t *data;                  /* Read target, CMXD_URING_READ_SIZE bytes */
+};
+
+struct uring_write {
+    bool in_use;
+    int fd;
+    cmxd_uring_done_fn done;
+    void *ctx;
+    uint8_t data[CMXD_URING_WRITE_MAX];
+};
+
+struct uring {
+    int fd;
+    /* Submission queue */
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned sq_entries;
+    struct io_uring_sqe *sqes;
+    unsigned to_submit;
+    /* Completion queue */
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    /* Mappings */
+    void *ring_ptr;
+    size_t ring_len;
+    size_t sqes_len;
+};
+
+/* Module state */
+static struct uring ring = { .fd = -1 };
+static struct uring_slot slots[CMXD_URING_MAX_SLOTS];
+static struct uring_write writes[CMXD_URING_MAX_WRITES];
+static int writes_pending = 0;
+static struct cmxd_uring_stats stats;
+static log_func_t log_function = NULL;
+
+/* Logging macros using the configured log function */
+#define log_error(fmt, ...) do { if (log_function) log_function("ERROR", fmt, ##__VA_ARGS__); } while(0)
+#define log_warn(fmt, ...)  do { if (log_function) log_function("WARN", fmt, ##__VA_ARGS__); } while(0)
+#define log_info(fmt, ...)  do { if (log_function) log_function("INFO", fmt, ##__VA_ARGS__); } while(0)
+#define log_debug(fmt, ...) do { if (log_function) log_function("DEBUG", fmt, ##__VA_ARGS__); } while(0)
+
+/*
+ * =============================================================================
+ * RING SETUP
+ * =============================================================================
+ */
+
+static int uring_enter(unsigned to_submit, unsigned min_complete, unsigned flags, void *arg, size_t argsz)
+{
+    stats.enters++;
+    return (int)syscall(__NR_io_uring_enter, ring.fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+static void ring_unmap(void)
+{
+    if (ring.sqes && ring.sqes != MAP_FAILED) {
+        munmap(ring.sqes, ring.sqes_len);
+    }
+    if (ring.ring_ptr && ring.ring_ptr != MAP_FAILED) {
+        munmap(ring.ring_ptr, ring.ring_len);
+    }
+    if (ring.fd >= 0) {
+        close(ring.fd);
+    }
+    memset(&ring, 0, sizeof(ring));
+    ring.fd = -1;
+}
+
+int cmxd_uring_init(log_func_t log_func)
+{
+    struct io_uring_params params;
+    const unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_FAST_POLL | IORING_FEAT_EXT_ARG;
+
+    log_function = log_func;
+    memset(&params, 0, sizeof(params));
+    memset(&stats, 0, sizeof(stats));
+
+    ring.fd = (int)syscall(__NR_io_uring_setup, CMXD_URING_ENTRIES, &params);
+    if (ring.fd < 0) {
+        log_warn("io_uring unavailable (%s), using poll()", strerror(errno));
+        ring.fd = -1;
+        return -1;
+    }
+    if ((params.features & required) != required) {
+        log_warn("io_uring lacks fast poll or wait timeouts (kernel < 5.11), using poll()");
+        ring_unmap();
+        return -1;
+    }
+
+    /* SQ and CQ rings share one mapping with IORING_FEAT_SINGLE_MMAP */
+    size_t sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring.ring_len = sq_len > cq_len ? sq_len : cq_len;
+    ring.ring_ptr = mmap(NULL, ring.ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring.fd, IORING_OFF_SQ_RING);
+    ring.sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring.sqes = mmap(NULL, ring.sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ring.fd, IORING_OFF_SQES);
+    if (ring.ring_ptr == MAP_FAILED || ring.sqes == MAP_FAILED) {
+        log_warn("Failed to map io_uring: %s", strerror(errno));
+        ring_unmap();
+        return -1;
+    }
+
+    uint8_t *base = ring.ring_ptr;
+    ring.sq_head = (unsigned *)(base + params.sq_off.head);
+    ring.sq_tail = (unsigned *)(base + params.sq_off.tail);
+    ring.sq_mask = (unsigned *)(base + params.sq_off.ring_mask);
+    ring.sq_array = (unsigned *)(base + params.sq_off.array);
+    ring.sq_entries = params.sq_entries;
+    ring.cq_head = (unsigned *)(base + params.cq_off.head);
+    ring.cq_tail = (unsigned *)(base + params.cq_off.tail);
+    ring.cq_mask = (unsigned *)(base + params.cq_off.ring_mask);
+    ring.cqes = (struct io_uring_cqe *)(base + params.cq_off.cqes);
+
+    for (int i = 0; i < CMXD_URING_MAX_SLOTS; i++) {
+        slots[i].fd = -1;
+        slots[i].data = NULL;
+    }
+    memset(writes, 0, sizeof(writes));
+    writes_pending = 0;
+
+    log_info("Using io_uring event loop (%u entries)", params.sq_entries);
+    return 0;
+}
+
+bool cmxd_uring_active(void)
+{
+    return ring.fd >= 0;
+}
+
+const struct cmxd_uring_stats *cmxd_uring_get_stats(void)
+{
+    return &stats;
+}
+
+/*
+ * =============================================================================
+ * SUBMISSION AND COMPLETION
+ * =============================================================================
+ */
+
+/* Next free SQE, flushing the queue to the kernel if it is full */
+static struct io_uring_sqe *get_sqe(void)
+{
+    unsigned head = __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE);
+    unsigned tail = *ring.sq_tail;
+
+    if (tail - head >= ring.sq_entries) {
+        int ret = uring_enter(ring.to_submit, 0, 0, NULL, 0);
+        if (ret < 0) {
+            return NULL;
+        }
+        stats.submitted += (unsigned)ret;
+        ring.to_submit -= (unsigned)ret;
+        head = __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE);
+        if (tail - head >= ring.sq_entries) {
+            return NULL;
+        }
+    }
+
+    unsigned index = tail & *ring.sq_mask;
+    struct io_uring_sqe *sqe = &ring.sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring.sq_array[index] = index;
+    return sqe;
+}
+
+/* Publish the SQE returned by the last get_sqe() */
+static void commit_sqe(void)
+{
+    __atomic_store_n(ring.sq_tail, *ring.sq_tail + 1, __ATOMIC_RELEASE);
+    ring.to_submit++;
+}
+
+static void complete_write(unsigned index, int res)
+{
+    struct uring_write *w;
+
+    if (index >= CMXD_URING_MAX_WRITES || !writes[index].in_use) {
+        return;
+    }
+    w = &writes[index];
+    stats.writes++;
+    if (w->done) {
+        w->done(w->ctx, w->fd, res);
+    }
+    w->in_use = false;
+    writes_pending--;
+}
+
+static void complete_slot(unsigned index, int res, struct pollfd *fds, int nfds)
+{
+    struct uring_slot *s;
+
+    if (index >= CMXD_URING_MAX_SLOTS) {
+        return;
+    }
+    s = &slots[index];
+    s->inflight = false;
+
+    if (s->cancelling || res == -ECANCELED) {
+        s->cancelling = false;
+        return;
+    }
+    if ((int)index >= nfds || fds[index].fd != s->fd) {
+        return;
+    }
+
+    if (!s->is_read) {
+        fds[index].revents |= res < 0 ? POLLERR : (short)res;
+        return;
+    }
+
+    if (res == -EAGAIN) {
+        /* A fresh non-blocking fd: let the ring park the next read instead */
+        int flags = fcntl(s->fd, F_GETFL);
+        if (flags >= 0) {
+            fcntl(s->fd, F_SETFL, flags & ~O_NONBLOCK);
+        }
+        return;
+    }
+
+    s->len = res;
+    if (res > 0) {
+        stats.reads++;
+        fds[index].revents |= POLLIN;
+    } else {
+        fds[index].revents |= res == 0 ? POLLHUP : POLLERR;
+    }
+}
+
+/* Reap every available CQE; returns how many were reaped */
+static int reap(struct pollfd *fds, int nfds)
+{
+    unsigned head = *ring.cq_head;
+    unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+    int count = 0;
+
+    while (head != tail) {
+        const struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+        uint64_t op = cqe->user_data >> 32;
+        unsigned index = (unsigned)(cqe->user_data & 0xFFFFFFFFu);
+
+        if (op == URING_OP_SLOT) {
+            complete_slot(index, cqe->res, fds, nfds);
+        } else if (op == URING_OP_WRITE) {
+            complete_write(index, cqe->res);
+        }
+        head++;
+        count++;
+    }
+
+    __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+    stats.completed += (unsigned)count;
+    return count;
+}
+
+/* Keep a read or poll armed on a slot, cancelling it when the fd changed */
+static void arm_slot(int index, const struct pollfd *pfd, size_t read_size)
+{
+    struct uring_slot *s = &slots[index];
+    struct io_uring_sqe *sqe;
+
+    if (s->inflight) {
+        if (s->fd != pfd->fd && !s->cancelling && (sqe = get_sqe()) != NULL) {
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = URING_USER_DATA(URING_OP_SLOT, index);
+            sqe->user_data = URING_USER_DATA(URING_OP_CANCEL, index);
+            commit_sqe();
+            s->cancelling = true;
+        }
+        return;
+    }
+    if (pfd->fd < 0) {
+        return;
+    }
+
+    if (read_size > 0 && !s->data) {
+        s->data = malloc(CMXD_URING_READ_SIZE);
+        if (!s->data) {
+            return;
+        }
+    }
+
+    sqe = get_sqe();
+    if (!sqe) {
+        return;
+    }
+    s->is_read = read_size > 0;
+    if (s->is_read) {
+        sqe->opcode = IORING_OP_READ;
+        sqe->addr = (uint64_t)(uintptr_t)s->data;
+        sqe->len = (unsigned)(read_size < CMXD_URING_READ_SIZE ? read_size : CMXD_URING_READ_SIZE);
+        sqe->off = (uint64_t)-1;
+    } else {
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->poll32_events = (unsigned)pfd->events;
+    }
+    sqe->fd = pfd->fd;
+    sqe->user_data = URING_USER_DATA(URING_OP_SLOT, index);
+    commit_sqe();
+
+    s->fd = pfd->fd;
+    s->inflight = true;
+    s->len = 0;
+}
+
+/*
+ * poll() replacement. Slots with a nonzero read_sizes entry complete with
+ * POLLIN once their read has data (see cmxd_uring_read_data()); the others
+ * report poll events. Queued writes are submitted by the same call.
+ * Returns the number of ready fds, 0 on timeout and -1 with errno set.
+ */
+int cmxd_uring_wait(struct pollfd *fds, int nfds, const size_t *read_sizes, int timeout_ms)
+{
+    struct timespec start, now;
+    int ready;
+
+    if (nfds > CMXD_URING_MAX_SLOTS) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (int i = 0; i < nfds; i++) {
+        fds[i].revents = 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (;;) {
+        struct __kernel_timespec ts;
+        struct io_uring_getevents_arg arg = {
+            .sigmask = 0,
+            .sigmask_sz = _NSIG / 8,
+            .ts = 0,
+        };
+        unsigned submitting;
+        int ret;
+
+        for (int i = 0; i < nfds; i++) {
+            arm_slot(i, &fds[i], read_sizes ? read_sizes[i] : 0);
+        }
+
+        if (timeout_ms >= 0) {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            long remaining = timeout_ms - ((now.tv_sec - start.tv_sec) * 1000 +
+                                           (now.tv_nsec - start.tv_nsec) / 1000000);
+            if (remaining < 0) {
+                remaining = 0;
+            }
+            ts.tv_sec = remaining / 1000;
+            ts.tv_nsec = (remaining % 1000) * 1000000;
+            arg.ts = (uint64_t)(uintptr_t)&ts;
+        }
+
+        /*
+         * Outstanding writes always complete, so waiting for them plus one
+         * more keeps their completions from waking us on their own.
+         */
+        submitting = ring.to_submit;
+        ret = uring_enter(submitting, (unsigned)writes_pending + 1,
+                          IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+        if (ret < 0) {
+            if (errno == ETIME) {
+                reap(fds, nfds);
+                break;
+            }
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                /* Signal or full CQ: reap what is there and let the caller look */
+                reap(fds, nfds);
+                errno = EINTR;
+                return -1;
+            }
+            log_error("io_uring_enter failed: %s", strerror(errno));
+            return -1;
+        }
+        stats.submitted += (unsigned)ret;
+        ring.to_submit -= (unsigned)ret;
+
+        int reaped = reap(fds, nfds);
+        ready = 0;
+        for (int i = 0; i < nfds; i++) {
+            if (fds[i].revents) {
+                ready++;
+            }
+        }
+        if (ready > 0) {
+            return ready;
+        }
+
+        if (timeout_ms >= 0) {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if ((now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000 >= timeout_ms) {
+                break;
+            }
+        }
+        /*
+         * With SQEs submitted the kernel reports success even if the wait was
+         * cut short by a signal; hand control back so the caller can see it.
+         */
+        if (submitting > 0 && reaped == 0) {
+            errno = EINTR;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* Data of the last completed read on a slot */
+const uint8_t *cmxd_uring_read_data(int slot, ssize_t *len)
+{
+    if (slot < 0 || slot >= CMXD_URING_MAX_SLOTS || !slots[slot].data) {
+        *len = -1;
+        return NULL;
+    }
+    *len = slots[slot].len;
+    return slots[slot].data;
+}
+
+/*
+ * =============================================================================
+ * QUEUED OUTPUT
+ * =============================================================================
+ */
+
+/* Queue a pwrite() at offset 0, as used for sysfs attributes */
+int cmxd_uring_queue_write(int fd, const void *data, size_t len, cmxd_uring_done_fn done, void *ctx)
+{
+    struct io_uring_sqe *sqe;
+    int index = -1;
+
+    if (!cmxd_uring_active() || len > CMXD_URING_WRITE_MAX) {
+        return -1;
+    }
+    for (int i = 0; i < CMXD_URING_MAX_WRITES; i++) {
+        if (!writes[i].in_use) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0 || (sqe = get_sqe()) == NULL) {
+        /* Caller writes synchronously instead */
+        stats.sync_fallbacks++;
+        return -1;
+    }
+
+    struct uring_write *w = &writes[index];
+    memcpy(w->data, data, len);
+    w->fd = fd;
+    w->done = done;
+    w->ctx = ctx;
+    w->in_use = true;
+    writes_pending++;
+
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)w->data;
+    sqe->len = (unsigned)len;
+    sqe->off = 0;
+    sqe->user_data = URING_USER_DATA(URING_OP_WRITE, index);
+    commit_sqe();
+    return 0;
+}
+
+/* Flush queued output, then tear the ring down (cancelling armed reads) */
+void cmxd_uring_cleanup(void)
+{
+    if (!cmxd_uring_active()) {
+        return;
+    }
+
+    while (ring.to_submit > 0 || writes_pending > 0) {
+        int ret = uring_enter(ring.to_submit, writes_pending > 0 ? 1 : 0, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        ring.to_submit -= (unsigned)ret;
+        reap(NULL, 0);
+    }
+
+    ring_unmap();
+    for (int i = 0; i < CMXD_URING_MAX_SLOTS; i++) {
+        free(slots[i].data);
+        slots[i].data = NULL;
+        slots[i].fd = -1;
+        slots[i].inflight = false;
+        slots[i].cancelling = false;
+    }
+    log_debug("io_uring backend shut down");
+}
@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * io_uring event loop backend for CMXD (Chuwi Minibook X Daemon)
+ *
+ * Optional replacement for the poll()/read()/pwrite() chain of the main
+ * loop: buffer reads stay armed in the ring, sysfs writes are queued, and
+ * one io_uring_enter() per cycle submits everything and reaps the
+ * completions. Built only with ENABLE_IO_URING=1.
+ *
+ * Copyright (c) 2025 Armando DiCianno <armando@noonshy.com>
+ */
+
+#ifndef CMXD_URING_H
+#define CMXD_URING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <poll.h>
+#include <sys/types.h>
+
+#include "cmxd-data.h"
+
+#define CMXD_URING_ENTRIES      64
+#define CMXD_URING_MAX_SLOTS    8       /* Watched fds, one per pollfd */
+#define CMXD_URING_READ_SIZE    (CMXD_IIO_MAX_BATCH * CMXD_SCAN_MAX_BYTES)
+#define CMXD_URING_MAX_WRITES   32      /* Queued writes in flight */
+#define CMXD_URING_WRITE_MAX    512     /* Largest queued payload */
+
+/* Completion of a queued write: res is the byte count or -errno */
+typedef void (*cmxd_uring_done_fn)(void *ctx, int fd, int res);
+
+struct cmxd_uring_stats {
+    uint64_t enters;                /* io_uring_enter() calls */
+    uint64_t submitted;             /* SQEs handed to the kernel */
+    uint64_t completed;             /* CQEs reaped */
+    uint64_t reads;                 /* Buffer reads completed with data */
+    uint64_t writes;                /* Writes completed */
+    uint64_t sync_fallbacks;        /* Writes done synchronously because the queue was full */
+};
+
+int cmxd_uring_init(log_func_t log_function);
+void cmxd_uring_cleanup(void);
+bool cmxd_uring_active(void);
+
+int cmxd_uring_wait(struct pollfd *fds, int nfds, const size_t *read_sizes, int timeout_ms);
+const uint8_t *cmxd_uring_read_data(int slot, ssize_t *len);
+
+int cmxd_uring_queue_write(int fd, const void *data, size_t len, cmxd_uring_done_fn done, void *ctx);
+
+const struct cmxd_uring_stats *cmxd_uring_get_stats(void);
+
+#endif /* CMXD_URING_H */
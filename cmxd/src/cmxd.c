@@ -27,11 +27,18 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <sys/types.h>
+#include <dirent.h>
 
 #include "cmxd-calculations.h"
+#include "cmxd-fixed.h"
 #include "cmxd-orientation.h"
 #include "cmxd-modes.h"
 #include "cmxd-data.h"
+#include "cmxd-cache.h"
+#include "cmxd-discovery.h"
+#include "cmxd-pairing.h"
+#include "cmxd-rate.h"
+#include "cmxd-mirror.h"
 #include "cmxd-events.h"
 #include "cmxd-paths.h"
 #include "cmxd-protocol.h"
@@ -40,6 +47,10 @@
 #include "cmxd-dbus.h"
 #endif
 
+#ifdef ENABLE_IO_URING
+#include "cmxd-uring.h"
+#endif
+
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
@@ -53,6 +64,12 @@
 
 #define DEVICE_NAME_MAX 128
 
+/* Startup waits for the kernel module and sensors, woken by uevents */
+#define DISCOVERY_TIMEOUT_MS 2000
+
+/* Re-check interval for returning sensors when uevents are unavailable */
+#define SENSOR_RETRY_MS 1000
+
 /*
  * =============================================================================
  * CONFIGURATION AND GLOBAL STATE
@@ -65,6 +82,20 @@ struct config {
     char lid_dev[64];               /* Lid accelerometer device name */
     char sysfs_path[PATH_MAX];      /* Kernel module sysfs path */
     unsigned int buffer_timeout_ms; /* IIO buffer polling timeout */
+    int buffer_length;              /* IIO buffer length in scans */
+    int buffer_watermark;           /* Scans queued per wakeup */
+    int trigger_type;               /* Preferred sampling trigger */
+    unsigned int sampling_hz;       /* hrtimer sampling frequency */
+    unsigned int pair_tolerance_ms; /* Max base/lid timestamp skew for a match */
+    unsigned int pair_staleness_ms; /* Max age of a last-known partner scan */
+    int pair_interpolate;           /* Interpolate partners between scans */
+    unsigned int idle_hz;           /* Sampling rate while still (0 = fixed rate) */
+    double motion_threshold;        /* Vector deviation (m/s^2) that counts as motion */
+    double angle_threshold;         /* Hinge deviation (degrees) that counts as motion */
+    unsigned int idle_delay_ms;     /* Stillness before dropping to the idle rate */
+    unsigned int deep_idle_ms;      /* Stillness before parking on sensor events (0 = never) */
+    int fixed_point;                /* Fuse pairs in integers instead of doubles */
+    struct cmxd_mirror_config mirror; /* Which raw vectors are written to the kernel */
     int verbose;                    /* Verbose logging flag */
     /* Event system configuration - fixed at compile time */
     int enable_unix_socket;         /* Enable Unix domain socket events */
@@ -75,11 +106,37 @@ struct config {
 /* Global state */
 static volatile sig_atomic_t running = 1;
 
+/* Discovery snapshot; warm when loaded and revalidated at startup */
+static struct cmxd_cache cache;
+static bool cache_warm = false;
+static bool cache_ready = false;    /* Devices recorded, state changes are saved */
+
+/* Sensor scales as Q16 mm/s^2 per LSB for the fixed-point path */
+static int32_t base_scale_q, lid_scale_q;
+
 /* Default configuration values */
 static struct config cfg = {
     .base_dev = "iio:device0",         /* Overridden by kernel module */
     .lid_dev = "iio:device1",          /* Overridden by kernel module */
     .buffer_timeout_ms = 100,          /* 100ms IIO buffer timeout */
+    .buffer_length = CMXD_IIO_DEFAULT_BUFFER_LENGTH,
+    .buffer_watermark = CMXD_IIO_DEFAULT_WATERMARK,
+    .trigger_type = CMXD_TRIGGER_HRTIMER,
+    .sampling_hz = CMXD_DEFAULT_SAMPLING_HZ,
+    .pair_tolerance_ms = CMXD_PAIR_DEFAULT_TOLERANCE_MS,
+    .pair_staleness_ms = CMXD_PAIR_DEFAULT_STALENESS_MS,
+    .pair_interpolate = 1,
+    .idle_hz = CMXD_RATE_DEFAULT_IDLE_HZ,
+    .motion_threshold = CMXD_RATE_DEFAULT_MOTION,
+    .angle_threshold = CMXD_RATE_DEFAULT_ANGLE,
+    .idle_delay_ms = CMXD_RATE_DEFAULT_IDLE_DELAY_MS,
+    .deep_idle_ms = CMXD_RATE_DEFAULT_DEEP_IDLE_MS,
+    .fixed_point = 0,
+    .mirror = {
+        .policy = CMXD_MIRROR_ON_DEMAND,
+        .every = CMXD_MIRROR_DEFAULT_EVERY,
+        .deadband = CMXD_MIRROR_DEFAULT_DEADBAND,
+    },
     .verbose = 0,                      /* No verbose logging by default */
     .sysfs_path = CMXD_DEFAULT_SYSFS_PATH,
     .enable_unix_socket = 1,           /* Unix domain socket enabled */
@@ -104,6 +161,16 @@ static void signal_handler(int sig)
             /* Use printf since log macros aren't available yet */
             printf("[INFO] Received signal %d, shutting down...\n", sig);
             running = 0;
+#ifdef ENABLE_IO_URING
+            /*
+             * Writes from here would be queued behind the loop's and then
+             * hit closed handles; the loop flushes the ring and exits, and
+             * main() restores laptop mode synchronously afterwards.
+             */
+            if (cmxd_uring_active()) {
+                break;
+            }
+#endif
             cleanup_and_exit();
             break;
         case SIGHUP:
@@ -184,9 +251,14 @@ static void cleanup_and_exit(void)
     if (cmxd_write_orientation(CMXD_PROTOCOL_ORIENTATION_LANDSCAPE) < 0) {
         log_warn("Failed to restore landscape orientation during cleanup");
     }
+    if (cmxd_commit_state(0) < 0) {
+        log_warn("Failed to write state to kernel module during cleanup");
+    }
     
     /* Cleanup event system */
     cmxd_events_cleanup();
+    cmxd_data_cleanup();
+    cmxd_discovery_close();
     
     log_info("Cleanup complete - laptop mode restored");
 }
@@ -197,67 +269,560 @@ static void cleanup_and_exit(void)
  * =============================================================================
  */
 
+/* Monotonic clock in nanoseconds */
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* What one base/lid pair says, from either fusion path */
+struct pair_result {
+    double hinge_angle;             /* 0-360°, negative if unreliable */
+    int orientation_code;
+    const char *device_mode;        /* May be CMXD_MODE_INDETERMINATE */
+    const char *orientation;
+    double base_ms2[3];             /* Vectors for the rate controller */
+    double lid_ms2[3];
+};
+
+/* Scale once; magnitudes, angles and horizontals are derived on demand */
+static void fuse_pair(const struct accel_sample *base_sample, const struct accel_sample *lid_sample,
+                      double base_scale, double lid_scale, struct pair_result *pair)
+{
+    struct cmxd_frame frame;
+    
+    cmxd_frame_init(&frame, base_sample, lid_sample, base_scale, lid_scale);
+    pair->hinge_angle = cmxd_frame_hinge_angle_360(&frame);
+    
+    pair->device_mode = CMXD_PROTOCOL_MODE_LAPTOP;  /* Default fallback */
+    pair->orientation_code = 0;
+    if (pair->hinge_angle >= 0) {
+        pair->orientation_code = cmxd_get_device_orientation(frame.lid[0], frame.lid[1], frame.lid[2]);
+        pair->device_mode = cmxd_get_stable_device_mode_for_frame(&frame, pair->hinge_angle,
+                                                                  pair->orientation_code);
+    }
+    pair->orientation = cmxd_get_orientation_for_frame(&frame, pair->device_mode);
+    
+    memcpy(pair->base_ms2, frame.base, sizeof(pair->base_ms2));
+    memcpy(pair->lid_ms2, frame.lid, sizeof(pair->lid_ms2));
+}
+
+/* The same decisions in integers, with the kernel module's arithmetic */
+static void fuse_pair_fixed(const struct accel_sample *base_sample, const struct accel_sample *lid_sample,
+                            struct pair_result *pair)
+{
+    struct cmx_pair fixed;
+    
+    cmxd_fixed_pair_init(&fixed, base_sample, lid_sample, base_scale_q, lid_scale_q);
+    int angle = cmxd_fixed_hinge_angle_360(&fixed);
+    
+    pair->device_mode = CMXD_PROTOCOL_MODE_LAPTOP;  /* Default fallback */
+    pair->orientation_code = 0;
+    if (angle >= 0) {
+        pair->orientation_code = cmxd_get_device_orientation_fixed(fixed.lid);
+        pair->device_mode = cmxd_get_stable_device_mode_for_fixed_pair(&fixed, angle, pair->orientation_code);
+    }
+    pair->orientation = cmxd_get_orientation_for_fixed_pair(&fixed, pair->device_mode);
+    
+    /* Back to doubles only for logging and the rate controller */
+    pair->hinge_angle = angle < 0 ? -1.0 : angle / 10.0;
+    for (int i = 0; i < 3; i++) {
+        pair->base_ms2[i] = fixed.base[i] / 1000.0;
+        pair->lid_ms2[i] = fixed.lid[i] / 1000.0;
+    }
+}
+
+/*
+ * Run one base/lid sample pair through angle, mode and orientation detection.
+ * Returns true when the rate controller selected a new sampling rate.
+ */
+static bool process_sensor_pair(const struct accel_sample *base_sample, const struct accel_sample *lid_sample,
+                                double base_scale, double lid_scale, struct cmxd_rate_controller *rate)
+{
+    /* Log sensor data in debug mode */
+    log_debug("Sensor data - Base: (%d,%d,%d), Lid: (%d,%d,%d)", 
+             base_sample->x, base_sample->y, base_sample->z,
+             lid_sample->x, lid_sample->y, lid_sample->z);
+
+    /* Hinge angle (0-360° system), stable mode with gravity confidence, and orientation */
+    struct pair_result pair;
+    if (cfg.fixed_point) {
+        fuse_pair_fixed(base_sample, lid_sample, &pair);
+    } else {
+        fuse_pair(base_sample, lid_sample, base_scale, lid_scale, &pair);
+    }
+    double hinge_angle = pair.hinge_angle;
+    const char* device_mode = pair.device_mode;
+    int orientation_code = pair.orientation_code;
+    log_debug("HINGE: %.1f°", hinge_angle);
+    
+    /* Filter out indeterminate mode before writing to kernel module */
+    /* The kernel only accepts: "closing", "laptop", "flat", "tent", "tablet" */
+    static char last_kernel_mode[32] = CMXD_PROTOCOL_MODE_LAPTOP;
+    const char* kernel_mode = device_mode;
+    
+    if (strcmp(device_mode, CMXD_MODE_INDETERMINATE) == 0) {
+        /* Keep the last known good mode for kernel */
+        kernel_mode = last_kernel_mode;
+        log_debug("MODE: %s (indeterminate)", kernel_mode);
+        log_debug("KERNEL: Indeterminate detected - keeping last mode '%s' for kernel", kernel_mode);
+    } else {
+        /* Update last known good mode */
+        strncpy(last_kernel_mode, device_mode, sizeof(last_kernel_mode) - 1);
+        last_kernel_mode[sizeof(last_kernel_mode) - 1] = '\0';
+        log_debug("MODE: %s", device_mode);
+    }
+    log_debug("Hinge angle: %.1f°, device orientation: %d", hinge_angle, orientation_code);
+    
+    /* Orientation follows the sensor the actual device mode calls for */
+    const char* orientation = pair.orientation;
+    log_debug("Device mode: %s, Orientation: %s", kernel_mode, orientation);
+    
+    /* Published with the state record for the module's hinge IIO device */
+    cmxd_write_angle(hinge_angle);
+    
+    /* Write filtered mode to kernel module and send events */
+    if (cmxd_write_mode_with_events(kernel_mode) < 0) {
+        log_warn("Failed to write mode to kernel module");
+    }
+    
+    /* Write detected orientation to kernel module and send events */
+    if (cmxd_write_orientation_with_events(orientation) < 0) {
+        log_warn("Failed to write orientation to kernel module");
+    }
+    
+    /* Remember the published state for the next start */
+    if (cache_ready && cmxd_cache_set_state(&cache, kernel_mode, orientation)) {
+        cmxd_cache_save(&cache);
+    }
+    
+    /* Let the motion detector pick the next sampling rate */
+    return cmxd_rate_observe(rate, pair.base_ms2, pair.lid_ms2, hinge_angle, monotonic_ns());
+}
+
+/*
+ * Apply the rate controller's current rate. With the hrtimer trigger the
+ * trigger itself is retuned and the watchdog follows; with the sysfs trigger
+ * the poll timeout is the sampling period.
+ */
+static void apply_sampling_rate(const struct cmxd_rate_controller *rate, bool kernel_paced,
+                                int watermark, int *poll_timeout)
+{
+    unsigned int hz = cmxd_rate_current_hz(rate);
+    
+    if (kernel_paced) {
+        if (cmxd_set_trigger_frequency(hz) < 0) {
+            log_warn("Failed to set sampling frequency to %u Hz", hz);
+            return;
+        }
+        int watchdog_ms = (int)(4000U * (unsigned int)watermark / hz);
+        *poll_timeout = watchdog_ms > (int)cfg.buffer_timeout_ms ? watchdog_ms : (int)cfg.buffer_timeout_ms;
+    } else {
+        *poll_timeout = (int)(1000U / hz);
+    }
+    
+    log_debug("RATE: %s, %u Hz (poll timeout %d ms)",
+              rate->state == CMXD_RATE_IDLE ? "idle" : "active", hz, *poll_timeout);
+}
+
+/*
+ * Park sampling until a sensor reports motion: arm the threshold events
+ * around the last pair, then detach both buffers so the trigger stops.
+ */
+static bool enter_deep_idle(struct iio_buffer *base_buf, struct iio_buffer *lid_buf,
+                            const struct accel_sample *base_last, const struct accel_sample *lid_last,
+                            double base_scale, double lid_scale)
+{
+    /* Same motion threshold as the rate controller, in raw sensor units */
+    int base_margin = (int)(cfg.motion_threshold / base_scale + 0.5);
+    int lid_margin = (int)(cfg.motion_threshold / lid_scale + 0.5);
+    
+    if (cmxd_arm_iio_events(base_buf, base_last, base_margin > 0 ? base_margin : 1) < 0 ||
+        cmxd_arm_iio_events(lid_buf, lid_last, lid_margin > 0 ? lid_margin : 1) < 0) {
+        cmxd_disarm_iio_events(base_buf);
+        cmxd_disarm_iio_events(lid_buf);
+        return false;
+    }
+    
+    if (cmxd_suspend_iio_buffer(base_buf) < 0 || cmxd_suspend_iio_buffer(lid_buf) < 0) {
+        cmxd_disarm_iio_events(base_buf);
+        cmxd_disarm_iio_events(lid_buf);
+        cmxd_resume_iio_buffer(base_buf);
+        cmxd_resume_iio_buffer(lid_buf);
+        return false;
+    }
+    
+    return true;
+}
+
+/* Resume buffered sampling after a wake event */
+static int leave_deep_idle(struct iio_buffer *base_buf, struct iio_buffer *lid_buf)
+{
+    cmxd_disarm_iio_events(base_buf);
+    cmxd_disarm_iio_events(lid_buf);
+    
+    if (cmxd_resume_iio_buffer(base_buf) < 0 || cmxd_resume_iio_buffer(lid_buf) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Report batching efficiency and overflow losses for one buffer */
+static void log_buffer_stats(const char *label, const struct iio_buffer *buf)
+{
+    const struct iio_buffer_stats *st = &buf->stats;
+    
+    log_info("%s buffer: %llu samples in %llu wakeups (%.1f/wakeup), %llu overruns, ~%llu samples lost",
+             label, (unsigned long long)st->samples, (unsigned long long)st->wakeups,
+             st->wakeups ? (double)st->samples / st->wakeups : 0.0,
+             (unsigned long long)st->overruns, (unsigned long long)st->samples_lost);
+}
+
+/* Report how long sampling ran at each rate */
+static void log_rate_stats(struct cmxd_rate_controller *rate)
+{
+    const struct cmxd_rate_stats *st = &rate->stats;
+    
+    cmxd_rate_account(rate, monotonic_ns());
+    log_info("Rate: active %u Hz %.1fs (%llu samples), idle %u Hz %.1fs (%llu samples), deep idle %.1fs",
+             rate->config.active_hz, (double)st->ns_at_rate[CMXD_RATE_ACTIVE] / 1e9,
+             (unsigned long long)st->samples_at_rate[CMXD_RATE_ACTIVE],
+             rate->config.idle_hz, (double)st->ns_at_rate[CMXD_RATE_IDLE] / 1e9,
+             (unsigned long long)st->samples_at_rate[CMXD_RATE_IDLE],
+             (double)st->ns_at_rate[CMXD_RATE_DEEP_IDLE] / 1e9);
+    log_info("Rate: %llu to idle, %llu to deep idle, %llu to active",
+             (unsigned long long)st->to_idle, (unsigned long long)st->to_deep_idle,
+             (unsigned long long)st->to_active);
+}
+
+/* Report how many raw vectors reached the kernel */
+static void log_mirror_stats(const struct cmxd_mirror *mirror)
+{
+    const struct cmxd_mirror_stats *st = &mirror->stats;
+    char policy[32];
+    
+    cmxd_mirror_describe(&mirror->config, policy, sizeof(policy));
+    log_info("Vector mirror (%s): %llu of %llu vectors written (%.1f%%)", policy,
+             (unsigned long long)st->mirrored, (unsigned long long)st->offered,
+             st->offered ? 100.0 * (double)st->mirrored / (double)st->offered : 0.0);
+}
+
+/* Report how base and lid scans were paired for fusion */
+static void log_pairing_stats(const struct cmxd_pairing *pairing)
+{
+    const struct cmxd_pair_stats *st = &pairing->stats;
+    
+    log_info("Pairing: %llu pairs (%llu matched, %llu interpolated, %llu last-known), "
+             "skew avg %.2f ms max %.2f ms",
+             (unsigned long long)st->pairs, (unsigned long long)st->matched,
+             (unsigned long long)st->interpolated, (unsigned long long)st->stale,
+             st->pairs ? (double)st->skew_total_ns / st->pairs / 1e6 : 0.0,
+             (double)st->skew_max_ns / 1e6);
+    log_info("Pairing: unpaired base %llu lid %llu, ring drops base %llu lid %llu",
+             (unsigned long long)st->unpaired[CMXD_PAIR_BASE], (unsigned long long)st->unpaired[CMXD_PAIR_LID],
+             (unsigned long long)st->dropped[CMXD_PAIR_BASE], (unsigned long long)st->dropped[CMXD_PAIR_LID]);
+}
+
+/*
+ * =============================================================================
+ * SENSOR DISCOVERY
+ * =============================================================================
+ */
+
+/* Readiness check: a sysfs path exists (ctx is the path) */
+static bool path_ready(void *ctx)
+{
+    return access((const char *)ctx, F_OK) == 0;
+}
+
+/* Readiness check: the kernel module has resolved both IIO devices */
+static bool device_assignments_ready(void *ctx)
+{
+    (void)ctx;
+    return cmxd_read_kernel_device_assignments(cfg.base_dev, sizeof(cfg.base_dev),
+                                               cfg.lid_dev, sizeof(cfg.lid_dev)) == 0;
+}
+
+/* Readiness check: both assigned accelerometers expose their channels */
+static bool sensors_ready(void *ctx)
+{
+    (void)ctx;
+    return cmxd_iio_device_ready(cfg.base_dev) && cmxd_iio_device_ready(cfg.lid_dev);
+}
+
+/* Did this uevent take away one of the sensors we stream from? */
+static bool uevent_removes_sensor(const struct cmxd_uevent *event)
+{
+    return strcmp(event->subsystem, "iio") == 0 && strcmp(event->action, "remove") == 0 &&
+           (strcmp(event->kernel_name, cfg.base_dev) == 0 || strcmp(event->kernel_name, cfg.lid_dev) == 0);
+}
+
+/*
+ * Enable both sensor buffers and read their scales; nothing stays enabled on
+ * failure. A warm cache supplies the layouts and scales, otherwise they are
+ * discovered and the cache is rewritten.
+ */
+static int arm_sensors(struct iio_buffer *base_buf, struct iio_buffer *lid_buf,
+                       double *base_scale, double *lid_scale)
+{
+    struct cmxd_scan_layout base_layout, lid_layout;
+    bool warm = cache_warm &&
+                cmxd_cache_device_layout(&cache.base, &base_layout) == 0 &&
+                cmxd_cache_device_layout(&cache.lid, &lid_layout) == 0;
+    
+    /* The snapshot only ever describes the first arm after startup */
+    cache_warm = false;
+    
+    if (cmxd_setup_iio_buffer(base_buf, cfg.base_dev, warm ? &base_layout : NULL) < 0) {
+        log_error("Failed to setup IIO buffer for base device %s", cfg.base_dev);
+        cmxd_cleanup_iio_buffer(base_buf);
+        return -1;
+    }
+    
+    if (cmxd_setup_iio_buffer(lid_buf, cfg.lid_dev, warm ? &lid_layout : NULL) < 0) {
+        log_error("Failed to setup IIO buffer for lid device %s", cfg.lid_dev);
+        cmxd_cleanup_iio_buffer(base_buf);
+        cmxd_cleanup_iio_buffer(lid_buf);
+        return -1;
+    }
+    
+    /* Read scale factors for both devices */
+    *base_scale = warm ? cache.base.scale : cmxd_read_accel_scale(cfg.base_dev);
+    *lid_scale = warm ? cache.lid.scale : cmxd_read_accel_scale(cfg.lid_dev);
+    
+    if (*base_scale <= 0.0) {
+        log_warn("Invalid base scale %f, using default 0.009582", *base_scale);
+        *base_scale = 0.009582;
+    }
+    
+    if (*lid_scale <= 0.0) {
+        log_warn("Invalid lid scale %f, using default 0.009582", *lid_scale);
+        *lid_scale = 0.009582;
+    }
+    
+    log_info("Using scales: base=%f, lid=%f", *base_scale, *lid_scale);
+    base_scale_q = cmxd_fixed_scale(*base_scale);
+    lid_scale_q = cmxd_fixed_scale(*lid_scale);
+    
+    /* Snapshot what was discovered for the next start */
+    if (warm) {
+        cache_ready = true;
+    } else if (cmxd_cache_set_device(&cache.base, base_buf, *base_scale) == 0 &&
+               cmxd_cache_set_device(&cache.lid, lid_buf, *lid_scale) == 0) {
+        snprintf(cache.trigger_name, sizeof(cache.trigger_name), "%s", base_buf->trigger_name);
+        cache_ready = cmxd_cache_save(&cache) == 0;
+    }
+    return 0;
+}
+
+/*
+ * Bring the sensors back after a removal. A re-probed sensor may come back
+ * under a different iio:deviceN, so the assignments are read again first.
+ */
+static int rearm_sensors(struct iio_buffer *base_buf, struct iio_buffer *lid_buf,
+                         double *base_scale, double *lid_scale)
+{
+    if (!device_assignments_ready(NULL) || !sensors_ready(NULL)) {
+        return -1;
+    }
+    return arm_sensors(base_buf, lid_buf, base_scale, lid_scale);
+}
+
+#ifdef ENABLE_IO_URING
+/* Report how much work each ring submission carried */
+static void log_uring_stats(uint64_t fused_samples)
+{
+    const struct cmxd_uring_stats *st = cmxd_uring_get_stats();
+    
+    log_info("io_uring: %llu enters, %llu SQEs, %llu reads, %llu writes/sends, %llu sync fallbacks, "
+             "%.2f enters per fused sample",
+             (unsigned long long)st->enters, (unsigned long long)st->submitted,
+             (unsigned long long)st->reads, (unsigned long long)st->writes,
+             (unsigned long long)st->sync_fallbacks,
+             fused_samples ? (double)st->enters / fused_samples : 0.0);
+}
+#endif
+
+/* Wait for buffer data or events: poll(), or one io_uring_enter() when built with io_uring */
+static int wait_for_events(struct pollfd *poll_fds, int nfds, const struct iio_buffer *base_buf,
+                           const struct iio_buffer *lid_buf, int timeout)
+{
+#ifdef ENABLE_IO_URING
+    if (cmxd_uring_active()) {
+        /* Slots 0 and 1 keep a buffer read armed; the rest are polled */
+        size_t read_sizes[7] = {
+            cmxd_iio_buffer_read_size(base_buf, CMXD_IIO_MAX_BATCH),
+            cmxd_iio_buffer_read_size(lid_buf, CMXD_IIO_MAX_BATCH),
+            0, 0, 0, 0, 0
+        };
+        return cmxd_uring_wait(poll_fds, nfds, read_sizes, timeout);
+    }
+#else
+    (void)base_buf;
+    (void)lid_buf;
+#endif
+    return poll(poll_fds, nfds, timeout);
+}
+
+/* Drain the scans queued on one buffer (slot is its index in poll_fds) */
+static int drain_buffer(struct iio_buffer *buf, int slot, struct accel_sample *batch)
+{
+#ifdef ENABLE_IO_URING
+    if (cmxd_uring_active() && cmxd_iio_buffer_read_size(buf, CMXD_IIO_MAX_BATCH) > 0) {
+        /* The ring already read them into the slot */
+        ssize_t len;
+        const uint8_t *data = cmxd_uring_read_data(slot, &len);
+        if (!data || len < 0) {
+            log_error("Buffer read failed on %s: %s", buf->device_name, strerror(len < 0 ? (int)-len : EIO));
+            return -1;
+        }
+        return cmxd_decode_iio_buffer_samples(buf, data, len, batch, CMXD_IIO_MAX_BATCH);
+    }
+#else
+    (void)slot;
+#endif
+    return cmxd_read_iio_buffer_samples(buf, batch, CMXD_IIO_MAX_BATCH);
+}
+
 /* Main processing loop with event-driven IIO reading */
 static int run_main_loop(void)
 {
     struct iio_buffer base_buf, lid_buf;
     struct accel_sample base_sample, lid_sample;
-    struct pollfd poll_fds[2];
+    struct accel_sample base_batch[CMXD_IIO_MAX_BATCH], lid_batch[CMXD_IIO_MAX_BATCH];
+    struct pollfd poll_fds[7];
     int base_xs, base_ys, base_zs;
     int lid_xs, lid_ys, lid_zs;
     unsigned int error_count = 0;
     const unsigned int max_errors = 10;
     int poll_timeout = cfg.buffer_timeout_ms; /* Use configured buffer timeout for poll() */
-    int base_valid = 0, lid_valid = 0;
     double base_scale, lid_scale;
+    struct cmxd_pairing pairing;
+    struct cmxd_pair_config pair_cfg = {
+        .tolerance_ns = (uint64_t)cfg.pair_tolerance_ms * 1000000ULL,
+        .max_staleness_ns = (uint64_t)cfg.pair_staleness_ms * 1000000ULL,
+        .interpolate = cfg.pair_interpolate != 0,
+    };
     
-    /* Ensure IIO trigger exists (create if needed, but leave persistent) */
-    log_debug("Ensuring IIO trigger is available...");
-    if (cmxd_ensure_iio_trigger_exists() < 0) {
-        log_error("Failed to ensure IIO trigger exists");
+    struct cmxd_rate_controller rate;
+    struct cmxd_mirror mirror;
+    bool rate_changed = false;
+    bool have_pair = false;
+    bool deep_idle = false;
+    bool sensors_lost = false;
+    
+    cmxd_pairing_init(&pairing, &pair_cfg);
+    cmxd_mirror_init(&mirror, &cfg.mirror);
+    
+    /* Select sampling trigger: the cmx module's, our own hrtimer trigger, or the sysfs trigger */
+    log_debug("Setting up IIO sampling trigger...");
+    if (cmxd_setup_iio_trigger() < 0) {
+        log_error("Failed to set up an IIO trigger");
         return -1;
     }
     
     log_debug("Setting up IIO buffers for event-driven reading...");
     
-    /* Setup IIO buffers */
-    if (cmxd_setup_iio_buffer(&base_buf, cfg.base_dev) < 0) {
-        log_error("Failed to setup IIO buffer for base device %s", cfg.base_dev);
+    /* Setup IIO buffers and read scale factors */
+    if (arm_sensors(&base_buf, &lid_buf, &base_scale, &lid_scale) < 0) {
+        cmxd_cleanup_iio_trigger();
         return -1;
     }
     
-    if (cmxd_setup_iio_buffer(&lid_buf, cfg.lid_dev) < 0) {
-        log_error("Failed to setup IIO buffer for lid device %s", cfg.lid_dev);
-        cmxd_cleanup_iio_buffer(&base_buf);
-        return -1;
+    /* With a kernel-paced trigger the poll timeout is only a stall watchdog */
+    bool kernel_paced = cmxd_iio_trigger_is_hrtimer();
+    if (kernel_paced) {
+        int watchdog_ms = (int)(4000U * (unsigned int)base_buf.watermark / cfg.sampling_hz);
+        if (watchdog_ms > poll_timeout) {
+            poll_timeout = watchdog_ms;
+        }
+        log_debug("Kernel-paced sampling, stall watchdog %d ms", poll_timeout);
     }
     
-    /* Read scale factors for both devices */
-    base_scale = cmxd_read_accel_scale(cfg.base_dev);
-    lid_scale = cmxd_read_accel_scale(cfg.lid_dev);
-    
-    if (base_scale <= 0.0) {
-        log_warn("Invalid base scale %f, using default 0.009582", base_scale);
-        base_scale = 0.009582;
+    /* The active rate is the configured one: trigger frequency or poll period */
+    struct cmxd_rate_config rate_cfg = {
+        .active_hz = kernel_paced ? cfg.sampling_hz : 1000U / cfg.buffer_timeout_ms,
+        .idle_hz = cfg.idle_hz,
+        .motion_threshold = cfg.motion_threshold,
+        .angle_threshold = cfg.angle_threshold,
+        .idle_delay_ms = cfg.idle_delay_ms,
+    };
+    if (rate_cfg.active_hz == 0) {
+        rate_cfg.active_hz = 1;
     }
-    
-    if (lid_scale <= 0.0) {
-        log_warn("Invalid lid scale %f, using default 0.009582", lid_scale);
-        lid_scale = 0.009582;
+    cmxd_rate_init(&rate, &rate_cfg, monotonic_ns());
+    if (cmxd_rate_enabled(&rate)) {
+        log_info("Adaptive sampling: %u Hz active, %u Hz after %u ms still",
+                 rate_cfg.active_hz, rate_cfg.idle_hz, rate_cfg.idle_delay_ms);
     }
     
-    log_info("Using scales: base=%f, lid=%f", base_scale, lid_scale);
+    /* Deep idle needs both sensors to be able to wake us */
+    bool deep_idle_capable = cfg.deep_idle_ms > 0 &&
+                             cmxd_iio_events_available(&base_buf) && cmxd_iio_events_available(&lid_buf);
+    if (deep_idle_capable) {
+        log_info("Deep idle on sensor threshold events after %u ms still", cfg.deep_idle_ms);
+    } else if (cfg.deep_idle_ms > 0) {
+        log_debug("Sensors expose no threshold events, deep idle unavailable");
+    }
     
     /* Setup poll file descriptors */
     poll_fds[0].fd = base_buf.buffer_fd;
     poll_fds[0].events = POLLIN;
     poll_fds[1].fd = lid_buf.buffer_fd;
     poll_fds[1].events = POLLIN;
+    /* Event fds are only polled in deep idle; negative fds are ignored */
+    poll_fds[2].fd = -1;
+    poll_fds[2].events = POLLIN;
+    poll_fds[3].fd = -1;
+    poll_fds[3].events = POLLIN;
+    /* Kernel uevents: sensors being removed and coming back */
+    poll_fds[4].fd = cmxd_discovery_fd();
+    poll_fds[4].events = POLLIN;
+    /* The module's resume_seq: samples and mode history go stale in system sleep */
+    poll_fds[5].fd = cmxd_resume_fd();
+    poll_fds[5].events = POLLPRI;
+    /* The module's vec_watchers: whether anyone reads the raw vectors */
+    poll_fds[6].fd = -1;
+    poll_fds[6].events = POLLPRI;
+    if (mirror.config.policy == CMXD_MIRROR_ON_DEMAND) {
+        poll_fds[6].fd = cmxd_vec_watchers_fd();
+        int watchers = cmxd_vec_watchers();
+        if (watchers < 0) {
+            log_info("Kernel module reports no vec_watchers, mirroring every vector");
+            mirror.config.policy = CMXD_MIRROR_ALL;
+            poll_fds[6].fd = -1;
+        } else {
+            cmxd_mirror_set_watched(&mirror, watchers > 0);
+        }
+    }
+    if (mirror.config.policy != CMXD_MIRROR_ALL) {
+        char policy[32];
+        cmxd_mirror_describe(&mirror.config, policy, sizeof(policy));
+        log_info("Vector mirror policy: %s", policy);
+    }
+    
+#ifdef ENABLE_IO_URING
+    /* Falls back to poll() when the kernel's io_uring is missing or too old */
+    cmxd_uring_init(log_msg);
+#endif
     
     log_debug("Starting event-driven main loop...");
     
     while (running) {
-        int poll_result = poll(poll_fds, 2, poll_timeout);
+        int base_count = 0, lid_count = 0;
+        int timeout = poll_timeout;
+        bool lost = false;
+        bool resumed = false;
+        
+        if (sensors_lost) {
+            timeout = poll_fds[4].fd >= 0 ? -1 : SENSOR_RETRY_MS;
+        } else if (deep_idle) {
+            timeout = -1;
+        }
+        
+        int poll_result = wait_for_events(poll_fds, 7, &base_buf, &lid_buf, timeout);
         
         if (poll_result < 0) {
             if (errno == EINTR) {
@@ -267,16 +832,116 @@ static int run_main_loop(void)
             break;
         }
         
+        /* Watch for our sensors going away */
+        if (poll_fds[4].revents & POLLIN) {
+            struct cmxd_uevent event;
+            while (cmxd_discovery_read(&event) > 0) {
+                if (!sensors_lost && uevent_removes_sensor(&event)) {
+                    log_warn("Sensor %s was removed", event.kernel_name);
+                    lost = true;
+                }
+            }
+        }
+        for (int i = 0; i < 4 && !sensors_lost; i++) {
+            if (poll_fds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                log_warn("Poll error on %s %s", (i % 2) ? "lid" : "base", i < 2 ? "buffer" : "events");
+                lost = true;
+            }
+        }
+        
+        /*
+         * Back from system sleep: drop unpaired scans and the mode history so
+         * the first fresh pair decides the mode, and sample at the active rate
+         */
+        if ((poll_fds[5].revents & (POLLPRI | POLLERR)) && cmxd_resumed()) {
+            log_info("Resumed from system sleep, resynchronizing");
+            resumed = true;
+            cmxd_pairing_init(&pairing, &pair_cfg);
+            cmxd_modes_resync();
+            if (!sensors_lost && !deep_idle && rate.state != CMXD_RATE_ACTIVE) {
+                rate_changed = true;
+            }
+            cmxd_rate_wake(&rate, monotonic_ns());
+        }
+        
+        /* A reader of base_vec, lid_vec or /dev/cmx came or went */
+        if (poll_fds[6].revents & (POLLPRI | POLLERR)) {
+            int watchers = cmxd_vec_watchers();
+            if (watchers >= 0 && (watchers > 0) != mirror.watched) {
+                log_debug("%d vector watcher(s), %s mirroring", watchers, watchers ? "resuming" : "pausing");
+                cmxd_mirror_set_watched(&mirror, watchers > 0);
+            }
+        }
+        
+        /* Tear down and wait for the kernel to bring the sensors back */
+        if (lost) {
+            cmxd_cache_invalidate();
+            cache_ready = false;
+            cmxd_cleanup_iio_buffer(&base_buf);
+            cmxd_cleanup_iio_buffer(&lid_buf);
+            cmxd_pairing_init(&pairing, &pair_cfg);
+            sensors_lost = true;
+            deep_idle = false;
+            have_pair = false;
+            for (int i = 0; i < 4; i++) {
+                poll_fds[i].fd = -1;
+            }
+            log_warn("Sensors unavailable, waiting for them to return");
+            continue;
+        }
+        
+        if (sensors_lost) {
+            if (rearm_sensors(&base_buf, &lid_buf, &base_scale, &lid_scale) < 0) {
+                continue;
+            }
+            sensors_lost = false;
+            poll_fds[0].fd = base_buf.buffer_fd;
+            poll_fds[1].fd = lid_buf.buffer_fd;
+            deep_idle_capable = cfg.deep_idle_ms > 0 &&
+                                cmxd_iio_events_available(&base_buf) && cmxd_iio_events_available(&lid_buf);
+            cmxd_rate_wake(&rate, monotonic_ns());
+            apply_sampling_rate(&rate, kernel_paced, base_buf.watermark, &poll_timeout);
+            log_info("Sensors back: base=%s lid=%s", cfg.base_dev, cfg.lid_dev);
+            continue;
+        }
+        
+        if (deep_idle) {
+            if (!resumed && !((poll_fds[2].revents | poll_fds[3].revents) & POLLIN)) {
+                continue;
+            }
+            
+            /* Motion or resume: resume buffered sampling at the active rate */
+            cmxd_read_iio_events(&base_buf);
+            cmxd_read_iio_events(&lid_buf);
+            if (leave_deep_idle(&base_buf, &lid_buf) < 0) {
+                log_error("Failed to resume sampling after deep idle");
+                break;
+            }
+            deep_idle = false;
+            poll_fds[0].fd = base_buf.buffer_fd;
+            poll_fds[1].fd = lid_buf.buffer_fd;
+            poll_fds[2].fd = -1;
+            poll_fds[3].fd = -1;
+            cmxd_rate_wake(&rate, monotonic_ns());
+            apply_sampling_rate(&rate, kernel_paced, base_buf.watermark, &poll_timeout);
+            log_info("%s, leaving deep idle", resumed ? "Resumed" : "Motion event");
+            continue;
+        }
+        
         if (poll_result == 0) {
+            if (kernel_paced) {
+                log_warn("No samples from hrtimer trigger within %d ms", poll_timeout);
+                continue;
+            }
             /* Timeout - trigger new samples */
             cmxd_trigger_iio_sampling();
             continue;
         }
         
-        /* Check for base sensor data */
+        /* Drain all queued base sensor scans */
         if (poll_fds[0].revents & POLLIN) {
-            int result = cmxd_read_iio_buffer_sample(&base_buf, &base_sample);
-            if (result < 0) {
+            base_count = drain_buffer(&base_buf, 0, base_batch);
+            if (base_count < 0) {
                 error_count++;
                 if (error_count >= max_errors) {
                     log_error("Too many consecutive base read errors (%u), exiting", error_count);
@@ -284,30 +949,30 @@ static int run_main_loop(void)
                 }
                 log_warn("Base read error %u/%u", error_count, max_errors);
                 continue;
-            } else if (result > 0) {
+            } else if (base_count > 0) {
+                const struct accel_sample *latest = &base_batch[base_count - 1];
+                
                 /* Apply actual scaling factor */
-                cmxd_apply_scale(base_sample.x, base_sample.y, base_sample.z, base_scale, 
+                cmxd_apply_scale(latest->x, latest->y, latest->z, base_scale, 
                            &base_xs, &base_ys, &base_zs);
                 
-                log_debug("Base: X=%d, Y=%d, Z=%d", base_sample.x, base_sample.y, base_sample.z);
-                
-                /* Write to kernel module */
-                if (cmxd_write_vector("base", base_xs, base_ys, base_zs) < 0) {
+                /* Write the newest vector of the batch to kernel module, if the policy wants it */
+                int base_vec[3] = { base_xs, base_ys, base_zs };
+                if (cmxd_mirror_want(&mirror, CMXD_MIRROR_BASE, base_vec) &&
+                    cmxd_write_vector("base", base_xs, base_ys, base_zs) < 0) {
                     log_error("Failed to write base vector to kernel module");
                     break;
                 }
                 
-                base_valid = 1;
-                
                 /* Reset error count on successful read */
                 error_count = 0;
             }
         }
         
-        /* Check for lid sensor data */
+        /* Drain all queued lid sensor scans */
         if (poll_fds[1].revents & POLLIN) {
-            int result = cmxd_read_iio_buffer_sample(&lid_buf, &lid_sample);
-            if (result < 0) {
+            lid_count = drain_buffer(&lid_buf, 1, lid_batch);
+            if (lid_count < 0) {
                 error_count++;
                 if (error_count >= max_errors) {
                     log_error("Too many consecutive lid read errors (%u), exiting", error_count);
@@ -315,136 +980,121 @@ static int run_main_loop(void)
                 }
                 log_warn("Lid read error %u/%u", error_count, max_errors);
                 continue;
-            } else if (result > 0) {
+            } else if (lid_count > 0) {
+                const struct accel_sample *latest = &lid_batch[lid_count - 1];
+                
                 /* Apply actual scaling factor */
-                cmxd_apply_scale(lid_sample.x, lid_sample.y, lid_sample.z, lid_scale,
+                cmxd_apply_scale(latest->x, latest->y, latest->z, lid_scale,
                            &lid_xs, &lid_ys, &lid_zs);
                 
-                log_debug("Lid: X=%d, Y=%d, Z=%d", lid_sample.x, lid_sample.y, lid_sample.z);
-                
-                /* Write to kernel module */
-                if (cmxd_write_vector("lid", lid_xs, lid_ys, lid_zs) < 0) {
+                /* Write the newest vector of the batch to kernel module, if the policy wants it */
+                int lid_vec[3] = { lid_xs, lid_ys, lid_zs };
+                if (cmxd_mirror_want(&mirror, CMXD_MIRROR_LID, lid_vec) &&
+                    cmxd_write_vector("lid", lid_xs, lid_ys, lid_zs) < 0) {
                     log_error("Failed to write lid vector to kernel module");
                     break;
                 }
                 
-                lid_valid = 1;
-                
                 /* Reset error count on successful read */
                 error_count = 0;
             }
         }
         
-        /* Process sensor data if we have valid readings from both sensors */
-        if (base_valid && lid_valid) {
-            /* Log sensor data in debug mode */
-            log_debug("Sensor data - Base: (%d,%d,%d), Lid: (%d,%d,%d)", 
-                     base_sample.x, base_sample.y, base_sample.z,
-                     lid_sample.x, lid_sample.y, lid_sample.z);
-
-            /* Calculate hinge angle for mode detection using 0-360° system */
-            double hinge_angle = cmxd_calculate_hinge_angle_360(&base_sample, &lid_sample, base_scale, lid_scale);
-            log_debug("HINGE: %.1f°", hinge_angle);
-            
-            /* Convert to m/s² for gravity confidence assessment */
-            double base_x_ms, base_y_ms, base_z_ms;
-            double lid_x_ms, lid_y_ms, lid_z_ms;
-            cmxd_convert_to_ms2(&base_sample, base_scale, &base_x_ms, &base_y_ms, &base_z_ms);
-            cmxd_convert_to_ms2(&lid_sample, lid_scale, &lid_x_ms, &lid_y_ms, &lid_z_ms);
-            
-            double base_mag = cmxd_calculate_magnitude(base_x_ms, base_y_ms, base_z_ms);
-            double lid_mag = cmxd_calculate_magnitude(lid_x_ms, lid_y_ms, lid_z_ms);
-            
-            /* Calculate raw hinge angle for orientation-based logic */
-            double raw_hinge_angle = cmxd_calculate_hinge_angle(&base_sample, &lid_sample, base_scale, lid_scale);
-            
-            /* Calculate horizontal acceleration properly for laptop orientation */
-            /* Base should be flat (X,Y small), lid orientation depends on RAW hinge angle */
-            double base_horizontal = cmxd_calculate_horizontal_magnitude(base_x_ms, base_y_ms);
-            
-            /* For lid horizontal calculation, consider expected orientation based on raw hinge angle */
-            double lid_horizontal;
-            if (raw_hinge_angle >= 70 && raw_hinge_angle <= 110) {
-                /* Laptop mode: lid is roughly vertical, X-axis reading is expected gravity */
-                /* Only Y and Z components indicate unexpected motion */
-                lid_horizontal = cmxd_calculate_horizontal_magnitude(lid_y_ms, lid_z_ms);
-            } else if (raw_hinge_angle >= 160) {
-                /* Flat/tent/tablet modes: lid orientation varies, use different calculation */
-                lid_horizontal = cmxd_calculate_horizontal_magnitude(lid_x_ms, lid_y_ms);
-            } else {
-                /* Transitional angles: use full calculation */
-                lid_horizontal = cmxd_calculate_horizontal_magnitude(lid_x_ms, lid_y_ms);
-            }
-            
-            double total_horizontal = base_horizontal + lid_horizontal;
-            
-            /* Detect device mode using stable mode detection with gravity confidence */
-            const char* device_mode = CMXD_PROTOCOL_MODE_LAPTOP;  /* Default fallback */
-            int orientation_code = 0;
-            if (hinge_angle >= 0) {
-                /* Get orientation code for mode detection */
-                orientation_code = cmxd_get_device_orientation(lid_sample.x, lid_sample.y, lid_sample.z);
-                device_mode = cmxd_get_stable_device_mode_with_gravity(hinge_angle, orientation_code, 
-                                                                     base_mag, lid_mag, total_horizontal);
-            }
-            /* Filter out indeterminate mode before writing to kernel module */
-            /* The kernel only accepts: "closing", "laptop", "flat", "tent", "tablet" */
-            static char last_kernel_mode[32] = CMXD_PROTOCOL_MODE_LAPTOP;
-            const char* kernel_mode = device_mode;
-            
-            if (strcmp(device_mode, CMXD_MODE_INDETERMINATE) == 0) {
-                /* Keep the last known good mode for kernel */
-                kernel_mode = last_kernel_mode;
-                log_debug("MODE: %s (indeterminate)", kernel_mode);
-                log_debug("KERNEL: Indeterminate detected - keeping last mode '%s' for kernel", kernel_mode);
-            } else {
-                /* Update last known good mode */
-                strncpy(last_kernel_mode, device_mode, sizeof(last_kernel_mode) - 1);
-                last_kernel_mode[sizeof(last_kernel_mode) - 1] = '\0';
-                log_debug("MODE: %s", device_mode);
-            }
-            log_debug("Hinge angle: %.1f°, device orientation: %d", hinge_angle, orientation_code);
-            
-            /* Detect orientation using dual-sensor switching based on actual device mode */
-            const char* orientation = cmxd_get_orientation_with_sensor_switching(
-                lid_sample.x, lid_sample.y, lid_sample.z,
-                base_sample.x, base_sample.y, base_sample.z, device_mode);
-            log_debug("Device mode: %s, Orientation: %s", kernel_mode, orientation);
-            
-            /* Write filtered mode to kernel module and send events */
-            if (cmxd_write_mode_with_events(kernel_mode) < 0) {
-                log_warn("Failed to write mode to kernel module");
-            }
-            
-            /* Write detected orientation to kernel module and send events */
-            if (cmxd_write_orientation_with_events(orientation) < 0) {
-                log_warn("Failed to write orientation to kernel module");
-            }
-            
-            /* Reset valid flags - we'll calculate again when new data arrives */
-            base_valid = 0;
-            lid_valid = 0;
+        /* Queue the batches and run every timestamp-matched pair through fusion */
+        cmxd_pairing_push(&pairing, CMXD_PAIR_BASE, base_batch, base_count);
+        cmxd_pairing_push(&pairing, CMXD_PAIR_LID, lid_batch, lid_count);
+        while (cmxd_pairing_next(&pairing, &base_sample, &lid_sample)) {
+            log_debug("Base: X=%d, Y=%d, Z=%d", base_sample.x, base_sample.y, base_sample.z);
+            log_debug("Lid: X=%d, Y=%d, Z=%d", lid_sample.x, lid_sample.y, lid_sample.z);
+            rate_changed |= process_sensor_pair(&base_sample, &lid_sample, base_scale, lid_scale, &rate);
+            have_pair = true;
         }
         
-        /* Check for poll errors */
-        if (poll_fds[0].revents & (POLLERR | POLLHUP | POLLNVAL)) {
-            log_error("Poll error on base buffer");
-            break;
+        /* One combined kernel write for this pass's vectors, mode and orientation */
+        uint64_t newest_ts = 0;
+        if (base_count > 0) newest_ts = base_batch[base_count - 1].timestamp;
+        if (lid_count > 0 && lid_batch[lid_count - 1].timestamp > newest_ts) {
+            newest_ts = lid_batch[lid_count - 1].timestamp;
         }
-        if (poll_fds[1].revents & (POLLERR | POLLHUP | POLLNVAL)) {
-            log_error("Poll error on lid buffer");
-            break;
+        if (cmxd_commit_state(newest_ts) < 0) {
+            log_warn("Failed to write state to kernel module");
+        }
+        
+        if (rate_changed) {
+            apply_sampling_rate(&rate, kernel_paced, base_buf.watermark, &poll_timeout);
+            rate_changed = false;
+        }
+        
+        /* Long stillness: stop sampling and sleep until a sensor event */
+        uint64_t now = monotonic_ns();
+        if (deep_idle_capable && have_pair &&
+            cmxd_rate_still_ns(&rate, now) >= (uint64_t)cfg.deep_idle_ms * 1000000ULL) {
+            if (enter_deep_idle(&base_buf, &lid_buf, &base_sample, &lid_sample, base_scale, lid_scale)) {
+                deep_idle = true;
+                poll_fds[0].fd = -1;
+                poll_fds[1].fd = -1;
+                poll_fds[2].fd = base_buf.event_fd;
+                poll_fds[3].fd = lid_buf.event_fd;
+                cmxd_rate_enter_deep_idle(&rate, now);
+                log_info("Still for %u ms, entering deep idle", cfg.deep_idle_ms);
+            } else {
+                log_warn("Failed to arm threshold events, deep idle disabled");
+                deep_idle_capable = false;
+            }
         }
     }
     
+    log_buffer_stats("Base", &base_buf);
+    log_buffer_stats("Lid", &lid_buf);
+    log_pairing_stats(&pairing);
+    log_rate_stats(&rate);
+    log_mirror_stats(&mirror);
+#ifdef ENABLE_IO_URING
+    if (cmxd_uring_active()) {
+        log_uring_stats(pairing.stats.pairs);
+    }
+    /* Flush queued writes before the buffers go away */
+    cmxd_uring_cleanup();
+#endif
+    
     log_info("Cleaning up IIO buffers...");
     cmxd_cleanup_iio_buffer(&base_buf);
     cmxd_cleanup_iio_buffer(&lid_buf);
+    cmxd_cleanup_iio_trigger();
     
     log_info("Event-driven main loop terminated");
     return 0;
 }
 
+/* Log the entries of the IIO devices directory, for startup diagnostics */
+static void log_iio_devices(const char *devices_path)
+{
+    struct dirent *entry;
+    int count = 0;
+    
+    DIR *dir = opendir(devices_path);
+    if (!dir) {
+        log_error("  Cannot list %s: %s", devices_path, strerror(errno));
+        return;
+    }
+    
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        if (count++ < 10) {
+            log_error("    %s", entry->d_name);
+        }
+    }
+    closedir(dir);
+    
+    if (count == 0) {
+        log_error("  No IIO devices in %s", devices_path);
+    } else if (count > 10) {
+        log_error("    ... and %d more", count - 10);
+    }
+}
+
 /* Load configuration from file */
 static int load_config_file(const char *config_path)
 {
@@ -489,6 +1139,69 @@ static int load_config_file(const char *config_path)
             if (timeout_ms > 0 && timeout_ms <= 10000) {
                 cfg.buffer_timeout_ms = (unsigned int)timeout_ms;
             }
+        } else if (strcmp(key, "BUFFER_LENGTH") == 0) {
+            unsigned long length = strtoul(value, NULL, 10);
+            if (length > 0 && length <= CMXD_IIO_MAX_BATCH) {
+                cfg.buffer_length = (int)length;
+            }
+        } else if (strcmp(key, "BUFFER_WATERMARK") == 0) {
+            unsigned long watermark = strtoul(value, NULL, 10);
+            if (watermark > 0 && watermark <= CMXD_IIO_MAX_BATCH) {
+                cfg.buffer_watermark = (int)watermark;
+            }
+        } else if (strcmp(key, "SAMPLING_FREQUENCY_HZ") == 0) {
+            unsigned long hz = strtoul(value, NULL, 10);
+            if (hz > 0 && hz <= CMXD_MAX_SAMPLING_HZ) {
+                cfg.sampling_hz = (unsigned int)hz;
+            }
+        } else if (strcmp(key, "PAIR_TOLERANCE_MS") == 0) {
+            unsigned long tolerance_ms = strtoul(value, NULL, 10);
+            if (tolerance_ms <= 1000) {
+                cfg.pair_tolerance_ms = (unsigned int)tolerance_ms;
+            }
+        } else if (strcmp(key, "PAIR_MAX_STALENESS_MS") == 0) {
+            unsigned long staleness_ms = strtoul(value, NULL, 10);
+            if (staleness_ms > 0 && staleness_ms <= 10000) {
+                cfg.pair_staleness_ms = (unsigned int)staleness_ms;
+            }
+        } else if (strcmp(key, "PAIR_INTERPOLATE") == 0) {
+            cfg.pair_interpolate = (strcmp(value, "0") != 0);
+        } else if (strcmp(key, "IDLE_SAMPLING_HZ") == 0) {
+            unsigned long hz = strtoul(value, NULL, 10);
+            if (hz <= CMXD_MAX_SAMPLING_HZ) {
+                cfg.idle_hz = (unsigned int)hz;
+            }
+        } else if (strcmp(key, "MOTION_THRESHOLD") == 0) {
+            double threshold = strtod(value, NULL);
+            if (threshold > 0.0 && threshold <= 10.0) {
+                cfg.motion_threshold = threshold;
+            }
+        } else if (strcmp(key, "ANGLE_THRESHOLD") == 0) {
+            double threshold = strtod(value, NULL);
+            if (threshold > 0.0 && threshold <= 90.0) {
+                cfg.angle_threshold = threshold;
+            }
+        } else if (strcmp(key, "IDLE_DELAY_MS") == 0) {
+            unsigned long delay_ms = strtoul(value, NULL, 10);
+            if (delay_ms <= 600000) {
+                cfg.idle_delay_ms = (unsigned int)delay_ms;
+            }
+        } else if (strcmp(key, "DEEP_IDLE_DELAY_MS") == 0) {
+            unsigned long delay_ms = strtoul(value, NULL, 10);
+            if (delay_ms <= 3600000) {
+                cfg.deep_idle_ms = (unsigned int)delay_ms;
+            }
+        } else if (strcmp(key, "TRIGGER") == 0) {
+            if (strcmp(value, "hrtimer") == 0) {
+                cfg.trigger_type = CMXD_TRIGGER_HRTIMER;
+            } else if (strcmp(value, "sysfs") == 0) {
+                cfg.trigger_type = CMXD_TRIGGER_SYSFS;
+            }
+        } else if (strcmp(key, "VECTOR_MIRROR") == 0) {
+            struct cmxd_mirror_config mirror;
+            if (cmxd_mirror_parse(value, &mirror) == 0) {
+                cfg.mirror = mirror;
+            }
         } else if (strcmp(key, "SYSFS_DIR") == 0) {
             strncpy(cfg.sysfs_path, value, sizeof(cfg.sysfs_path) - 1);
             cfg.sysfs_path[sizeof(cfg.sysfs_path) - 1] = '\0';
@@ -509,7 +1222,26 @@ static void usage(void)
     printf("\n");
     printf("Options:\n");
     printf("  -t, --timeout-ms MS      Buffer read timeout in milliseconds (default: %u)\n", cfg.buffer_timeout_ms);
+    printf("  -b, --buffer-length N    IIO buffer length in scans (default: %d, max: %d)\n",
+           cfg.buffer_length, CMXD_IIO_MAX_BATCH);
+    printf("  -w, --watermark N        Scans queued before each wakeup (default: %d)\n", cfg.buffer_watermark);
+    printf("  -f, --sampling-hz HZ     hrtimer trigger sampling frequency (default: %u)\n", cfg.sampling_hz);
+    printf("  -T, --trigger TYPE       Sampling trigger: hrtimer (the cmx module's if present) or sysfs (default: hrtimer)\n");
+    printf("  -i, --idle-hz HZ         Sampling rate while still, 0 for a fixed rate (default: %u)\n",
+           cfg.idle_hz);
+    printf("                           (motion after a still period is seen up to 1/HZ s late)\n");
+    printf("  -D, --deep-idle-ms MS    Stillness before sleeping on sensor events, 0 never (default: %u)\n",
+           cfg.deep_idle_ms);
+    printf("  -p, --pair-tolerance MS  Max base/lid timestamp skew for a match (default: %u)\n",
+           cfg.pair_tolerance_ms);
+    printf("  -S, --max-staleness MS   Max age of a last-known partner scan (default: %u)\n",
+           cfg.pair_staleness_ms);
+    printf("      --no-interpolate     Pair unmatched scans with last-known data only\n");
+    printf("  -M, --vector-mirror POL  Raw vectors written to the kernel: all, off, every[:N],\n");
+    printf("                           deadband[:M/S2] or on-demand (default: on-demand)\n");
+    printf("      --fixed-point        Fuse samples in integer arithmetic, as the kernel module does\n");
     printf("  -s, --sysfs-path PATH    Kernel module sysfs path (default: %s)\n", cfg.sysfs_path);
+    printf("  -R, --root DIR           Resolve /sys, /dev, /proc and /run under DIR (env: %s)\n", CMXD_ROOT_ENV);
     printf("  -v, --verbose            Verbose logging (shows all debug information)\n");
 #ifdef ENABLE_DBUS
     printf("      --no-dbus            Disable DBus event publishing\n");
@@ -520,6 +1252,8 @@ static void usage(void)
     printf("Examples:\n");
     printf("  %s                       # Use defaults with auto-detected devices\n", PROGRAM_NAME);
     printf("  %s -t 50 -v             # 50ms buffer timeout, verbose\n", PROGRAM_NAME);
+    printf("  %s -b 64 -w 8            # Drain up to 8 scans per wakeup\n", PROGRAM_NAME);
+    printf("  %s -f 50 -w 5            # 50 Hz kernel-paced sampling, 10 wakeups/s\n", PROGRAM_NAME);
 #ifdef ENABLE_DBUS
     printf("  %s --no-dbus             # Disable DBus support\n", PROGRAM_NAME);
 #endif
@@ -530,7 +1264,19 @@ static int parse_args(int argc, char **argv)
 {
     static struct option long_options[] = {
         {"timeout-ms",  required_argument, 0, 't'},
+        {"buffer-length", required_argument, 0, 'b'},
+        {"watermark",   required_argument, 0, 'w'},
+        {"sampling-hz", required_argument, 0, 'f'},
+        {"trigger",     required_argument, 0, 'T'},
+        {"idle-hz",     required_argument, 0, 'i'},
+        {"deep-idle-ms", required_argument, 0, 'D'},
+        {"pair-tolerance", required_argument, 0, 'p'},
+        {"max-staleness", required_argument, 0, 'S'},
+        {"no-interpolate", no_argument,    0, 1001},
+        {"vector-mirror", required_argument, 0, 'M'},
+        {"fixed-point", no_argument,       0, 1002},
         {"sysfs-path",  required_argument, 0, 's'},
+        {"root",        required_argument, 0, 'R'},
         {"verbose",     no_argument,       0, 'v'},
 #ifdef ENABLE_DBUS
         {"no-dbus",     no_argument,       0, 1000},
@@ -544,7 +1290,10 @@ static int parse_args(int argc, char **argv)
     char *endptr;
     unsigned long val;
     
-    while ((c = getopt_long(argc, argv, "t:s:vhV", long_options, NULL)) != -1) {
+    /* The environment sets the filesystem root; --root overrides it */
+    cmxd_paths_set_root(getenv(CMXD_ROOT_ENV));
+    
+    while ((c = getopt_long(argc, argv, "t:b:w:f:T:i:D:p:S:M:s:R:vhV", long_options, NULL)) != -1) {
         switch (c) {
             case 't':
                 errno = 0;
@@ -556,6 +1305,103 @@ static int parse_args(int argc, char **argv)
                 cfg.buffer_timeout_ms = (unsigned int)val;
                 break;
                 
+            case 'b':
+                errno = 0;
+                val = strtoul(optarg, &endptr, 10);
+                if (errno != 0 || endptr == optarg || val == 0 || val > CMXD_IIO_MAX_BATCH) {
+                    log_error("Invalid buffer length: %s (must be 1-%d scans)", optarg, CMXD_IIO_MAX_BATCH);
+                    return -1;
+                }
+                cfg.buffer_length = (int)val;
+                break;
+                
+            case 'w':
+                errno = 0;
+                val = strtoul(optarg, &endptr, 10);
+                if (errno != 0 || endptr == optarg || val == 0 || val > CMXD_IIO_MAX_BATCH) {
+                    log_error("Invalid watermark: %s (must be 1-%d scans)", optarg, CMXD_IIO_MAX_BATCH);
+                    return -1;
+                }
+                cfg.buffer_watermark = (int)val;
+                break;
+                
+            case 'f':
+                errno = 0;
+                val = strtoul(optarg, &endptr, 10);
+                if (errno != 0 || endptr == optarg || val == 0 || val > CMXD_MAX_SAMPLING_HZ) {
+                    log_error("Invalid sampling frequency: %s (must be 1-%d Hz)", optarg, CMXD_MAX_SAMPLING_HZ);
+                    return -1;
+                }
+                cfg.sampling_hz = (unsigned int)val;
+                break;
+                
+            case 'T':
+                if (strcmp(optarg, "hrtimer") == 0) {
+                    cfg.trigger_type = CMXD_TRIGGER_HRTIMER;
+                } else if (strcmp(optarg, "sysfs") == 0) {
+                    cfg.trigger_type = CMXD_TRIGGER_SYSFS;
+                } else {
+                    log_error("Invalid trigger type: %s (must be hrtimer or sysfs)", optarg);
+                    return -1;
+                }
+                break;
+                
+            case 'i':
+                errno = 0;
+                val = strtoul(optarg, &endptr, 10);
+                if (errno != 0 || endptr == optarg || val > CMXD_MAX_SAMPLING_HZ) {
+                    log_error("Invalid idle sampling frequency: %s (must be 0-%d Hz)", optarg, CMXD_MAX_SAMPLING_HZ);
+                    return -1;
+                }
+                cfg.idle_hz = (unsigned int)val;
+                break;
+                
+            case 'D':
+                errno = 0;
+                val = strtoul(optarg, &endptr, 10);
+                if (errno != 0 || endptr == optarg || val > 3600000) {
+                    log_error("Invalid deep idle delay: %s (must be 0-3600000 ms)", optarg);
+                    return -1;
+                }
+                cfg.deep_idle_ms = (unsigned int)val;
+                break;
+                
+            case 'p':
+                errno = 0;
+                val = strtoul(optarg, &endptr, 10);
+                if (errno != 0 || endptr == optarg || val > 1000) {
+                    log_error("Invalid pair tolerance: %s (must be 0-1000 ms)", optarg);
+                    return -1;
+                }
+                cfg.pair_tolerance_ms = (unsigned int)val;
+                break;
+                
+            case 'S':
+                errno = 0;
+                val = strtoul(optarg, &endptr, 10);
+                if (errno != 0 || endptr == optarg || val == 0 || val > 10000) {
+                    log_error("Invalid staleness bound: %s (must be 1-10000 ms)", optarg);
+                    return -1;
+                }
+                cfg.pair_staleness_ms = (unsigned int)val;
+                break;
+                
+            case 1001: /* --no-interpolate */
+                cfg.pair_interpolate = 0;
+                break;
+                
+            case 1002: /* --fixed-point */
+                cfg.fixed_point = 1;
+                break;
+                
+            case 'M':
+                if (cmxd_mirror_parse(optarg, &cfg.mirror) < 0) {
+                    log_error("Invalid vector mirror policy: %s (must be all, off, every[:N], "
+                              "deadband[:M/S2] or on-demand)", optarg);
+                    return -1;
+                }
+                break;
+                
             case 's':
                 if (strlen(optarg) >= sizeof(cfg.sysfs_path)) {
                     log_error("Sysfs path too long");
@@ -564,6 +1410,14 @@ static int parse_args(int argc, char **argv)
                 strcpy(cfg.sysfs_path, optarg);
                 break;
                 
+            case 'R':
+                if (strlen(optarg) >= PATH_MAX / 2) {
+                    log_error("Root path too long");
+                    return -1;
+                }
+                cmxd_paths_set_root(optarg);
+                break;
+                
             case 'v':
                 cfg.verbose = 1;
                 break;
@@ -597,6 +1451,31 @@ static int parse_args(int argc, char **argv)
     return 0;
 }
 
+/* Re-anchor the configured sysfs and socket paths under the filesystem root */
+static int resolve_root_paths(void)
+{
+    char path[PATH_MAX];
+    
+    if (!cmxd_paths_root()[0]) {
+        return 0;
+    }
+    
+    if (cmxd_path(path, sizeof(cfg.sysfs_path), "%s", cfg.sysfs_path) < 0) {
+        log_error("Sysfs path too long under root %s", cmxd_paths_root());
+        return -1;
+    }
+    strcpy(cfg.sysfs_path, path);
+    
+    if (cmxd_path(path, sizeof(cfg.unix_socket_path), "%s", cfg.unix_socket_path) < 0) {
+        log_error("Socket path too long under root %s", cmxd_paths_root());
+        return -1;
+    }
+    strcpy(cfg.unix_socket_path, path);
+    
+    log_info("Using filesystem root %s", cmxd_paths_root());
+    return 0;
+}
+
 /* Setup signal handlers */
 static int setup_signals(void)
 {
@@ -632,23 +1511,36 @@ int main(int argc, char **argv)
     }
     
     /* Load configuration file (may override some defaults) */
-    load_config_file(CMXD_DEFAULT_CONFIG_FILE);
+    char path[PATH_MAX];
+    cmxd_path(path, sizeof(path), CMXD_DEFAULT_CONFIG_FILE);
+    load_config_file(path);
+    
+    /* Configured paths are given as on a real system; move them under the root */
+    if (resolve_root_paths() < 0) {
+        return 1;
+    }
     
     /* Early validation: Check if IIO subsystem exists */
-    if (access(IIO_BASE_PATH, F_OK) != 0) {
-        log_error("IIO subsystem not found at %s", IIO_BASE_PATH);
+    cmxd_path(path, sizeof(path), IIO_BASE_PATH);
+    if (access(path, F_OK) != 0) {
+        log_error("IIO subsystem not found at %s", path);
         log_error("The Industrial I/O subsystem is required for accelerometer access");
         log_error("Make sure CONFIG_IIO is enabled in your kernel configuration");
         return 1;
     }
     
+    /* Device changes wake the startup waits below; without uevents they re-check periodically */
+    if (cmxd_discovery_open(log_msg) < 0) {
+        log_warn("Kernel uevents unavailable, device waits fall back to polling");
+    }
+    
     /* Wait for kernel module sysfs interface to be available */
     char sysfs_path[PATH_MAX];
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wformat-truncation"
     snprintf(sysfs_path, sizeof(sysfs_path), "%s/base_vec", cfg.sysfs_path);
 #pragma GCC diagnostic pop
-    if (cmxd_wait_for_path(sysfs_path, 2) < 0) {
+    if (cmxd_discovery_wait(path_ready, sysfs_path, DISCOVERY_TIMEOUT_MS) < 0) {
         log_error("Kernel module sysfs interface not found: %s", cfg.sysfs_path);
         log_error("The cmx kernel module does not appear to be loaded");
         log_error("To load the module: sudo modprobe cmx");
@@ -658,12 +1550,26 @@ int main(int argc, char **argv)
     
     /* Initialize data module - needed for device assignment reading */
     struct cmxd_data_config data_cfg = {
+        .buffer_length = cfg.buffer_length,
+        .buffer_watermark = cfg.buffer_watermark,
+        .trigger_type = cfg.trigger_type,
+        .sampling_hz = cfg.sampling_hz,
         .verbose = cfg.verbose
     };
     snprintf(data_cfg.sysfs_path, sizeof(data_cfg.sysfs_path), "%s", cfg.sysfs_path);
     cmxd_data_init(&data_cfg, log_msg);
     log_debug("Data module initialized");
     
+    /* A valid snapshot from a previous run replaces device discovery */
+    cmxd_cache_init(log_msg);
+    if (cmxd_cache_load(&cache) == 0) {
+        snprintf(cfg.base_dev, sizeof(cfg.base_dev), "%s", cache.base.name);
+        snprintf(cfg.lid_dev, sizeof(cfg.lid_dev), "%s", cache.lid.name);
+        cache_warm = true;
+        log_info("Using discovery cache: base=%s lid=%s trigger=%s",
+                 cfg.base_dev, cfg.lid_dev, cache.trigger_name[0] ? cache.trigger_name : "none");
+    }
+    
     /* Initialize event system */
     struct cmxd_events_config events_cfg = {
         .enable_unix_socket = cfg.enable_unix_socket,
@@ -679,9 +1585,16 @@ int main(int argc, char **argv)
     }
     log_debug("Event system initialized");
     
+    /* Republish the last known state so clients don't wait for the first samples */
+    if (cache_warm && cache.mode[0] && cache.orientation[0]) {
+        cmxd_write_mode_with_events(cache.mode);
+        cmxd_write_orientation_with_events(cache.orientation);
+        cmxd_commit_state(0);
+        log_info("Restored last state: mode=%s orientation=%s", cache.mode, cache.orientation);
+    }
+    
     /* Read device assignments from kernel module - REQUIRED */
-    if (cmxd_read_kernel_device_assignments(cfg.base_dev, sizeof(cfg.base_dev), 
-                                            cfg.lid_dev, sizeof(cfg.lid_dev)) < 0) {
+    if (!cache_warm && cmxd_discovery_wait(device_assignments_ready, NULL, DISCOVERY_TIMEOUT_MS) < 0) {
         log_error("Kernel device assignments not available - cannot continue");
         log_error("Make sure the kernel module is loaded and devices are detected");
         
@@ -690,17 +1603,20 @@ int main(int argc, char **argv)
         log_error("  Expected sysfs path: %s", cfg.sysfs_path);
         
         /* Check if any IIO devices exist at all */
-        if (access(IIO_DEVICES_PATH, F_OK) != 0) {
-            log_error("  No IIO subsystem found (%s missing)", IIO_DEVICES_PATH);
+        cmxd_path(path, sizeof(path), IIO_DEVICES_PATH);
+        if (access(path, F_OK) != 0) {
+            log_error("  No IIO subsystem found (%s missing)", path);
             log_error("  The IIO subsystem may not be enabled in the kernel");
         } else {
             log_error("  IIO subsystem exists, checking for devices...");
-            int result = system(IIO_DEVICES_LIST_CMD);
-            (void)result; /* Suppress unused result warning - diagnostic only */
+            log_iio_devices(path);
         }
         
         /* Check for accelerometer devices */
-        if (access(IIO_DEV_DEVICE0, F_OK) != 0 && access(IIO_DEV_DEVICE1, F_OK) != 0) {
+        char dev0[PATH_MAX], dev1[PATH_MAX];
+        cmxd_path(dev0, sizeof(dev0), IIO_DEV_DEVICE0);
+        cmxd_path(dev1, sizeof(dev1), IIO_DEV_DEVICE1);
+        if (access(dev0, F_OK) != 0 && access(dev1, F_OK) != 0) {
             log_error("  No IIO character devices found (%s)", IIO_DEV_CHAR_MSG);
             log_error("  Try: %s", IIO_DEV_LIST_CMD);
         }
@@ -709,16 +1625,10 @@ int main(int argc, char **argv)
     }
     
     /* Wait for devices to be ready */
-    char base_path[PATH_MAX], lid_path[PATH_MAX];
-    snprintf(base_path, sizeof(base_path), IIO_ACCEL_X_RAW_TEMPLATE, cfg.base_dev);
-    if (cmxd_wait_for_path(base_path, 2) < 0) {
-        log_error("Base IIO device not ready: %s", cfg.base_dev);
-        return 1;
-    }
-    
-    snprintf(lid_path, sizeof(lid_path), IIO_ACCEL_X_RAW_TEMPLATE, cfg.lid_dev);
-    if (cmxd_wait_for_path(lid_path, 2) < 0) {
-        log_error("Lid IIO device not ready: %s", cfg.lid_dev);
+    if (!cache_warm && cmxd_discovery_wait(sensors_ready, NULL, DISCOVERY_TIMEOUT_MS) < 0) {
+        log_error("IIO devices not ready: base=%s (%s) lid=%s (%s)",
+                  cfg.base_dev, cmxd_iio_device_ready(cfg.base_dev) ? "ok" : "missing",
+                  cfg.lid_dev, cmxd_iio_device_ready(cfg.lid_dev) ? "ok" : "missing");
         return 1;
     }
     
@@ -728,8 +1638,13 @@ int main(int argc, char **argv)
     }
     
     log_info("Starting %s %s", PROGRAM_NAME, VERSION);
-    log_info("Configuration: base=%s lid=%s timeout=%ums sysfs=%s", 
-             cfg.base_dev, cfg.lid_dev, cfg.buffer_timeout_ms, cfg.sysfs_path);
+    log_info("Configuration: base=%s lid=%s timeout=%ums buffer=%d watermark=%d trigger=%s@%uHz idle=%uHz "
+             "pairing=%ums/%ums%s sysfs=%s", 
+             cfg.base_dev, cfg.lid_dev, cfg.buffer_timeout_ms,
+             cfg.buffer_length, cfg.buffer_watermark,
+             cfg.trigger_type == CMXD_TRIGGER_HRTIMER ? "hrtimer" : "sysfs",
+             cfg.sampling_hz, cfg.idle_hz, cfg.pair_tolerance_ms, cfg.pair_staleness_ms,
+             cfg.pair_interpolate ? "+interp" : "", cfg.sysfs_path);
     
     /* Validate paths */
     if (cmxd_validate_paths(cfg.base_dev, cfg.lid_dev) < 0) {
@@ -753,6 +1668,10 @@ int main(int argc, char **argv)
     cmxd_calculations_set_log_debug(log_debug_callback);
     log_debug("Calculations module initialized");
     
+    if (cfg.fixed_point) {
+        log_info("Fixed-point fusion enabled");
+    }
+    
     /* Run main loop */
     int ret = run_main_loop();
     